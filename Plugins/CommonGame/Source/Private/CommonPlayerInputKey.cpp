@@ -6,12 +6,12 @@
 #include "CommonInputTypeEnum.h"
 #include "CommonLocalPlayer.h"
 #include "CommonPlayerController.h"
+#include "CommonUIAnimationSubsystem.h"
 #include "Fonts/FontMeasure.h"
 #include "Framework/Application/SlateApplication.h"
 #include "Materials/Material.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Rendering/SlateRenderer.h"
-#include "TimerManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonPlayerInputKey)
 
@@ -23,6 +23,8 @@ class FSlateRect;
 DECLARE_LOG_CATEGORY_EXTERN(LogCommonPlayerInput, Log, All);
 DEFINE_LOG_CATEGORY(LogCommonPlayerInput);
 
+static const FName NAME_HoldProgressAnimation(TEXT("HoldProgress"));
+
 struct FSlateDrawUtil
 {
 	static void DrawBrushCenterFit(
@@ -122,6 +124,11 @@ void UCommonPlayerInputKey::NativeConstruct()
 
 void UCommonPlayerInputKey::NativeDestruct()
 {
+	if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
+	{
+		AnimationSubsystem->StopAllAnimations(this);
+	}
+
 	if (ProgressPercentageMID)
 	{
 		// Need to restore the material on the brush before we kill off the MID.
@@ -225,7 +232,13 @@ void UCommonPlayerInputKey::StartHoldProgress(FName HoldActionName, float HoldDu
 		HoldKeybindDuration = HoldDuration;
 		HoldKeybindStartTime = GetWorld()->GetRealTimeSeconds();
 
-		UpdateHoldProgress();
+		UpdateHoldProgress(0.f);
+
+		// Progress is advanced by the shared UI animation pass rather than a per-widget timer.
+		if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
+		{
+			AnimationSubsystem->PlayAnimation(this, NAME_HoldProgressAnimation, FCommonUIAnimationUpdate::CreateUObject(this, &ThisClass::UpdateHoldProgress));
+		}
 	}
 }
 
@@ -236,6 +249,11 @@ void UCommonPlayerInputKey::StopHoldProgress(FName HoldActionName, bool bComplet
 		HoldKeybindStartTime = 0.f;
 		HoldKeybindDuration = 0.f;
 
+		if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
+		{
+			AnimationSubsystem->StopAnimation(this, NAME_HoldProgressAnimation);
+		}
+
 		if (ensure(ProgressPercentageMID))
 		{
 			ProgressPercentageMID->SetScalarParameterValue(PercentageMaterialParameterName, 0.f);
@@ -259,12 +277,13 @@ void UCommonPlayerInputKey::SyncHoldProgress()
 	}
 }
 
-void UCommonPlayerInputKey::UpdateHoldProgress()
+bool UCommonPlayerInputKey::UpdateHoldProgress(float InElapsedTime)
 {
+	bool bHoldInProgress = false;
+
 	if (HoldKeybindStartTime != 0.f && HoldKeybindDuration > 0.f)
 	{
-		const float CurrentTime = GetWorld()->GetRealTimeSeconds();
-		const float ElapsedTime = FMath::Min(CurrentTime - HoldKeybindStartTime, HoldKeybindDuration);
+		const float ElapsedTime = FMath::Min(InElapsedTime, HoldKeybindDuration);
 		const float RemainingTime = FMath::Max(0.0f, HoldKeybindDuration - ElapsedTime);
 
 		if (ElapsedTime < HoldKeybindDuration && ensure(ProgressPercentageMID))
@@ -272,8 +291,7 @@ void UCommonPlayerInputKey::UpdateHoldProgress()
 			const float HoldKeybindPercentage = ElapsedTime / HoldKeybindDuration;
 			ProgressPercentageMID->SetScalarParameterValue(PercentageMaterialParameterName, HoldKeybindPercentage);
 
-			// Schedule a callback for next tick to update the hold progress again.
-			GetWorld()->GetTimerManager().SetTimerForNextTick(this, &ThisClass::UpdateHoldProgress);		
+			bHoldInProgress = true;
 		}
 
 		if (bShowTimeCountDown)
@@ -288,6 +306,8 @@ void UCommonPlayerInputKey::UpdateHoldProgress()
 			RecalculateDesiredSize();
 		}
 	}
+
+	return bHoldInProgress;
 }
 
 void UCommonPlayerInputKey::UpdateKeybindWidget()
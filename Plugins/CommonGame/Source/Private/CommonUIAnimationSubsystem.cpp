@@ -0,0 +1,145 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CommonUIAnimationSubsystem.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonUIAnimationSubsystem)
+
+UCommonUIAnimationSubsystem* UCommonUIAnimationSubsystem::Get(const UObject* WorldContextObject)
+{
+	if (const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr)
+	{
+		return World->GetSubsystem<UCommonUIAnimationSubsystem>();
+	}
+	return nullptr;
+}
+
+void UCommonUIAnimationSubsystem::PlayAnimation(const UObject* Owner, FName Channel, FCommonUIAnimationUpdate&& Update)
+{
+	check(Owner);
+
+	const int32 ExistingIndex = FindAnimationIndex(Owner, Channel);
+	FActiveAnimation& Animation = (ExistingIndex != INDEX_NONE) ? ActiveAnimations[ExistingIndex] : ActiveAnimations.AddDefaulted_GetRef();
+	Animation.Owner = Owner;
+	Animation.Channel = Channel;
+	Animation.StartTime = GetCurrentTime();
+	Animation.Update = MoveTemp(Update);
+}
+
+void UCommonUIAnimationSubsystem::StopAnimation(const UObject* Owner, FName Channel)
+{
+	const int32 Index = FindAnimationIndex(Owner, Channel);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (bIsUpdating)
+	{
+		ActiveAnimations[Index].Update.Unbind();
+	}
+	else
+	{
+		ActiveAnimations.RemoveAtSwap(Index, EAllowShrinking::No);
+	}
+}
+
+void UCommonUIAnimationSubsystem::StopAllAnimations(const UObject* Owner)
+{
+	for (int32 Index = ActiveAnimations.Num() - 1; Index >= 0; --Index)
+	{
+		if (ActiveAnimations[Index].Owner.Get() == Owner)
+		{
+			if (bIsUpdating)
+			{
+				ActiveAnimations[Index].Update.Unbind();
+			}
+			else
+			{
+				ActiveAnimations.RemoveAtSwap(Index, EAllowShrinking::No);
+			}
+		}
+	}
+}
+
+bool UCommonUIAnimationSubsystem::IsAnimationPlaying(const UObject* Owner, FName Channel) const
+{
+	const int32 Index = FindAnimationIndex(Owner, Channel);
+	return Index != INDEX_NONE && ActiveAnimations[Index].Update.IsBound();
+}
+
+void UCommonUIAnimationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double CurrentTime = GetCurrentTime();
+
+	{
+		TGuardValue<bool> UpdatingGuard(bIsUpdating, true);
+
+		// Animations started from inside an update begin next frame.
+		const int32 NumToUpdate = ActiveAnimations.Num();
+		for (int32 Index = 0; Index < NumToUpdate; ++Index)
+		{
+			FActiveAnimation& Animation = ActiveAnimations[Index];
+			if (!Animation.Owner.IsValid() || !Animation.Update.IsBound())
+			{
+				Animation.Update.Unbind();
+				continue;
+			}
+
+			const double StartTime = Animation.StartTime;
+			const bool bKeepRunning = Animation.Update.Execute(static_cast<float>(CurrentTime - StartTime));
+
+			// The update may have added entries (reallocating the array) or restarted its own channel.
+			FActiveAnimation& UpdatedAnimation = ActiveAnimations[Index];
+			if (!bKeepRunning && UpdatedAnimation.StartTime == StartTime)
+			{
+				UpdatedAnimation.Update.Unbind();
+			}
+		}
+	}
+
+	ActiveAnimations.RemoveAllSwap([](const FActiveAnimation& Animation)
+	{
+		return !Animation.Update.IsBound();
+	}, EAllowShrinking::No);
+}
+
+bool UCommonUIAnimationSubsystem::IsTickable() const
+{
+	return ActiveAnimations.Num() > 0;
+}
+
+TStatId UCommonUIAnimationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCommonUIAnimationSubsystem, STATGROUP_Tickables);
+}
+
+bool UCommonUIAnimationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCommonUIAnimationSubsystem::Deinitialize()
+{
+	ActiveAnimations.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UCommonUIAnimationSubsystem::FindAnimationIndex(const UObject* Owner, FName Channel) const
+{
+	return ActiveAnimations.IndexOfByPredicate([Owner, Channel](const FActiveAnimation& Animation)
+	{
+		return Animation.Channel == Channel && Animation.Owner.Get() == Owner;
+	});
+}
+
+double UCommonUIAnimationSubsystem::GetCurrentTime() const
+{
+	const UWorld* World = GetWorld();
+	return World ? World->GetRealTimeSeconds() : 0.0;
+}
@@ -200,8 +200,11 @@ private:
 	 */
 	UE_API void SyncHoldProgress();
 
-	/** Called for updating the HoldKeybindImage during a hold keybind */
-	UE_API void UpdateHoldProgress();
+	/**
+	 * Called for updating the HoldKeybindImage during a hold keybind.
+	 * Driven by UCommonUIAnimationSubsystem; returns false once the hold has finished.
+	 */
+	UE_API bool UpdateHoldProgress(float ElapsedTime);
 
 	/** Called when we want to set up this keybind widget as a hold keybind */
 	UE_API void SetupHoldKeybind();
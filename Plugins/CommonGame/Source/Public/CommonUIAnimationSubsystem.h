@@ -0,0 +1,80 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "CommonUIAnimationSubsystem.generated.h"
+
+#define UE_API COMMONGAME_API
+
+class UObject;
+
+/**
+ * Called once per frame while an animation is active.
+ * Receives the real time in seconds since the animation started; return false to finish it.
+ */
+DECLARE_DELEGATE_RetVal_OneParam(bool, FCommonUIAnimationUpdate, float /*ElapsedTime*/);
+
+/**
+ * Drives cosmetic UI animations (pulses, click feedback, hold progress) in a single batched
+ * pass per frame, so widgets can stay tick-free while they are not animating.
+ *
+ * Animations are keyed by (owner, channel); playing an animation on a channel that is already
+ * running restarts it. The subsystem only ticks while at least one animation is registered, and
+ * entries whose owner has been garbage collected are dropped automatically.
+ */
+UCLASS(MinimalAPI)
+class UCommonUIAnimationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UE_API UCommonUIAnimationSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Starts (or restarts) the animation on the given owner/channel. */
+	UE_API void PlayAnimation(const UObject* Owner, FName Channel, FCommonUIAnimationUpdate&& Update);
+
+	/** Stops the animation on the given owner/channel without a final update. */
+	UE_API void StopAnimation(const UObject* Owner, FName Channel);
+
+	/** Stops every animation registered by the given owner. */
+	UE_API void StopAllAnimations(const UObject* Owner);
+
+	UE_API bool IsAnimationPlaying(const UObject* Owner, FName Channel) const;
+
+	int32 GetNumActiveAnimations() const { return ActiveAnimations.Num(); }
+
+	//~FTickableGameObject interface
+	UE_API virtual void Tick(float DeltaTime) override;
+	UE_API virtual bool IsTickable() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	UE_API virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+protected:
+	//~UWorldSubsystem interface
+	UE_API virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	UE_API virtual void Deinitialize() override;
+	//~End of UWorldSubsystem interface
+
+private:
+	struct FActiveAnimation
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		FName Channel;
+		double StartTime = 0.0;
+		FCommonUIAnimationUpdate Update;
+	};
+
+	int32 FindAnimationIndex(const UObject* Owner, FName Channel) const;
+
+	double GetCurrentTime() const;
+
+	TArray<FActiveAnimation> ActiveAnimations;
+
+	/** Set while updates are running; stopped entries are unbound and compacted after the pass. */
+	bool bIsUpdating = false;
+};
+
+#undef UE_API
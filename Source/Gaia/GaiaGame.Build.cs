@@ -69,5 +69,11 @@ public class GaiaGame : ModuleRules
 				"GameplayCameras"
 			});
 		
+		// 烘焙时生成服务器定义数据库
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("UnrealEd");
+		}
+		
 	}
 }
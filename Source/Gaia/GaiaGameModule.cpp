@@ -1,14 +1,38 @@
 #include "Modules/ModuleManager.h"
 
+#if WITH_EDITOR
+#include "CookOnTheSide/CookOnTheFlyServer.h"
+#include "Gameplay/Inventory/GaiaDefinitionBlobCommandlet.h"
+#include "GaiaLogChannels.h"
+#endif
+
 class FGaiaGameModule : public FDefaultGameModuleImpl
 {
 	virtual void StartupModule() override
 	{
+#if WITH_EDITOR
+		// 烘焙开始前重新生成服务器定义数据库，保证打包的文件与数据表一致
+		CookStartedHandle = UE::Cook::FDelegates::CookByTheBookStarted.AddLambda([](UE::Cook::ICookInfo&)
+		{
+			FString Error;
+			if (!UGaiaDefinitionBlobCommandlet::GenerateDefinitionDatabase(UGaiaDefinitionBlobCommandlet::GetDefaultOutputPath(), Error))
+			{
+				UE_LOG(LogGaia, Error, TEXT("[定义数据库] 烘焙时生成失败: %s"), *Error);
+			}
+		});
+#endif
 	}
 
 	virtual void ShutdownModule() override
 	{
+#if WITH_EDITOR
+		UE::Cook::FDelegates::CookByTheBookStarted.Remove(CookStartedHandle);
+#endif
 	}
+
+#if WITH_EDITOR
+	FDelegateHandle CookStartedHandle;
+#endif
 };
 
 IMPLEMENT_PRIMARY_GAME_MODULE(FGaiaGameModule, GaiaGame, "GaiaGame");
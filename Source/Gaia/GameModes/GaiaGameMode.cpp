@@ -1,4 +1,6 @@
 #include "GaiaGameMode.h"
+#include "GameFramework/PlayerController.h"
+#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaGameMode)
 
@@ -6,3 +8,25 @@ AGaiaGameMode::AGaiaGameMode(const FObjectInitializer& ObjectInitializer)
 : Super(ObjectInitializer)
 {
 }
+
+void AGaiaGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	// 加载玩家的库存分片（PostLogin 时 PlayerState 的 UniqueId 已经有效）
+	if (UGaiaInventorySubsystem* InventorySystem = UGaiaInventorySubsystem::Get(this))
+	{
+		InventorySystem->HandlePlayerLogin(NewPlayer);
+	}
+}
+
+void AGaiaGameMode::Logout(AController* Exiting)
+{
+	// 保存并移出玩家的库存分片
+	if (UGaiaInventorySubsystem* InventorySystem = UGaiaInventorySubsystem::Get(this))
+	{
+		InventorySystem->HandlePlayerLogout(Cast<APlayerController>(Exiting));
+	}
+
+	Super::Logout(Exiting);
+}
@@ -12,5 +12,10 @@ class AGaiaGameMode : public AModularGameModeBase
 
 public:
 	UE_API AGaiaGameMode(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	//~AGameModeBase interface
+	UE_API virtual void PostLogin(APlayerController* NewPlayer) override;
+	UE_API virtual void Logout(AController* Exiting) override;
+	//~End of AGameModeBase interface
 };
 #undef UE_API
\ No newline at end of file
@@ -0,0 +1,17 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaCraftingRecipe.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaCraftingRecipe)
+
+void UGaiaCraftingRecipe::GetRequirements(TMap<FName, int32>& OutRequirements) const
+{
+	OutRequirements.Reset();
+	for (const FGaiaItemGrant& Ingredient : Ingredients)
+	{
+		if (!Ingredient.ItemDefinitionID.IsNone() && Ingredient.Quantity > 0)
+		{
+			OutRequirements.FindOrAdd(Ingredient.ItemDefinitionID) += Ingredient.Quantity;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaCraftingRecipe.generated.h"
+
+/**
+ * 制作配方
+ * 消耗 Ingredients，产出 Outputs；可制作次数由 UGaiaCraftingSubsystem 按容器树的定义数量增量维护，
+ * 执行时交给 UGaiaInventorySubsystem::ExchangeItems 一次性扣除和发放
+ */
+UCLASS(BlueprintType, Const)
+class GAIAGAME_API UGaiaCraftingRecipe : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * 合并同一物品的多个材料条目
+	 * @param OutRequirements 输出：物品定义 -> 每次制作需要的数量
+	 */
+	void GetRequirements(TMap<FName, int32>& OutRequirements) const;
+
+public:
+	/** 显示名称 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting")
+	FText DisplayName;
+
+	/** 每次制作消耗的材料 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting", meta = (TitleProperty = "ItemDefinitionID"))
+	TArray<FGaiaItemGrant> Ingredients;
+
+	/** 每次制作的产出 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Crafting", meta = (TitleProperty = "ItemDefinitionID"))
+	TArray<FGaiaItemGrant> Outputs;
+};
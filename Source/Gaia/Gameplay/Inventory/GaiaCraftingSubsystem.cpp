@@ -0,0 +1,317 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaCraftingSubsystem.h"
+#include "GaiaCraftingRecipe.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaLogChannels.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaCraftingSubsystem)
+
+void UGaiaCraftingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	InventorySubsystem = Collection.InitializeDependency<UGaiaInventorySubsystem>();
+	if (InventorySubsystem)
+	{
+		CountsChangedHandle = InventorySubsystem->OnRootDefinitionCountsChanged.AddUObject(this, &ThisClass::HandleRootDefinitionCountsChanged);
+		CountsResetHandle = InventorySubsystem->OnRootDefinitionCountsReset.AddUObject(this, &ThisClass::HandleRootDefinitionCountsReset);
+	}
+
+	for (const TSoftObjectPtr<UGaiaCraftingRecipe>& RecipePtr : GetDefault<UGaiaInventoryManagerSettings>()->CraftingRecipes)
+	{
+		if (UGaiaCraftingRecipe* Recipe = RecipePtr.LoadSynchronous())
+		{
+			RegisterRecipe(Recipe);
+		}
+		else if (!RecipePtr.IsNull())
+		{
+			UE_LOG(LogGaia, Warning, TEXT("[制作] 无法加载配方: %s"), *RecipePtr.ToString());
+		}
+	}
+
+	UE_LOG(LogGaia, Log, TEXT("[制作] 初始化完成: %d 个配方"), Recipes.Num());
+}
+
+void UGaiaCraftingSubsystem::Deinitialize()
+{
+	if (InventorySubsystem)
+	{
+		InventorySubsystem->OnRootDefinitionCountsChanged.Remove(CountsChangedHandle);
+		InventorySubsystem->OnRootDefinitionCountsReset.Remove(CountsResetHandle);
+		InventorySubsystem = nullptr;
+	}
+
+	WatchedTrees.Empty();
+	IngredientRecipes.Empty();
+	RecipeRequirements.Empty();
+	Recipes.Empty();
+
+	Super::Deinitialize();
+}
+
+UGaiaCraftingSubsystem* UGaiaCraftingSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UGaiaCraftingSubsystem>() : nullptr;
+}
+
+// ========================================
+// 配方
+// ========================================
+
+int32 UGaiaCraftingSubsystem::RegisterRecipe(UGaiaCraftingRecipe* Recipe)
+{
+	if (!Recipe)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = FindRecipeIndex(Recipe);
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	const int32 RecipeIndex = Recipes.Add(Recipe);
+
+	TMap<FName, int32> Requirements;
+	Recipe->GetRequirements(Requirements);
+	FRecipeRequirements& Entry = RecipeRequirements.AddDefaulted_GetRef();
+	for (const auto& RequirementPair : Requirements)
+	{
+		Entry.Items.Emplace(RequirementPair.Key, RequirementPair.Value);
+		IngredientRecipes.FindOrAdd(RequirementPair.Key).Add(RecipeIndex);
+	}
+
+	if (Requirements.IsEmpty())
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[制作] 配方 %s 没有材料，不会出现在可制作集合中"), *GetNameSafe(Recipe));
+	}
+
+	// 已关注的容器树补上新配方
+	for (auto& TreePair : WatchedTrees)
+	{
+		const int32 Count = ComputeCraftableCount(TreePair.Key, RecipeIndex);
+		TreePair.Value.CraftableCounts.Add(Count);
+		TreePair.Value.CraftableSet.Add(Count > 0);
+		if (Count > 0)
+		{
+			OnCraftableSetChanged.Broadcast(TreePair.Key, { RecipeIndex });
+		}
+	}
+
+	return RecipeIndex;
+}
+
+int32 UGaiaCraftingSubsystem::FindRecipeIndex(const UGaiaCraftingRecipe* Recipe) const
+{
+	return Recipes.IndexOfByKey(Recipe);
+}
+
+UGaiaCraftingRecipe* UGaiaCraftingSubsystem::GetRecipe(int32 RecipeIndex) const
+{
+	return Recipes.IsValidIndex(RecipeIndex) ? Recipes[RecipeIndex].Get() : nullptr;
+}
+
+// ========================================
+// 可制作集合
+// ========================================
+
+void UGaiaCraftingSubsystem::WatchContainerTree(const FGuid& RootContainerUID)
+{
+	if (!RootContainerUID.IsValid() || WatchedTrees.Contains(RootContainerUID))
+	{
+		return;
+	}
+
+	FWatchedTree& Tree = WatchedTrees.Add(RootContainerUID);
+	Tree.CraftableCounts.SetNumUninitialized(Recipes.Num());
+	Tree.CraftableSet.Init(false, Recipes.Num());
+	for (int32 RecipeIndex = 0; RecipeIndex < Recipes.Num(); ++RecipeIndex)
+	{
+		const int32 Count = ComputeCraftableCount(RootContainerUID, RecipeIndex);
+		Tree.CraftableCounts[RecipeIndex] = Count;
+		Tree.CraftableSet[RecipeIndex] = Count > 0;
+	}
+}
+
+void UGaiaCraftingSubsystem::UnwatchContainerTree(const FGuid& RootContainerUID)
+{
+	WatchedTrees.Remove(RootContainerUID);
+}
+
+int32 UGaiaCraftingSubsystem::GetCraftableCount(const FGuid& RootContainerUID, const UGaiaCraftingRecipe* Recipe) const
+{
+	const int32 RecipeIndex = FindRecipeIndex(Recipe);
+	if (RecipeIndex == INDEX_NONE)
+	{
+		return 0;
+	}
+
+	if (const FWatchedTree* Tree = WatchedTrees.Find(RootContainerUID))
+	{
+		return Tree->CraftableCounts[RecipeIndex];
+	}
+	return ComputeCraftableCount(RootContainerUID, RecipeIndex);
+}
+
+void UGaiaCraftingSubsystem::GetCraftableRecipes(const FGuid& RootContainerUID, TArray<UGaiaCraftingRecipe*>& OutRecipes) const
+{
+	OutRecipes.Reset();
+	if (const FWatchedTree* Tree = WatchedTrees.Find(RootContainerUID))
+	{
+		for (TConstSetBitIterator<> It(Tree->CraftableSet); It; ++It)
+		{
+			OutRecipes.Add(Recipes[It.GetIndex()]);
+		}
+	}
+}
+
+const TBitArray<>* UGaiaCraftingSubsystem::FindCraftableSet(const FGuid& RootContainerUID) const
+{
+	const FWatchedTree* Tree = WatchedTrees.Find(RootContainerUID);
+	return Tree ? &Tree->CraftableSet : nullptr;
+}
+
+int32 UGaiaCraftingSubsystem::ComputeCraftableCount(const FGuid& RootContainerUID, int32 RecipeIndex) const
+{
+	const FRecipeRequirements& Requirements = RecipeRequirements[RecipeIndex];
+	if (!InventorySubsystem || Requirements.Items.IsEmpty())
+	{
+		return 0;
+	}
+
+	const TMap<FName, int32>* RootCounts = InventorySubsystem->FindRootDefinitionCounts(RootContainerUID);
+	if (!RootCounts)
+	{
+		return 0;
+	}
+
+	int32 Craftable = MAX_int32;
+	for (const TPair<FName, int32>& Requirement : Requirements.Items)
+	{
+		const int32* Count = RootCounts->Find(Requirement.Key);
+		Craftable = FMath::Min(Craftable, Count ? *Count / Requirement.Value : 0);
+		if (Craftable == 0)
+		{
+			break;
+		}
+	}
+	return Craftable;
+}
+
+void UGaiaCraftingSubsystem::HandleRootDefinitionCountsChanged(const FGuid& RootContainerUID, const TArray<FName>& ChangedDefinitionIDs)
+{
+	FWatchedTree* Tree = WatchedTrees.Find(RootContainerUID);
+	if (!Tree)
+	{
+		return;
+	}
+
+	// 只重算用到变化定义的配方，每个配方最多一次
+	TBitArray<> Visited(false, Recipes.Num());
+	TArray<int32> ChangedRecipeIndices;
+	for (const FName& ItemDefID : ChangedDefinitionIDs)
+	{
+		const TArray<int32>* RecipeIndices = IngredientRecipes.Find(ItemDefID);
+		if (!RecipeIndices)
+		{
+			continue;
+		}
+
+		for (const int32 RecipeIndex : *RecipeIndices)
+		{
+			if (Visited[RecipeIndex])
+			{
+				continue;
+			}
+			Visited[RecipeIndex] = true;
+
+			const int32 Count = ComputeCraftableCount(RootContainerUID, RecipeIndex);
+			if (Count != Tree->CraftableCounts[RecipeIndex])
+			{
+				Tree->CraftableCounts[RecipeIndex] = Count;
+				Tree->CraftableSet[RecipeIndex] = Count > 0;
+				ChangedRecipeIndices.Add(RecipeIndex);
+			}
+		}
+	}
+
+	if (!ChangedRecipeIndices.IsEmpty())
+	{
+		OnCraftableSetChanged.Broadcast(RootContainerUID, ChangedRecipeIndices);
+	}
+}
+
+void UGaiaCraftingSubsystem::HandleRootDefinitionCountsReset()
+{
+	for (auto& TreePair : WatchedTrees)
+	{
+		TArray<int32> ChangedRecipeIndices;
+		for (int32 RecipeIndex = 0; RecipeIndex < Recipes.Num(); ++RecipeIndex)
+		{
+			const int32 Count = ComputeCraftableCount(TreePair.Key, RecipeIndex);
+			if (Count != TreePair.Value.CraftableCounts[RecipeIndex])
+			{
+				TreePair.Value.CraftableCounts[RecipeIndex] = Count;
+				TreePair.Value.CraftableSet[RecipeIndex] = Count > 0;
+				ChangedRecipeIndices.Add(RecipeIndex);
+			}
+		}
+
+		if (!ChangedRecipeIndices.IsEmpty())
+		{
+			OnCraftableSetChanged.Broadcast(TreePair.Key, ChangedRecipeIndices);
+		}
+	}
+}
+
+// ========================================
+// 制作
+// ========================================
+
+bool UGaiaCraftingSubsystem::Craft(const FGuid& RootContainerUID, UGaiaCraftingRecipe* Recipe, int32 Times, FGaiaGrantResult& OutGrantResult)
+{
+	OutGrantResult = FGaiaGrantResult();
+
+	const int32 RecipeIndex = FindRecipeIndex(Recipe);
+	if (RecipeIndex == INDEX_NONE || !InventorySubsystem)
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[制作] 配方未注册: %s"), *GetNameSafe(Recipe));
+		return false;
+	}
+
+	const int32 CraftTimes = FMath::Min(Times, ComputeCraftableCount(RootContainerUID, RecipeIndex));
+	if (CraftTimes <= 0)
+	{
+		return false;
+	}
+
+	TArray<FGaiaItemGrant> Costs;
+	for (const TPair<FName, int32>& Requirement : RecipeRequirements[RecipeIndex].Items)
+	{
+		Costs.Emplace(Requirement.Key, Requirement.Value * CraftTimes);
+	}
+
+	TArray<FGaiaItemGrant> Grants;
+	for (const FGaiaItemGrant& Output : Recipe->Outputs)
+	{
+		if (!Output.ItemDefinitionID.IsNone() && Output.Quantity > 0)
+		{
+			Grants.Emplace(Output.ItemDefinitionID, Output.Quantity * CraftTimes);
+		}
+	}
+
+	// 扣除和发放在同一次修改中完成，可制作次数随修改结束的数量广播更新
+	if (!InventorySubsystem->ExchangeItems(Costs, Grants, RootContainerUID, OutGrantResult))
+	{
+		UE_CLOG(!OutGrantResult.Overflow.IsEmpty(), LogGaia, Log, TEXT("[制作] %s: 容器 %s 放不下全部产出，未制作"),
+			*GetNameSafe(Recipe), *RootContainerUID.ToString());
+		return false;
+	}
+
+	UE_LOG(LogGaia, Log, TEXT("[制作] %s x%d: 容器 %s"), *GetNameSafe(Recipe), CraftTimes, *RootContainerUID.ToString());
+	return true;
+}
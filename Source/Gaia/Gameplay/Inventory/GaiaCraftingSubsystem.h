@@ -0,0 +1,158 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaCraftingSubsystem.generated.h"
+
+#define UE_API GAIAGAME_API
+
+class UGaiaCraftingRecipe;
+class UGaiaInventorySubsystem;
+
+/**
+ * 容器树的可制作次数发生变化
+ * @param RootContainerUID 根容器
+ * @param ChangedRecipeIndices 可制作次数变化的配方下标
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FGaiaOnCraftableSetChanged, const FGuid& /*RootContainerUID*/, const TArray<int32>& /*ChangedRecipeIndices*/);
+
+/**
+ * Gaia制作子系统
+ *
+ * 为关注的容器树（通常是玩家背包）维护每个配方的可制作次数：
+ * - 订阅库存子系统按根容器广播的定义数量变化，只重算用到这些定义的配方
+ * - 每个配方的可制作次数只依赖根容器数量索引，O(材料种类)，不扫描槽位
+ * - 可制作集合是按配方下标的位数组，变化时只广播变化的配方
+ * - 玩家的根容器登记到 UGaiaInventoryRPCComponent 时开始关注，组件把变化的配方和次数用客户端RPC发给拥有者；
+ *   客户端按配方下标识别配方，因此运行时注册的配方需要在服务器和客户端以相同顺序注册
+ * 制作通过 UGaiaInventorySubsystem::ExchangeItems 在一次修改中扣除材料并发放产出
+ */
+UCLASS(MinimalAPI)
+class UGaiaCraftingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	UE_API virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	UE_API virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/** 获取制作子系统 */
+	static UE_API UGaiaCraftingSubsystem* Get(const UObject* WorldContextObject);
+
+	//~BEGIN 配方
+
+	/**
+	 * 注册配方（设置中的配方在初始化时自动注册）
+	 * @return 配方下标（已注册时返回原下标）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Crafting")
+	UE_API int32 RegisterRecipe(UGaiaCraftingRecipe* Recipe);
+
+	/** 获取配方下标（未注册返回 INDEX_NONE） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Crafting")
+	UE_API int32 FindRecipeIndex(const UGaiaCraftingRecipe* Recipe) const;
+
+	/** 获取已注册的配方 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Crafting")
+	UE_API UGaiaCraftingRecipe* GetRecipe(int32 RecipeIndex) const;
+
+	/** 获取已注册的配方数量 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Crafting")
+	int32 GetNumRecipes() const { return Recipes.Num(); }
+
+	//~END 配方
+
+	//~BEGIN 可制作集合
+
+	/** 开始维护容器树的可制作次数（立即全量计算一次） */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Crafting")
+	UE_API void WatchContainerTree(const FGuid& RootContainerUID);
+
+	/** 停止维护容器树的可制作次数 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Crafting")
+	UE_API void UnwatchContainerTree(const FGuid& RootContainerUID);
+
+	/** 获取容器树中配方的可制作次数（未关注的容器树直接计算） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Crafting")
+	UE_API int32 GetCraftableCount(const FGuid& RootContainerUID, const UGaiaCraftingRecipe* Recipe) const;
+
+	/** 获取容器树中当前可以制作的配方（需要先关注） */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Crafting")
+	UE_API void GetCraftableRecipes(const FGuid& RootContainerUID, TArray<UGaiaCraftingRecipe*>& OutRecipes) const;
+
+	/** 获取可制作集合（按配方下标的位数组，未关注时返回nullptr） */
+	UE_API const TBitArray<>* FindCraftableSet(const FGuid& RootContainerUID) const;
+
+	/** 关注的容器树可制作次数变化（库存修改作用域结束时广播） */
+	FGaiaOnCraftableSetChanged OnCraftableSetChanged;
+
+	//~END 可制作集合
+
+	//~BEGIN 制作
+
+	/**
+	 * 制作（仅服务器）
+	 * 次数限制到当前可制作次数，材料从容器树中扣除，产出放入同一容器树；产出放不下时什么都不做
+	 * @param RootContainerUID 根容器
+	 * @param Recipe 配方
+	 * @param Times 制作次数
+	 * @param OutGrantResult 产出发放结果（产出放不下时不制作，Overflow 为放不下的部分）
+	 * @return 是否制作成功
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Crafting")
+	UE_API bool Craft(const FGuid& RootContainerUID, UGaiaCraftingRecipe* Recipe, int32 Times, FGaiaGrantResult& OutGrantResult);
+
+	//~END 制作
+
+private:
+	/** 计算容器树中配方的可制作次数 */
+	int32 ComputeCraftableCount(const FGuid& RootContainerUID, int32 RecipeIndex) const;
+
+	/** 库存子系统：根容器的定义数量变化 */
+	void HandleRootDefinitionCountsChanged(const FGuid& RootContainerUID, const TArray<FName>& ChangedDefinitionIDs);
+
+	/** 库存子系统：数量索引整体重建 */
+	void HandleRootDefinitionCountsReset();
+
+	/** 配方扣除的材料（同一物品已合并） */
+	struct FRecipeRequirements
+	{
+		TArray<TPair<FName, int32>> Items;
+	};
+
+	/** 关注的容器树 */
+	struct FWatchedTree
+	{
+		/** 按配方下标的可制作次数 */
+		TArray<int32> CraftableCounts;
+
+		/** 可制作次数大于0的配方 */
+		TBitArray<> CraftableSet;
+	};
+
+	/** 已注册的配方 */
+	UPROPERTY()
+	TArray<TObjectPtr<UGaiaCraftingRecipe>> Recipes;
+
+	/** 与 Recipes 一一对应的材料 */
+	TArray<FRecipeRequirements> RecipeRequirements;
+
+	/** 物品定义 -> 用到它的配方下标 */
+	TMap<FName, TArray<int32>> IngredientRecipes;
+
+	/** 关注的容器树 */
+	TMap<FGuid, FWatchedTree> WatchedTrees;
+
+	/** 库存子系统 */
+	UPROPERTY()
+	TObjectPtr<UGaiaInventorySubsystem> InventorySubsystem;
+
+	FDelegateHandle CountsChangedHandle;
+	FDelegateHandle CountsResetHandle;
+};
+
+#undef UE_API
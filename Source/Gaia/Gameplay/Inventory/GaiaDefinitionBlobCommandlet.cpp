@@ -0,0 +1,108 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaDefinitionBlobCommandlet.h"
+#include "GaiaDefinitionDatabase.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaLogChannels.h"
+#include "DataRegistry.h"
+#include "DataRegistrySubsystem.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaDefinitionBlobCommandlet)
+
+namespace GaiaDefinitionBlob
+{
+	/** 收集某个注册表类型的全部缓存行，行结构必须是 T 或其子结构 */
+	template <typename T>
+	static bool CollectDefinitions(UDataRegistrySubsystem& Subsystem, FName RegistryType, TMap<FName, const T*>& OutDefinitions, FString& OutError)
+	{
+		const UDataRegistry* Registry = Subsystem.GetRegistryForType(RegistryType);
+		if (!Registry)
+		{
+			OutError = FString::Printf(TEXT("找不到数据注册表: %s"), *RegistryType.ToString());
+			return false;
+		}
+
+		TMap<FDataRegistryId, const uint8*> CachedItems;
+		const UScriptStruct* ItemStruct = nullptr;
+		if (!Registry->GetAllCachedItems(CachedItems, ItemStruct) || !ItemStruct || !ItemStruct->IsChildOf(T::StaticStruct()))
+		{
+			OutError = FString::Printf(TEXT("数据注册表 %s 没有可用的 %s 缓存"), *RegistryType.ToString(), *T::StaticStruct()->GetName());
+			return false;
+		}
+
+		OutDefinitions.Reserve(CachedItems.Num());
+		for (const auto& Pair : CachedItems)
+		{
+			OutDefinitions.Add(Pair.Key.ItemName, reinterpret_cast<const T*>(Pair.Value));
+		}
+		return true;
+	}
+}
+
+UGaiaDefinitionBlobCommandlet::UGaiaDefinitionBlobCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UGaiaDefinitionBlobCommandlet::Main(const FString& Params)
+{
+	FString OutputPath;
+	if (!FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		OutputPath = GetDefaultOutputPath();
+	}
+
+	FString Error;
+	if (!GenerateDefinitionDatabase(OutputPath, Error))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[定义数据库] 生成失败: %s"), *Error);
+		return 1;
+	}
+	return 0;
+}
+
+bool UGaiaDefinitionBlobCommandlet::GenerateDefinitionDatabase(const FString& OutputPath, FString& OutError)
+{
+	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+	UDataRegistrySubsystem* Subsystem = UDataRegistrySubsystem::Get();
+	if (!Subsystem)
+	{
+		OutError = TEXT("数据注册表子系统不可用");
+		return false;
+	}
+
+	// 命令行环境下注册表不会自动初始化
+	Subsystem->LoadAllRegistries();
+	Subsystem->InitializeAllRegistries();
+
+	TMap<FName, const FGaiaItemDefinition*> ItemDefinitions;
+	TMap<FName, const FGaiaContainerDefinition*> ContainerDefinitions;
+	if (!GaiaDefinitionBlob::CollectDefinitions(*Subsystem, Settings->ItemDefinitionRegistryType, ItemDefinitions, OutError)
+		|| !GaiaDefinitionBlob::CollectDefinitions(*Subsystem, Settings->ContainerDefinitionRegistryType, ContainerDefinitions, OutError))
+	{
+		return false;
+	}
+
+	TArray<uint8> Data;
+	FGaiaDefinitionDatabase::BuildBlob(ItemDefinitions, ContainerDefinitions, Data);
+
+	if (!FFileHelper::SaveArrayToFile(Data, *OutputPath))
+	{
+		OutError = FString::Printf(TEXT("无法写入: %s"), *OutputPath);
+		return false;
+	}
+
+	UE_LOG(LogGaia, Display, TEXT("[定义数据库] 已生成 %s：物品定义 %d，容器定义 %d，%d 字节"),
+		*OutputPath, ItemDefinitions.Num(), ContainerDefinitions.Num(), Data.Num());
+	return true;
+}
+
+FString UGaiaDefinitionBlobCommandlet::GetDefaultOutputPath()
+{
+	return FPaths::ProjectContentDir() / GetDefault<UGaiaInventoryManagerSettings>()->DefinitionDatabasePath;
+}
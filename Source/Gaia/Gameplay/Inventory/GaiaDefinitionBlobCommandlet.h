@@ -0,0 +1,38 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "GaiaDefinitionBlobCommandlet.generated.h"
+
+/**
+ * 生成服务器定义数据库
+ *
+ * 从数据注册表（对应的数据表）读取全部物品/容器定义，写出 FGaiaDefinitionDatabase 文件。
+ * 编辑器烘焙开始时会自动执行一次；也可以单独运行：
+ *   UnrealEditor-Cmd Gaia.uproject -run=GaiaDefinitionBlob [-Output=<完整路径>]
+ * 默认输出到 Content/<DefinitionDatabasePath>，该目录按 NonUFS 方式打包，以便服务器直接内存映射。
+ */
+UCLASS()
+class GAIAGAME_API UGaiaDefinitionBlobCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGaiaDefinitionBlobCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+	/**
+	 * 生成定义数据库文件
+	 * @param OutputPath 输出文件完整路径
+	 * @param OutError 失败原因
+	 * @return 是否成功
+	 */
+	static bool GenerateDefinitionDatabase(const FString& OutputPath, FString& OutError);
+
+	/** 默认输出路径（Content/<DefinitionDatabasePath>） */
+	static FString GetDefaultOutputPath();
+};
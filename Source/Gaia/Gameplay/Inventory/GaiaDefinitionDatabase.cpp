@@ -0,0 +1,562 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaDefinitionDatabase.h"
+#include "GaiaInventoryStats.h"
+#include "GaiaLogChannels.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+DECLARE_CYCLE_STAT(TEXT("Definition Database Mount"), STAT_GaiaInventory_DefinitionMount, STATGROUP_GaiaInventory);
+
+TUniquePtr<FGaiaDefinitionDatabase> FGaiaDefinitionDatabase::Instance;
+
+namespace GaiaDefinitionDatabase
+{
+	// ========================================
+	// 文件记录（定长，按偏移直接读取）
+	// ========================================
+
+	struct FBlobHeader
+	{
+		uint32 Magic;
+		int32 Version;
+		int32 NumStrings;
+		uint32 StringDataSize;
+		int32 NumTags;
+		int32 NumTagRefs;
+		int32 NumItems;
+		int32 NumContainers;
+		int32 NumModifiers;
+	};
+
+	enum EItemFlags : uint32
+	{
+		ItemFlag_Stackable = 1 << 0,
+		ItemFlag_HasContainer = 1 << 1,
+		ItemFlag_AllowGridRotation = 1 << 2,
+	};
+
+	enum EContainerFlags : uint32
+	{
+		ContainerFlag_EnableVolumeLimit = 1 << 0,
+		ContainerFlag_AllowNestedContainers = 1 << 1,
+		ContainerFlag_UseGridLayout = 1 << 2,
+	};
+
+	struct FItemRecord
+	{
+		int32 NameIndex;
+		int32 Weight;
+		int32 Volume;
+		int32 MaxStackSize;
+		/** 容器定义ID的字符串索引，无容器为 INDEX_NONE */
+		int32 ContainerDefIndex;
+		int32 TagRefStart;
+		int32 TagRefCount;
+		uint32 Flags;
+		uint16 GridWidth;
+		uint16 GridHeight;
+		int32 ModifierStart;
+		int32 ModifierCount;
+		float LifetimeSeconds;
+		/** 过期后转变成的物品定义ID的字符串索引，过期删除为 INDEX_NONE */
+		int32 ExpiredDefIndex;
+	};
+
+	struct FModifierRecord
+	{
+		/** 属性标签在标签表中的索引 */
+		int32 StatTagIndex;
+		float Additive;
+		float Multiplicative;
+	};
+
+	struct FContainerRecord
+	{
+		int32 NameIndex;
+		int32 SlotCount;
+		int32 MaxVolume;
+		int32 TagRefStart;
+		int32 TagRefCount;
+		uint32 Flags;
+		uint16 GridWidth;
+		uint16 GridHeight;
+	};
+
+	static_assert(sizeof(FBlobHeader) == 36, "FBlobHeader 布局变化需要提升 Version");
+	static_assert(sizeof(FItemRecord) == 52, "FItemRecord 布局变化需要提升 Version");
+	static_assert(sizeof(FModifierRecord) == 12, "FModifierRecord 布局变化需要提升 Version");
+	static_assert(sizeof(FContainerRecord) == 28, "FContainerRecord 布局变化需要提升 Version");
+
+	/** 写入时的字符串/标签去重表 */
+	struct FBlobTables
+	{
+		TArray<FName> Strings;
+		TMap<FName, int32> StringToIndex;
+		TArray<int32> Tags;
+		TMap<FName, int32> TagToIndex;
+		TArray<int32> TagRefs;
+
+		int32 GetStringIndex(FName Name)
+		{
+			if (const int32* Found = StringToIndex.Find(Name))
+			{
+				return *Found;
+			}
+			const int32 Index = Strings.Add(Name);
+			StringToIndex.Add(Name, Index);
+			return Index;
+		}
+
+		int32 GetTagIndex(FName TagName)
+		{
+			if (const int32* Found = TagToIndex.Find(TagName))
+			{
+				return *Found;
+			}
+			const int32 Index = Tags.Add(GetStringIndex(TagName));
+			TagToIndex.Add(TagName, Index);
+			return Index;
+		}
+
+		/** 追加一组标签引用，返回起始位置 */
+		int32 AddTagRefs(const FGameplayTagContainer& TagContainer)
+		{
+			const int32 Start = TagRefs.Num();
+			for (const FGameplayTag& Tag : TagContainer)
+			{
+				TagRefs.Add(GetTagIndex(Tag.GetTagName()));
+			}
+			return Start;
+		}
+	};
+
+	template <typename T>
+	static void AppendPOD(TArray<uint8>& Data, const T& Value)
+	{
+		Data.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+	}
+
+	template <typename T>
+	static void AppendPODArray(TArray<uint8>& Data, const TArray<T>& Values)
+	{
+		Data.Append(reinterpret_cast<const uint8*>(Values.GetData()), Values.Num() * sizeof(T));
+	}
+
+	/** 映射内存上的只读游标，越界时返回nullptr */
+	struct FBlobReader
+	{
+		const uint8* Data;
+		int64 Size;
+		int64 Offset = 0;
+
+		template <typename T>
+		const T* Take(int64 Count)
+		{
+			if (Count < 0 || Count > (Size - Offset) / static_cast<int64>(sizeof(T)))
+			{
+				return nullptr;
+			}
+			const T* Result = reinterpret_cast<const T*>(Data + Offset);
+			Offset += Count * sizeof(T);
+			return Result;
+		}
+	};
+}
+
+// ========================================
+// 生成
+// ========================================
+
+void FGaiaDefinitionDatabase::BuildBlob(
+	const TMap<FName, const FGaiaItemDefinition*>& ItemDefinitions,
+	const TMap<FName, const FGaiaContainerDefinition*>& ContainerDefinitions,
+	TArray<uint8>& OutData)
+{
+	using namespace GaiaDefinitionDatabase;
+
+	FBlobTables Tables;
+
+	TArray<FItemRecord> ItemRecords;
+	TArray<FModifierRecord> ModifierRecords;
+	ItemRecords.Reserve(ItemDefinitions.Num());
+	for (const auto& Pair : ItemDefinitions)
+	{
+		const FGaiaItemDefinition& Def = *Pair.Value;
+
+		FItemRecord& Record = ItemRecords.AddZeroed_GetRef();
+		Record.NameIndex = Tables.GetStringIndex(Pair.Key);
+		Record.Weight = Def.ItemWeight;
+		Record.Volume = Def.ItemVolume;
+		Record.MaxStackSize = Def.MaxStackSize;
+		Record.ContainerDefIndex = Def.ContainerDefinitionID.IsNone() ? INDEX_NONE : Tables.GetStringIndex(Def.ContainerDefinitionID);
+		Record.TagRefStart = Tables.AddTagRefs(Def.ItemTags);
+		Record.TagRefCount = Tables.TagRefs.Num() - Record.TagRefStart;
+		Record.Flags = (Def.bStackable ? ItemFlag_Stackable : 0) | (Def.bHasContainer ? ItemFlag_HasContainer : 0)
+			| (Def.bAllowGridRotation ? ItemFlag_AllowGridRotation : 0);
+		Record.GridWidth = static_cast<uint16>(Def.GridWidth);
+		Record.GridHeight = static_cast<uint16>(Def.GridHeight);
+		Record.ModifierStart = ModifierRecords.Num();
+		for (const FGaiaStatModifier& Modifier : Def.StatModifiers)
+		{
+			FModifierRecord& ModifierRecord = ModifierRecords.AddZeroed_GetRef();
+			ModifierRecord.StatTagIndex = Tables.GetTagIndex(Modifier.StatTag.GetTagName());
+			ModifierRecord.Additive = Modifier.Additive;
+			ModifierRecord.Multiplicative = Modifier.Multiplicative;
+		}
+		Record.ModifierCount = ModifierRecords.Num() - Record.ModifierStart;
+		Record.LifetimeSeconds = Def.LifetimeSeconds;
+		Record.ExpiredDefIndex = Def.ExpiredItemDefinitionID.IsNone() ? INDEX_NONE : Tables.GetStringIndex(Def.ExpiredItemDefinitionID);
+	}
+
+	TArray<FContainerRecord> ContainerRecords;
+	ContainerRecords.Reserve(ContainerDefinitions.Num());
+	for (const auto& Pair : ContainerDefinitions)
+	{
+		const FGaiaContainerDefinition& Def = *Pair.Value;
+
+		FContainerRecord& Record = ContainerRecords.AddZeroed_GetRef();
+		Record.NameIndex = Tables.GetStringIndex(Pair.Key);
+		Record.SlotCount = Def.SlotCount;
+		Record.MaxVolume = Def.MaxVolume;
+		Record.TagRefStart = Tables.AddTagRefs(Def.AllowedItemTags);
+		Record.TagRefCount = Tables.TagRefs.Num() - Record.TagRefStart;
+		Record.Flags = (Def.bEnableVolumeLimit ? ContainerFlag_EnableVolumeLimit : 0) | (Def.bAllowNestedContainers ? ContainerFlag_AllowNestedContainers : 0)
+			| (Def.bUseGridLayout ? ContainerFlag_UseGridLayout : 0);
+		Record.GridWidth = static_cast<uint16>(Def.GridWidth);
+		Record.GridHeight = static_cast<uint16>(Def.GridHeight);
+	}
+
+	// 字符串：偏移表（N+1项）+ UTF-8 数据，数据区补齐到4字节
+	TArray<uint32> StringOffsets;
+	TArray<uint8> StringData;
+	StringOffsets.Reserve(Tables.Strings.Num() + 1);
+	for (const FName& Name : Tables.Strings)
+	{
+		StringOffsets.Add(StringData.Num());
+		const FTCHARToUTF8 Converted(*Name.ToString());
+		StringData.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+	}
+	StringOffsets.Add(StringData.Num());
+	StringData.AddZeroed(Align(StringData.Num(), 4) - StringData.Num());
+
+	FBlobHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.NumStrings = Tables.Strings.Num();
+	Header.StringDataSize = StringData.Num();
+	Header.NumTags = Tables.Tags.Num();
+	Header.NumTagRefs = Tables.TagRefs.Num();
+	Header.NumItems = ItemRecords.Num();
+	Header.NumContainers = ContainerRecords.Num();
+	Header.NumModifiers = ModifierRecords.Num();
+
+	OutData.Reset();
+	AppendPOD(OutData, Header);
+	AppendPODArray(OutData, StringOffsets);
+	AppendPODArray(OutData, StringData);
+	AppendPODArray(OutData, Tables.Tags);
+	AppendPODArray(OutData, Tables.TagRefs);
+	AppendPODArray(OutData, ItemRecords);
+	AppendPODArray(OutData, ContainerRecords);
+	AppendPODArray(OutData, ModifierRecords);
+}
+
+// ========================================
+// 挂载
+// ========================================
+
+FGaiaDefinitionDatabase::FGaiaDefinitionDatabase() = default;
+
+FGaiaDefinitionDatabase::~FGaiaDefinitionDatabase() = default;
+
+bool FGaiaDefinitionDatabase::Mount(const FString& FilePath, FString& OutError)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_DefinitionMount);
+	check(IsInGameThread());
+
+	TUniquePtr<FGaiaDefinitionDatabase> Database = MakeUnique<FGaiaDefinitionDatabase>();
+
+	// 映射在数据库存在期间一直保留，记录直接从映射内存读取
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	Database->MappedFile.Reset(PlatformFile.OpenMapped(*FilePath));
+	Database->MappedRegion.Reset(Database->MappedFile ? Database->MappedFile->MapRegion(0, Database->MappedFile->GetFileSize()) : nullptr);
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	if (Database->MappedRegion)
+	{
+		Data = Database->MappedRegion->GetMappedPtr();
+		Size = Database->MappedRegion->GetMappedSize();
+	}
+	else
+	{
+		// 不支持内存映射的平台或文件在pak内：退化为一次性读入
+		if (!FFileHelper::LoadFileToArray(Database->FileData, *FilePath, FILEREAD_Silent))
+		{
+			OutError = FString::Printf(TEXT("无法打开定义数据库: %s"), *FilePath);
+			return false;
+		}
+		Data = Database->FileData.GetData();
+		Size = Database->FileData.Num();
+	}
+
+	if (!Database->Initialize(Data, Size, OutError))
+	{
+		return false;
+	}
+
+	UE_LOG(LogGaia, Log, TEXT("[定义数据库] 已挂载 %s（%s）：物品定义 %d，容器定义 %d，%lld 字节"),
+		*FilePath, Database->MappedRegion ? TEXT("内存映射") : TEXT("读入内存"),
+		Database->GetNumItemDefinitions(), Database->GetNumContainerDefinitions(), Size);
+
+	Instance = MoveTemp(Database);
+	return true;
+}
+
+void FGaiaDefinitionDatabase::Unmount()
+{
+	check(IsInGameThread());
+	Instance.Reset();
+}
+
+bool FGaiaDefinitionDatabase::Initialize(const uint8* Data, int64 Size, FString& OutError)
+{
+	using namespace GaiaDefinitionDatabase;
+
+	FBlobReader Reader{ Data, Size };
+
+	const FBlobHeader* Header = Reader.Take<FBlobHeader>(1);
+	if (!Header || Header->Magic != Magic)
+	{
+		OutError = TEXT("定义数据库文件头无效");
+		return false;
+	}
+	if (Header->Version != Version)
+	{
+		OutError = FString::Printf(TEXT("定义数据库版本不匹配: %d（需要 %d），请重新生成"), Header->Version, Version);
+		return false;
+	}
+
+	const uint32* StringOffsets = Reader.Take<uint32>(static_cast<int64>(Header->NumStrings) + 1);
+	const uint8* StringData = Reader.Take<uint8>(Header->StringDataSize);
+	const int32* Tags = Reader.Take<int32>(Header->NumTags);
+	TagRefs = Reader.Take<int32>(Header->NumTagRefs);
+	ItemRecords = Reader.Take<FItemRecord>(Header->NumItems);
+	ContainerRecords = Reader.Take<FContainerRecord>(Header->NumContainers);
+	ModifierRecords = Reader.Take<FModifierRecord>(Header->NumModifiers);
+	if (Header->NumStrings < 0 || !StringOffsets || !StringData || !Tags || !TagRefs || !ItemRecords || !ContainerRecords || !ModifierRecords)
+	{
+		OutError = TEXT("定义数据库已截断");
+		return false;
+	}
+
+	// 字符串只转换一次，后续全部按索引取 FName
+	Names.Reserve(Header->NumStrings);
+	for (int32 Index = 0; Index < Header->NumStrings; ++Index)
+	{
+		const uint32 Begin = StringOffsets[Index];
+		const uint32 End = StringOffsets[Index + 1];
+		if (Begin > End || End > Header->StringDataSize)
+		{
+			OutError = TEXT("定义数据库字符串表损坏");
+			return false;
+		}
+		Names.Add(FName(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(StringData + Begin), End - Begin)));
+	}
+
+	// 每个唯一标签只向标签管理器解析一次
+	ResolvedTags.Reserve(Header->NumTags);
+	for (int32 Index = 0; Index < Header->NumTags; ++Index)
+	{
+		if (!Names.IsValidIndex(Tags[Index]))
+		{
+			OutError = TEXT("定义数据库标签表损坏");
+			return false;
+		}
+		const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(Names[Tags[Index]], false);
+		UE_CLOG(!Tag.IsValid(), LogGaia, Warning, TEXT("[定义数据库] 未注册的标签: %s"), *Names[Tags[Index]].ToString());
+		ResolvedTags.Add(Tag);
+	}
+
+	auto AreTagRefsValid = [&](int32 Start, int32 Count)
+	{
+		if (Start < 0 || Count < 0 || Count > Header->NumTagRefs - Start)
+		{
+			return false;
+		}
+		for (int32 Ref = Start; Ref < Start + Count; ++Ref)
+		{
+			if (!ResolvedTags.IsValidIndex(TagRefs[Ref]))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// 只校验和建立索引，定义在第一次查询时构建
+	ItemIndexByID.Reserve(Header->NumItems);
+	for (int32 Index = 0; Index < Header->NumItems; ++Index)
+	{
+		const FItemRecord& Record = ItemRecords[Index];
+
+		bool bValid = Names.IsValidIndex(Record.NameIndex)
+			&& (Record.ContainerDefIndex == INDEX_NONE || Names.IsValidIndex(Record.ContainerDefIndex))
+			&& (Record.ExpiredDefIndex == INDEX_NONE || Names.IsValidIndex(Record.ExpiredDefIndex))
+			&& AreTagRefsValid(Record.TagRefStart, Record.TagRefCount)
+			&& Record.ModifierStart >= 0 && Record.ModifierCount >= 0 && Record.ModifierCount <= Header->NumModifiers - Record.ModifierStart;
+		for (int32 ModifierIndex = Record.ModifierStart; bValid && ModifierIndex < Record.ModifierStart + Record.ModifierCount; ++ModifierIndex)
+		{
+			bValid = ResolvedTags.IsValidIndex(ModifierRecords[ModifierIndex].StatTagIndex);
+		}
+		if (!bValid)
+		{
+			OutError = FString::Printf(TEXT("定义数据库物品记录 %d 损坏"), Index);
+			return false;
+		}
+
+		ItemIndexByID.Add(Names[Record.NameIndex], Index);
+	}
+
+	ContainerIndexByID.Reserve(Header->NumContainers);
+	for (int32 Index = 0; Index < Header->NumContainers; ++Index)
+	{
+		const FContainerRecord& Record = ContainerRecords[Index];
+		if (!Names.IsValidIndex(Record.NameIndex) || !AreTagRefsValid(Record.TagRefStart, Record.TagRefCount))
+		{
+			OutError = FString::Printf(TEXT("定义数据库容器记录 %d 损坏"), Index);
+			return false;
+		}
+
+		ContainerIndexByID.Add(Names[Record.NameIndex], Index);
+	}
+
+	BuiltItems = MakeUnique<std::atomic<const FGaiaItemDefinition*>[]>(Header->NumItems);
+	BuiltContainers = MakeUnique<std::atomic<const FGaiaContainerDefinition*>[]>(Header->NumContainers);
+	return true;
+}
+
+// ========================================
+// 构建
+// ========================================
+
+void FGaiaDefinitionDatabase::AppendTags(int32 TagRefStart, int32 TagRefCount, FGameplayTagContainer& OutTags) const
+{
+	for (int32 Ref = TagRefStart; Ref < TagRefStart + TagRefCount; ++Ref)
+	{
+		if (ResolvedTags[TagRefs[Ref]].IsValid())
+		{
+			OutTags.AddTagFast(ResolvedTags[TagRefs[Ref]]);
+		}
+	}
+}
+
+void FGaiaDefinitionDatabase::BuildItemDefinition(int32 Index, FGaiaItemDefinition& OutDef) const
+{
+	using namespace GaiaDefinitionDatabase;
+
+	const FItemRecord& Record = ItemRecords[Index];
+	AppendTags(Record.TagRefStart, Record.TagRefCount, OutDef.ItemTags);
+
+	OutDef.StatModifiers.Reserve(Record.ModifierCount);
+	for (int32 ModifierIndex = Record.ModifierStart; ModifierIndex < Record.ModifierStart + Record.ModifierCount; ++ModifierIndex)
+	{
+		const FModifierRecord& ModifierRecord = ModifierRecords[ModifierIndex];
+		FGaiaStatModifier& Modifier = OutDef.StatModifiers.AddDefaulted_GetRef();
+		Modifier.StatTag = ResolvedTags[ModifierRecord.StatTagIndex];
+		Modifier.Additive = ModifierRecord.Additive;
+		Modifier.Multiplicative = ModifierRecord.Multiplicative;
+	}
+
+	OutDef.ItemWeight = Record.Weight;
+	OutDef.ItemVolume = Record.Volume;
+	OutDef.MaxStackSize = Record.MaxStackSize;
+	OutDef.bStackable = (Record.Flags & ItemFlag_Stackable) != 0;
+	OutDef.bHasContainer = (Record.Flags & ItemFlag_HasContainer) != 0;
+	OutDef.bAllowGridRotation = (Record.Flags & ItemFlag_AllowGridRotation) != 0;
+	OutDef.GridWidth = FMath::Clamp<int32>(Record.GridWidth, 1, FGaiaInventoryGrid::MaxWidth);
+	OutDef.GridHeight = FMath::Clamp<int32>(Record.GridHeight, 1, FGaiaInventoryGrid::MaxHeight);
+	OutDef.ContainerDefinitionID = Record.ContainerDefIndex != INDEX_NONE ? Names[Record.ContainerDefIndex] : NAME_None;
+	OutDef.LifetimeSeconds = FMath::Max(Record.LifetimeSeconds, 0.0f);
+	OutDef.ExpiredItemDefinitionID = Record.ExpiredDefIndex != INDEX_NONE ? Names[Record.ExpiredDefIndex] : NAME_None;
+}
+
+void FGaiaDefinitionDatabase::BuildContainerDefinition(int32 Index, FGaiaContainerDefinition& OutDef) const
+{
+	using namespace GaiaDefinitionDatabase;
+
+	const FContainerRecord& Record = ContainerRecords[Index];
+	AppendTags(Record.TagRefStart, Record.TagRefCount, OutDef.AllowedItemTags);
+
+	OutDef.SlotCount = Record.SlotCount;
+	OutDef.MaxVolume = Record.MaxVolume;
+	OutDef.bEnableVolumeLimit = (Record.Flags & ContainerFlag_EnableVolumeLimit) != 0;
+	OutDef.bAllowNestedContainers = (Record.Flags & ContainerFlag_AllowNestedContainers) != 0;
+	OutDef.bUseGridLayout = (Record.Flags & ContainerFlag_UseGridLayout) != 0;
+	OutDef.GridWidth = FMath::Clamp<int32>(Record.GridWidth, 1, FGaiaInventoryGrid::MaxWidth);
+	OutDef.GridHeight = FMath::Clamp<int32>(Record.GridHeight, 1, FGaiaInventoryGrid::MaxHeight);
+}
+
+// ========================================
+// 查询
+// ========================================
+
+const FGaiaItemDefinition* FGaiaDefinitionDatabase::FindItemDefinition(FName ItemDefID) const
+{
+	const int32* Index = ItemIndexByID.Find(ItemDefID);
+	if (!Index)
+	{
+		return nullptr;
+	}
+
+	std::atomic<const FGaiaItemDefinition*>& Slot = BuiltItems[*Index];
+	if (const FGaiaItemDefinition* Built = Slot.load(std::memory_order_acquire))
+	{
+		return Built;
+	}
+
+	FScopeLock Lock(&BuildLock);
+	if (const FGaiaItemDefinition* Built = Slot.load(std::memory_order_relaxed))
+	{
+		return Built;
+	}
+
+	FGaiaItemDefinition* Def = ItemStorage.Add_GetRef(MakeUnique<FGaiaItemDefinition>()).Get();
+	BuildItemDefinition(*Index, *Def);
+	Slot.store(Def, std::memory_order_release);
+	return Def;
+}
+
+const FGaiaContainerDefinition* FGaiaDefinitionDatabase::FindContainerDefinition(FName ContainerDefID) const
+{
+	const int32* Index = ContainerIndexByID.Find(ContainerDefID);
+	if (!Index)
+	{
+		return nullptr;
+	}
+
+	std::atomic<const FGaiaContainerDefinition*>& Slot = BuiltContainers[*Index];
+	if (const FGaiaContainerDefinition* Built = Slot.load(std::memory_order_acquire))
+	{
+		return Built;
+	}
+
+	FScopeLock Lock(&BuildLock);
+	if (const FGaiaContainerDefinition* Built = Slot.load(std::memory_order_relaxed))
+	{
+		return Built;
+	}
+
+	FGaiaContainerDefinition* Def = ContainerStorage.Add_GetRef(MakeUnique<FGaiaContainerDefinition>()).Get();
+	BuildContainerDefinition(*Index, *Def);
+	Slot.store(Def, std::memory_order_release);
+	return Def;
+}
+
+int32 FGaiaDefinitionDatabase::GetNumBuiltDefinitions() const
+{
+	FScopeLock Lock(&BuildLock);
+	return ItemStorage.Num() + ContainerStorage.Num();
+}
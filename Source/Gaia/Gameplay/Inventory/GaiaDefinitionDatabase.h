@@ -0,0 +1,130 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GaiaInventoryTypes.h"
+#include <atomic>
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+namespace GaiaDefinitionDatabase
+{
+	struct FItemRecord;
+	struct FContainerRecord;
+	struct FModifierRecord;
+}
+
+/**
+ * 服务器定义数据库（只读）
+ *
+ * 由烘焙阶段从数据表生成的二进制定义文件，专供专用服务器使用：
+ * - 只包含规则需要的字段（重量、体积、堆叠、容器、标签、槽位数、网格尺寸、属性修正、寿命），不含 FText、图标软引用和右键菜单
+ * - 启动时以内存映射方式打开文件，直接按偏移读取定长记录；字符串和标签表在文件内去重，
+ *   每个标签只解析一次
+ * - 挂载后 UGaiaInventorySubsystem::FindItemDefinition/FindContainerDefinition 直接查本库；
+ *   专用服务器目标（GaiaServer）的配置不扫描数据注册表目录，数据表资源不会被加载
+ *
+ * 映射在挂载期间一直保留，挂载时只校验记录并按ID建立记录下标索引。
+ * 对外仍返回 FGaiaItemDefinition/FGaiaContainerDefinition 指针（规则、存档和读模型都依赖该类型），
+ * 每个定义在第一次被查询时才由映射记录构建（文本/图标/菜单字段保持为空）并缓存，
+ * 从未用到的定义只占映射中的定长记录。查询可以在任意线程进行。
+ *
+ * 文件布局（小端，4字节对齐）：
+ * Header | 字符串偏移表 | 字符串数据(UTF-8) | 标签表(字符串索引) | 标签引用表(标签索引) | 物品记录 | 容器记录 | 属性修正记录
+ */
+class GAIAGAME_API FGaiaDefinitionDatabase
+{
+public:
+	/** 文件头标识 'GDEF' */
+	static constexpr uint32 Magic = 0x46454447;
+
+	/** 文件格式版本（2：物品和容器记录增加网格尺寸；3：物品属性修正表；4：物品寿命） */
+	static constexpr int32 Version = 4;
+
+	/**
+	 * 由定义表生成数据库文件内容（编辑器/命令行工具使用）
+	 * @param ItemDefinitions 物品定义（ID -> 定义）
+	 * @param ContainerDefinitions 容器定义（ID -> 定义）
+	 * @param OutData 输出：文件内容
+	 */
+	static void BuildBlob(
+		const TMap<FName, const FGaiaItemDefinition*>& ItemDefinitions,
+		const TMap<FName, const FGaiaContainerDefinition*>& ContainerDefinitions,
+		TArray<uint8>& OutData);
+
+	/**
+	 * 挂载数据库文件（游戏线程，替换已挂载的数据库）
+	 * @param FilePath 文件完整路径
+	 * @param OutError 失败原因
+	 * @return 是否成功
+	 */
+	static bool Mount(const FString& FilePath, FString& OutError);
+
+	/** 卸载数据库，定义查询退回数据注册表 */
+	static void Unmount();
+
+	/** 获取已挂载的数据库（未挂载返回nullptr） */
+	static const FGaiaDefinitionDatabase* Get() { return Instance.Get(); }
+
+	/** 查找物品定义（不存在返回nullptr） */
+	const FGaiaItemDefinition* FindItemDefinition(FName ItemDefID) const;
+
+	/** 查找容器定义（不存在返回nullptr） */
+	const FGaiaContainerDefinition* FindContainerDefinition(FName ContainerDefID) const;
+
+	int32 GetNumItemDefinitions() const { return ItemIndexByID.Num(); }
+	int32 GetNumContainerDefinitions() const { return ContainerIndexByID.Num(); }
+
+	/** 已构建的定义数量（物品 + 容器） */
+	int32 GetNumBuiltDefinitions() const;
+
+	FGaiaDefinitionDatabase();
+	~FGaiaDefinitionDatabase();
+
+private:
+	/** 校验映射内存中的所有记录并建立索引，任何越界或格式错误都视为文件损坏 */
+	bool Initialize(const uint8* Data, int64 Size, FString& OutError);
+
+	/** 由映射记录构建定义（记录已在挂载时校验） */
+	void BuildItemDefinition(int32 Index, FGaiaItemDefinition& OutDef) const;
+	void BuildContainerDefinition(int32 Index, FGaiaContainerDefinition& OutDef) const;
+
+	/** 追加记录引用的标签 */
+	void AppendTags(int32 TagRefStart, int32 TagRefCount, FGameplayTagContainer& OutTags) const;
+
+	/** 映射句柄必须比映射区域活得久（按声明的逆序析构） */
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	/** 不支持内存映射时一次性读入的文件内容 */
+	TArray<uint8> FileData;
+
+	/** 指向映射内存的记录表 */
+	const GaiaDefinitionDatabase::FItemRecord* ItemRecords = nullptr;
+	const GaiaDefinitionDatabase::FContainerRecord* ContainerRecords = nullptr;
+	const GaiaDefinitionDatabase::FModifierRecord* ModifierRecords = nullptr;
+	const int32* TagRefs = nullptr;
+
+	/** 字符串表（每个字符串只转换一次） */
+	TArray<FName> Names;
+
+	/** 标签表（每个唯一标签只向标签管理器解析一次） */
+	TArray<FGameplayTag> ResolvedTags;
+
+	/** ID -> 记录下标 */
+	TMap<FName, int32> ItemIndexByID;
+	TMap<FName, int32> ContainerIndexByID;
+
+	/** 按记录下标发布已构建的定义（发布后不再修改，读取不加锁） */
+	TUniquePtr<std::atomic<const FGaiaItemDefinition*>[]> BuiltItems;
+	TUniquePtr<std::atomic<const FGaiaContainerDefinition*>[]> BuiltContainers;
+
+	/** 已构建定义的存储（只在 BuildLock 内追加） */
+	mutable TArray<TUniquePtr<FGaiaItemDefinition>> ItemStorage;
+	mutable TArray<TUniquePtr<FGaiaContainerDefinition>> ContainerStorage;
+	mutable FCriticalSection BuildLock;
+
+	static TUniquePtr<FGaiaDefinitionDatabase> Instance;
+};
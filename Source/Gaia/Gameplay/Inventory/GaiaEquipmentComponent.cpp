@@ -0,0 +1,447 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaEquipmentComponent.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaInventoryRPCComponent.h"
+#include "GaiaLogChannels.h"
+#include "GameFramework/Actor.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaEquipmentComponent)
+
+UGaiaEquipmentComponent::UGaiaEquipmentComponent()
+{
+	SetIsReplicatedByDefault(true);
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UGaiaEquipmentComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// 装备容器和汇总只在服务器维护，客户端通过复制读取
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (!InventorySystem)
+	{
+		return;
+	}
+
+	CountsChangedHandle = InventorySystem->OnRootDefinitionCountsChanged.AddUObject(this, &ThisClass::HandleRootDefinitionCountsChanged);
+	CountsResetHandle = InventorySystem->OnRootDefinitionCountsReset.AddUObject(this, &ThisClass::HandleRootDefinitionCountsReset);
+
+	// 启用玩家分片时 BeginPlay 早于登录，此时分片ID还没设置，由 HandlePlayerLogin 找回或创建
+	if (!EquipmentContainerUID.IsValid() && !ContainerDefinitionID.IsNone() && !GetDefault<UGaiaInventoryManagerSettings>()->bEnablePlayerShards)
+	{
+		SetEquipmentContainer(InventorySystem->CreateContainerInstance(ContainerDefinitionID));
+	}
+}
+
+void UGaiaEquipmentComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem())
+	{
+		InventorySystem->OnRootDefinitionCountsChanged.Remove(CountsChangedHandle);
+		InventorySystem->OnRootDefinitionCountsReset.Remove(CountsResetHandle);
+		if (GetOwnerRole() == ROLE_Authority && EquipmentContainerUID.IsValid())
+		{
+			InventorySystem->SetContainerSlotFilters(EquipmentContainerUID, TArray<FGameplayTagContainer>());
+		}
+	}
+	CountsChangedHandle.Reset();
+	CountsResetHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGaiaEquipmentComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UGaiaEquipmentComponent, EquipmentContainerUID);
+
+	// 汇总只在 SyncEquippedSlots 实际改变时标记脏，平时不参与属性比较
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UGaiaEquipmentComponent, StatAggregates, Params);
+}
+
+// ========================================
+// 装备操作
+// ========================================
+
+void UGaiaEquipmentComponent::SetEquipmentContainer(const FGuid& InContainerUID)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (GetOwnerRole() != ROLE_Authority || !InventorySystem)
+	{
+		return;
+	}
+
+	FGaiaContainerInstance Container;
+	if (!InventorySystem->FindContainerByUID(InContainerUID, Container))
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[装备] %s 的装备容器不存在: %s"), *GetNameSafe(GetOwner()), *InContainerUID.ToString());
+		return;
+	}
+
+	UE_CLOG(Container.Slots.Num() < Slots.Num(), LogGaia, Warning, TEXT("[装备] 装备容器槽位数 %d 少于装备槽数 %d，多出的装备槽不可用"),
+		Container.Slots.Num(), Slots.Num());
+
+	if (EquipmentContainerUID.IsValid() && EquipmentContainerUID != InContainerUID)
+	{
+		InventorySystem->SetContainerSlotFilters(EquipmentContainerUID, TArray<FGameplayTagContainer>());
+	}
+	EquipmentContainerUID = InContainerUID;
+
+	TArray<FGameplayTagContainer> SlotFilters;
+	SlotFilters.Reserve(Slots.Num());
+	for (const FGaiaEquipmentSlotDefinition& Slot : Slots)
+	{
+		SlotFilters.Add(Slot.AllowedItemTags);
+	}
+	InventorySystem->SetContainerSlotFilters(EquipmentContainerUID, SlotFilters);
+
+	// 与RPC组件在同一Actor上时登记为玩家拥有的容器（推送给客户端，并随玩家分片保存）
+	if (UGaiaInventoryRPCComponent* RPCComp = GetOwner()->FindComponentByClass<UGaiaInventoryRPCComponent>())
+	{
+		RPCComp->AddOwnedContainerUID(EquipmentContainerUID);
+	}
+
+	SyncEquippedSlots(true);
+}
+
+void UGaiaEquipmentComponent::RestoreEquipmentContainer(const TArray<FGuid>& RootContainerUIDs)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (GetOwnerRole() != ROLE_Authority || !InventorySystem || ContainerDefinitionID.IsNone())
+	{
+		return;
+	}
+
+	for (const FGuid& ContainerUID : RootContainerUIDs)
+	{
+		FGaiaContainerInstance Container;
+		if (InventorySystem->FindContainerByUID(ContainerUID, Container) && Container.ContainerDefinitionID == ContainerDefinitionID)
+		{
+			SetEquipmentContainer(ContainerUID);
+			return;
+		}
+	}
+
+	if (!EquipmentContainerUID.IsValid())
+	{
+		SetEquipmentContainer(InventorySystem->CreateContainerInstance(ContainerDefinitionID));
+	}
+}
+
+FMoveItemResult UGaiaEquipmentComponent::EquipItem(const FGuid& ItemUID, int32 SlotIndex)
+{
+	FMoveItemResult Result;
+
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	FGaiaContainerInstance Container;
+	if (GetOwnerRole() != ROLE_Authority || !InventorySystem || !InventorySystem->FindContainerByUID(EquipmentContainerUID, Container))
+	{
+		Result.Result = EMoveItemResult::InvalidTarget;
+		Result.ErrorMessage = TEXT("装备容器不可用");
+		return Result;
+	}
+
+	FGaiaItemInstance Item;
+	if (!InventorySystem->FindItemByUID(ItemUID, Item))
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("物品不存在: %s"), *ItemUID.ToString());
+		return Result;
+	}
+	if (Item.CurrentContainerUID == EquipmentContainerUID)
+	{
+		Result.ErrorMessage = TEXT("物品已经装备");
+		return Result;
+	}
+
+	const FGaiaItemDefinition* ItemDef = UGaiaInventorySubsystem::FindItemDefinition(Item.ItemDefinitionID);
+	if (!ItemDef)
+	{
+		Result.Result = EMoveItemResult::InvalidDefinition;
+		Result.ErrorMessage = FString::Printf(TEXT("无法获取物品定义 (ItemDefID: %s)"), *Item.ItemDefinitionID.ToString());
+		return Result;
+	}
+
+	auto GetSlotItemUID = [&Container](int32 Index)
+	{
+		const int32 ContainerSlotIndex = Container.GetSlotIndexByID(Index);
+		return ContainerSlotIndex != INDEX_NONE ? Container.Slots[ContainerSlotIndex].ItemInstanceUID : FGuid();
+	};
+
+	// 未指定装备槽时取第一个接受该物品的空槽，都被占用时替换第一个接受的槽
+	if (SlotIndex == INDEX_NONE)
+	{
+		for (int32 Index = 0; Index < Slots.Num(); ++Index)
+		{
+			if (Container.GetSlotIndexByID(Index) == INDEX_NONE || !Slots[Index].AcceptsItem(*ItemDef))
+			{
+				continue;
+			}
+			if (SlotIndex == INDEX_NONE)
+			{
+				SlotIndex = Index;
+			}
+			if (!GetSlotItemUID(Index).IsValid())
+			{
+				SlotIndex = Index;
+				break;
+			}
+		}
+	}
+
+	if (!Slots.IsValidIndex(SlotIndex) || Container.GetSlotIndexByID(SlotIndex) == INDEX_NONE || !Slots[SlotIndex].AcceptsItem(*ItemDef))
+	{
+		Result.Result = EMoveItemResult::TypeMismatch;
+		Result.ErrorMessage = FString::Printf(TEXT("没有可以装备该物品的装备槽 (%s)"), *Item.GetDebugName());
+		return Result;
+	}
+
+	// 替换：先把原装备放回新物品所在的容器
+	const FGuid PreviousItemUID = GetSlotItemUID(SlotIndex);
+	if (PreviousItemUID.IsValid())
+	{
+		if (!Item.IsInContainer())
+		{
+			Result.Result = EMoveItemResult::InvalidTarget;
+			Result.ErrorMessage = TEXT("没有容器可以放回原来的装备");
+			return Result;
+		}
+
+		const FMoveItemResult UnequipResult = InventorySystem->TryMoveItem(PreviousItemUID, Item.CurrentContainerUID, INDEX_NONE, -1);
+		if (!UnequipResult.IsSuccess())
+		{
+			return UnequipResult;
+		}
+	}
+
+	Result = InventorySystem->TryMoveItem(ItemUID, EquipmentContainerUID, SlotIndex, 1);
+	if (!Result.IsSuccess() && PreviousItemUID.IsValid())
+	{
+		// 新物品放不进去，原装备回到装备槽
+		InventorySystem->TryMoveItem(PreviousItemUID, EquipmentContainerUID, SlotIndex, -1);
+	}
+
+	UE_LOG(LogGaia, Log, TEXT("[装备] %s 装备 %s 到槽 %d: %s"),
+		*GetNameSafe(GetOwner()), *Item.GetDebugName(), SlotIndex, Result.IsSuccess() ? TEXT("成功") : *Result.ErrorMessage);
+	return Result;
+}
+
+FMoveItemResult UGaiaEquipmentComponent::UnequipItem(int32 SlotIndex, const FGuid& TargetContainerUID)
+{
+	FMoveItemResult Result;
+
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (GetOwnerRole() != ROLE_Authority || !InventorySystem)
+	{
+		Result.ErrorMessage = TEXT("库存系统不可用");
+		return Result;
+	}
+
+	const FGuid ItemUID = GetEquippedItemUID(SlotIndex);
+	if (!ItemUID.IsValid())
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("装备槽 %d 为空"), SlotIndex);
+		return Result;
+	}
+	if (TargetContainerUID == EquipmentContainerUID)
+	{
+		Result.Result = EMoveItemResult::InvalidTarget;
+		Result.ErrorMessage = TEXT("不能卸下到装备容器");
+		return Result;
+	}
+
+	Result = InventorySystem->TryMoveItem(ItemUID, TargetContainerUID, INDEX_NONE, -1);
+
+	UE_LOG(LogGaia, Log, TEXT("[装备] %s 卸下槽 %d 的装备: %s"),
+		*GetNameSafe(GetOwner()), SlotIndex, Result.IsSuccess() ? TEXT("成功") : *Result.ErrorMessage);
+	return Result;
+}
+
+// ========================================
+// 查询
+// ========================================
+
+int32 UGaiaEquipmentComponent::FindSlotIndex(FGameplayTag SlotTag) const
+{
+	return Slots.IndexOfByPredicate([&SlotTag](const FGaiaEquipmentSlotDefinition& Slot)
+	{
+		return Slot.SlotTag == SlotTag;
+	});
+}
+
+FGuid UGaiaEquipmentComponent::GetEquippedItemUID(int32 SlotIndex) const
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	FGaiaContainerInstance Container;
+	if (!Slots.IsValidIndex(SlotIndex) || !InventorySystem || !InventorySystem->FindContainerByUID(EquipmentContainerUID, Container))
+	{
+		return FGuid();
+	}
+
+	const int32 ContainerSlotIndex = Container.GetSlotIndexByID(SlotIndex);
+	return ContainerSlotIndex != INDEX_NONE ? Container.Slots[ContainerSlotIndex].ItemInstanceUID : FGuid();
+}
+
+float UGaiaEquipmentComponent::GetStatValue(FGameplayTag StatTag, float BaseValue) const
+{
+	const int32* Found = StatIndices.Find(StatTag);
+	return Found ? StatAggregates[*Found].Evaluate(BaseValue) : BaseValue;
+}
+
+bool UGaiaEquipmentComponent::GetStatAggregate(FGameplayTag StatTag, FGaiaStatAggregate& OutAggregate) const
+{
+	if (const int32* Found = StatIndices.Find(StatTag))
+	{
+		OutAggregate = StatAggregates[*Found];
+		return true;
+	}
+	return false;
+}
+
+// ========================================
+// 汇总维护
+// ========================================
+
+void UGaiaEquipmentComponent::OnRep_StatAggregates()
+{
+	RebuildStatIndices();
+	OnStatsChanged.Broadcast();
+}
+
+UGaiaInventorySubsystem* UGaiaEquipmentComponent::GetInventorySubsystem() const
+{
+	return UGaiaInventorySubsystem::Get(this);
+}
+
+void UGaiaEquipmentComponent::HandleRootDefinitionCountsChanged(const FGuid& RootContainerUID, const TArray<FName>& ChangedDefinitionIDs)
+{
+	// 装备容器没有所属物品，始终是根容器；数量不变的移动（装备槽之间交换）不影响汇总
+	if (RootContainerUID == EquipmentContainerUID)
+	{
+		SyncEquippedSlots();
+	}
+}
+
+void UGaiaEquipmentComponent::HandleRootDefinitionCountsReset()
+{
+	if (EquipmentContainerUID.IsValid())
+	{
+		SyncEquippedSlots(true);
+	}
+}
+
+void UGaiaEquipmentComponent::SyncEquippedSlots(bool bForceRebuild)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	FGaiaContainerInstance Container;
+	const bool bHasContainer = InventorySystem && InventorySystem->FindContainerByUID(EquipmentContainerUID, Container);
+
+	bool bChanged = false;
+	if (bForceRebuild)
+	{
+		bChanged = !StatAggregates.IsEmpty();
+		StatAggregates.Reset();
+		StatIndices.Reset();
+		SlotDefinitionIDs.Reset();
+	}
+	SlotDefinitionIDs.SetNum(Slots.Num());
+
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+	{
+		FName CurrentDefID = NAME_None;
+		const int32 ContainerSlotIndex = bHasContainer ? Container.GetSlotIndexByID(SlotIndex) : INDEX_NONE;
+		FGaiaItemInstance Item;
+		if (ContainerSlotIndex != INDEX_NONE && !Container.Slots[ContainerSlotIndex].IsEmpty()
+			&& InventorySystem->FindItemByUID(Container.Slots[ContainerSlotIndex].ItemInstanceUID, Item))
+		{
+			CurrentDefID = Item.ItemDefinitionID;
+		}
+
+		if (CurrentDefID == SlotDefinitionIDs[SlotIndex])
+		{
+			continue;
+		}
+
+		bChanged |= ApplyDefinitionModifiers(SlotDefinitionIDs[SlotIndex], -1);
+		bChanged |= ApplyDefinitionModifiers(CurrentDefID, 1);
+		SlotDefinitionIDs[SlotIndex] = CurrentDefID;
+	}
+
+	if (bChanged)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(UGaiaEquipmentComponent, StatAggregates, this);
+		OnStatsChanged.Broadcast();
+	}
+}
+
+bool UGaiaEquipmentComponent::ApplyDefinitionModifiers(FName ItemDefID, int32 Sign)
+{
+	const FGaiaItemDefinition* ItemDef = ItemDefID.IsNone() ? nullptr : UGaiaInventorySubsystem::FindItemDefinition(ItemDefID);
+	if (!ItemDef || ItemDef->StatModifiers.IsEmpty())
+	{
+		return false;
+	}
+
+	bool bChanged = false;
+	bool bHasEmptyEntries = false;
+	for (const FGaiaStatModifier& Modifier : ItemDef->StatModifiers)
+	{
+		if (!Modifier.StatTag.IsValid())
+		{
+			continue;
+		}
+
+		int32 AggregateIndex = INDEX_NONE;
+		if (const int32* Found = StatIndices.Find(Modifier.StatTag))
+		{
+			AggregateIndex = *Found;
+		}
+		else if (Sign > 0)
+		{
+			AggregateIndex = StatAggregates.AddDefaulted();
+			StatAggregates[AggregateIndex].StatTag = Modifier.StatTag;
+			StatIndices.Add(Modifier.StatTag, AggregateIndex);
+		}
+		else
+		{
+			continue;
+		}
+
+		FGaiaStatAggregate& Aggregate = StatAggregates[AggregateIndex];
+		Aggregate.Additive += Sign * Modifier.Additive;
+		Aggregate.Multiplicative += Sign * Modifier.Multiplicative;
+		Aggregate.SourceCount += Sign;
+		bHasEmptyEntries |= Aggregate.SourceCount <= 0;
+		bChanged = true;
+	}
+
+	if (bHasEmptyEntries)
+	{
+		StatAggregates.RemoveAll([](const FGaiaStatAggregate& Aggregate)
+		{
+			return Aggregate.SourceCount <= 0;
+		});
+		RebuildStatIndices();
+	}
+	return bChanged;
+}
+
+void UGaiaEquipmentComponent::RebuildStatIndices()
+{
+	StatIndices.Reset();
+	for (int32 Index = 0; Index < StatAggregates.Num(); ++Index)
+	{
+		StatIndices.Add(StatAggregates[Index].StatTag, Index);
+	}
+}
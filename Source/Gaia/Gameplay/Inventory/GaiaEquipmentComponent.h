@@ -0,0 +1,242 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaEquipmentComponent.generated.h"
+
+class UGaiaInventorySubsystem;
+
+/** 装备属性汇总变化事件 */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnEquipmentStatsChanged);
+
+/**
+ * 装备槽定义
+ * 第 N 个装备槽对应装备容器中槽位ID为 N 的槽位
+ */
+USTRUCT(BlueprintType)
+struct FGaiaEquipmentSlotDefinition
+{
+	GENERATED_BODY()
+
+	/** 装备槽标签（如 Equipment.Slot.Head） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Equipment Slot")
+	FGameplayTag SlotTag;
+
+	/** 允许装备的物品标签（规则同容器定义的 AllowedItemTags，为空时不允许任何物品） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Equipment Slot")
+	FGameplayTagContainer AllowedItemTags;
+
+	/** 物品是否可以装备到此槽位 */
+	bool AcceptsItem(const FGaiaItemDefinition& ItemDef) const
+	{
+		for (const FGameplayTag& ItemTag : ItemDef.ItemTags)
+		{
+			if (AllowedItemTags.HasTag(ItemTag))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * 单个属性的汇总值
+ * 最终值 = (基础值 + Additive) * (1 + Multiplicative)
+ */
+USTRUCT(BlueprintType)
+struct FGaiaStatAggregate
+{
+	GENERATED_BODY()
+
+	/** 属性标签 */
+	UPROPERTY(BlueprintReadOnly, Category = "Stat Aggregate")
+	FGameplayTag StatTag;
+
+	/** 加值之和 */
+	UPROPERTY(BlueprintReadOnly, Category = "Stat Aggregate")
+	float Additive = 0.0f;
+
+	/** 乘数加成之和 */
+	UPROPERTY(BlueprintReadOnly, Category = "Stat Aggregate")
+	float Multiplicative = 0.0f;
+
+	/** 计入的修正条数（降为0时移除整项，反复加减不会留下浮点误差；只在服务器使用，不复制） */
+	UPROPERTY(NotReplicated)
+	int32 SourceCount = 0;
+
+	/** 按基础值计算最终值 */
+	float Evaluate(float BaseValue) const
+	{
+		return (BaseValue + Additive) * (1.0f + Multiplicative);
+	}
+};
+
+/**
+ * 装备组件
+ *
+ * 装备槽由一个库存容器承载（槽位ID = 装备槽下标），装备/卸下就是在该容器和背包之间移动物品，
+ * 因此存档、日志、网络推送都沿用库存系统。组件维护已装备物品的属性修正汇总：
+ * - 订阅库存子系统按根容器广播的定义数量变化，只比较装备容器的直接槽位，
+ *   只对内容变化的装备槽减去旧物品、加上新物品的修正（O(装备槽数)，不重算全部）
+ * - 汇总按属性标签索引，角色读取属性为 O(1)
+ * - 汇总数组使用推送模型复制，只有汇总实际变化时才标记脏并发送
+ *
+ * 使用方式：
+ * - 挂载在 PlayerState 上（与 UGaiaInventoryRPCComponent 同一Actor时自动登记为玩家拥有的容器）
+ * - 启用玩家分片时装备容器是分片的根容器，登录时按容器定义找回；未启用时 BeginPlay 直接创建
+ * - 配置 Slots 和 ContainerDefinitionID（容器定义的槽位数不少于装备槽数，标签允许所有装备）
+ * - 客户端通过 UGaiaInventoryRPCComponent::RequestEquipItem/RequestUnequipItem 发起请求
+ */
+UCLASS(ClassGroup=(Inventory), meta=(BlueprintSpawnableComponent))
+class GAIAGAME_API UGaiaEquipmentComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGaiaEquipmentComponent();
+
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	//~ End UActorComponent Interface
+
+	//~BEGIN 装备操作（仅服务器）
+
+	/**
+	 * 使用已有的装备容器，替换当前容器并重建汇总
+	 * 装备槽的标签限制登记到库存子系统，任何途径移入装备容器都要遵守
+	 * @param InContainerUID 装备容器UID
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Equipment")
+	void SetEquipmentContainer(const FGuid& InContainerUID);
+
+	/**
+	 * 从玩家分片的根容器中找回装备容器（容器定义为 ContainerDefinitionID 的那个），没有时创建
+	 * 由 UGaiaInventorySubsystem::HandlePlayerLogin 在设置分片ID之后调用，新建的容器随分片保存
+	 * @param RootContainerUIDs 分片的根容器
+	 */
+	void RestoreEquipmentContainer(const TArray<FGuid>& RootContainerUIDs);
+
+	/**
+	 * 装备物品
+	 * 目标装备槽已有物品时，先把它放回新物品原来所在的容器
+	 * 不检查物品归属，代客户端调用时由调用方检查（见 UGaiaInventoryRPCComponent::ServerEquipItem）
+	 * @param ItemUID 物品UID（可堆叠物品只装备一个）
+	 * @param SlotIndex 装备槽下标（INDEX_NONE 表示第一个可用的装备槽，优先空槽）
+	 * @return 移动结果
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Equipment")
+	FMoveItemResult EquipItem(const FGuid& ItemUID, int32 SlotIndex = -1);
+
+	/**
+	 * 卸下装备
+	 * @param SlotIndex 装备槽下标
+	 * @param TargetContainerUID 放入的容器（自动分配槽位，不检查归属）
+	 * @return 移动结果
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Equipment")
+	FMoveItemResult UnequipItem(int32 SlotIndex, const FGuid& TargetContainerUID);
+
+	//~END 装备操作
+
+	//~BEGIN 查询
+
+	/** 获取装备容器UID */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Equipment")
+	FGuid GetEquipmentContainerUID() const { return EquipmentContainerUID; }
+
+	/** 获取装备槽定义 */
+	const TArray<FGaiaEquipmentSlotDefinition>& GetSlots() const { return Slots; }
+
+	/** 获取装备容器定义ID */
+	FName GetContainerDefinitionID() const { return ContainerDefinitionID; }
+
+	/** 按标签查找装备槽下标（不存在返回 INDEX_NONE） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Equipment")
+	int32 FindSlotIndex(FGameplayTag SlotTag) const;
+
+	/** 获取装备槽中的物品UID（仅服务器） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Equipment")
+	FGuid GetEquippedItemUID(int32 SlotIndex) const;
+
+	/**
+	 * 获取属性最终值（O(1)，服务器和客户端都可调用）
+	 * @param StatTag 属性标签
+	 * @param BaseValue 角色的基础值
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Equipment")
+	float GetStatValue(FGameplayTag StatTag, float BaseValue) const;
+
+	/** 获取属性汇总（没有任何装备修正该属性时返回false） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Equipment")
+	bool GetStatAggregate(FGameplayTag StatTag, FGaiaStatAggregate& OutAggregate) const;
+
+	/** 获取所有属性汇总 */
+	const TArray<FGaiaStatAggregate>& GetStatAggregates() const { return StatAggregates; }
+
+	//~END 查询
+
+	/** 属性汇总变化（服务器在库存修改后、客户端在收到复制后触发） */
+	UPROPERTY(BlueprintAssignable, Category = "Gaia|Equipment")
+	FOnEquipmentStatsChanged OnStatsChanged;
+
+protected:
+	/** 装备槽 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gaia|Equipment")
+	TArray<FGaiaEquipmentSlotDefinition> Slots;
+
+	/** 装备容器定义ID（装备容器不存在时用于创建） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gaia|Equipment")
+	FName ContainerDefinitionID;
+
+	/** 装备容器UID */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Gaia|Equipment")
+	FGuid EquipmentContainerUID;
+
+	/** 属性汇总（推送模型复制） */
+	UPROPERTY(ReplicatedUsing = OnRep_StatAggregates)
+	TArray<FGaiaStatAggregate> StatAggregates;
+
+	UFUNCTION()
+	void OnRep_StatAggregates();
+
+private:
+	/** 获取库存子系统 */
+	UGaiaInventorySubsystem* GetInventorySubsystem() const;
+
+	/** 库存子系统：根容器的定义数量变化 */
+	void HandleRootDefinitionCountsChanged(const FGuid& RootContainerUID, const TArray<FName>& ChangedDefinitionIDs);
+
+	/** 库存子系统：数量索引整体重建 */
+	void HandleRootDefinitionCountsReset();
+
+	/**
+	 * 比较装备容器的直接槽位与已计入的定义，只对变化的装备槽更新汇总
+	 * @param bForceRebuild 清空汇总后全部重新计入
+	 */
+	void SyncEquippedSlots(bool bForceRebuild = false);
+
+	/**
+	 * 计入或移除一件装备的属性修正
+	 * @param Sign 1 计入，-1 移除
+	 * @return 汇总是否变化
+	 */
+	bool ApplyDefinitionModifiers(FName ItemDefID, int32 Sign);
+
+	/** 重建属性标签索引 */
+	void RebuildStatIndices();
+
+	/** 属性标签 -> StatAggregates 下标 */
+	TMap<FGameplayTag, int32> StatIndices;
+
+	/** 每个装备槽当前计入汇总的物品定义（空槽为 NAME_None） */
+	TArray<FName> SlotDefinitionIDs;
+
+	FDelegateHandle CountsChangedHandle;
+	FDelegateHandle CountsResetHandle;
+};
@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaInventoryIdAllocator.h"
+#include "GaiaLogChannels.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FGaiaBlockIdAllocator::FGaiaBlockIdAllocator(uint16 InServerId, const FString& InStateFilePath, uint32 InBlockSize)
+	: ServerId(InServerId)
+	, StateFilePath(InStateFilePath)
+	, BlockSize(FMath::Max<uint32>(InBlockSize, 1))
+{
+}
+
+FGuid FGaiaBlockIdAllocator::AllocateUID()
+{
+	if (NextCounter >= BlockEnd && !ReserveBlock())
+	{
+		return FGuid::NewGuid();
+	}
+
+	return FGaiaInventoryId::ToGuid(FGaiaInventoryId::Make(ServerId, NextCounter++));
+}
+
+void FGaiaBlockIdAllocator::NotifyExistingUID(const FGuid& UID)
+{
+	uint64 Id = 0;
+	if (!FGaiaInventoryId::TryGetId(UID, Id) || FGaiaInventoryId::GetServerId(Id) != ServerId)
+	{
+		return;
+	}
+
+	// 存档里有超过当前位置的ID（例如状态文件丢失），跳过它，并在下次分配时重新预留
+	const uint64 Counter = FGaiaInventoryId::GetCounter(Id);
+	if (Counter >= NextCounter)
+	{
+		NextCounter = Counter + 1;
+		BlockEnd = FMath::Min(BlockEnd, NextCounter);
+	}
+}
+
+bool FGaiaBlockIdAllocator::ReserveBlock()
+{
+	if (bStateCorrupt)
+	{
+		return false;
+	}
+
+	uint64 HighWater = 0;
+	if (!bStateLoaded)
+	{
+		TArray<uint8> Data;
+		if (FFileHelper::LoadFileToArray(Data, *StateFilePath, FILEREAD_Silent))
+		{
+			FMemoryReader Ar(Data);
+			Ar << HighWater;
+			if (Ar.IsError())
+			{
+				UE_LOG(LogGaia, Error, TEXT("[库存ID] 状态文件损坏，本次运行退化为随机GUID: %s"), *StateFilePath);
+				bStateCorrupt = true;
+				return false;
+			}
+		}
+		bStateLoaded = true;
+	}
+
+	const uint64 BlockStart = FMath::Max(NextCounter, HighWater);
+	const uint64 NewBlockEnd = BlockStart + BlockSize;
+	if (NewBlockEnd > FGaiaInventoryId::MaxCounter)
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存ID] 服务器 %d 的计数器已耗尽"), ServerId);
+		return false;
+	}
+
+	// 新高水位落盘之后才能发放这一块
+	TArray<uint8> Data;
+	FMemoryWriter Ar(Data);
+	uint64 NewHighWater = NewBlockEnd;
+	Ar << NewHighWater;
+
+	const FString TempPath = StateFilePath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Data, *TempPath) || !IFileManager::Get().Move(*StateFilePath, *TempPath, true))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存ID] 无法写入状态文件，退化为随机GUID: %s"), *StateFilePath);
+		return false;
+	}
+
+	NextCounter = BlockStart;
+	BlockEnd = NewBlockEnd;
+
+	UE_LOG(LogGaia, Verbose, TEXT("[库存ID] 服务器 %d 预留计数 [%llu, %llu)"), ServerId, BlockStart, NewBlockEnd);
+	return true;
+}
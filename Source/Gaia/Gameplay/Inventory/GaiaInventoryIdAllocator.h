@@ -0,0 +1,116 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 服务器发放的64位库存ID
+ *
+ * 布局：高16位服务器ID + 低48位递增计数器。
+ * 现有接口仍使用 FGuid，ID 通过固定标记嵌入 FGuid（A=标记，B=0，C/D=ID高低32位），
+ * 随机 GUID 恰好撞上这个形状的概率可以忽略；存档按形状识别，只写8字节。
+ */
+struct GAIAGAME_API FGaiaInventoryId
+{
+	/** 嵌入 FGuid 时的标记 'GAID' */
+	static constexpr uint32 GuidMarker = 0x44494147;
+
+	/** 计数器位数 */
+	static constexpr int32 CounterBits = 48;
+
+	static constexpr uint64 MaxCounter = (uint64(1) << CounterBits) - 1;
+
+	static uint64 Make(uint16 ServerId, uint64 Counter)
+	{
+		return (uint64(ServerId) << CounterBits) | (Counter & MaxCounter);
+	}
+
+	static uint16 GetServerId(uint64 Id) { return static_cast<uint16>(Id >> CounterBits); }
+	static uint64 GetCounter(uint64 Id) { return Id & MaxCounter; }
+
+	/** 64位ID转换为兼容的 FGuid */
+	static FGuid ToGuid(uint64 Id)
+	{
+		return FGuid(GuidMarker, 0, static_cast<uint32>(Id >> 32), static_cast<uint32>(Id));
+	}
+
+	/** FGuid 是否由64位ID转换而来，是则输出ID */
+	static bool TryGetId(const FGuid& Guid, uint64& OutId)
+	{
+		if (Guid.A != GuidMarker || Guid.B != 0)
+		{
+			return false;
+		}
+		OutId = (uint64(Guid.C) << 32) | Guid.D;
+		return true;
+	}
+};
+
+/**
+ * 库存UID分配器接口（游戏线程）
+ * 子系统创建物品和容器时通过它取得UID，可以用 UGaiaInventorySubsystem::SetIdAllocator 替换
+ */
+class GAIAGAME_API IGaiaInventoryIdAllocator
+{
+public:
+	virtual ~IGaiaInventoryIdAllocator() = default;
+
+	/** 分配一个新的UID */
+	virtual FGuid AllocateUID() = 0;
+
+	/** 加载存档后调用，保证之后分配的UID不与已有UID重复 */
+	virtual void NotifyExistingUID(const FGuid& UID) {}
+};
+
+/** 随机GUID分配器（每次调用 FGuid::NewGuid） */
+class GAIAGAME_API FGaiaRandomGuidAllocator : public IGaiaInventoryIdAllocator
+{
+public:
+	virtual FGuid AllocateUID() override { return FGuid::NewGuid(); }
+};
+
+/**
+ * 按块预留的递增ID分配器
+ *
+ * 每次从状态文件记录的高水位预留一整块计数值，先把新高水位写入文件再开始发放，
+ * 块内分配只是计数器自增。崩溃后从下一块开始，最多浪费一块，不会重复发放。
+ * 状态文件写入失败时退化为随机GUID，保证UID唯一；状态文件损坏时本次运行一直使用随机GUID。
+ */
+class GAIAGAME_API FGaiaBlockIdAllocator : public IGaiaInventoryIdAllocator
+{
+public:
+	/**
+	 * @param InServerId 服务器ID（多台服务器共享存档时必须互不相同）
+	 * @param InStateFilePath 高水位状态文件完整路径
+	 * @param InBlockSize 每次预留的计数值个数
+	 */
+	FGaiaBlockIdAllocator(uint16 InServerId, const FString& InStateFilePath, uint32 InBlockSize = 65536);
+
+	//~ Begin IGaiaInventoryIdAllocator Interface
+	virtual FGuid AllocateUID() override;
+	virtual void NotifyExistingUID(const FGuid& UID) override;
+	//~ End IGaiaInventoryIdAllocator Interface
+
+	uint16 GetServerId() const { return ServerId; }
+
+private:
+	/** 预留下一块并持久化高水位 */
+	bool ReserveBlock();
+
+	uint16 ServerId;
+	FString StateFilePath;
+	uint64 BlockSize;
+
+	/** 下一个要发放的计数值 */
+	uint64 NextCounter = 0;
+
+	/** 当前块的结束计数值（不含） */
+	uint64 BlockEnd = 0;
+
+	/** 是否已读取状态文件 */
+	bool bStateLoaded = false;
+
+	/** 状态文件损坏（只读取和报告一次，之后直接退化为随机GUID） */
+	bool bStateCorrupt = false;
+};
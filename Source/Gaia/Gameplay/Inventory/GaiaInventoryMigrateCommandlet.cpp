@@ -0,0 +1,580 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaInventoryMigrateCommandlet.h"
+#include "GaiaDefinitionDatabase.h"
+#include "GaiaInventoryIdAllocator.h"
+#include "GaiaInventoryPersistence.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaLogChannels.h"
+#include "DataRegistrySubsystem.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaInventoryMigrateCommandlet)
+
+// ========================================
+// 迁移过程
+// ========================================
+
+namespace GaiaInventoryMigrate
+{
+	/** 迁移统计 */
+	struct FStats
+	{
+		int32 NumItems = 0;
+		int32 NumContainers = 0;
+		int32 RemappedItems = 0;
+		int32 RemappedContainers = 0;
+		int32 RemovedItems = 0;
+		int32 RemovedContainers = 0;
+		int32 SplitStacks = 0;
+		int32 ResizedContainers = 0;
+		int32 OrphanedItems = 0;
+		int32 ClearedReferences = 0;
+	};
+
+	/**
+	 * 定义ID解析（带缓存）
+	 * 每个旧ID只查一次定义表，不存在的定义只报告一次
+	 */
+	class FDefinitionResolver
+	{
+	public:
+		bool LoadRemapFile(const FString& FilePath, FString& OutError)
+		{
+			TArray<FString> Lines;
+			if (!FFileHelper::LoadFileToStringArray(Lines, *FilePath))
+			{
+				OutError = FString::Printf(TEXT("无法读取重映射文件: %s"), *FilePath);
+				return false;
+			}
+
+			for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+			{
+				const FString Line = Lines[LineIndex].TrimStartAndEnd();
+				if (Line.IsEmpty() || Line.StartsWith(TEXT("#")))
+				{
+					continue;
+				}
+
+				TArray<FString> Tokens;
+				Line.ParseIntoArrayWS(Tokens);
+				TMap<FName, FName>* Remap = Tokens.Num() != 3 ? nullptr
+					: Tokens[0] == TEXT("Item") ? &ItemRemap
+					: Tokens[0] == TEXT("Container") ? &ContainerRemap
+					: nullptr;
+				if (!Remap)
+				{
+					OutError = FString::Printf(TEXT("重映射文件第 %d 行格式错误: %s"), LineIndex + 1, *Line);
+					return false;
+				}
+				Remap->Add(FName(*Tokens[1]), FName(*Tokens[2]));
+			}
+			return true;
+		}
+
+		/**
+		 * 解析物品定义
+		 * @param InOutDefID 旧ID，输出重映射后的ID
+		 * @return 定义（被删除或不存在时返回nullptr）
+		 */
+		const FGaiaItemDefinition* ResolveItem(FName& InOutDefID)
+		{
+			return Resolve(ItemRemap, ItemCache, InOutDefID, &UGaiaInventorySubsystem::FindItemDefinition, TEXT("物品"));
+		}
+
+		const FGaiaContainerDefinition* ResolveContainer(FName& InOutDefID)
+		{
+			return Resolve(ContainerRemap, ContainerCache, InOutDefID, &UGaiaInventorySubsystem::FindContainerDefinition, TEXT("容器"));
+		}
+
+	private:
+		template <typename T>
+		struct TCacheEntry
+		{
+			FName NewDefID;
+			const T* Definition = nullptr;
+		};
+
+		template <typename T>
+		static const T* Resolve(
+			const TMap<FName, FName>& Remap,
+			TMap<FName, TCacheEntry<T>>& Cache,
+			FName& InOutDefID,
+			const T* (*FindDefinition)(FName),
+			const TCHAR* Kind)
+		{
+			if (const TCacheEntry<T>* Cached = Cache.Find(InOutDefID))
+			{
+				InOutDefID = Cached->NewDefID;
+				return Cached->Definition;
+			}
+
+			TCacheEntry<T>& Entry = Cache.Add(InOutDefID);
+			const FName* Mapped = Remap.Find(InOutDefID);
+			Entry.NewDefID = Mapped ? *Mapped : InOutDefID;
+			Entry.Definition = Entry.NewDefID.IsNone() ? nullptr : FindDefinition(Entry.NewDefID);
+
+			if (!Entry.Definition)
+			{
+				UE_LOG(LogGaia, Warning, TEXT("[库存迁移] %s定义 %s %s"), Kind, *InOutDefID.ToString(),
+					Mapped && Mapped->IsNone() ? TEXT("已按重映射删除") : TEXT("不存在"));
+			}
+
+			InOutDefID = Entry.NewDefID;
+			return Entry.Definition;
+		}
+
+		TMap<FName, FName> ItemRemap;
+		TMap<FName, FName> ContainerRemap;
+		TMap<FName, TCacheEntry<FGaiaItemDefinition>> ItemCache;
+		TMap<FName, TCacheEntry<FGaiaContainerDefinition>> ContainerCache;
+	};
+
+	class FMigrator
+	{
+	public:
+		FMigrator(const FGaiaInventoryMigrateOptions& InOptions)
+			: Options(InOptions)
+			, IdAllocator(UGaiaInventorySubsystem::GetDefaultIdAllocator())
+		{
+		}
+
+		FDefinitionResolver Resolver;
+		FStats Stats;
+
+		/**
+		 * 第一遍：记录所有容器，以及迁移后不再保留的容器
+		 * 容器被删除的情况：定义不存在，或者拥有它的物品被删除/不再带容器
+		 */
+		void ScanBucket(const TMap<FGuid, FGaiaItemInstance>& ItemMap, const TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+		{
+			for (const auto& ContainerPair : ContainerMap)
+			{
+				ExistingContainers.Add(ContainerPair.Key);
+				IdAllocator->NotifyExistingUID(ContainerPair.Key);
+
+				FName DefID = ContainerPair.Value.ContainerDefinitionID;
+				if (!Resolver.ResolveContainer(DefID) && !Options.bKeepUnknown)
+				{
+					RemovedContainers.Add(ContainerPair.Key);
+				}
+			}
+
+			for (const auto& ItemPair : ItemMap)
+			{
+				IdAllocator->NotifyExistingUID(ItemPair.Key);
+
+				const FGaiaItemInstance& Item = ItemPair.Value;
+				if (!Item.HasContainer())
+				{
+					continue;
+				}
+
+				FName DefID = Item.ItemDefinitionID;
+				const FGaiaItemDefinition* Definition = Resolver.ResolveItem(DefID);
+				const bool bItemKept = Definition || Options.bKeepUnknown;
+				if (!bItemKept || (Definition && !Definition->bHasContainer))
+				{
+					RemovedContainers.Add(Item.OwnedContainerUID);
+				}
+			}
+		}
+
+		/**
+		 * 第二遍：迁移一组物品和容器（一个桶或整个快照）
+		 * @param OutOrphans 非空时，迁移后的游离物品移到这里（桶模式由调用方逐桶追加到游离物品桶）
+		 */
+		void MigrateBucket(TMap<FGuid, FGaiaItemInstance>& ItemMap, TMap<FGuid, FGaiaContainerInstance>& ContainerMap, TMap<FGuid, FGaiaItemInstance>* OutOrphans)
+		{
+			for (auto It = ContainerMap.CreateIterator(); It; ++It)
+			{
+				++Stats.NumContainers;
+				if (RemovedContainers.Contains(It.Key()))
+				{
+					++Stats.RemovedContainers;
+					It.RemoveCurrent();
+					continue;
+				}
+				MigrateContainer(It.Value());
+			}
+
+			// 需要重新放置的物品（拆出的堆叠、被移出槽位的物品） -> 目标容器
+			TArray<TPair<FGuid, FGuid>> PendingPlacements;
+			TArray<FGaiaItemInstance> SplitItems;
+
+			for (auto It = ItemMap.CreateIterator(); It; ++It)
+			{
+				++Stats.NumItems;
+				FGaiaItemInstance& Item = It.Value();
+
+				const FName OldDefID = Item.ItemDefinitionID;
+				const FGaiaItemDefinition* Definition = Resolver.ResolveItem(Item.ItemDefinitionID);
+				if ((!Definition && !Options.bKeepUnknown) || Item.Quantity <= 0)
+				{
+					++Stats.RemovedItems;
+					It.RemoveCurrent();
+					continue;
+				}
+				if (Item.ItemDefinitionID != OldDefID)
+				{
+					++Stats.RemappedItems;
+				}
+
+				if (Item.HasContainer() && (RemovedContainers.Contains(Item.OwnedContainerUID) || !ExistingContainers.Contains(Item.OwnedContainerUID)))
+				{
+					++Stats.ClearedReferences;
+					Item.OwnedContainerUID = FGuid();
+				}
+
+				if (Item.IsInContainer() && RemovedContainers.Contains(Item.CurrentContainerUID))
+				{
+					++Stats.OrphanedItems;
+					Item.CurrentContainerUID = FGuid();
+					Item.CurrentSlotID = INDEX_NONE;
+				}
+
+				// 拆出的堆叠放回物品原来所在的容器
+				const FGuid HomeContainerUID = Item.CurrentContainerUID;
+				const FGaiaContainerInstance* HomeContainer = Item.IsInContainer() ? ContainerMap.Find(Item.CurrentContainerUID) : nullptr;
+				if (HomeContainer && HomeContainer->GetSlotIndexByID(Item.CurrentSlotID) == INDEX_NONE)
+				{
+					// 槽位随定义缩减，换到同一容器的空槽位
+					PendingPlacements.Emplace(Item.InstanceUID, HomeContainerUID);
+					Item.CurrentContainerUID = FGuid();
+					Item.CurrentSlotID = INDEX_NONE;
+				}
+
+				const int32 StackLimit = Definition ? (Definition->IsStackable() ? FMath::Max(Definition->MaxStackSize, 1) : 1) : MAX_int32;
+				if (Item.Quantity > StackLimit)
+				{
+					++Stats.SplitStacks;
+					for (int32 Excess = Item.Quantity - StackLimit; Excess > 0; Excess -= StackLimit)
+					{
+						FGaiaItemInstance& Split = SplitItems.AddDefaulted_GetRef();
+						Split.InstanceUID = IdAllocator->AllocateUID();
+						Split.ItemDefinitionID = Item.ItemDefinitionID;
+						Split.Quantity = FMath::Min(Excess, StackLimit);
+						PendingPlacements.Emplace(Split.InstanceUID, HomeContainerUID);
+					}
+					Item.Quantity = StackLimit;
+				}
+			}
+
+			for (FGaiaItemInstance& Split : SplitItems)
+			{
+				ItemMap.Add(Split.InstanceUID, MoveTemp(Split));
+			}
+
+			FGaiaInventorySerializer::RebuildDerivedData(ItemMap, ContainerMap);
+
+			for (const TPair<FGuid, FGuid>& Placement : PendingPlacements)
+			{
+				FGaiaContainerInstance* Container = Placement.Value.IsValid() ? ContainerMap.Find(Placement.Value) : nullptr;
+				FGaiaItemInstance& Item = ItemMap.FindChecked(Placement.Key);
+
+				// 网格容器按占地找位置，占用表在第一次放入时建立
+				const FGaiaContainerDefinition* ContainerDef = Container ? UGaiaInventorySubsystem::FindContainerDefinition(Container->ContainerDefinitionID) : nullptr;
+				const FGaiaItemDefinition* ItemDef = UGaiaInventorySubsystem::FindItemDefinition(Item.ItemDefinitionID);
+				const bool bGrid = ContainerDef && ContainerDef->bUseGridLayout && ItemDef;
+				bool bRotated = false;
+				int32 SlotID = INDEX_NONE;
+				if (bGrid)
+				{
+					if (Container->GridRows.IsEmpty())
+					{
+						UGaiaInventorySubsystem::RebuildGridOccupancy(*Container, ItemMap);
+					}
+					SlotID = UGaiaInventorySubsystem::FindPlacementSlot(*Container, *ContainerDef, *ItemDef, false, bRotated);
+				}
+				else if (Container)
+				{
+					SlotID = Container->FindEmptySlotID();
+				}
+
+				const int32 SlotIndex = Container ? Container->GetSlotIndexByID(SlotID) : INDEX_NONE;
+				if (SlotIndex == INDEX_NONE)
+				{
+					if (Placement.Value.IsValid())
+					{
+						++Stats.OrphanedItems;
+					}
+					continue;
+				}
+
+				Item.CurrentContainerUID = Container->ContainerUID;
+				Item.CurrentSlotID = SlotID;
+				Item.bRotated = bRotated;
+				Container->Slots[SlotIndex].ItemInstanceUID = Item.InstanceUID;
+
+				if (bGrid)
+				{
+					UGaiaInventorySubsystem::RebuildGridOccupancy(*Container, ItemMap);
+				}
+			}
+
+			if (OutOrphans)
+			{
+				for (auto It = ItemMap.CreateIterator(); It; ++It)
+				{
+					if (It.Value().IsOrphan())
+					{
+						OutOrphans->Add(It.Key(), MoveTemp(It.Value()));
+						It.RemoveCurrent();
+					}
+				}
+			}
+		}
+
+		const FGaiaInventoryMigrateOptions& Options;
+
+	private:
+		/** 重映射容器定义，槽位数按新定义调整（只增删末尾槽位，已有槽位ID不变） */
+		void MigrateContainer(FGaiaContainerInstance& Container)
+		{
+			const FName OldDefID = Container.ContainerDefinitionID;
+			const FGaiaContainerDefinition* Definition = Resolver.ResolveContainer(Container.ContainerDefinitionID);
+			if (Container.ContainerDefinitionID != OldDefID)
+			{
+				++Stats.RemappedContainers;
+			}
+
+			const int32 SlotCount = Definition ? Definition->GetSlotCount() : Container.Slots.Num();
+			if (SlotCount == Container.Slots.Num())
+			{
+				return;
+			}
+
+			++Stats.ResizedContainers;
+			if (SlotCount < Container.Slots.Num())
+			{
+				Container.Slots.SetNum(SlotCount);
+				return;
+			}
+
+			int32 NextSlotID = 0;
+			for (const FGaiaSlotInfo& Slot : Container.Slots)
+			{
+				NextSlotID = FMath::Max(NextSlotID, Slot.SlotID + 1);
+			}
+			while (Container.Slots.Num() < SlotCount)
+			{
+				Container.Slots.Add(FGaiaSlotInfo(NextSlotID++));
+			}
+		}
+
+		TSharedPtr<IGaiaInventoryIdAllocator> IdAllocator;
+
+		/** 输入中的所有容器 */
+		TSet<FGuid> ExistingContainers;
+
+		/** 迁移后删除的容器 */
+		TSet<FGuid> RemovedContainers;
+	};
+
+	static bool MigrateDirectory(FMigrator& Migrator, FString& OutError)
+	{
+		const FGaiaInventoryMigrateOptions& Options = Migrator.Options;
+
+		IFileManager& FileManager = IFileManager::Get();
+		TArray<FString> ExistingFiles;
+		FileManager.FindFiles(ExistingFiles, *FPaths::Combine(Options.OutputPath, TEXT("*")), true, false);
+		if (ExistingFiles.Num() > 0)
+		{
+			OutError = FString::Printf(TEXT("输出目录不为空: %s"), *Options.OutputPath);
+			return false;
+		}
+		if (!FileManager.MakeDirectory(*Options.OutputPath, true))
+		{
+			OutError = FString::Printf(TEXT("无法创建输出目录: %s"), *Options.OutputPath);
+			return false;
+		}
+
+		if (!FGaiaInventoryContainerStore::ForEachBucket(Options.InputPath,
+			[&Migrator](TMap<FGuid, FGaiaItemInstance>& ItemMap, TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+			{
+				Migrator.ScanBucket(ItemMap, ContainerMap);
+				return true;
+			}, OutError))
+		{
+			return false;
+		}
+
+		// 每个桶产生的游离物品直接追加到输出的游离物品桶，不在内存中累积
+		FGaiaInventoryContainerStore::FOrphanBucketWriter OrphanWriter;
+		if (!OrphanWriter.Open(Options.OutputPath))
+		{
+			OutError = FString::Printf(TEXT("无法写入输出目录: %s"), *Options.OutputPath);
+			return false;
+		}
+
+		TMap<FGuid, FGaiaItemInstance> OrphanItems;
+		FGaiaInventorySnapshot Bucket;
+		bool bWriteFailed = false;
+		if (!FGaiaInventoryContainerStore::ForEachBucket(Options.InputPath,
+			[&Migrator, &OrphanItems, &OrphanWriter, &Bucket, &bWriteFailed, &Options](TMap<FGuid, FGaiaItemInstance>& ItemMap, TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+			{
+				OrphanItems.Reset();
+				Migrator.MigrateBucket(ItemMap, ContainerMap, &OrphanItems);
+				for (const auto& ContainerPair : ContainerMap)
+				{
+					FGaiaInventoryContainerStore::CaptureContainerBucket(ContainerPair.Value, ItemMap, Bucket);
+					if (!FGaiaInventoryContainerStore::WriteBucketFile(Options.OutputPath, Bucket))
+					{
+						bWriteFailed = true;
+						return false;
+					}
+				}
+
+				if (OrphanItems.Num() > 0)
+				{
+					FGaiaInventorySerializer::CaptureSnapshot(OrphanItems, TMap<FGuid, FGaiaContainerInstance>(), Bucket);
+					if (!OrphanWriter.Append(Bucket))
+					{
+						bWriteFailed = true;
+						return false;
+					}
+				}
+				return true;
+			}, OutError))
+		{
+			if (bWriteFailed)
+			{
+				OutError = FString::Printf(TEXT("无法写入输出目录: %s"), *Options.OutputPath);
+			}
+			return false;
+		}
+
+		if (!OrphanWriter.Close())
+		{
+			OutError = FString::Printf(TEXT("无法写入输出目录: %s"), *Options.OutputPath);
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool MigrateSnapshotFile(FMigrator& Migrator, FString& OutError)
+	{
+		const FGaiaInventoryMigrateOptions& Options = Migrator.Options;
+
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *Options.InputPath))
+		{
+			OutError = FString::Printf(TEXT("无法读取: %s"), *Options.InputPath);
+			return false;
+		}
+
+		// 快照文件是单个整体，只能整体载入
+		TMap<FGuid, FGaiaItemInstance> ItemMap;
+		TMap<FGuid, FGaiaContainerInstance> ContainerMap;
+		if (!FGaiaInventorySerializer::Load(Data, ItemMap, ContainerMap, OutError))
+		{
+			return false;
+		}
+
+		Migrator.ScanBucket(ItemMap, ContainerMap);
+		Migrator.MigrateBucket(ItemMap, ContainerMap, nullptr);
+
+		FGaiaInventorySaveStats SaveStats;
+		if (!FGaiaInventorySerializer::Save(ItemMap, ContainerMap, Data, OutError))
+		{
+			return false;
+		}
+		if (!FGaiaInventorySerializer::WriteToFile(Data, Options.OutputPath, SaveStats))
+		{
+			OutError = SaveStats.Error;
+			return false;
+		}
+		return true;
+	}
+}
+
+// ========================================
+// 命令行
+// ========================================
+
+UGaiaInventoryMigrateCommandlet::UGaiaInventoryMigrateCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UGaiaInventoryMigrateCommandlet::Main(const FString& Params)
+{
+	FGaiaInventoryMigrateOptions Options;
+	FParse::Value(*Params, TEXT("Input="), Options.InputPath);
+	FParse::Value(*Params, TEXT("Output="), Options.OutputPath);
+	FParse::Value(*Params, TEXT("Remap="), Options.RemapFilePath);
+	FParse::Value(*Params, TEXT("Definitions="), Options.DefinitionDatabasePath);
+	Options.bKeepUnknown = FParse::Param(*Params, TEXT("KeepUnknown"));
+
+	FString Error;
+	if (!Migrate(Options, Error))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存迁移] 失败: %s"), *Error);
+		return 1;
+	}
+	return 0;
+}
+
+bool UGaiaInventoryMigrateCommandlet::Migrate(const FGaiaInventoryMigrateOptions& Options, FString& OutError)
+{
+	using namespace GaiaInventoryMigrate;
+
+	if (Options.InputPath.IsEmpty() || Options.OutputPath.IsEmpty())
+	{
+		OutError = TEXT("需要 -Input= 和 -Output=");
+		return false;
+	}
+	if (FPaths::IsSamePath(Options.InputPath, Options.OutputPath))
+	{
+		OutError = TEXT("输出不能覆盖输入");
+		return false;
+	}
+
+	const bool bDirectory = IFileManager::Get().DirectoryExists(*Options.InputPath);
+	if (!bDirectory && !IFileManager::Get().FileExists(*Options.InputPath))
+	{
+		OutError = FString::Printf(TEXT("输入不存在: %s"), *Options.InputPath);
+		return false;
+	}
+
+	// 定义来源：指定的定义数据库，否则数据注册表（命令行环境下不会自动初始化）
+	if (!Options.DefinitionDatabasePath.IsEmpty())
+	{
+		if (!FGaiaDefinitionDatabase::Mount(Options.DefinitionDatabasePath, OutError))
+		{
+			return false;
+		}
+	}
+	else if (UDataRegistrySubsystem* RegistrySubsystem = UDataRegistrySubsystem::Get())
+	{
+		RegistrySubsystem->LoadAllRegistries();
+		RegistrySubsystem->InitializeAllRegistries();
+	}
+
+	FMigrator Migrator(Options);
+	if (!Options.RemapFilePath.IsEmpty() && !Migrator.Resolver.LoadRemapFile(Options.RemapFilePath, OutError))
+	{
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	if (!(bDirectory ? MigrateDirectory(Migrator, OutError) : MigrateSnapshotFile(Migrator, OutError)))
+	{
+		return false;
+	}
+
+	const FStats& Stats = Migrator.Stats;
+	UE_LOG(LogGaia, Display, TEXT("[库存迁移] 完成 %s -> %s（%.1f 秒）"),
+		*Options.InputPath, *Options.OutputPath, FPlatformTime::Seconds() - StartTime);
+	UE_LOG(LogGaia, Display, TEXT("[库存迁移] 物品 %d：重映射 %d，删除 %d，拆分堆叠 %d，成为游离 %d，清除容器引用 %d"),
+		Stats.NumItems, Stats.RemappedItems, Stats.RemovedItems, Stats.SplitStacks, Stats.OrphanedItems, Stats.ClearedReferences);
+	UE_LOG(LogGaia, Display, TEXT("[库存迁移] 容器 %d：重映射 %d，删除 %d，调整槽位 %d"),
+		Stats.NumContainers, Stats.RemappedContainers, Stats.RemovedContainers, Stats.ResizedContainers);
+	return true;
+}
@@ -0,0 +1,67 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "GaiaInventoryMigrateCommandlet.generated.h"
+
+/** 离线迁移的参数 */
+struct FGaiaInventoryMigrateOptions
+{
+	/** 输入：按容器寻址的存档目录，或单个快照文件 */
+	FString InputPath;
+
+	/** 输出：目录（输入为目录时，必须不存在或为空）或快照文件，不能与输入相同 */
+	FString OutputPath;
+
+	/**
+	 * 定义ID重映射文件（可选），每行一条：
+	 *   Item <旧ID> <新ID>
+	 *   Container <旧ID> <新ID>
+	 * 新ID写 None 表示删除该定义的所有实例；# 开头为注释
+	 */
+	FString RemapFilePath;
+
+	/** 服务器定义数据库文件（可选），指定时不加载数据注册表 */
+	FString DefinitionDatabasePath;
+
+	/** 保留定义不存在的实例（默认删除） */
+	bool bKeepUnknown = false;
+};
+
+/**
+ * 离线库存迁移与压实
+ *
+ * 在服务器停机时处理存档，服务器启动时不需要做任何迁移：
+ * - 按重映射表替换物品/容器定义ID，删除定义已不存在的实例
+ * - 按新的堆叠上限拆分超出的堆叠，多出的部分放入同一容器的空槽位，放不下时成为游离物品
+ * - 容器槽位数与新定义不一致时调整槽位，被移出的物品同样重新放置
+ * - 清除指向已删除容器的引用；已删除容器中的物品成为游离物品，不会随容器丢失
+ * - 按当前格式重写所有记录
+ *
+ * 输入为存档目录时逐桶流式处理：第一遍只收集容器UID，第二遍每次只读写一个桶，
+ * 内存只与容器数量和单个桶大小相关。输入为快照文件时整体载入。
+ *
+ *   UnrealEditor-Cmd Gaia.uproject -run=GaiaInventoryMigrate -Input=<目录或文件> -Output=<目录或文件>
+ *       [-Remap=<重映射文件>] [-Definitions=<定义数据库文件>] [-KeepUnknown]
+ */
+UCLASS()
+class GAIAGAME_API UGaiaInventoryMigrateCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGaiaInventoryMigrateCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+	/**
+	 * 执行迁移
+	 * @param Options 迁移参数
+	 * @param OutError 失败原因
+	 * @return 是否成功（失败时输出可能不完整，输入保持不变）
+	 */
+	static bool Migrate(const FGaiaInventoryMigrateOptions& Options, FString& OutError);
+};
@@ -0,0 +1,1702 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaInventoryPersistence.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaInventoryIdAllocator.h"
+#include "GaiaInventoryStats.h"
+#include "GaiaLogChannels.h"
+#include "Algo/SortBy.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Snapshot Capture"), STAT_GaiaInventory_SnapshotCapture, STATGROUP_GaiaInventory);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Serialize"), STAT_GaiaInventory_SnapshotSerialize, STATGROUP_GaiaInventory);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Compress"), STAT_GaiaInventory_SnapshotCompress, STATGROUP_GaiaInventory);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Write"), STAT_GaiaInventory_SnapshotWrite, STATGROUP_GaiaInventory);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Load"), STAT_GaiaInventory_SnapshotLoad, STATGROUP_GaiaInventory);
+
+namespace GaiaInventoryPersistence
+{
+	/** 定义ID字符串表（写入时去重） */
+	struct FNameTableBuilder
+	{
+		TArray<FName> Names;
+		TMap<FName, int32> NameToIndex;
+
+		int32 GetIndex(FName Name)
+		{
+			if (const int32* Found = NameToIndex.Find(Name))
+			{
+				return *Found;
+			}
+			const int32 Index = Names.Add(Name);
+			NameToIndex.Add(Name, Index);
+			return Index;
+		}
+	};
+
+	/** 槽位ID是否为 0..N-1 连续排列（创建容器时的默认布局） */
+	static bool HasContiguousSlotIDs(const FGaiaContainerInstance& Container)
+	{
+		for (int32 Index = 0; Index < Container.Slots.Num(); ++Index)
+		{
+			if (Container.Slots[Index].SlotID != Index)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** 计数字段的合理性检查（每条记录至少占1字节，超过剩余字节数必然是损坏数据） */
+	static bool IsValidCount(FArchive& Ar, int32 Count)
+	{
+		return Count >= 0 && Count <= Ar.TotalSize() - Ar.Tell();
+	}
+
+	/** 解压后大小相对压缩大小的倍数上限（文件头中的原始大小不可信，分配前先限制） */
+	static constexpr int64 MaxCompressionRatio = 64;
+
+	/** 解压后正文的绝对上限 */
+	static constexpr int64 MaxDecompressedSize = 1024 * 1024 * 1024;
+
+	/** 单个容器的槽位数上限（连续槽位不占存档字节，需要单独限制） */
+	static constexpr int32 MaxSlotsPerContainer = 65535;
+
+	/** 物品槽位ID中的网格朝向标记（槽位ID远小于这一位，不增加记录大小） */
+	static constexpr int32 RotatedSlotFlag = 1 << 30;
+
+	/** 写入时把朝向合并进槽位ID */
+	static int32 PackSlotID(int32 SlotID, bool bRotated)
+	{
+		return (bRotated && SlotID >= 0) ? (SlotID | RotatedSlotFlag) : SlotID;
+	}
+
+	/** 读取时拆出朝向（旧版本没有朝向，原样返回） */
+	static int32 UnpackSlotID(int32 PackedSlotID, bool bHasRotation, bool& bOutRotated)
+	{
+		bOutRotated = bHasRotation && PackedSlotID >= 0 && (PackedSlotID & RotatedSlotFlag) != 0;
+		return bOutRotated ? (PackedSlotID & ~RotatedSlotFlag) : PackedSlotID;
+	}
+
+	/** 物品数量中的寿命标记（有寿命的物品在记录末尾追加剩余秒数，其余物品不增加记录大小） */
+	static constexpr int32 LifetimeQuantityFlag = 1 << 30;
+
+	/** 写入时把寿命标记合并进数量 */
+	static int32 PackQuantity(int32 Quantity, float RemainingLifetime)
+	{
+		return RemainingLifetime > 0.0f ? (Quantity | LifetimeQuantityFlag) : Quantity;
+	}
+
+	/** 读取时拆出寿命标记（旧版本没有寿命，原样返回） */
+	static int32 UnpackQuantity(int32 PackedQuantity, bool bHasLifetimes, bool& bOutHasLifetime)
+	{
+		bOutHasLifetime = bHasLifetimes && PackedQuantity > 0 && (PackedQuantity & LifetimeQuantityFlag) != 0;
+		return bOutHasLifetime ? (PackedQuantity & ~LifetimeQuantityFlag) : PackedQuantity;
+	}
+
+	/** 过期时间换算为写入存档的剩余寿命（已到期但还没处理的物品保留一个极小值，加载后立即过期） */
+	static float GetRemainingLifetime(const FGaiaItemInstance& Item, double LifetimeClock)
+	{
+		return Item.HasLifetime() ? FMath::Max(static_cast<float>(Item.ExpireTime - LifetimeClock), UE_KINDA_SMALL_NUMBER) : 0.0f;
+	}
+
+	/** 存档中的剩余寿命换算为过期时间 */
+	static double GetExpireTime(float RemainingLifetime, double LifetimeClock)
+	{
+		return RemainingLifetime > 0.0f ? LifetimeClock + RemainingLifetime : 0.0;
+	}
+
+	/** UID 编码类型（紧凑编码时写在 UID 之前） */
+	enum class EUIDEncoding : uint8
+	{
+		/** 无效UID，不写数据 */
+		None,
+		/** 分配器发放的64位ID */
+		Id64,
+		/** 完整 GUID */
+		Guid,
+	};
+
+	/**
+	 * 读写UID
+	 * @param bCompact 为 false 时按旧格式直接读写16字节
+	 */
+	static void SerializeUID(FArchive& Ar, FGuid& UID, bool bCompact = true)
+	{
+		if (!bCompact)
+		{
+			Ar << UID;
+			return;
+		}
+
+		uint64 Id = 0;
+		uint8 Encoding = static_cast<uint8>(EUIDEncoding::Guid);
+		if (Ar.IsSaving())
+		{
+			Encoding = static_cast<uint8>(!UID.IsValid() ? EUIDEncoding::None
+				: FGaiaInventoryId::TryGetId(UID, Id) ? EUIDEncoding::Id64
+				: EUIDEncoding::Guid);
+		}
+		Ar << Encoding;
+
+		switch (static_cast<EUIDEncoding>(Encoding))
+		{
+		case EUIDEncoding::None:
+			UID = FGuid();
+			break;
+		case EUIDEncoding::Id64:
+			Ar << Id;
+			UID = FGaiaInventoryId::ToGuid(Id);
+			break;
+		case EUIDEncoding::Guid:
+			Ar << UID;
+			break;
+		default:
+			Ar.SetError();
+			break;
+		}
+	}
+
+	/** 日志记录类型 */
+	enum class EJournalRecord : uint8
+	{
+		/** 名字表追加：FString */
+		NameDef,
+		/** 容器状态：UID、定义索引、槽位数 */
+		ContainerState,
+		/** 容器删除：UID */
+		ContainerRemoved,
+		/** 物品状态：UID、定义索引、数量、所在容器UID、槽位ID（含网格朝向）、拥有容器UID */
+		ItemState,
+		/** 物品删除：UID */
+		ItemRemoved,
+	};
+
+	/** 存档正文的压缩方式 */
+	enum class ECompression : uint8
+	{
+		None,
+		Oodle,
+	};
+}
+
+void FGaiaInventorySerializer::CaptureSnapshot(
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+	FGaiaInventorySnapshot& OutSnapshot,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotCapture);
+
+	OutSnapshot.Containers.Reset(ContainerMap.Num());
+	OutSnapshot.CustomSlotIDs.Reset();
+	OutSnapshot.Items.Reset(ItemMap.Num());
+
+	for (const auto& ContainerPair : ContainerMap)
+	{
+		const FGaiaContainerInstance& Container = ContainerPair.Value;
+
+		FGaiaInventorySnapshot::FContainerRecord& Record = OutSnapshot.Containers.AddDefaulted_GetRef();
+		Record.ContainerUID = Container.ContainerUID;
+		Record.ContainerDefinitionID = Container.ContainerDefinitionID;
+		Record.NumSlots = Container.Slots.Num();
+
+		if (!HasContiguousSlotIDs(Container))
+		{
+			Record.CustomSlotIDsStart = OutSnapshot.CustomSlotIDs.Num();
+			for (const FGaiaSlotInfo& Slot : Container.Slots)
+			{
+				OutSnapshot.CustomSlotIDs.Add(Slot.SlotID);
+			}
+		}
+	}
+
+	for (const auto& ItemPair : ItemMap)
+	{
+		const FGaiaItemInstance& Item = ItemPair.Value;
+
+		FGaiaInventorySnapshot::FItemRecord& Record = OutSnapshot.Items.AddDefaulted_GetRef();
+		Record.InstanceUID = Item.InstanceUID;
+		Record.ItemDefinitionID = Item.ItemDefinitionID;
+		Record.Quantity = Item.Quantity;
+		Record.CurrentContainerUID = Item.CurrentContainerUID;
+		Record.CurrentSlotID = Item.CurrentSlotID;
+		Record.OwnedContainerUID = Item.OwnedContainerUID;
+		Record.bRotated = Item.bRotated;
+		Record.RemainingLifetime = GetRemainingLifetime(Item, LifetimeClock);
+	}
+}
+
+bool FGaiaInventorySerializer::SerializeSnapshot(const FGaiaInventorySnapshot& Snapshot, TArray<uint8>& OutData, FGaiaInventorySaveStats& InOutStats)
+{
+	using namespace GaiaInventoryPersistence;
+
+	OutData.Reset();
+	InOutStats.NumItems = Snapshot.Items.Num();
+	InOutStats.NumContainers = Snapshot.Containers.Num();
+
+	TArray<uint8> Body;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotSerialize);
+		const double StartTime = FPlatformTime::Seconds();
+
+		// 1. 建立字符串表和容器索引
+		FNameTableBuilder NameTable;
+		TMap<FGuid, int32> ContainerIndices;
+		ContainerIndices.Reserve(Snapshot.Containers.Num());
+
+		for (int32 ContainerIndex = 0; ContainerIndex < Snapshot.Containers.Num(); ++ContainerIndex)
+		{
+			ContainerIndices.Add(Snapshot.Containers[ContainerIndex].ContainerUID, ContainerIndex);
+			NameTable.GetIndex(Snapshot.Containers[ContainerIndex].ContainerDefinitionID);
+		}
+
+		for (const FGaiaInventorySnapshot::FItemRecord& Record : Snapshot.Items)
+		{
+			NameTable.GetIndex(Record.ItemDefinitionID);
+		}
+
+		FMemoryWriter Ar(Body);
+
+		// 2. 字符串表
+		int32 NumNames = NameTable.Names.Num();
+		Ar << NumNames;
+		for (const FName& Name : NameTable.Names)
+		{
+			FString NameString = Name.ToString();
+			Ar << NameString;
+		}
+
+		// 3. 容器表
+		int32 NumContainers = Snapshot.Containers.Num();
+		Ar << NumContainers;
+		for (const FGaiaInventorySnapshot::FContainerRecord& Record : Snapshot.Containers)
+		{
+			FGuid ContainerUID = Record.ContainerUID;
+			int32 DefIndex = NameTable.GetIndex(Record.ContainerDefinitionID);
+			int32 NumSlots = Record.NumSlots;
+			uint8 bContiguousSlots = Record.CustomSlotIDsStart == INDEX_NONE ? 1 : 0;
+
+			SerializeUID(Ar, ContainerUID);
+			Ar << DefIndex;
+			Ar << NumSlots;
+			Ar << bContiguousSlots;
+
+			if (!bContiguousSlots)
+			{
+				for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+				{
+					int32 SlotID = Snapshot.CustomSlotIDs[Record.CustomSlotIDsStart + SlotIndex];
+					Ar << SlotID;
+				}
+			}
+		}
+
+		// 4. 物品表（容器引用写成容器表索引）
+		int32 NumItems = Snapshot.Items.Num();
+		Ar << NumItems;
+		for (const FGaiaInventorySnapshot::FItemRecord& Record : Snapshot.Items)
+		{
+			FGuid InstanceUID = Record.InstanceUID;
+			int32 DefIndex = NameTable.GetIndex(Record.ItemDefinitionID);
+			int32 Quantity = PackQuantity(Record.Quantity, Record.RemainingLifetime);
+			int32 ContainerIndex = INDEX_NONE;
+			int32 SlotID = INDEX_NONE;
+			int32 OwnedContainerIndex = INDEX_NONE;
+
+			if (Record.CurrentContainerUID.IsValid())
+			{
+				if (const int32* Found = ContainerIndices.Find(Record.CurrentContainerUID))
+				{
+					ContainerIndex = *Found;
+					SlotID = PackSlotID(Record.CurrentSlotID, Record.bRotated);
+				}
+				else
+				{
+					UE_LOG(LogGaia, Warning, TEXT("[库存存档] 物品 %s 引用的容器 %s 不存在，按游离物品保存"),
+						*Record.InstanceUID.ToString(), *Record.CurrentContainerUID.ToString());
+				}
+			}
+
+			if (Record.OwnedContainerUID.IsValid())
+			{
+				if (const int32* Found = ContainerIndices.Find(Record.OwnedContainerUID))
+				{
+					OwnedContainerIndex = *Found;
+				}
+			}
+
+			SerializeUID(Ar, InstanceUID);
+			Ar << DefIndex;
+			Ar << Quantity;
+			Ar << ContainerIndex;
+			Ar << SlotID;
+			Ar << OwnedContainerIndex;
+
+			if (Record.RemainingLifetime > 0.0f)
+			{
+				float RemainingLifetime = Record.RemainingLifetime;
+				Ar << RemainingLifetime;
+			}
+		}
+
+		if (Ar.IsError())
+		{
+			InOutStats.Error = TEXT("写入存档失败");
+			return false;
+		}
+
+		InOutStats.RawBytes = Body.Num();
+		InOutStats.SerializeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	// 5. 压缩正文（压缩后不更小时直接存原始数据）
+	uint8 Compression = static_cast<uint8>(ECompression::None);
+	TArray<uint8> CompressedBody;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotCompress);
+		const double StartTime = FPlatformTime::Seconds();
+
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, Body.Num());
+		CompressedBody.SetNumUninitialized(CompressedSize);
+		if (FCompression::CompressMemory(NAME_Oodle, CompressedBody.GetData(), CompressedSize, Body.GetData(), Body.Num())
+			&& CompressedSize < Body.Num())
+		{
+			Compression = static_cast<uint8>(ECompression::Oodle);
+			CompressedBody.SetNum(CompressedSize);
+		}
+
+		InOutStats.CompressMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	const TArray<uint8>& StoredBody = Compression == static_cast<uint8>(ECompression::None) ? Body : CompressedBody;
+
+	// 6. 文件头 + 正文
+	FMemoryWriter Ar(OutData);
+	uint32 FileMagic = Magic;
+	int32 Version = static_cast<int32>(EGaiaInventorySaveVersion::Latest);
+	int32 RawSize = Body.Num();
+	int32 StoredSize = StoredBody.Num();
+	Ar << FileMagic;
+	Ar << Version;
+	Ar << Compression;
+	Ar << RawSize;
+	Ar << StoredSize;
+	OutData.Append(StoredBody);
+
+	InOutStats.StoredBytes = OutData.Num();
+	return true;
+}
+
+bool FGaiaInventorySerializer::WriteToFile(const TArray<uint8>& Data, const FString& FilePath, FGaiaInventorySaveStats& InOutStats)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotWrite);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// 临时文件先刷到磁盘再替换：替换成功即表示存档已落盘，调用方可以据此丢弃内存中的数据
+	const FString TempPath = FilePath + TEXT(".tmp");
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(TempPath));
+	bool bWritten = false;
+	{
+		TUniquePtr<IFileHandle> TempHandle(PlatformFile.OpenWrite(*TempPath, false, false));
+		bWritten = TempHandle && TempHandle->Write(Data.GetData(), Data.Num()) && TempHandle->Flush(true);
+	}
+	bWritten = bWritten && IFileManager::Get().Move(*FilePath, *TempPath, true);
+
+	InOutStats.WriteMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	if (!bWritten)
+	{
+		InOutStats.Error = FString::Printf(TEXT("无法写入文件: %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FGaiaInventorySerializer::Save(
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+	TArray<uint8>& OutData,
+	FString& OutError,
+	double LifetimeClock)
+{
+	FGaiaInventorySnapshot Snapshot;
+	CaptureSnapshot(ItemMap, ContainerMap, Snapshot, LifetimeClock);
+
+	FGaiaInventorySaveStats Stats;
+	if (!SerializeSnapshot(Snapshot, OutData, Stats))
+	{
+		OutError = Stats.Error;
+		return false;
+	}
+	return true;
+}
+
+bool FGaiaInventorySerializer::Load(
+	const TArray<uint8>& Data,
+	TMap<FGuid, FGaiaItemInstance>& OutItemMap,
+	TMap<FGuid, FGaiaContainerInstance>& OutContainerMap,
+	FString& OutError,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotLoad);
+
+	OutItemMap.Reset();
+	OutContainerMap.Reset();
+
+	FMemoryReader HeaderAr(Data);
+
+	auto Fail = [&](const FString& Error)
+	{
+		OutError = Error;
+		OutItemMap.Reset();
+		OutContainerMap.Reset();
+		return false;
+	};
+
+	// 1. 文件头
+	uint32 FileMagic = 0;
+	int32 Version = 0;
+	HeaderAr << FileMagic;
+	HeaderAr << Version;
+
+	if (HeaderAr.IsError() || FileMagic != Magic)
+	{
+		return Fail(TEXT("不是库存存档"));
+	}
+
+	if (Version < static_cast<int32>(EGaiaInventorySaveVersion::Initial)
+		|| Version > static_cast<int32>(EGaiaInventorySaveVersion::Latest))
+	{
+		return Fail(FString::Printf(TEXT("不支持的存档版本: %d（当前版本 %d）"),
+			Version, static_cast<int32>(EGaiaInventorySaveVersion::Latest)));
+	}
+
+	// Compressed 版本起文件头后是压缩信息，正文可能被压缩
+	TArrayView<const uint8> Body = MakeArrayView(Data).RightChop(HeaderAr.Tell());
+	TArray<uint8> DecompressedBody;
+	if (Version >= static_cast<int32>(EGaiaInventorySaveVersion::Compressed))
+	{
+		uint8 Compression = 0;
+		int32 RawSize = 0;
+		int32 StoredSize = 0;
+		HeaderAr << Compression;
+		HeaderAr << RawSize;
+		HeaderAr << StoredSize;
+
+		if (HeaderAr.IsError() || RawSize < 0 || StoredSize < 0 || StoredSize > HeaderAr.TotalSize() - HeaderAr.Tell())
+		{
+			return Fail(TEXT("存档文件头损坏"));
+		}
+
+		Body = MakeArrayView(Data).Slice(HeaderAr.Tell(), StoredSize);
+
+		if (Compression == static_cast<uint8>(ECompression::Oodle))
+		{
+			if (RawSize > static_cast<int64>(StoredSize) * MaxCompressionRatio || RawSize > MaxDecompressedSize)
+			{
+				return Fail(FString::Printf(TEXT("存档解压后大小异常: %d（压缩大小 %d）"), RawSize, StoredSize));
+			}
+
+			DecompressedBody.SetNumUninitialized(RawSize);
+			if (!FCompression::UncompressMemory(NAME_Oodle, DecompressedBody.GetData(), RawSize, Body.GetData(), StoredSize))
+			{
+				return Fail(TEXT("存档解压失败"));
+			}
+			Body = DecompressedBody;
+		}
+		else if (Compression != static_cast<uint8>(ECompression::None))
+		{
+			return Fail(FString::Printf(TEXT("未知的压缩方式: %d"), Compression));
+		}
+	}
+
+	FMemoryReaderView Ar(Body);
+	const bool bCompactIds = Version >= static_cast<int32>(EGaiaInventorySaveVersion::CompactIds);
+	const bool bHasGridRotation = Version >= static_cast<int32>(EGaiaInventorySaveVersion::GridRotation);
+	const bool bHasItemLifetimes = Version >= static_cast<int32>(EGaiaInventorySaveVersion::ItemLifetimes);
+
+	// 2. 字符串表
+	int32 NumNames = 0;
+	Ar << NumNames;
+	if (Ar.IsError() || !IsValidCount(Ar, NumNames))
+	{
+		return Fail(TEXT("字符串表损坏"));
+	}
+
+	TArray<FName> Names;
+	Names.Reserve(NumNames);
+	for (int32 Index = 0; Index < NumNames; ++Index)
+	{
+		FString NameString;
+		Ar << NameString;
+		Names.Add(FName(*NameString));
+	}
+
+	// 物品定义按字符串表索引只解析一次，统计缓存直接在物品遍历中累加
+	TArray<const FGaiaItemDefinition*> ItemDefs;
+	ItemDefs.Init(nullptr, NumNames);
+	TBitArray<> ItemDefResolved(false, NumNames);
+
+	// 3. 容器表
+	int32 NumContainers = 0;
+	Ar << NumContainers;
+	if (Ar.IsError() || !IsValidCount(Ar, NumContainers))
+	{
+		return Fail(TEXT("容器表损坏"));
+	}
+
+	TArray<FGaiaContainerInstance> LoadedContainers;
+	LoadedContainers.SetNum(NumContainers);
+	TBitArray<> ContiguousSlots(false, NumContainers);
+
+	for (int32 ContainerIndex = 0; ContainerIndex < NumContainers; ++ContainerIndex)
+	{
+		FGaiaContainerInstance& Container = LoadedContainers[ContainerIndex];
+
+		int32 DefIndex = INDEX_NONE;
+		int32 NumSlots = 0;
+		uint8 bContiguousSlots = 0;
+
+		SerializeUID(Ar, Container.ContainerUID, bCompactIds);
+		Ar << DefIndex;
+		Ar << NumSlots;
+		Ar << bContiguousSlots;
+
+		if (Ar.IsError() || !Names.IsValidIndex(DefIndex) || NumSlots < 0 || NumSlots > MaxSlotsPerContainer
+			|| !IsValidCount(Ar, bContiguousSlots ? 0 : NumSlots))
+		{
+			return Fail(FString::Printf(TEXT("容器记录 %d 损坏"), ContainerIndex));
+		}
+
+		Container.ContainerDefinitionID = Names[DefIndex];
+		Container.Slots.Reserve(NumSlots);
+		for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+		{
+			int32 SlotID = SlotIndex;
+			if (!bContiguousSlots)
+			{
+				Ar << SlotID;
+			}
+			Container.Slots.Add(FGaiaSlotInfo(SlotID));
+		}
+
+		// 统计缓存从0开始，在物品遍历中累加
+		Container.bNeedRecalculate = false;
+		ContiguousSlots[ContainerIndex] = bContiguousSlots != 0;
+	}
+
+	// 4. 物品表：一次遍历重建槽位引用、父子关系和统计缓存
+	int32 NumItems = 0;
+	Ar << NumItems;
+	if (Ar.IsError() || !IsValidCount(Ar, NumItems))
+	{
+		return Fail(TEXT("物品表损坏"));
+	}
+
+	OutItemMap.Reserve(NumItems);
+	for (int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex)
+	{
+		FGaiaItemInstance Item;
+		int32 DefIndex = INDEX_NONE;
+		int32 ContainerIndex = INDEX_NONE;
+		int32 OwnedContainerIndex = INDEX_NONE;
+
+		SerializeUID(Ar, Item.InstanceUID, bCompactIds);
+		Ar << DefIndex;
+		Ar << Item.Quantity;
+		Ar << ContainerIndex;
+		Ar << Item.CurrentSlotID;
+		Ar << OwnedContainerIndex;
+		Item.CurrentSlotID = UnpackSlotID(Item.CurrentSlotID, bHasGridRotation, Item.bRotated);
+
+		bool bHasLifetime = false;
+		Item.Quantity = UnpackQuantity(Item.Quantity, bHasItemLifetimes, bHasLifetime);
+		if (bHasLifetime)
+		{
+			float RemainingLifetime = 0.0f;
+			Ar << RemainingLifetime;
+			Item.ExpireTime = GetExpireTime(RemainingLifetime, LifetimeClock);
+		}
+
+		if (Ar.IsError() || !Names.IsValidIndex(DefIndex)
+			|| (ContainerIndex != INDEX_NONE && !LoadedContainers.IsValidIndex(ContainerIndex))
+			|| (OwnedContainerIndex != INDEX_NONE && !LoadedContainers.IsValidIndex(OwnedContainerIndex)))
+		{
+			return Fail(FString::Printf(TEXT("物品记录 %d 损坏"), ItemIndex));
+		}
+
+		Item.ItemDefinitionID = Names[DefIndex];
+
+		// 放入所在容器的槽位
+		if (ContainerIndex != INDEX_NONE)
+		{
+			FGaiaContainerInstance& Container = LoadedContainers[ContainerIndex];
+			const int32 SlotIndex = ContiguousSlots[ContainerIndex]
+				? (Container.Slots.IsValidIndex(Item.CurrentSlotID) ? Item.CurrentSlotID : INDEX_NONE)
+				: Container.GetSlotIndexByID(Item.CurrentSlotID);
+
+			if (SlotIndex == INDEX_NONE || !Container.Slots[SlotIndex].IsEmpty())
+			{
+				return Fail(FString::Printf(TEXT("物品记录 %d 的槽位 %d 无效或重复占用"), ItemIndex, Item.CurrentSlotID));
+			}
+
+			Item.CurrentContainerUID = Container.ContainerUID;
+			Container.Slots[SlotIndex].ItemInstanceUID = Item.InstanceUID;
+
+			if (!ItemDefResolved[DefIndex])
+			{
+				ItemDefs[DefIndex] = UGaiaInventorySubsystem::FindItemDefinition(Item.ItemDefinitionID);
+				ItemDefResolved[DefIndex] = true;
+			}
+
+			++Container.CachedUsedSlotCount;
+			Container.CachedDefinitionCounts.FindOrAdd(Item.ItemDefinitionID) += Item.Quantity;
+			if (const FGaiaItemDefinition* ItemDef = ItemDefs[DefIndex])
+			{
+				Container.CachedTotalWeight += ItemDef->ItemWeight * Item.Quantity;
+				Container.CachedTotalVolume += ItemDef->ItemVolume * Item.Quantity;
+			}
+		}
+		else
+		{
+			Item.CurrentSlotID = INDEX_NONE;
+		}
+
+		// 关联拥有的容器
+		if (OwnedContainerIndex != INDEX_NONE)
+		{
+			FGaiaContainerInstance& OwnedContainer = LoadedContainers[OwnedContainerIndex];
+			OwnedContainer.OwnerItemUID = Item.InstanceUID;
+			OwnedContainer.ParentContainerUID = Item.CurrentContainerUID;
+			Item.OwnedContainerUID = OwnedContainer.ContainerUID;
+		}
+
+		OutItemMap.Add(Item.InstanceUID, MoveTemp(Item));
+	}
+
+	// 5. 容器移入映射表（网格占用依赖物品的最终位置，在此重建）
+	OutContainerMap.Reserve(NumContainers);
+	for (FGaiaContainerInstance& Container : LoadedContainers)
+	{
+		UGaiaInventorySubsystem::RebuildGridOccupancy(Container, OutItemMap);
+		const FGuid ContainerUID = Container.ContainerUID;
+		OutContainerMap.Add(ContainerUID, MoveTemp(Container));
+	}
+
+	RebuildNestingInfo(OutContainerMap);
+	return true;
+}
+
+void FGaiaInventorySerializer::RebuildDerivedData(
+	TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+	TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap)
+{
+	for (auto& ContainerPair : InOutContainerMap)
+	{
+		FGaiaContainerInstance& Container = ContainerPair.Value;
+		Container.OwnerItemUID = FGuid();
+		Container.ParentContainerUID = FGuid();
+		for (FGaiaSlotInfo& Slot : Container.Slots)
+		{
+			Slot.ItemInstanceUID = FGuid();
+		}
+		Container.MarkDirty();
+	}
+
+	for (auto& ItemPair : InOutItemMap)
+	{
+		FGaiaItemInstance& Item = ItemPair.Value;
+
+		if (Item.IsInContainer())
+		{
+			FGaiaContainerInstance* Container = InOutContainerMap.Find(Item.CurrentContainerUID);
+			const int32 SlotIndex = Container ? Container->GetSlotIndexByID(Item.CurrentSlotID) : INDEX_NONE;
+
+			if (SlotIndex != INDEX_NONE && Container->Slots[SlotIndex].IsEmpty())
+			{
+				Container->Slots[SlotIndex].ItemInstanceUID = Item.InstanceUID;
+			}
+			else
+			{
+				UE_LOG(LogGaia, Warning, TEXT("[库存存档] 物品 %s 的位置无效或被占用（容器 %s 槽位 %d），按游离物品恢复"),
+					*Item.GetShortUID(), *Item.CurrentContainerUID.ToString(), Item.CurrentSlotID);
+				Item.CurrentContainerUID = FGuid();
+				Item.CurrentSlotID = INDEX_NONE;
+			}
+		}
+		else
+		{
+			Item.CurrentSlotID = INDEX_NONE;
+		}
+	}
+
+	// 父子关系依赖物品的最终位置，单独一遍
+	for (auto& ItemPair : InOutItemMap)
+	{
+		const FGaiaItemInstance& Item = ItemPair.Value;
+		if (FGaiaContainerInstance* OwnedContainer = Item.HasContainer() ? InOutContainerMap.Find(Item.OwnedContainerUID) : nullptr)
+		{
+			OwnedContainer->OwnerItemUID = Item.InstanceUID;
+			OwnedContainer->ParentContainerUID = Item.CurrentContainerUID;
+		}
+	}
+
+	RebuildNestingInfo(InOutContainerMap);
+}
+
+void FGaiaInventorySerializer::RebuildNestingInfo(TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap)
+{
+	for (auto& ContainerPair : InOutContainerMap)
+	{
+		ContainerPair.Value.NestingDepth = INDEX_NONE;
+	}
+
+	// 沿父链向上找到已计算的祖先或根，再沿原路向下赋值，每个容器只计算一次
+	TArray<FGaiaContainerInstance*> Chain;
+	for (auto& ContainerPair : InOutContainerMap)
+	{
+		Chain.Reset();
+		FGaiaContainerInstance* Current = &ContainerPair.Value;
+		while (Current && Current->NestingDepth == INDEX_NONE)
+		{
+			if (Chain.Contains(Current))
+			{
+				// 存档中的父链成环，在最后一个容器处断开
+				FGaiaContainerInstance* Last = Chain.Last();
+				UE_LOG(LogGaia, Warning, TEXT("[库存存档] 容器 %s 的父链成环，按顶层容器恢复"), *Last->ContainerUID.ToString());
+				Last->ParentContainerUID = FGuid();
+				Current = nullptr;
+				break;
+			}
+			Chain.Add(Current);
+			Current = Current->ParentContainerUID.IsValid() ? InOutContainerMap.Find(Current->ParentContainerUID) : nullptr;
+		}
+
+		const FGaiaContainerInstance* Ancestor = Current && Current->NestingDepth != INDEX_NONE ? Current : nullptr;
+		for (int32 Index = Chain.Num() - 1; Index >= 0; --Index)
+		{
+			FGaiaContainerInstance& Container = *Chain[Index];
+			if (Ancestor && Container.ParentContainerUID == Ancestor->ContainerUID)
+			{
+				Container.NestingDepth = Ancestor->NestingDepth + 1;
+				Container.RootContainerUID = Ancestor->GetRootContainerUID();
+			}
+			else
+			{
+				// 父容器不在本表中（或已断开）视为顶层
+				Container.NestingDepth = 0;
+				Container.RootContainerUID = FGuid();
+			}
+			Ancestor = &Container;
+		}
+	}
+
+	// 子树高度从最深的容器向上汇总到父容器
+	TArray<FGaiaContainerInstance*> ByDepth;
+	ByDepth.Reserve(InOutContainerMap.Num());
+	for (auto& ContainerPair : InOutContainerMap)
+	{
+		ContainerPair.Value.NestedHeight = 0;
+		ByDepth.Add(&ContainerPair.Value);
+	}
+	Algo::SortBy(ByDepth, [](const FGaiaContainerInstance* Container) { return Container->NestingDepth; }, TGreater<>());
+	for (const FGaiaContainerInstance* Container : ByDepth)
+	{
+		FGaiaContainerInstance* Parent = Container->NestingDepth > 0 ? InOutContainerMap.Find(Container->ParentContainerUID) : nullptr;
+		if (Parent)
+		{
+			Parent->NestedHeight = FMath::Max(Parent->NestedHeight, Container->NestedHeight + 1);
+		}
+	}
+}
+
+// ========================================
+// 按容器寻址的存档目录
+// ========================================
+
+namespace GaiaInventoryPersistence
+{
+	static const TCHAR* OrphanBucketFileName = TEXT("Orphans.bucket");
+	static const TCHAR* CommitFileName = TEXT("Commit.pending");
+	static const TCHAR* TempSuffix = TEXT(".tmp");
+}
+
+FString FGaiaInventoryContainerStore::GetContainerBucketFileName(const FGuid& ContainerUID)
+{
+	return ContainerUID.ToString(EGuidFormats::Digits) + TEXT(".bucket");
+}
+
+void FGaiaInventoryContainerStore::CaptureContainerBucket(
+	const FGaiaContainerInstance& Container,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	FGaiaInventorySnapshot& OutBucket,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	OutBucket.Containers.Reset(1);
+	OutBucket.CustomSlotIDs.Reset();
+	OutBucket.Items.Reset();
+
+	FGaiaInventorySnapshot::FContainerRecord& ContainerRecord = OutBucket.Containers.AddDefaulted_GetRef();
+	ContainerRecord.ContainerUID = Container.ContainerUID;
+	ContainerRecord.ContainerDefinitionID = Container.ContainerDefinitionID;
+	ContainerRecord.NumSlots = Container.Slots.Num();
+
+	if (!HasContiguousSlotIDs(Container))
+	{
+		ContainerRecord.CustomSlotIDsStart = 0;
+		for (const FGaiaSlotInfo& Slot : Container.Slots)
+		{
+			OutBucket.CustomSlotIDs.Add(Slot.SlotID);
+		}
+	}
+
+	// 只遍历本容器的槽位，代价与容器大小成正比
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : ItemMap.Find(Slot.ItemInstanceUID);
+		if (!Item)
+		{
+			continue;
+		}
+
+		FGaiaInventorySnapshot::FItemRecord& Record = OutBucket.Items.AddDefaulted_GetRef();
+		Record.InstanceUID = Item->InstanceUID;
+		Record.ItemDefinitionID = Item->ItemDefinitionID;
+		Record.Quantity = Item->Quantity;
+		Record.CurrentContainerUID = Item->CurrentContainerUID;
+		Record.CurrentSlotID = Item->CurrentSlotID;
+		Record.OwnedContainerUID = Item->OwnedContainerUID;
+		Record.bRotated = Item->bRotated;
+		Record.RemainingLifetime = GetRemainingLifetime(*Item, LifetimeClock);
+	}
+}
+
+void FGaiaInventoryContainerStore::SerializeBucket(const FGaiaInventorySnapshot& Bucket, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+	FMemoryWriter Ar(OutData);
+
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	Ar << FileMagic;
+	Ar << FileVersion;
+
+	// 桶很小，定义ID直接写字符串，不建字符串表
+	int32 NumContainers = Bucket.Containers.Num();
+	Ar << NumContainers;
+	for (const FGaiaInventorySnapshot::FContainerRecord& Record : Bucket.Containers)
+	{
+		FGuid ContainerUID = Record.ContainerUID;
+		FString DefString = Record.ContainerDefinitionID.ToString();
+		int32 NumSlots = Record.NumSlots;
+		uint8 bContiguousSlots = Record.CustomSlotIDsStart == INDEX_NONE ? 1 : 0;
+
+		SerializeUID(Ar, ContainerUID);
+		Ar << DefString;
+		Ar << NumSlots;
+		Ar << bContiguousSlots;
+
+		if (!bContiguousSlots)
+		{
+			for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+			{
+				int32 SlotID = Bucket.CustomSlotIDs[Record.CustomSlotIDsStart + SlotIndex];
+				Ar << SlotID;
+			}
+		}
+	}
+
+	int32 NumItems = Bucket.Items.Num();
+	Ar << NumItems;
+	SerializeItemRecords(Ar, Bucket);
+}
+
+void FGaiaInventoryContainerStore::SerializeItemRecords(FArchive& Ar, const FGaiaInventorySnapshot& Bucket)
+{
+	for (const FGaiaInventorySnapshot::FItemRecord& Record : Bucket.Items)
+	{
+		FGuid InstanceUID = Record.InstanceUID;
+		FString DefString = Record.ItemDefinitionID.ToString();
+		int32 Quantity = PackQuantity(Record.Quantity, Record.RemainingLifetime);
+		FGuid CurrentContainerUID = Record.CurrentContainerUID;
+		int32 SlotID = PackSlotID(Record.CurrentSlotID, Record.bRotated);
+		FGuid OwnedContainerUID = Record.OwnedContainerUID;
+
+		SerializeUID(Ar, InstanceUID);
+		Ar << DefString;
+		Ar << Quantity;
+		SerializeUID(Ar, CurrentContainerUID);
+		Ar << SlotID;
+		SerializeUID(Ar, OwnedContainerUID);
+
+		if (Record.RemainingLifetime > 0.0f)
+		{
+			float RemainingLifetime = Record.RemainingLifetime;
+			Ar << RemainingLifetime;
+		}
+	}
+}
+
+bool FGaiaInventoryContainerStore::LoadBucket(
+	const TArray<uint8>& Data,
+	TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+	TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap,
+	FString& OutError,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	FMemoryReader Ar(Data);
+
+	uint32 FileMagic = 0;
+	int32 FileVersion = 0;
+	Ar << FileMagic;
+	Ar << FileVersion;
+	if (Ar.IsError() || FileMagic != Magic || FileVersion < 1 || FileVersion > Version)
+	{
+		OutError = TEXT("不是库存桶文件或版本不支持");
+		return false;
+	}
+	const bool bCompactIds = FileVersion >= 2;
+	const bool bHasGridRotation = FileVersion >= 3;
+	const bool bHasItemLifetimes = FileVersion >= 4;
+
+	int32 NumContainers = 0;
+	Ar << NumContainers;
+	if (Ar.IsError() || !IsValidCount(Ar, NumContainers))
+	{
+		OutError = TEXT("容器记录损坏");
+		return false;
+	}
+
+	for (int32 ContainerIndex = 0; ContainerIndex < NumContainers; ++ContainerIndex)
+	{
+		FGuid ContainerUID;
+		FString DefString;
+		int32 NumSlots = 0;
+		uint8 bContiguousSlots = 0;
+		SerializeUID(Ar, ContainerUID, bCompactIds);
+		Ar << DefString;
+		Ar << NumSlots;
+		Ar << bContiguousSlots;
+
+		if (Ar.IsError() || NumSlots < 0 || NumSlots > MaxSlotsPerContainer || !IsValidCount(Ar, bContiguousSlots ? 0 : NumSlots))
+		{
+			OutError = TEXT("容器记录损坏");
+			return false;
+		}
+
+		FGaiaContainerInstance& Container = InOutContainerMap.Add(ContainerUID);
+		Container.ContainerUID = ContainerUID;
+		Container.ContainerDefinitionID = FName(*DefString);
+		Container.Slots.Reserve(NumSlots);
+		for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+		{
+			int32 SlotID = SlotIndex;
+			if (!bContiguousSlots)
+			{
+				Ar << SlotID;
+			}
+			Container.Slots.Add(FGaiaSlotInfo(SlotID));
+		}
+	}
+
+	int32 NumItems = 0;
+	Ar << NumItems;
+	if (Ar.IsError() || !IsValidCount(Ar, NumItems))
+	{
+		OutError = TEXT("物品记录损坏");
+		return false;
+	}
+
+	for (int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex)
+	{
+		FGaiaItemInstance Item;
+		FString DefString;
+		SerializeUID(Ar, Item.InstanceUID, bCompactIds);
+		Ar << DefString;
+		Ar << Item.Quantity;
+		SerializeUID(Ar, Item.CurrentContainerUID, bCompactIds);
+		Ar << Item.CurrentSlotID;
+		SerializeUID(Ar, Item.OwnedContainerUID, bCompactIds);
+
+		bool bHasLifetime = false;
+		Item.Quantity = UnpackQuantity(Item.Quantity, bHasItemLifetimes, bHasLifetime);
+		if (bHasLifetime)
+		{
+			float RemainingLifetime = 0.0f;
+			Ar << RemainingLifetime;
+			Item.ExpireTime = GetExpireTime(RemainingLifetime, LifetimeClock);
+		}
+
+		if (Ar.IsError())
+		{
+			OutError = TEXT("物品记录损坏");
+			return false;
+		}
+
+		Item.CurrentSlotID = UnpackSlotID(Item.CurrentSlotID, bHasGridRotation, Item.bRotated);
+		Item.ItemDefinitionID = FName(*DefString);
+		InOutItemMap.Add(Item.InstanceUID, MoveTemp(Item));
+	}
+
+	return true;
+}
+
+bool FGaiaInventoryContainerStore::SaveChanges(const FString& Directory, const FGaiaInventoryStoreChanges& Changes, FGaiaInventorySaveStats& InOutStats)
+{
+	using namespace GaiaInventoryPersistence;
+
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.MakeDirectory(*Directory, true);
+
+	// 上一次保存中途崩溃留下的清单先补完，避免与本次清单交错
+	ApplyPendingCommit(Directory);
+
+	TArray<FString> CommitLines;
+	TSet<FString> WrittenFiles;
+	TArray<uint8> Data;
+
+	auto WriteBucket = [&](const FGaiaInventorySnapshot& Bucket, const FString& FileName)
+	{
+		{
+			SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotSerialize);
+			const double StartTime = FPlatformTime::Seconds();
+			SerializeBucket(Bucket, Data);
+			InOutStats.SerializeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotWrite);
+		const double StartTime = FPlatformTime::Seconds();
+		const FString TempPath = FPaths::Combine(Directory, FileName) + TempSuffix;
+		const bool bWritten = FFileHelper::SaveArrayToFile(Data, *TempPath);
+		InOutStats.WriteMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		if (!bWritten)
+		{
+			InOutStats.Error = FString::Printf(TEXT("无法写入文件: %s"), *TempPath);
+			return false;
+		}
+
+		InOutStats.RawBytes += Data.Num();
+		InOutStats.StoredBytes += Data.Num();
+		InOutStats.NumContainers += Bucket.Containers.Num();
+		InOutStats.NumItems += Bucket.Items.Num();
+
+		CommitLines.Add(TEXT("W ") + FileName);
+		WrittenFiles.Add(FileName);
+		return true;
+	};
+
+	// 1. 变化的桶写入临时文件
+	for (const FGaiaInventorySnapshot& Bucket : Changes.ContainerBuckets)
+	{
+		if (!ensure(Bucket.Containers.Num() == 1) || !WriteBucket(Bucket, GetContainerBucketFileName(Bucket.Containers[0].ContainerUID)))
+		{
+			return false;
+		}
+	}
+
+	if (Changes.OrphanBucket.IsSet() && !WriteBucket(Changes.OrphanBucket.GetValue(), OrphanBucketFileName))
+	{
+		return false;
+	}
+
+	// 2. 需要删除的桶
+	if (Changes.bFullRewrite)
+	{
+		TArray<FString> ExistingFiles;
+		FileManager.FindFiles(ExistingFiles, *FPaths::Combine(Directory, TEXT("*.bucket")), true, false);
+		for (const FString& FileName : ExistingFiles)
+		{
+			if (!WrittenFiles.Contains(FileName))
+			{
+				CommitLines.Add(TEXT("D ") + FileName);
+			}
+		}
+	}
+	else
+	{
+		for (const FGuid& ContainerUID : Changes.RemovedContainerUIDs)
+		{
+			CommitLines.Add(TEXT("D ") + GetContainerBucketFileName(ContainerUID));
+		}
+	}
+
+	if (CommitLines.IsEmpty())
+	{
+		return true;
+	}
+
+	// 3. 提交清单落盘后本次保存即视为完成，之后的替换可以在下次加载时补完
+	const FString CommitPath = FPaths::Combine(Directory, CommitFileName);
+	const FString CommitTempPath = CommitPath + TempSuffix;
+	if (!FFileHelper::SaveStringArrayToFile(CommitLines, *CommitTempPath) || !FileManager.Move(*CommitPath, *CommitTempPath, true))
+	{
+		InOutStats.Error = FString::Printf(TEXT("无法写入提交清单: %s"), *CommitPath);
+		return false;
+	}
+
+	// 4. 替换
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotWrite);
+		const double StartTime = FPlatformTime::Seconds();
+		ApplyPendingCommit(Directory);
+		InOutStats.WriteMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	return true;
+}
+
+void FGaiaInventoryContainerStore::ApplyPendingCommit(const FString& Directory)
+{
+	using namespace GaiaInventoryPersistence;
+
+	IFileManager& FileManager = IFileManager::Get();
+	const FString CommitPath = FPaths::Combine(Directory, CommitFileName);
+
+	TArray<FString> CommitLines;
+	if (!FFileHelper::LoadFileToStringArray(CommitLines, *CommitPath))
+	{
+		return;
+	}
+
+	for (const FString& Line : CommitLines)
+	{
+		if (Line.Len() < 3)
+		{
+			continue;
+		}
+
+		const FString FilePath = FPaths::Combine(Directory, Line.RightChop(2));
+		if (Line[0] == TEXT('W'))
+		{
+			// 临时文件不存在说明上次已经替换过
+			const FString TempPath = FilePath + TempSuffix;
+			if (FileManager.FileExists(*TempPath))
+			{
+				FileManager.Move(*FilePath, *TempPath, true);
+			}
+		}
+		else if (Line[0] == TEXT('D'))
+		{
+			FileManager.Delete(*FilePath, false, false, true);
+		}
+	}
+
+	FileManager.Delete(*CommitPath, false, false, true);
+}
+
+bool FGaiaInventoryContainerStore::Load(
+	const FString& Directory,
+	TMap<FGuid, FGaiaItemInstance>& OutItemMap,
+	TMap<FGuid, FGaiaContainerInstance>& OutContainerMap,
+	FString& OutError,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	SCOPE_CYCLE_COUNTER(STAT_GaiaInventory_SnapshotLoad);
+
+	OutItemMap.Reset();
+	OutContainerMap.Reset();
+
+	IFileManager& FileManager = IFileManager::Get();
+	if (!FileManager.DirectoryExists(*Directory))
+	{
+		return true;
+	}
+
+	// 崩溃恢复：补完上一次提交，丢弃没有进入清单的临时文件
+	ApplyPendingCommit(Directory);
+
+	TArray<FString> TempFiles;
+	FileManager.FindFiles(TempFiles, *FPaths::Combine(Directory, FString(TEXT("*.bucket")) + TempSuffix), true, false);
+	for (const FString& FileName : TempFiles)
+	{
+		FileManager.Delete(*FPaths::Combine(Directory, FileName), false, false, true);
+	}
+
+	TArray<FString> BucketFiles;
+	FileManager.FindFiles(BucketFiles, *FPaths::Combine(Directory, TEXT("*.bucket")), true, false);
+
+	TArray<uint8> Data;
+	for (const FString& FileName : BucketFiles)
+	{
+		if (!FFileHelper::LoadFileToArray(Data, *FPaths::Combine(Directory, FileName)) || !LoadBucket(Data, OutItemMap, OutContainerMap, OutError, LifetimeClock))
+		{
+			OutError = FString::Printf(TEXT("%s: %s"), *FileName, OutError.IsEmpty() ? TEXT("无法读取") : *OutError);
+			OutItemMap.Reset();
+			OutContainerMap.Reset();
+			return false;
+		}
+	}
+
+	FGaiaInventorySerializer::RebuildDerivedData(OutItemMap, OutContainerMap);
+	return true;
+}
+
+bool FGaiaInventoryContainerStore::ForEachBucket(
+	const FString& Directory,
+	TFunctionRef<bool(TMap<FGuid, FGaiaItemInstance>&, TMap<FGuid, FGaiaContainerInstance>&)> Visitor,
+	FString& OutError)
+{
+	using namespace GaiaInventoryPersistence;
+
+	IFileManager& FileManager = IFileManager::Get();
+	if (!FileManager.DirectoryExists(*Directory))
+	{
+		OutError = FString::Printf(TEXT("目录不存在: %s"), *Directory);
+		return false;
+	}
+
+	ApplyPendingCommit(Directory);
+
+	TArray<FString> BucketFiles;
+	FileManager.FindFiles(BucketFiles, *FPaths::Combine(Directory, TEXT("*.bucket")), true, false);
+
+	// 游离物品桶放到最后
+	const int32 OrphanIndex = BucketFiles.IndexOfByKey(FString(OrphanBucketFileName));
+	if (OrphanIndex != INDEX_NONE)
+	{
+		BucketFiles.RemoveAt(OrphanIndex);
+		BucketFiles.Add(OrphanBucketFileName);
+	}
+
+	TArray<uint8> Data;
+	TMap<FGuid, FGaiaItemInstance> ItemMap;
+	TMap<FGuid, FGaiaContainerInstance> ContainerMap;
+	for (const FString& FileName : BucketFiles)
+	{
+		ItemMap.Reset();
+		ContainerMap.Reset();
+		if (!FFileHelper::LoadFileToArray(Data, *FPaths::Combine(Directory, FileName)) || !LoadBucket(Data, ItemMap, ContainerMap, OutError, 0.0))
+		{
+			OutError = FString::Printf(TEXT("%s: %s"), *FileName, OutError.IsEmpty() ? TEXT("无法读取") : *OutError);
+			return false;
+		}
+
+		if (!Visitor(ItemMap, ContainerMap))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FGaiaInventoryContainerStore::WriteBucketFile(const FString& Directory, const FGaiaInventorySnapshot& Bucket)
+{
+	using namespace GaiaInventoryPersistence;
+
+	TArray<uint8> Data;
+	SerializeBucket(Bucket, Data);
+
+	const FString FileName = Bucket.Containers.IsEmpty() ? FString(OrphanBucketFileName) : GetContainerBucketFileName(Bucket.Containers[0].ContainerUID);
+	return FFileHelper::SaveArrayToFile(Data, *FPaths::Combine(Directory, FileName));
+}
+
+FGaiaInventoryContainerStore::FOrphanBucketWriter::~FOrphanBucketWriter()
+{
+	Writer.Reset();
+}
+
+bool FGaiaInventoryContainerStore::FOrphanBucketWriter::Open(const FString& Directory)
+{
+	using namespace GaiaInventoryPersistence;
+
+	FilePath = FPaths::Combine(Directory, OrphanBucketFileName);
+	NumItems = 0;
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Writer)
+	{
+		return false;
+	}
+
+	// 与 SerializeBucket 相同的布局：没有容器记录，物品数先占位
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	int32 NumContainers = 0;
+	*Writer << FileMagic;
+	*Writer << FileVersion;
+	*Writer << NumContainers;
+	CountOffset = Writer->Tell();
+	int32 PlaceholderCount = 0;
+	*Writer << PlaceholderCount;
+	return !Writer->IsError();
+}
+
+bool FGaiaInventoryContainerStore::FOrphanBucketWriter::Append(const FGaiaInventorySnapshot& Items)
+{
+	if (!Writer)
+	{
+		return false;
+	}
+
+	SerializeItemRecords(*Writer, Items);
+	NumItems += Items.Items.Num();
+	return !Writer->IsError();
+}
+
+bool FGaiaInventoryContainerStore::FOrphanBucketWriter::Close()
+{
+	if (!Writer)
+	{
+		return true;
+	}
+
+	if (NumItems == 0)
+	{
+		Writer.Reset();
+		IFileManager::Get().Delete(*FilePath, false, false, true);
+		return true;
+	}
+
+	Writer->Seek(CountOffset);
+	*Writer << NumItems;
+	const bool bSuccess = Writer->Close() && !Writer->IsError();
+	Writer.Reset();
+	return bSuccess;
+}
+
+// ========================================
+// 操作日志
+// ========================================
+
+FGaiaInventoryJournal::~FGaiaInventoryJournal()
+{
+	Close();
+}
+
+bool FGaiaInventoryJournal::Open(const FString& InFilePath)
+{
+	Close();
+
+	FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*InFilePath, false, false));
+	if (!FileHandle)
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存日志] 无法打开日志文件: %s"), *InFilePath);
+		return false;
+	}
+
+	TArray<uint8> Header;
+	FMemoryWriter Ar(Header);
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	Ar << FileMagic;
+	Ar << FileVersion;
+
+	if (!FileHandle->Write(Header.GetData(), Header.Num()) || !FileHandle->Flush(true))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存日志] 无法写入日志文件头: %s"), *InFilePath);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FGaiaInventoryJournal::Close()
+{
+	FileHandle.Reset();
+	PendingBatch.Reset();
+	NameIndices.Reset();
+	CommittedBytes = 0;
+}
+
+int32 FGaiaInventoryJournal::GetNameIndex(FName Name)
+{
+	if (const int32* Found = NameIndices.Find(Name))
+	{
+		return *Found;
+	}
+
+	const int32 Index = NameIndices.Num();
+	NameIndices.Add(Name, Index);
+
+	FMemoryWriter Ar(PendingBatch, false, true);
+	uint8 RecordType = static_cast<uint8>(GaiaInventoryPersistence::EJournalRecord::NameDef);
+	FString NameString = Name.ToString();
+	Ar << RecordType;
+	Ar << NameString;
+
+	return Index;
+}
+
+void FGaiaInventoryJournal::WriteContainerState(const FGaiaContainerInstance& Container)
+{
+	int32 DefIndex = GetNameIndex(Container.ContainerDefinitionID);
+
+	FMemoryWriter Ar(PendingBatch, false, true);
+	uint8 RecordType = static_cast<uint8>(GaiaInventoryPersistence::EJournalRecord::ContainerState);
+	FGuid ContainerUID = Container.ContainerUID;
+	int32 NumSlots = Container.Slots.Num();
+	Ar << RecordType;
+	GaiaInventoryPersistence::SerializeUID(Ar, ContainerUID);
+	Ar << DefIndex;
+	Ar << NumSlots;
+}
+
+void FGaiaInventoryJournal::WriteContainerRemoved(const FGuid& ContainerUID)
+{
+	FMemoryWriter Ar(PendingBatch, false, true);
+	uint8 RecordType = static_cast<uint8>(GaiaInventoryPersistence::EJournalRecord::ContainerRemoved);
+	FGuid UID = ContainerUID;
+	Ar << RecordType;
+	GaiaInventoryPersistence::SerializeUID(Ar, UID);
+}
+
+void FGaiaInventoryJournal::WriteItemState(const FGaiaItemInstance& Item, double LifetimeClock)
+{
+	int32 DefIndex = GetNameIndex(Item.ItemDefinitionID);
+
+	FMemoryWriter Ar(PendingBatch, false, true);
+	uint8 RecordType = static_cast<uint8>(GaiaInventoryPersistence::EJournalRecord::ItemState);
+	FGuid InstanceUID = Item.InstanceUID;
+	float RemainingLifetime = GaiaInventoryPersistence::GetRemainingLifetime(Item, LifetimeClock);
+	int32 Quantity = GaiaInventoryPersistence::PackQuantity(Item.Quantity, RemainingLifetime);
+	FGuid CurrentContainerUID = Item.CurrentContainerUID;
+	int32 SlotID = GaiaInventoryPersistence::PackSlotID(Item.CurrentSlotID, Item.bRotated);
+	FGuid OwnedContainerUID = Item.OwnedContainerUID;
+	Ar << RecordType;
+	GaiaInventoryPersistence::SerializeUID(Ar, InstanceUID);
+	Ar << DefIndex;
+	Ar << Quantity;
+	GaiaInventoryPersistence::SerializeUID(Ar, CurrentContainerUID);
+	Ar << SlotID;
+	GaiaInventoryPersistence::SerializeUID(Ar, OwnedContainerUID);
+	if (RemainingLifetime > 0.0f)
+	{
+		Ar << RemainingLifetime;
+	}
+}
+
+void FGaiaInventoryJournal::WriteItemRemoved(const FGuid& ItemUID)
+{
+	FMemoryWriter Ar(PendingBatch, false, true);
+	uint8 RecordType = static_cast<uint8>(GaiaInventoryPersistence::EJournalRecord::ItemRemoved);
+	FGuid UID = ItemUID;
+	Ar << RecordType;
+	GaiaInventoryPersistence::SerializeUID(Ar, UID);
+}
+
+bool FGaiaInventoryJournal::Commit()
+{
+	if (PendingBatch.IsEmpty())
+	{
+		return true;
+	}
+
+	if (!FileHandle)
+	{
+		PendingBatch.Reset();
+		return false;
+	}
+
+	uint32 BatchHeader[2] = { static_cast<uint32>(PendingBatch.Num()), FCrc::MemCrc32(PendingBatch.GetData(), PendingBatch.Num()) };
+	const bool bWritten = FileHandle->Write(reinterpret_cast<const uint8*>(BatchHeader), sizeof(BatchHeader))
+		&& FileHandle->Write(PendingBatch.GetData(), PendingBatch.Num())
+		&& FileHandle->Flush(true);
+
+	if (!bWritten)
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存日志] 写入失败，日志已关闭"));
+		Close();
+		return false;
+	}
+
+	CommittedBytes += sizeof(BatchHeader) + PendingBatch.Num();
+	PendingBatch.Reset();
+	return true;
+}
+
+bool FGaiaInventoryJournal::Replay(
+	const TArray<uint8>& Data,
+	TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+	TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap,
+	int32& OutNumBatches,
+	FString& OutError,
+	double LifetimeClock)
+{
+	using namespace GaiaInventoryPersistence;
+
+	OutNumBatches = 0;
+
+	FMemoryReader Ar(Data);
+
+	uint32 FileMagic = 0;
+	int32 FileVersion = 0;
+	Ar << FileMagic;
+	Ar << FileVersion;
+
+	if (Ar.IsError() || FileMagic != Magic)
+	{
+		OutError = TEXT("不是库存日志");
+		return false;
+	}
+
+	if (FileVersion < 1 || FileVersion > Version)
+	{
+		OutError = FString::Printf(TEXT("不支持的日志版本: %d"), FileVersion);
+		return false;
+	}
+	const bool bCompactIds = FileVersion >= 2;
+	const bool bHasGridRotation = FileVersion >= 3;
+	const bool bHasItemLifetimes = FileVersion >= 4;
+
+	TArray<FName> Names;
+
+	while (!Ar.AtEnd())
+	{
+		// 批次头：长度 + CRC，不完整或校验失败说明是崩溃时的残留，丢弃剩余部分
+		uint32 BatchSize = 0;
+		uint32 BatchCrc = 0;
+		Ar << BatchSize;
+		Ar << BatchCrc;
+
+		const int64 BatchStart = Ar.Tell();
+		if (Ar.IsError() || BatchSize > Ar.TotalSize() - BatchStart
+			|| FCrc::MemCrc32(Data.GetData() + BatchStart, BatchSize) != BatchCrc)
+		{
+			UE_LOG(LogGaia, Warning, TEXT("[库存日志] 丢弃末尾不完整的批次（偏移 %lld）"), BatchStart);
+			break;
+		}
+
+		FMemoryReaderView BatchAr(MakeArrayView(Data.GetData() + BatchStart, BatchSize));
+		Ar.Seek(BatchStart + BatchSize);
+
+		while (!BatchAr.AtEnd())
+		{
+			uint8 RecordType = 0;
+			BatchAr << RecordType;
+
+			switch (static_cast<EJournalRecord>(RecordType))
+			{
+			case EJournalRecord::NameDef:
+				{
+					FString NameString;
+					BatchAr << NameString;
+					Names.Add(FName(*NameString));
+				}
+				break;
+
+			case EJournalRecord::ContainerState:
+				{
+					FGuid ContainerUID;
+					int32 DefIndex = INDEX_NONE;
+					int32 NumSlots = 0;
+					SerializeUID(BatchAr, ContainerUID, bCompactIds);
+					BatchAr << DefIndex;
+					BatchAr << NumSlots;
+
+					if (!Names.IsValidIndex(DefIndex) || NumSlots < 0 || NumSlots > MaxSlotsPerContainer)
+					{
+						OutError = TEXT("容器记录损坏");
+						return false;
+					}
+
+					// 容器的定义和槽位布局创建后不变，已存在时无需处理
+					if (!InOutContainerMap.Contains(ContainerUID))
+					{
+						FGaiaContainerInstance& Container = InOutContainerMap.Add(ContainerUID);
+						Container.ContainerUID = ContainerUID;
+						Container.ContainerDefinitionID = Names[DefIndex];
+						Container.Slots.Reserve(NumSlots);
+						for (int32 SlotID = 0; SlotID < NumSlots; ++SlotID)
+						{
+							Container.Slots.Add(FGaiaSlotInfo(SlotID));
+						}
+					}
+				}
+				break;
+
+			case EJournalRecord::ContainerRemoved:
+				{
+					FGuid ContainerUID;
+					SerializeUID(BatchAr, ContainerUID, bCompactIds);
+					InOutContainerMap.Remove(ContainerUID);
+				}
+				break;
+
+			case EJournalRecord::ItemState:
+				{
+					FGuid InstanceUID;
+					int32 DefIndex = INDEX_NONE;
+					int32 Quantity = 0;
+					FGuid CurrentContainerUID;
+					int32 SlotID = INDEX_NONE;
+					FGuid OwnedContainerUID;
+					SerializeUID(BatchAr, InstanceUID, bCompactIds);
+					BatchAr << DefIndex;
+					BatchAr << Quantity;
+					SerializeUID(BatchAr, CurrentContainerUID, bCompactIds);
+					BatchAr << SlotID;
+					SerializeUID(BatchAr, OwnedContainerUID, bCompactIds);
+
+					bool bHasLifetime = false;
+					float RemainingLifetime = 0.0f;
+					Quantity = UnpackQuantity(Quantity, bHasItemLifetimes, bHasLifetime);
+					if (bHasLifetime)
+					{
+						BatchAr << RemainingLifetime;
+					}
+
+					if (!Names.IsValidIndex(DefIndex))
+					{
+						OutError = TEXT("物品记录损坏");
+						return false;
+					}
+
+					// 槽位引用在全部重放完成后统一重建
+					FGaiaItemInstance& Item = InOutItemMap.FindOrAdd(InstanceUID);
+					Item.InstanceUID = InstanceUID;
+					Item.ItemDefinitionID = Names[DefIndex];
+					Item.Quantity = Quantity;
+					Item.CurrentContainerUID = CurrentContainerUID;
+					Item.CurrentSlotID = UnpackSlotID(SlotID, bHasGridRotation, Item.bRotated);
+					Item.OwnedContainerUID = OwnedContainerUID;
+					Item.ExpireTime = GetExpireTime(RemainingLifetime, LifetimeClock);
+				}
+				break;
+
+			case EJournalRecord::ItemRemoved:
+				{
+					FGuid InstanceUID;
+					SerializeUID(BatchAr, InstanceUID, bCompactIds);
+
+					InOutItemMap.Remove(InstanceUID);
+				}
+				break;
+
+			default:
+				OutError = FString::Printf(TEXT("未知的日志记录类型: %d"), RecordType);
+				return false;
+			}
+
+			if (BatchAr.IsError())
+			{
+				OutError = TEXT("日志批次损坏");
+				return false;
+			}
+		}
+
+		++OutNumBatches;
+	}
+
+	return true;
+}
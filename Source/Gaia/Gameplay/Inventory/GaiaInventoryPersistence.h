@@ -0,0 +1,406 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GaiaInventoryTypes.h"
+
+class IFileHandle;
+
+/**
+ * 库存存档格式版本
+ * 修改格式时在 VersionPlusOne 之前追加新版本，并在 FGaiaInventorySerializer::Load 中处理旧版本
+ */
+enum class EGaiaInventorySaveVersion : int32
+{
+	/** 初始版本：定义ID字符串表 + 容器索引引用 */
+	Initial = 1,
+
+	/** 文件头后增加压缩方式和原始大小，正文整体压缩 */
+	Compressed,
+
+	/** UID 带类型前缀，分配器发放的64位ID只写8字节 */
+	CompactIds,
+
+	/** 物品槽位ID携带网格朝向标记 */
+	GridRotation,
+
+	/** 物品数量携带寿命标记，有寿命的物品追加剩余秒数 */
+	ItemLifetimes,
+
+	// -----<新版本加在这一行之前>-----
+	VersionPlusOne,
+	Latest = VersionPlusOne - 1
+};
+
+/**
+ * 游戏线程捕获的库存快照
+ * 只是实例数据的扁平拷贝（不建表、不格式化字符串），捕获完成后可以交给工作线程序列化
+ */
+struct FGaiaInventorySnapshot
+{
+	struct FContainerRecord
+	{
+		FGuid ContainerUID;
+		FName ContainerDefinitionID;
+		int32 NumSlots = 0;
+
+		/** 槽位ID不是 0..N-1 连续时，在 CustomSlotIDs 中的起始位置 */
+		int32 CustomSlotIDsStart = INDEX_NONE;
+	};
+
+	struct FItemRecord
+	{
+		FGuid InstanceUID;
+		FName ItemDefinitionID;
+		int32 Quantity = 0;
+		FGuid CurrentContainerUID;
+		int32 CurrentSlotID = INDEX_NONE;
+		FGuid OwnedContainerUID;
+		bool bRotated = false;
+
+		/** 剩余寿命（秒），0 表示永不过期 */
+		float RemainingLifetime = 0.0f;
+	};
+
+	TArray<FContainerRecord> Containers;
+	TArray<int32> CustomSlotIDs;
+	TArray<FItemRecord> Items;
+};
+
+/** 一次保存的统计 */
+struct FGaiaInventorySaveStats
+{
+	bool bSuccess = false;
+	FString Error;
+
+	int32 NumItems = 0;
+	int32 NumContainers = 0;
+
+	/** 压缩前/后的字节数 */
+	int64 RawBytes = 0;
+	int64 StoredBytes = 0;
+
+	/** 各阶段耗时（毫秒），捕获在游戏线程，其余在工作线程 */
+	double CaptureMs = 0.0;
+	double SerializeMs = 0.0;
+	double CompressMs = 0.0;
+	double WriteMs = 0.0;
+};
+
+/** 异步保存完成回调（在游戏线程调用） */
+DECLARE_DELEGATE_OneParam(FGaiaInventorySaveComplete, const FGaiaInventorySaveStats& /*Stats*/);
+
+/**
+ * 库存二进制存档
+ *
+ * 格式（小端）：
+ * - 文件头：Magic、版本号、压缩方式、正文原始大小、正文存储大小
+ * - 定义ID字符串表：物品/容器定义ID只写一次，实例中以表索引引用
+ * - 容器表：UID、定义索引、槽位数（槽位ID连续时不写槽位列表）
+ * - 物品表：UID、定义索引、数量、所在容器索引、槽位ID、拥有容器索引（有寿命的物品追加剩余秒数）
+ *
+ * 槽位引用、容器的 OwnerItemUID / ParentContainerUID / 嵌套深度 / 根容器和统计缓存都是派生数据，不写入存档，
+ * 加载时在一次线性遍历中重建。调试名称也不保存。
+ * 物品的过期时间以寿命时钟为准，存档中只保存剩余寿命，停服期间不计时。
+ */
+class GAIAGAME_API FGaiaInventorySerializer
+{
+public:
+	/** 存档文件头标识 'GINV' */
+	static constexpr uint32 Magic = 0x564E4947;
+
+	/**
+	 * 捕获快照（游戏线程，只做线性拷贝）
+	 * @param ItemMap 物品数据源
+	 * @param ContainerMap 容器数据源
+	 * @param OutSnapshot 输出：快照
+	 * @param LifetimeClock 物品寿命时钟的当前值（过期时间按它换算为剩余寿命写入）
+	 */
+	static void CaptureSnapshot(
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+		FGaiaInventorySnapshot& OutSnapshot,
+		double LifetimeClock = 0.0);
+
+	/**
+	 * 把快照序列化并压缩为存档字节（任意线程）
+	 * @param Snapshot 快照
+	 * @param OutData 输出：存档字节
+	 * @param InOutStats 统计（填写大小和耗时，失败时填写 Error）
+	 * @return 是否成功
+	 */
+	static bool SerializeSnapshot(const FGaiaInventorySnapshot& Snapshot, TArray<uint8>& OutData, FGaiaInventorySaveStats& InOutStats);
+
+	/**
+	 * 写入文件（任意线程）
+	 * 先写临时文件并刷到磁盘再替换，写入中途崩溃不会损坏已有存档，返回成功时存档已落盘
+	 */
+	static bool WriteToFile(const TArray<uint8>& Data, const FString& FilePath, FGaiaInventorySaveStats& InOutStats);
+
+	/**
+	 * 序列化整个物品/容器图（捕获 + 序列化，同步）
+	 * @param ItemMap 物品数据源
+	 * @param ContainerMap 容器数据源
+	 * @param OutData 输出：存档字节
+	 * @param OutError 失败原因
+	 * @param LifetimeClock 物品寿命时钟的当前值
+	 * @return 是否成功
+	 */
+	static bool Save(
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+		TArray<uint8>& OutData,
+		FString& OutError,
+		double LifetimeClock = 0.0);
+
+	/**
+	 * 反序列化并重建所有派生数据（槽位引用、父子关系、统计缓存）
+	 * 失败时输出表保持为空
+	 * @param Data 存档字节
+	 * @param OutItemMap 输出：物品表
+	 * @param OutContainerMap 输出：容器表
+	 * @param OutError 失败原因
+	 * @param LifetimeClock 物品寿命时钟的当前值（剩余寿命按它换算为过期时间）
+	 * @return 是否成功
+	 */
+	static bool Load(
+		const TArray<uint8>& Data,
+		TMap<FGuid, FGaiaItemInstance>& OutItemMap,
+		TMap<FGuid, FGaiaContainerInstance>& OutContainerMap,
+		FString& OutError,
+		double LifetimeClock = 0.0);
+
+	/**
+	 * 以物品的位置信息为准重建槽位引用和容器父子关系（不含统计缓存）
+	 * 两个物品声明同一个槽位时，后处理的物品变为游离状态
+	 */
+	static void RebuildDerivedData(
+		TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+		TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap);
+
+	/** 按 ParentContainerUID 重建嵌套深度、根容器和子树高度（父链成环时断开） */
+	static void RebuildNestingInfo(TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap);
+};
+
+/**
+ * 增量保存的变更集（游戏线程捕获，工作线程写入）
+ * 每个桶是一个容器及其槽位中的物品；游离物品单独一个桶
+ */
+struct FGaiaInventoryStoreChanges
+{
+	/** 需要重写的容器桶（每个快照只含一个容器记录） */
+	TArray<FGaiaInventorySnapshot> ContainerBuckets;
+
+	/** 已删除（或已移出，例如玩家分片）的容器 */
+	TArray<FGuid> RemovedContainerUIDs;
+
+	/** 游离物品桶（未变化时为空） */
+	TOptional<FGaiaInventorySnapshot> OrphanBucket;
+
+	/** 全量重写：删除目录中不在本次变更集里的所有桶 */
+	bool bFullRewrite = false;
+};
+
+/**
+ * 按容器寻址的库存存档目录
+ *
+ * 目录布局：
+ * - <ContainerUID>.bucket：容器记录 + 槽位中的物品（物品的容器引用直接写 UID）
+ * - Orphans.bucket：游离物品
+ * - Commit.pending：一次保存中待替换/删除的文件清单
+ *
+ * 一次保存只重写变化过的桶。各桶先写临时文件，再写入提交清单，最后逐个替换；
+ * 替换过程中崩溃时，下次加载先按清单补完替换，所以多个桶之间也不会出现一半新一半旧。
+ */
+class GAIAGAME_API FGaiaInventoryContainerStore
+{
+public:
+	/** 桶文件头标识 'GBKT' */
+	static constexpr uint32 Magic = 0x544B4247;
+
+	/** 桶格式版本（2：UID 紧凑编码；3：槽位ID携带网格朝向；4：物品剩余寿命；仍可读取旧版本） */
+	static constexpr int32 Version = 4;
+
+	/**
+	 * 写入变更集（任意线程）
+	 * @param Directory 存档目录
+	 * @param Changes 变更集
+	 * @param InOutStats 统计（填写数量、大小和耗时，失败时填写 Error）
+	 * @return 是否成功
+	 */
+	static bool SaveChanges(const FString& Directory, const FGaiaInventoryStoreChanges& Changes, FGaiaInventorySaveStats& InOutStats);
+
+	/**
+	 * 读取目录中的所有桶并重建槽位引用和父子关系（不含统计缓存）
+	 * 失败时输出表保持为空
+	 * @param Directory 存档目录
+	 * @param OutItemMap 输出：物品表
+	 * @param OutContainerMap 输出：容器表
+	 * @param OutError 失败原因
+	 * @param LifetimeClock 物品寿命时钟的当前值（剩余寿命按它换算为过期时间）
+	 * @return 是否成功（目录不存在视为空存档）
+	 */
+	static bool Load(
+		const FString& Directory,
+		TMap<FGuid, FGaiaItemInstance>& OutItemMap,
+		TMap<FGuid, FGaiaContainerInstance>& OutContainerMap,
+		FString& OutError,
+		double LifetimeClock = 0.0);
+
+	/**
+	 * 逐桶读取目录（离线工具使用，内存只与单个桶的大小相关）
+	 * 读取前先补完未完成的提交；游离物品桶最后访问，它的容器表为空。
+	 * 传给访问函数的表只含该桶内容，未重建槽位引用和父子关系
+	 * @param Directory 存档目录
+	 * @param Visitor 每个桶调用一次，返回 false 时中止
+	 * @param OutError 失败原因
+	 * @return 是否读完所有桶
+	 */
+	static bool ForEachBucket(
+		const FString& Directory,
+		TFunctionRef<bool(TMap<FGuid, FGaiaItemInstance>&, TMap<FGuid, FGaiaContainerInstance>&)> Visitor,
+		FString& OutError);
+
+	/**
+	 * 直接写入一个桶文件（离线工具写全新目录时使用，不经过提交清单）
+	 * 没有容器记录的桶写为游离物品桶
+	 */
+	static bool WriteBucketFile(const FString& Directory, const FGaiaInventorySnapshot& Bucket);
+
+	/**
+	 * 分批写入游离物品桶（离线工具写全新目录时使用，内存只与单批的大小相关）
+	 * 打开时写入文件头和占位的物品数，每批物品直接追加到文件，Close 时回填物品数
+	 */
+	class FOrphanBucketWriter
+	{
+	public:
+		~FOrphanBucketWriter();
+
+		/** 在目录中创建游离物品桶 */
+		bool Open(const FString& Directory);
+
+		/** 追加一批游离物品（快照中的容器记录被忽略） */
+		bool Append(const FGaiaInventorySnapshot& Items);
+
+		/** 回填物品数并关闭，没有任何物品时删除文件 */
+		bool Close();
+
+		int32 GetNumItems() const { return NumItems; }
+
+	private:
+		TUniquePtr<FArchive> Writer;
+		FString FilePath;
+		int64 CountOffset = 0;
+		int32 NumItems = 0;
+	};
+
+	/** 把容器及其槽位中的物品捕获为一个桶（LifetimeClock 同 FGaiaInventorySerializer::CaptureSnapshot） */
+	static void CaptureContainerBucket(
+		const FGaiaContainerInstance& Container,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		FGaiaInventorySnapshot& OutBucket,
+		double LifetimeClock = 0.0);
+
+private:
+	static FString GetContainerBucketFileName(const FGuid& ContainerUID);
+
+	/** 按提交清单完成上一次未完成的替换（幂等） */
+	static void ApplyPendingCommit(const FString& Directory);
+
+	static void SerializeBucket(const FGaiaInventorySnapshot& Bucket, TArray<uint8>& OutData);
+	static void SerializeItemRecords(FArchive& Ar, const FGaiaInventorySnapshot& Bucket);
+	static bool LoadBucket(
+		const TArray<uint8>& Data,
+		TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+		TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap,
+		FString& OutError,
+		double LifetimeClock);
+};
+
+/**
+ * 库存操作日志（追加写入）
+ *
+ * 每次已提交的修改只写入受影响物品/容器的最终状态，几十字节一条，而不是重写整个存档。
+ * 一次提交是一个批次：[长度][CRC32][记录...]，崩溃时写了一半的批次在重放时整体丢弃。
+ *
+ * 记录是物品/容器状态的整体覆盖，重放结束后再以物品位置为准重建槽位引用，
+ * 因此在较新的快照上重放较旧的日志段也会得到相同的结果（压缩过程中崩溃时会发生）。
+ * 定义ID在每个日志文件内第一次出现时写入名字表记录，之后只写索引。
+ */
+class GAIAGAME_API FGaiaInventoryJournal
+{
+public:
+	/** 日志文件头标识 'GJNL' */
+	static constexpr uint32 Magic = 0x4C4E4A47;
+
+	/** 日志格式版本（2：UID 紧凑编码；3：槽位ID携带网格朝向；4：物品剩余寿命；仍可读取旧版本） */
+	static constexpr int32 Version = 4;
+
+	~FGaiaInventoryJournal();
+
+	/**
+	 * 打开日志文件（截断已有内容并写入文件头）
+	 * @param InFilePath 日志文件路径
+	 * @return 是否成功
+	 */
+	bool Open(const FString& InFilePath);
+
+	/** 关闭日志文件（未提交的记录被丢弃） */
+	void Close();
+
+	bool IsOpen() const { return FileHandle.IsValid(); }
+
+	/** 自打开以来已提交的字节数（不含文件头） */
+	int64 GetCommittedBytes() const { return CommittedBytes; }
+
+	// ========================================
+	// 记录写入（写入当前批次，Commit 时落盘）
+	// ========================================
+
+	void WriteContainerState(const FGaiaContainerInstance& Container);
+	void WriteContainerRemoved(const FGuid& ContainerUID);
+	/** 写入物品状态（过期时间按 LifetimeClock 换算为剩余寿命） */
+	void WriteItemState(const FGaiaItemInstance& Item, double LifetimeClock = 0.0);
+	void WriteItemRemoved(const FGuid& ItemUID);
+
+	/**
+	 * 提交当前批次（写入并刷新到磁盘）
+	 * @return 是否成功，失败时日志不再可用
+	 */
+	bool Commit();
+
+	/**
+	 * 把日志重放到物品/容器表上
+	 * 只更新物品/容器记录本身，重放完所有日志段后需要调用 FGaiaInventorySerializer::RebuildDerivedData，
+	 * 统计缓存也需要调用者重算。末尾不完整的批次（崩溃时写了一半）会被丢弃并记录警告。
+	 * @param Data 日志文件内容
+	 * @param InOutItemMap 物品表（通常来自最近的快照）
+	 * @param InOutContainerMap 容器表（通常来自最近的快照）
+	 * @param OutNumBatches 输出：成功重放的批次数
+	 * @param OutError 失败原因
+	 * @param LifetimeClock 物品寿命时钟的当前值（剩余寿命按它换算为过期时间）
+	 * @return 文件头无效或记录无法识别时返回false（已重放的批次保留）
+	 */
+	static bool Replay(
+		const TArray<uint8>& Data,
+		TMap<FGuid, FGaiaItemInstance>& InOutItemMap,
+		TMap<FGuid, FGaiaContainerInstance>& InOutContainerMap,
+		int32& OutNumBatches,
+		FString& OutError,
+		double LifetimeClock = 0.0);
+
+private:
+	/** 获取定义ID在日志名字表中的索引（首次出现时追加名字表记录） */
+	int32 GetNameIndex(FName Name);
+
+	TUniquePtr<IFileHandle> FileHandle;
+
+	/** 当前批次（未提交） */
+	TArray<uint8> PendingBatch;
+
+	/** 日志名字表 */
+	TMap<FName, int32> NameIndices;
+
+	int64 CommittedBytes = 0;
+};
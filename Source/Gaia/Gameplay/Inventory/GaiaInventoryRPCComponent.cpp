@@ -2,10 +2,16 @@
 
 #include "GaiaInventoryRPCComponent.h"
 #include "GaiaInventorySubsystem.h"
+#include "GaiaCraftingSubsystem.h"
+#include "GaiaEquipmentComponent.h"
+#include "GaiaTradeSubsystem.h"
 #include "GaiaLogChannels.h"
 #include "Net/UnrealNetwork.h"
 #include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Pawn.h"
 #include "Engine/World.h"
+#include "TimerManager.h"
 
 UGaiaInventoryRPCComponent::UGaiaInventoryRPCComponent()
 {
@@ -30,6 +36,30 @@ void UGaiaInventoryRPCComponent::BeginPlay()
 	}
 }
 
+void UGaiaInventoryRPCComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// 服务器：玩家离开时取消其交易，报价的物品从未移动，无需恢复
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		if (UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this))
+		{
+			TradeSystem->CancelTrade(this, TEXT("交易一方已离开"));
+		}
+
+		if (UGaiaCraftingSubsystem* CraftingSystem = UGaiaCraftingSubsystem::Get(this))
+		{
+			CraftingSystem->OnCraftableSetChanged.Remove(CraftableSetChangedHandle);
+			for (const FGuid& ContainerUID : OwnedContainerUIDs)
+			{
+				CraftingSystem->UnwatchContainerTree(ContainerUID);
+			}
+		}
+		CraftableSetChangedHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void UGaiaInventoryRPCComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -101,6 +131,150 @@ void UGaiaInventoryRPCComponent::RequestDestroyItem(const FGuid& ItemUID)
 	}
 }
 
+void UGaiaInventoryRPCComponent::RequestSortContainer(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerSortContainer_Implementation(ContainerUID, SortKey);
+	}
+	else
+	{
+		ServerSortContainer(ContainerUID, SortKey);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestRotateItem(const FGuid& ItemUID)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerRotateItem_Implementation(ItemUID);
+	}
+	else
+	{
+		ServerRotateItem(ItemUID);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestEquipItem(const FGuid& ItemUID, int32 SlotIndex)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerEquipItem_Implementation(ItemUID, SlotIndex);
+	}
+	else
+	{
+		ServerEquipItem(ItemUID, SlotIndex);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestUnequipItem(int32 SlotIndex, const FGuid& TargetContainerUID)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerUnequipItem_Implementation(SlotIndex, TargetContainerUID);
+	}
+	else
+	{
+		ServerUnequipItem(SlotIndex, TargetContainerUID);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestConsolidateStacks(const FGuid& RootContainerUID)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerConsolidateStacks_Implementation(RootContainerUID);
+	}
+	else
+	{
+		ServerConsolidateStacks(RootContainerUID);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestQuickStackToNearby(const FGuid& SourceContainerUID, float Radius)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerQuickStackToNearby_Implementation(SourceContainerUID, Radius);
+	}
+	else
+	{
+		ServerQuickStackToNearby(SourceContainerUID, Radius);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestCraftRecipe(UGaiaCraftingRecipe* Recipe, const FGuid& RootContainerUID, int32 Times)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerCraftRecipe_Implementation(Recipe, RootContainerUID, Times);
+	}
+	else
+	{
+		ServerCraftRecipe(Recipe, RootContainerUID, Times);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestOpenTrade(APlayerState* Partner, const FGuid& RootContainerUID)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerOpenTrade_Implementation(Partner, RootContainerUID);
+	}
+	else
+	{
+		ServerOpenTrade(Partner, RootContainerUID);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestAcceptTrade(const FGuid& RootContainerUID)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerAcceptTrade_Implementation(RootContainerUID);
+	}
+	else
+	{
+		ServerAcceptTrade(RootContainerUID);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestSetTradeOffers(const TArray<FGaiaTradeOffer>& Offers)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerSetTradeOffers_Implementation(Offers);
+	}
+	else
+	{
+		ServerSetTradeOffers(Offers);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestConfirmTrade(int32 Revision)
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerConfirmTrade_Implementation(Revision);
+	}
+	else
+	{
+		ServerConfirmTrade(Revision);
+	}
+}
+
+void UGaiaInventoryRPCComponent::RequestCancelTrade()
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ServerCancelTrade_Implementation();
+	}
+	else
+	{
+		ServerCancelTrade();
+	}
+}
+
 void UGaiaInventoryRPCComponent::RequestOpenWorldContainer(const FGuid& ContainerUID)
 {
 	if (GetOwnerRole() == ROLE_Authority)
@@ -133,6 +307,13 @@ void UGaiaInventoryRPCComponent::RequestRefreshInventory()
 	}
 	else
 	{
+		// 已有请求在途时不再重复发送，数据到达后自然是最新的
+		if (bRefreshRequestPending)
+		{
+			UE_LOG(LogGaia, Verbose, TEXT("[RPC组件] 刷新请求已在途，跳过"));
+			return;
+		}
+		bRefreshRequestPending = true;
 		ServerRequestRefreshInventory();
 	}
 }
@@ -193,8 +374,8 @@ bool UGaiaInventoryRPCComponent::ServerMoveItem_Validate(
 	int32 TargetSlotID,
 	int32 Quantity)
 {
-	// 基本验证，防止恶意数据
-	return TargetSlotID >= -1 && TargetSlotID < 1000 && Quantity >= 0 && Quantity <= 9999;
+	// 基本验证，防止恶意数据（验证失败会断开连接，槽位是否存在、数量是否足够由服务器执行时检查并回报失败）
+	return TargetSlotID >= -1 && TargetSlotID < FGaiaInventoryGrid::MaxSlotCount && Quantity >= 0;
 }
 
 void UGaiaInventoryRPCComponent::ServerAddItem_Implementation(
@@ -333,6 +514,344 @@ bool UGaiaInventoryRPCComponent::ServerDestroyItem_Validate(const FGuid& ItemUID
 	return ItemUID.IsValid();
 }
 
+void UGaiaInventoryRPCComponent::ServerSortContainer_Implementation(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (!InventorySystem)
+	{
+		ClientOperationFailed(1, TEXT("库存系统不可用"));
+		return;
+	}
+
+	if (!OwnsContainerTree(ContainerUID))
+	{
+		ClientOperationFailed(9, TEXT("整理容器失败：容器不属于该玩家"));
+		return;
+	}
+
+	if (InventorySystem->HasContainerSlotFilters(ContainerUID))
+	{
+		ClientOperationFailed(9, TEXT("整理容器失败：该容器的槽位有限制"));
+		return;
+	}
+
+	if (InventorySystem->SortContainer(ContainerUID, SortKey))
+	{
+		// 整个整理只广播一次
+		InventorySystem->BroadcastContainerUpdate(ContainerUID);
+	}
+	else
+	{
+		ClientOperationFailed(9, TEXT("整理容器失败"));
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerSortContainer_Validate(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey)
+{
+	return ContainerUID.IsValid() && SortKey <= EGaiaContainerSortKey::Quantity;
+}
+
+void UGaiaInventoryRPCComponent::ServerRotateItem_Implementation(const FGuid& ItemUID)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (!InventorySystem)
+	{
+		ClientOperationFailed(1, TEXT("库存系统不可用"));
+		return;
+	}
+
+	if (InventorySystem->RotateItem(ItemUID))
+	{
+		FGaiaItemInstance Item;
+		if (InventorySystem->FindItemByUID(ItemUID, Item) && Item.IsInContainer())
+		{
+			InventorySystem->BroadcastContainerUpdate(Item.CurrentContainerUID);
+		}
+	}
+	else
+	{
+		ClientOperationFailed(12, TEXT("旋转物品失败"));
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerRotateItem_Validate(const FGuid& ItemUID)
+{
+	return ItemUID.IsValid();
+}
+
+void UGaiaInventoryRPCComponent::ServerEquipItem_Implementation(const FGuid& ItemUID, int32 SlotIndex)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	UGaiaEquipmentComponent* EquipmentComp = FindEquipmentComponent();
+	if (!InventorySystem || !EquipmentComp)
+	{
+		ClientOperationFailed(1, TEXT("装备系统不可用"));
+		return;
+	}
+
+	// 装备前记下来源容器，成功后两边各广播一次；只能装备自己容器树中的物品（被替换的装备也放回这里）
+	FGaiaItemInstance Item;
+	const FGuid SourceContainerUID = InventorySystem->FindItemByUID(ItemUID, Item) ? Item.CurrentContainerUID : FGuid();
+	if (!OwnsContainerTree(SourceContainerUID))
+	{
+		ClientOperationFailed(13, TEXT("装备失败：物品不在该玩家的容器中"));
+		return;
+	}
+
+	const FMoveItemResult Result = EquipmentComp->EquipItem(ItemUID, SlotIndex);
+	if (Result.IsSuccess())
+	{
+		InventorySystem->BroadcastContainerUpdate(EquipmentComp->GetEquipmentContainerUID());
+		if (SourceContainerUID.IsValid())
+		{
+			InventorySystem->BroadcastContainerUpdate(SourceContainerUID);
+		}
+	}
+	else
+	{
+		ClientOperationFailed(13, Result.ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerEquipItem_Validate(const FGuid& ItemUID, int32 SlotIndex)
+{
+	return ItemUID.IsValid() && SlotIndex >= -1 && SlotIndex < FGaiaInventoryGrid::MaxSlotCount;
+}
+
+void UGaiaInventoryRPCComponent::ServerUnequipItem_Implementation(int32 SlotIndex, const FGuid& TargetContainerUID)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	UGaiaEquipmentComponent* EquipmentComp = FindEquipmentComponent();
+	if (!InventorySystem || !EquipmentComp)
+	{
+		ClientOperationFailed(1, TEXT("装备系统不可用"));
+		return;
+	}
+
+	if (!OwnsContainerTree(TargetContainerUID))
+	{
+		ClientOperationFailed(13, TEXT("卸下装备失败：目标容器不属于该玩家"));
+		return;
+	}
+
+	const FMoveItemResult Result = EquipmentComp->UnequipItem(SlotIndex, TargetContainerUID);
+	if (Result.IsSuccess())
+	{
+		InventorySystem->BroadcastContainerUpdate(EquipmentComp->GetEquipmentContainerUID());
+		InventorySystem->BroadcastContainerUpdate(TargetContainerUID);
+	}
+	else
+	{
+		ClientOperationFailed(13, Result.ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerUnequipItem_Validate(int32 SlotIndex, const FGuid& TargetContainerUID)
+{
+	return TargetContainerUID.IsValid() && SlotIndex >= 0 && SlotIndex < FGaiaInventoryGrid::MaxSlotCount;
+}
+
+void UGaiaInventoryRPCComponent::ServerConsolidateStacks_Implementation(const FGuid& RootContainerUID)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (!InventorySystem)
+	{
+		ClientOperationFailed(1, TEXT("库存系统不可用"));
+		return;
+	}
+
+	if (!OwnsContainerTree(RootContainerUID))
+	{
+		ClientOperationFailed(15, TEXT("合并堆叠失败：容器不属于该玩家"));
+		return;
+	}
+
+	// 整棵树的变化作为一批广播
+	const FGaiaConsolidateResult Result = InventorySystem->ConsolidateStacks(RootContainerUID);
+	if (Result.HasChanges())
+	{
+		InventorySystem->BroadcastContainerUpdate(RootContainerUID);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerConsolidateStacks_Validate(const FGuid& RootContainerUID)
+{
+	return RootContainerUID.IsValid();
+}
+
+void UGaiaInventoryRPCComponent::ServerQuickStackToNearby_Implementation(const FGuid& SourceContainerUID, float Radius)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	if (!InventorySystem)
+	{
+		ClientOperationFailed(1, TEXT("库存系统不可用"));
+		return;
+	}
+
+	// 只能从自己的容器中转出
+	if (!OwnsContainerTree(SourceContainerUID))
+	{
+		ClientOperationFailed(10, TEXT("快速堆放失败：容器不属于该玩家"));
+		return;
+	}
+
+	// 查找中心取服务器上的角色位置，不信任客户端坐标
+	const APawn* Pawn = nullptr;
+	if (const APlayerController* PC = Cast<APlayerController>(GetOwner()))
+	{
+		Pawn = PC->GetPawn();
+	}
+	else if (const APlayerState* PS = Cast<APlayerState>(GetOwner()))
+	{
+		Pawn = PS->GetPawn();
+	}
+	if (!Pawn)
+	{
+		ClientOperationFailed(10, TEXT("快速堆放失败：没有可用的角色"));
+		return;
+	}
+
+	const float ClampedRadius = FMath::Min(Radius, GetDefault<UGaiaInventoryManagerSettings>()->MaxQuickStackRadius);
+	const FGaiaConsolidateResult Result = InventorySystem->QuickStackToNearbyContainers(SourceContainerUID, Pawn->GetActorLocation(), ClampedRadius);
+	if (Result.HasChanges())
+	{
+		// 整批变化只广播一次
+		InventorySystem->BroadcastContainerUpdate(SourceContainerUID);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerQuickStackToNearby_Validate(const FGuid& SourceContainerUID, float Radius)
+{
+	return SourceContainerUID.IsValid() && Radius > 0.0f;
+}
+
+void UGaiaInventoryRPCComponent::ServerCraftRecipe_Implementation(UGaiaCraftingRecipe* Recipe, const FGuid& RootContainerUID, int32 Times)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	UGaiaCraftingSubsystem* CraftingSystem = UGaiaCraftingSubsystem::Get(this);
+	if (!InventorySystem || !CraftingSystem)
+	{
+		ClientOperationFailed(1, TEXT("库存系统不可用"));
+		return;
+	}
+
+	// 只能用自己的容器制作（材料从中扣除，产出放入其中）
+	if (!OwnedContainerUIDs.Contains(RootContainerUID))
+	{
+		ClientOperationFailed(11, TEXT("制作失败：容器不属于该玩家"));
+		return;
+	}
+
+	FGaiaGrantResult GrantResult;
+	if (!CraftingSystem->Craft(RootContainerUID, Recipe, Times, GrantResult))
+	{
+		ClientOperationFailed(11, GrantResult.Overflow.IsEmpty() ? TEXT("制作失败：材料不足或配方无效") : TEXT("制作失败：容器空间不足，放不下产出"));
+		return;
+	}
+
+	// 扣除和发放只广播一次
+	InventorySystem->BroadcastContainerUpdate(RootContainerUID);
+}
+
+bool UGaiaInventoryRPCComponent::ServerCraftRecipe_Validate(UGaiaCraftingRecipe* Recipe, const FGuid& RootContainerUID, int32 Times)
+{
+	return RootContainerUID.IsValid() && Times > 0;
+}
+
+void UGaiaInventoryRPCComponent::ServerOpenTrade_Implementation(APlayerState* Partner, const FGuid& RootContainerUID)
+{
+	UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this);
+	if (!TradeSystem)
+	{
+		ClientOperationFailed(1, TEXT("交易系统不可用"));
+		return;
+	}
+
+	// 会话的所有变化由交易子系统只通知双方
+	FString ErrorMessage;
+	if (!TradeSystem->InviteTrade(this, UGaiaTradeSubsystem::FindParticipantComponent(Partner), RootContainerUID, ErrorMessage))
+	{
+		ClientOperationFailed(14, ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerOpenTrade_Validate(APlayerState* Partner, const FGuid& RootContainerUID)
+{
+	return RootContainerUID.IsValid();
+}
+
+void UGaiaInventoryRPCComponent::ServerAcceptTrade_Implementation(const FGuid& RootContainerUID)
+{
+	UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this);
+	if (!TradeSystem)
+	{
+		ClientOperationFailed(1, TEXT("交易系统不可用"));
+		return;
+	}
+
+	FString ErrorMessage;
+	if (!TradeSystem->AcceptTrade(this, RootContainerUID, ErrorMessage))
+	{
+		ClientOperationFailed(14, ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerAcceptTrade_Validate(const FGuid& RootContainerUID)
+{
+	return RootContainerUID.IsValid();
+}
+
+void UGaiaInventoryRPCComponent::ServerSetTradeOffers_Implementation(const TArray<FGaiaTradeOffer>& Offers)
+{
+	UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this);
+	if (!TradeSystem)
+	{
+		ClientOperationFailed(1, TEXT("交易系统不可用"));
+		return;
+	}
+
+	FString ErrorMessage;
+	if (!TradeSystem->SetTradeOffers(this, Offers, ErrorMessage))
+	{
+		ClientOperationFailed(14, ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerSetTradeOffers_Validate(const TArray<FGaiaTradeOffer>& Offers)
+{
+	return Offers.Num() <= 256;
+}
+
+void UGaiaInventoryRPCComponent::ServerConfirmTrade_Implementation(int32 Revision)
+{
+	UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this);
+	if (!TradeSystem)
+	{
+		ClientOperationFailed(1, TEXT("交易系统不可用"));
+		return;
+	}
+
+	// 成交后交易子系统只给双方推送库存，不广播给所有玩家
+	FString ErrorMessage;
+	if (!TradeSystem->ConfirmTrade(this, Revision, ErrorMessage))
+	{
+		ClientOperationFailed(14, ErrorMessage);
+	}
+}
+
+bool UGaiaInventoryRPCComponent::ServerConfirmTrade_Validate(int32 Revision)
+{
+	return Revision >= 0;
+}
+
+void UGaiaInventoryRPCComponent::ServerCancelTrade_Implementation()
+{
+	if (UGaiaTradeSubsystem* TradeSystem = UGaiaTradeSubsystem::Get(this))
+	{
+		TradeSystem->CancelTrade(this, TEXT("交易已取消"));
+	}
+}
+
 void UGaiaInventoryRPCComponent::ServerOpenWorldContainer_Implementation(const FGuid& ContainerUID)
 {
 	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
@@ -478,6 +997,8 @@ void UGaiaInventoryRPCComponent::ClientReceiveInventoryData_Implementation(
 	UE_LOG(LogGaia, Warning, TEXT("[RPC组件] ⭐⭐⭐ ClientReceiveInventoryData 被调用: %d 个物品, %d 个容器"),
 		Items.Num(), Containers.Num());
 
+	bRefreshRequestPending = false;
+
 	// 更新本地缓存
 	CachedItems.Empty();
 	for (const FGaiaItemInstance& Item : Items)
@@ -490,6 +1011,7 @@ void UGaiaInventoryRPCComponent::ClientReceiveInventoryData_Implementation(
 	{
 		CachedContainers.Add(Container.ContainerUID, Container);
 	}
+	++CacheRevision;
 
 	// 触发更新事件（UI可以监听此事件）
 	UE_LOG(LogGaia, Warning, TEXT("[RPC组件] ⭐⭐⭐ 广播 OnInventoryUpdated 事件"));
@@ -521,6 +1043,7 @@ void UGaiaInventoryRPCComponent::ClientReceiveInventoryDelta_Implementation(
 	{
 		CachedContainers.Add(Container.ContainerUID, Container);
 	}
+	++CacheRevision;
 
 	// 触发更新事件
 	UE_LOG(LogGaia, Warning, TEXT("[RPC组件] ⭐ 广播 OnInventoryUpdated 事件，绑定数量: %d"),
@@ -542,6 +1065,41 @@ void UGaiaInventoryRPCComponent::ClientOperationFailed_Implementation(int32 Erro
 	OnOperationFailed.Broadcast(ErrorCode, ErrorMessage);
 }
 
+void UGaiaInventoryRPCComponent::ClientTradeUpdated_Implementation(const FGaiaTradeSessionView& Session)
+{
+	UE_LOG(LogGaia, Log, TEXT("[网络] 交易更新: 会话 %s, 状态 %s, 修订号 %d"),
+		*Session.SessionID.ToString(), *UEnum::GetValueAsString(Session.State), Session.Revision);
+
+	CurrentTrade = Session;
+	OnTradeUpdated.Broadcast(CurrentTrade);
+}
+
+void UGaiaInventoryRPCComponent::ClientCraftableCountsChanged_Implementation(const FGuid& RootContainerUID, const TArray<int32>& RecipeIndices, const TArray<int32>& CraftableCounts)
+{
+	if (RecipeIndices.Num() != CraftableCounts.Num())
+	{
+		return;
+	}
+
+	TArray<int32>& Counts = CachedCraftableCounts.FindOrAdd(RootContainerUID);
+	for (int32 Index = 0; Index < RecipeIndices.Num(); ++Index)
+	{
+		const int32 RecipeIndex = RecipeIndices[Index];
+		if (RecipeIndex < 0)
+		{
+			continue;
+		}
+		if (RecipeIndex >= Counts.Num())
+		{
+			Counts.SetNumZeroed(RecipeIndex + 1);
+		}
+		Counts[RecipeIndex] = CraftableCounts[Index];
+	}
+
+	UE_LOG(LogGaia, Verbose, TEXT("[网络] 可制作次数更新: 容器 %s, %d 个配方"), *RootContainerUID.ToString(), RecipeIndices.Num());
+	OnCraftableRecipesChanged.Broadcast(RootContainerUID, RecipeIndices);
+}
+
 // ========================================
 // 客户端本地缓存访问
 // ========================================
@@ -566,6 +1124,27 @@ bool UGaiaInventoryRPCComponent::GetCachedContainer(const FGuid& ContainerUID, F
 	return false;
 }
 
+bool UGaiaInventoryRPCComponent::GetCachedItemRemainingLifetime(const FGuid& ItemUID, float& OutRemainingSeconds) const
+{
+	const FGaiaItemInstance* Found = CachedItems.Find(ItemUID);
+	const UWorld* World = GetWorld();
+	const UGaiaInventorySubsystem* InventorySystem = World ? World->GetSubsystem<UGaiaInventorySubsystem>() : nullptr;
+	if (!Found || !Found->HasLifetime() || !InventorySystem)
+	{
+		return false;
+	}
+
+	// ExpireTime 是服务器时间，与子系统的寿命时钟（客户端上为同步后的服务器时间）比较
+	OutRemainingSeconds = FMath::Max(static_cast<float>(Found->ExpireTime - InventorySystem->GetLifetimeClock()), 0.0f);
+	return true;
+}
+
+int32 UGaiaInventoryRPCComponent::GetCachedCraftableCount(const FGuid& RootContainerUID, int32 RecipeIndex) const
+{
+	const TArray<int32>* Counts = CachedCraftableCounts.Find(RootContainerUID);
+	return Counts && Counts->IsValidIndex(RecipeIndex) ? (*Counts)[RecipeIndex] : 0;
+}
+
 void UGaiaInventoryRPCComponent::AddOwnedContainerUID(const FGuid& ContainerUID)
 {
 	if (!ContainerUID.IsValid())
@@ -577,19 +1156,81 @@ void UGaiaInventoryRPCComponent::AddOwnedContainerUID(const FGuid& ContainerUID)
 	{
 		OwnedContainerUIDs.Add(ContainerUID);
 		UE_LOG(LogGaia, Verbose, TEXT("[RPC组件] 添加拥有的容器UID: %s"), *ContainerUID.ToString());
+
+		// 服务器主动推送，客户端收到复制后不必再发请求
+		if (GetOwnerRole() == ROLE_Authority)
+		{
+			// 归入玩家分片，登出时随分片保存移出
+			if (!InventoryShardId.IsEmpty())
+			{
+				if (UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem())
+				{
+					InventorySystem->AddPlayerShardRoot(InventoryShardId, ContainerUID);
+				}
+			}
+
+			WatchCraftableSet(ContainerUID);
+			SchedulePushInventory();
+		}
 	}
 }
 
+void UGaiaInventoryRPCComponent::WatchCraftableSet(const FGuid& RootContainerUID)
+{
+	UGaiaCraftingSubsystem* CraftingSystem = UGaiaCraftingSubsystem::Get(this);
+	if (!CraftingSystem)
+	{
+		return;
+	}
+
+	// 容器可能在 BeginPlay 之前登记（登录时加载分片），订阅放在第一次登记时
+	if (!CraftableSetChangedHandle.IsValid())
+	{
+		CraftableSetChangedHandle = CraftingSystem->OnCraftableSetChanged.AddUObject(this, &ThisClass::HandleCraftableSetChanged);
+	}
+
+	CraftingSystem->WatchContainerTree(RootContainerUID);
+
+	// 客户端从空集合开始，只需要当前可以制作的配方
+	TArray<int32> RecipeIndices;
+	if (const TBitArray<>* CraftableSet = CraftingSystem->FindCraftableSet(RootContainerUID))
+	{
+		for (TConstSetBitIterator<> It(*CraftableSet); It; ++It)
+		{
+			RecipeIndices.Add(It.GetIndex());
+		}
+	}
+	if (!RecipeIndices.IsEmpty())
+	{
+		HandleCraftableSetChanged(RootContainerUID, RecipeIndices);
+	}
+}
+
+void UGaiaInventoryRPCComponent::HandleCraftableSetChanged(const FGuid& RootContainerUID, const TArray<int32>& ChangedRecipeIndices)
+{
+	UGaiaCraftingSubsystem* CraftingSystem = UGaiaCraftingSubsystem::Get(this);
+	if (!CraftingSystem || !OwnedContainerUIDs.Contains(RootContainerUID))
+	{
+		return;
+	}
+
+	TArray<int32> CraftableCounts;
+	CraftableCounts.Reserve(ChangedRecipeIndices.Num());
+	for (const int32 RecipeIndex : ChangedRecipeIndices)
+	{
+		CraftableCounts.Add(CraftingSystem->GetCraftableCount(RootContainerUID, CraftingSystem->GetRecipe(RecipeIndex)));
+	}
+	ClientCraftableCountsChanged(RootContainerUID, ChangedRecipeIndices, CraftableCounts);
+}
+
 // ========================================
 // 复制回调
 // ========================================
 
 void UGaiaInventoryRPCComponent::OnRep_OwnedContainers()
 {
+	// 数据由服务器在 AddOwnedContainerUID 时主动推送，这里不再请求刷新
 	UE_LOG(LogGaia, Verbose, TEXT("[网络] 拥有的容器列表已更新: %d 个"), OwnedContainerUIDs.Num());
-	
-	// 请求刷新数据
-	RequestRefreshInventory();
 }
 
 void UGaiaInventoryRPCComponent::OnRep_OpenWorldContainers() const
@@ -613,11 +1254,58 @@ UGaiaInventorySubsystem* UGaiaInventoryRPCComponent::GetInventorySubsystem()
 	return CachedSubsystem;
 }
 
+bool UGaiaInventoryRPCComponent::OwnsContainerTree(const FGuid& ContainerUID)
+{
+	UGaiaInventorySubsystem* InventorySystem = GetInventorySubsystem();
+	const FGuid RootContainerUID = InventorySystem ? InventorySystem->GetRootContainerUID(ContainerUID) : FGuid();
+	return RootContainerUID.IsValid() && OwnedContainerUIDs.Contains(RootContainerUID);
+}
+
 APlayerController* UGaiaInventoryRPCComponent::GetOwningPlayerController() const
 {
 	return Cast<APlayerController>(GetOwner());
 }
 
+UGaiaEquipmentComponent* UGaiaInventoryRPCComponent::FindEquipmentComponent() const
+{
+	AActor* Owner = GetOwner();
+	if (UGaiaEquipmentComponent* EquipmentComp = Owner ? Owner->FindComponentByClass<UGaiaEquipmentComponent>() : nullptr)
+	{
+		return EquipmentComp;
+	}
+
+	const APlayerController* PC = Cast<APlayerController>(Owner);
+	const APlayerState* PS = PC ? PC->PlayerState.Get() : Cast<APlayerState>(Owner);
+	if (UGaiaEquipmentComponent* EquipmentComp = PS ? PS->FindComponentByClass<UGaiaEquipmentComponent>() : nullptr)
+	{
+		return EquipmentComp;
+	}
+
+	const APawn* Pawn = PC ? PC->GetPawn() : (PS ? PS->GetPawn() : nullptr);
+	return Pawn ? Pawn->FindComponentByClass<UGaiaEquipmentComponent>() : nullptr;
+}
+
+void UGaiaInventoryRPCComponent::SchedulePushInventory()
+{
+	if (bPushScheduled)
+	{
+		return;
+	}
+	
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+	
+	bPushScheduled = true;
+	World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		bPushScheduled = false;
+		ServerRequestRefreshInventory_Implementation();
+	}));
+}
+
 // ========================================
 // 调试辅助函数
 // ========================================
@@ -8,6 +8,9 @@
 #include "GaiaInventoryRPCComponent.generated.h"
 
 class UGaiaInventorySubsystem;
+class UGaiaCraftingRecipe;
+class UGaiaEquipmentComponent;
+class APlayerState;
 
 /**
  * 库存系统网络RPC组件
@@ -31,6 +34,7 @@ public:
 
 	//~ Begin UActorComponent Interface
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	//~ End UActorComponent Interface
 
@@ -79,6 +83,98 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
 	void RequestDestroyItem(const FGuid& ItemUID);
 
+	/**
+	 * 请求整理容器（合并堆叠并排序，服务器一次完成）
+	 * @param ContainerUID 要整理的容器UID
+	 * @param SortKey 排序方式
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestSortContainer(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey);
+
+	/**
+	 * 请求旋转网格容器中的物品（原位置放不下时失败）
+	 * @param ItemUID 物品UID
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestRotateItem(const FGuid& ItemUID);
+
+	/**
+	 * 请求装备物品（需要玩家挂载 UGaiaEquipmentComponent）
+	 * @param ItemUID 物品UID
+	 * @param SlotIndex 装备槽下标（-1表示自动选择）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestEquipItem(const FGuid& ItemUID, int32 SlotIndex = -1);
+
+	/**
+	 * 请求卸下装备
+	 * @param SlotIndex 装备槽下标
+	 * @param TargetContainerUID 放入的容器UID
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestUnequipItem(int32 SlotIndex, const FGuid& TargetContainerUID);
+
+	/**
+	 * 请求合并容器树中的未满堆叠
+	 * @param RootContainerUID 根容器UID（包含其中嵌套的容器）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestConsolidateStacks(const FGuid& RootContainerUID);
+
+	/**
+	 * 请求快速堆放：把容器中与附近世界容器已有内容同定义的物品全部存入
+	 * 服务器以玩家角色位置为中心查找，半径不超过设置中的上限
+	 * @param SourceContainerUID 来源容器UID（包含其中嵌套的容器）
+	 * @param Radius 查找半径
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestQuickStackToNearby(const FGuid& SourceContainerUID, float Radius = 1000.0f);
+
+	/**
+	 * 请求制作
+	 * 服务器在一次操作内扣除材料并发放产出，次数不超过当前可制作次数
+	 * @param Recipe 配方（需已在 UGaiaCraftingSubsystem 注册）
+	 * @param RootContainerUID 材料所在并接收产出的根容器UID
+	 * @param Times 制作次数
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void RequestCraftRecipe(UGaiaCraftingRecipe* Recipe, const FGuid& RootContainerUID, int32 Times = 1);
+
+	/**
+	 * 请求向其他玩家发起交易（需要对方接受）
+	 * @param Partner 对方的玩家状态
+	 * @param RootContainerUID 自己用于交易的根容器UID（报价物品从中取出，收到的物品放入其中）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	void RequestOpenTrade(APlayerState* Partner, const FGuid& RootContainerUID);
+
+	/**
+	 * 请求接受收到的交易邀请
+	 * @param RootContainerUID 自己用于交易的根容器UID
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	void RequestAcceptTrade(const FGuid& RootContainerUID);
+
+	/**
+	 * 请求替换自己的报价（不移动物品，双方的确认被清除）
+	 * @param Offers 报价（空数组表示撤回全部报价）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	void RequestSetTradeOffers(const TArray<FGaiaTradeOffer>& Offers);
+
+	/**
+	 * 请求确认当前报价，双方都确认后服务器一次完成交换
+	 * @param Revision 当前会话视图中的修订号
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	void RequestConfirmTrade(int32 Revision);
+
+	/**
+	 * 请求取消交易（邀请中或报价中）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	void RequestCancelTrade();
+
 	/**
 	 * 请求打开世界容器（箱子等）
 	 * @param ContainerUID 容器UID
@@ -128,6 +224,54 @@ public:
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerDestroyItem(const FGuid& ItemUID);
 
+	/** 服务器RPC：整理容器 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSortContainer(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey);
+
+	/** 服务器RPC：旋转物品 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerRotateItem(const FGuid& ItemUID);
+
+	/** 服务器RPC：装备物品 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerEquipItem(const FGuid& ItemUID, int32 SlotIndex);
+
+	/** 服务器RPC：卸下装备 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerUnequipItem(int32 SlotIndex, const FGuid& TargetContainerUID);
+
+	/** 服务器RPC：合并堆叠 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerConsolidateStacks(const FGuid& RootContainerUID);
+
+	/** 服务器RPC：快速堆放到附近容器 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerQuickStackToNearby(const FGuid& SourceContainerUID, float Radius);
+
+	/** 服务器RPC：制作 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerCraftRecipe(UGaiaCraftingRecipe* Recipe, const FGuid& RootContainerUID, int32 Times);
+
+	/** 服务器RPC：发起交易 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerOpenTrade(APlayerState* Partner, const FGuid& RootContainerUID);
+
+	/** 服务器RPC：接受交易 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerAcceptTrade(const FGuid& RootContainerUID);
+
+	/** 服务器RPC：设置报价 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetTradeOffers(const TArray<FGaiaTradeOffer>& Offers);
+
+	/** 服务器RPC：确认交易 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerConfirmTrade(int32 Revision);
+
+	/** 服务器RPC：取消交易 */
+	UFUNCTION(Server, Reliable)
+	void ServerCancelTrade();
+
 	/** 服务器RPC：打开世界容器 */
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerOpenWorldContainer(const FGuid& ContainerUID);
@@ -184,6 +328,22 @@ public:
 	UFUNCTION(Client, Reliable)
 	void ClientOperationFailed(int32 ErrorCode, const FString& ErrorMessage);
 
+	/**
+	 * 客户端RPC：交易会话更新（只发给会话的两个参与者）
+	 * @param Session 从接收方角度的会话视图
+	 */
+	UFUNCTION(Client, Reliable)
+	void ClientTradeUpdated(const FGaiaTradeSessionView& Session);
+
+	/**
+	 * 客户端RPC：拥有的容器树中配方的可制作次数变化
+	 * @param RootContainerUID 根容器
+	 * @param RecipeIndices 变化的配方下标
+	 * @param CraftableCounts 与 RecipeIndices 一一对应的可制作次数
+	 */
+	UFUNCTION(Client, Reliable)
+	void ClientCraftableCountsChanged(const FGuid& RootContainerUID, const TArray<int32>& RecipeIndices, const TArray<int32>& CraftableCounts);
+
 public:
 	// ========================================
 	// 蓝图事件（客户端UI监听）
@@ -215,6 +375,18 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Gaia|Inventory")
 	FOnContainerClosed OnContainerClosed;
 
+	/**
+	 * 交易会话更新事件（邀请、报价、确认、成交或取消）
+	 */
+	UPROPERTY(BlueprintAssignable, Category = "Gaia|Inventory|Trade")
+	FOnTradeUpdated OnTradeUpdated;
+
+	/**
+	 * 可制作配方变化事件（拥有的容器树中材料数量变化导致）
+	 */
+	UPROPERTY(BlueprintAssignable, Category = "Gaia|Inventory|Crafting")
+	FOnCraftableRecipesChanged OnCraftableRecipesChanged;
+
 public:
 	// ========================================
 	// 客户端本地缓存（仅用于UI显示）
@@ -233,6 +405,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
 	bool GetCachedContainer(const FGuid& ContainerUID, FGaiaContainerInstance& OutContainer) const;
 
+	/**
+	 * 获取本地缓存物品的剩余寿命（按同步后的服务器时间计算）
+	 * @return 物品不存在或不会过期时返回false
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Lifetime")
+	bool GetCachedItemRemainingLifetime(const FGuid& ItemUID, float& OutRemainingSeconds) const;
+
 	/**
 	 * 获取玩家拥有的所有容器UID
 	 */
@@ -241,9 +420,37 @@ public:
 
 	/**
 	 * 添加拥有的容器UID（用于权限注册）
+	 * 服务器会在下一帧把最新数据推送给该玩家，客户端无需再请求刷新
 	 */
 	void AddOwnedContainerUID(const FGuid& ContainerUID);
 
+	/**
+	 * 服务器：设置玩家的库存分片ID（由 UGaiaInventorySubsystem::HandlePlayerLogin 设置）
+	 * 设置后 AddOwnedContainerUID 登记的容器会归入该分片，登出时随分片保存
+	 */
+	void SetInventoryShardId(const FString& InShardId) { InventoryShardId = InShardId; }
+
+	/** 服务器：玩家的库存分片ID（未启用分片时为空） */
+	const FString& GetInventoryShardId() const { return InventoryShardId; }
+
+	/**
+	 * 获取最近一次收到的交易会话视图（会话结束后状态为 Completed/Cancelled）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Trade")
+	const FGaiaTradeSessionView& GetCurrentTrade() const { return CurrentTrade; }
+
+	/**
+	 * 获取本地缓存的可制作次数（服务器推送，配方下标即 UGaiaCraftingSubsystem 中的注册下标）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Crafting")
+	int32 GetCachedCraftableCount(const FGuid& RootContainerUID, int32 RecipeIndex) const;
+
+	/** 服务器：在下一帧推送一次完整数据（同一帧内多次调用只推送一次） */
+	void SchedulePushInventory();
+
+	/** 获取玩家的装备组件（依次查找所属Actor、PlayerState、Pawn） */
+	UGaiaEquipmentComponent* FindEquipmentComponent() const;
+
 	/**
 	 * 获取当前打开的世界容器UID列表
 	 */
@@ -262,6 +469,15 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Debug")
 	int32 GetCachedContainerCount() const { return CachedContainers.Num(); }
 
+	/** 本地缓存的物品数据（只读，供 UGaiaInventoryReadModel 使用） */
+	const TMap<FGuid, FGaiaItemInstance>& GetCachedItemMap() const { return CachedItems; }
+
+	/** 本地缓存的容器数据（只读，供 UGaiaInventoryReadModel 使用） */
+	const TMap<FGuid, FGaiaContainerInstance>& GetCachedContainerMap() const { return CachedContainers; }
+
+	/** 本地缓存的修订号（每次收到完整或增量数据递增，供只读模型判断索引是否过期） */
+	int32 GetCacheRevision() const { return CacheRevision; }
+
 	/**
 	 * 获取所有本地缓存的物品UID
 	 */
@@ -282,6 +498,9 @@ protected:
 	/** 获取库存子系统 */
 	UGaiaInventorySubsystem* GetInventorySubsystem();
 
+	/** 服务器：容器所在容器树的根容器是否属于该玩家（客户端传来的容器UID都要先检查） */
+	bool OwnsContainerTree(const FGuid& ContainerUID);
+
 	/** 获取所属的PlayerController */
 	APlayerController* GetOwningPlayerController() const;
 
@@ -298,6 +517,15 @@ private:
 	UPROPERTY()
 	TMap<FGuid, FGaiaContainerInstance> CachedContainers;
 
+	/** 本地缓存的修订号 */
+	int32 CacheRevision = 0;
+
+	/** 客户端：最近一次收到的交易会话视图 */
+	FGaiaTradeSessionView CurrentTrade;
+
+	/** 客户端：根容器 -> 按配方下标的可制作次数 */
+	TMap<FGuid, TArray<int32>> CachedCraftableCounts;
+
 	/** 玩家拥有的容器UID列表（复制自服务器） */
 	UPROPERTY(ReplicatedUsing=OnRep_OwnedContainers)
 	TArray<FGuid> OwnedContainerUIDs;
@@ -310,6 +538,24 @@ private:
 	UPROPERTY()
 	TObjectPtr<UGaiaInventorySubsystem> CachedSubsystem;
 
+	/** 客户端：刷新请求已发出、尚未收到数据（避免重复往返） */
+	bool bRefreshRequestPending = false;
+
+	/** 服务器：已安排下一帧推送数据 */
+	bool bPushScheduled = false;
+
+	/** 服务器：玩家的库存分片ID */
+	FString InventoryShardId;
+
+	/** 服务器：制作子系统的可制作集合变化订阅 */
+	FDelegateHandle CraftableSetChangedHandle;
+
+	/** 服务器：开始维护拥有的根容器的可制作集合，并把当前可制作的配方发给客户端 */
+	void WatchCraftableSet(const FGuid& RootContainerUID);
+
+	/** 服务器：制作子系统的可制作集合变化，只转发拥有的根容器 */
+	void HandleCraftableSetChanged(const FGuid& RootContainerUID, const TArray<int32>& ChangedRecipeIndices);
+
 	// ========================================
 	// 复制回调
 	// ========================================
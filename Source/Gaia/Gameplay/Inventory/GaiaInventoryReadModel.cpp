@@ -0,0 +1,332 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaInventoryReadModel.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaInventoryRPCComponent.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Algo/BinarySearch.h"
+#include "Internationalization/Culture.h"
+
+UGaiaInventoryReadModel* UGaiaInventoryReadModel::Get(const UObject* ContextObject)
+{
+	const ULocalPlayer* LocalPlayer = Cast<ULocalPlayer>(ContextObject);
+
+	if (!LocalPlayer)
+	{
+		if (const UUserWidget* Widget = Cast<UUserWidget>(ContextObject))
+		{
+			LocalPlayer = Widget->GetOwningLocalPlayer();
+		}
+		else if (const APlayerController* PC = Cast<APlayerController>(ContextObject))
+		{
+			LocalPlayer = PC->GetLocalPlayer();
+		}
+	}
+
+	if (!LocalPlayer && ContextObject)
+	{
+		if (const UWorld* World = ContextObject->GetWorld())
+		{
+			LocalPlayer = World->GetFirstLocalPlayerFromController();
+		}
+	}
+
+	return LocalPlayer ? LocalPlayer->GetSubsystem<UGaiaInventoryReadModel>() : nullptr;
+}
+
+UGaiaInventoryRPCComponent* UGaiaInventoryReadModel::GetRPCComponent() const
+{
+	if (UGaiaInventoryRPCComponent* RPCComp = CachedRPCComponent.Get())
+	{
+		return RPCComp;
+	}
+
+	const ULocalPlayer* LocalPlayer = GetLocalPlayer();
+	if (!LocalPlayer)
+	{
+		return nullptr;
+	}
+
+	if (APlayerController* PC = LocalPlayer->GetPlayerController(GetWorld()))
+	{
+		CachedRPCComponent = PC->FindComponentByClass<UGaiaInventoryRPCComponent>();
+	}
+	return CachedRPCComponent.Get();
+}
+
+// ========================================
+// 实例查询
+// ========================================
+
+const FGaiaItemInstance* UGaiaInventoryReadModel::FindItem(const FGuid& ItemUID) const
+{
+	return GetItemMap(GetRPCComponent()).Find(ItemUID);
+}
+
+const FGaiaContainerInstance* UGaiaInventoryReadModel::FindContainer(const FGuid& ContainerUID) const
+{
+	return GetContainerMap(GetRPCComponent()).Find(ContainerUID);
+}
+
+bool UGaiaInventoryReadModel::GetItem(const FGuid& ItemUID, FGaiaItemInstance& OutItem) const
+{
+	if (const FGaiaItemInstance* Item = FindItem(ItemUID))
+	{
+		OutItem = *Item;
+		return true;
+	}
+	return false;
+}
+
+bool UGaiaInventoryReadModel::GetContainer(const FGuid& ContainerUID, FGaiaContainerInstance& OutContainer) const
+{
+	if (const FGaiaContainerInstance* Container = FindContainer(ContainerUID))
+	{
+		OutContainer = *Container;
+		return true;
+	}
+	return false;
+}
+
+int32 UGaiaInventoryReadModel::GetContainerSlotCount(const FGuid& ContainerUID) const
+{
+	const FGaiaContainerInstance* Container = FindContainer(ContainerUID);
+	if (!Container)
+	{
+		return 0;
+	}
+
+	if (const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container->ContainerDefinitionID))
+	{
+		return ContainerDef->GetSlotCount();
+	}
+	return Container->Slots.Num();
+}
+
+// ========================================
+// 定义查询
+// ========================================
+
+const FGaiaItemDefinition* UGaiaInventoryReadModel::FindItemDefinition(FName ItemDefID)
+{
+	return UGaiaInventorySubsystem::FindItemDefinition(ItemDefID);
+}
+
+const FGaiaContainerDefinition* UGaiaInventoryReadModel::FindContainerDefinition(FName ContainerDefID)
+{
+	return UGaiaInventorySubsystem::FindContainerDefinition(ContainerDefID);
+}
+
+const FGaiaItemDefinition* UGaiaInventoryReadModel::FindItemDefinitionForItem(const FGuid& ItemUID) const
+{
+	const FGaiaItemInstance* Item = FindItem(ItemUID);
+	return Item ? FindItemDefinition(Item->ItemDefinitionID) : nullptr;
+}
+
+bool UGaiaInventoryReadModel::GetItemDefinitionForItem(const FGuid& ItemUID, FGaiaItemDefinition& OutItemDef) const
+{
+	if (const FGaiaItemDefinition* ItemDef = FindItemDefinitionForItem(ItemUID))
+	{
+		OutItemDef = *ItemDef;
+		return true;
+	}
+	return false;
+}
+
+// ========================================
+// 派生查询
+// ========================================
+
+void UGaiaInventoryReadModel::BuildDropTargetMap(const FGuid& ItemUID, const TArray<FGuid>& TargetContainerUIDs, TMap<FGuid, FGaiaContainerDropTargets>& OutTargets) const
+{
+	OutTargets.Reset();
+
+	const UGaiaInventoryRPCComponent* RPCComp = GetRPCComponent();
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap = GetItemMap(RPCComp);
+
+	if (const FGaiaItemInstance* Item = ItemMap.Find(ItemUID))
+	{
+		UGaiaInventorySubsystem::BuildDropTargetMap(*Item, TargetContainerUIDs, ItemMap, GetContainerMap(RPCComp), OutTargets);
+	}
+}
+
+FContainerUIDebugInfo UGaiaInventoryReadModel::GetContainerDebugInfo(const FGuid& ContainerUID) const
+{
+	const UGaiaInventoryRPCComponent* RPCComp = GetRPCComponent();
+
+	const FGaiaContainerInstance* Container = GetContainerMap(RPCComp).Find(ContainerUID);
+	if (!Container)
+	{
+		FContainerUIDebugInfo DebugInfo;
+		DebugInfo.ContainerUID = ContainerUID;
+		DebugInfo.SlotUsage = TEXT("容器不存在");
+		return DebugInfo;
+	}
+
+	return UGaiaInventorySubsystem::BuildContainerDebugInfo(*Container, GetItemMap(RPCComp));
+}
+
+// ========================================
+// 搜索
+// ========================================
+
+void UGaiaInventoryReadModel::FindMatchingSlots(const FGuid& RootContainerUID, const FGameplayTagQuery& TagQuery, const FString& NamePrefix, TArray<FGaiaSlotRef>& OutSlots) const
+{
+	OutSlots.Reset();
+
+	const UGaiaInventoryRPCComponent* RPCComp = GetRPCComponent();
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap = GetContainerMap(RPCComp);
+	const FGaiaContainerInstance* Root = ContainerMap.Find(RootContainerUID);
+	if (!Root)
+	{
+		return;
+	}
+
+	UpdateSearchIndex(RPCComp);
+
+	// 1. 名称前缀：在排序的名称索引中二分查找前缀区间
+	TArray<int32> CandidateDefinitions;
+	if (NamePrefix.IsEmpty())
+	{
+		CandidateDefinitions.Reserve(SearchDefinitions.Num());
+		for (int32 Index = 0; Index < SearchDefinitions.Num(); ++Index)
+		{
+			CandidateDefinitions.Add(Index);
+		}
+	}
+	else
+	{
+		const FString Prefix = NamePrefix.ToLower();
+		int32 NameIndex = Algo::LowerBoundBy(SearchNameIndex, Prefix, [](const TPair<FString, int32>& Entry) -> const FString& { return Entry.Key; });
+		for (; NameIndex < SearchNameIndex.Num() && SearchNameIndex[NameIndex].Key.StartsWith(Prefix, ESearchCase::CaseSensitive); ++NameIndex)
+		{
+			CandidateDefinitions.Add(SearchNameIndex[NameIndex].Value);
+		}
+	}
+
+	// 2. 标签查询：每种定义只判断一次
+	const bool bFilterTags = !TagQuery.IsEmpty();
+	TMap<FGuid, bool> ContainerInTree;
+	for (const int32 DefinitionIndex : CandidateDefinitions)
+	{
+		const FSearchDefinitionEntry& Entry = SearchDefinitions[DefinitionIndex];
+		if (bFilterTags && !TagQuery.Matches(Entry.ItemDef->ItemTags))
+		{
+			continue;
+		}
+
+		// 3. 只保留容器树中的槽位（每个容器只判断一次）
+		for (const FGaiaSlotRef& SlotRef : Entry.Slots)
+		{
+			bool* bInTree = ContainerInTree.Find(SlotRef.ContainerUID);
+			if (!bInTree)
+			{
+				const FGaiaContainerInstance* Container = ContainerMap.Find(SlotRef.ContainerUID);
+				bInTree = &ContainerInTree.Add(SlotRef.ContainerUID, Container && IsContainerInTree(*Container, *Root, ContainerMap));
+			}
+			if (*bInTree)
+			{
+				OutSlots.Add(SlotRef);
+			}
+		}
+	}
+}
+
+void UGaiaInventoryReadModel::UpdateSearchIndex(const UGaiaInventoryRPCComponent* RPCComp) const
+{
+	const FString Culture = FInternationalization::Get().GetCurrentCulture()->GetName();
+	const int32 Revision = RPCComp ? RPCComp->GetCacheRevision() : INDEX_NONE;
+	if (SearchIndexOwner.Get() == RPCComp && SearchIndexRevision == Revision && SearchIndexCulture == Culture)
+	{
+		return;
+	}
+
+	SearchIndexOwner = RPCComp;
+	SearchIndexRevision = Revision;
+	SearchIndexCulture = Culture;
+	SearchDefinitions.Reset();
+	SearchNameIndex.Reset();
+
+	// 定义 -> 槽位，只收录放在已缓存容器中的物品
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap = GetContainerMap(RPCComp);
+	TMap<FName, int32> DefinitionIndices;
+	for (const auto& ItemPair : GetItemMap(RPCComp))
+	{
+		const FGaiaItemInstance& Item = ItemPair.Value;
+		if (!Item.IsInContainer() || !ContainerMap.Contains(Item.CurrentContainerUID))
+		{
+			continue;
+		}
+
+		int32* DefinitionIndex = DefinitionIndices.Find(Item.ItemDefinitionID);
+		if (!DefinitionIndex)
+		{
+			const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item.ItemDefinitionID);
+			if (!ItemDef)
+			{
+				continue;
+			}
+
+			FSearchDefinitionEntry& Entry = SearchDefinitions.AddDefaulted_GetRef();
+			Entry.ItemDefID = Item.ItemDefinitionID;
+			Entry.ItemDef = ItemDef;
+			DefinitionIndex = &DefinitionIndices.Add(Item.ItemDefinitionID, SearchDefinitions.Num() - 1);
+		}
+
+		SearchDefinitions[*DefinitionIndex].Slots.Emplace(Item.CurrentContainerUID, Item.CurrentSlotID);
+	}
+
+	// 名称索引按当前语言的小写名称排序
+	SearchNameIndex.Reserve(SearchDefinitions.Num());
+	for (int32 Index = 0; Index < SearchDefinitions.Num(); ++Index)
+	{
+		SearchNameIndex.Emplace(SearchDefinitions[Index].ItemDef->ItemName.ToString().ToLower(), Index);
+	}
+	SearchNameIndex.Sort([](const TPair<FString, int32>& A, const TPair<FString, int32>& B) { return A.Key < B.Key; });
+}
+
+bool UGaiaInventoryReadModel::IsContainerInTree(const FGaiaContainerInstance& Container, const FGaiaContainerInstance& Root, const TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+{
+	if (Container.ContainerUID == Root.ContainerUID)
+	{
+		return true;
+	}
+
+	// 不同根或不比根更深时不可能在树中
+	if (Container.GetRootContainerUID() != Root.GetRootContainerUID() || Container.NestingDepth <= Root.NestingDepth)
+	{
+		return false;
+	}
+
+	// 根是顶层容器时同根即可
+	if (Root.NestingDepth == 0)
+	{
+		return true;
+	}
+
+	const FGaiaContainerInstance* Current = &Container;
+	for (int32 Steps = Container.NestingDepth - Root.NestingDepth; Current && Steps > 0; --Steps)
+	{
+		Current = ContainerMap.Find(Current->ParentContainerUID);
+	}
+	return Current && Current->ContainerUID == Root.ContainerUID;
+}
+
+// ========================================
+// 内部辅助
+// ========================================
+
+const TMap<FGuid, FGaiaItemInstance>& UGaiaInventoryReadModel::GetItemMap(const UGaiaInventoryRPCComponent* RPCComp)
+{
+	static const TMap<FGuid, FGaiaItemInstance> EmptyItems;
+	return RPCComp ? RPCComp->GetCachedItemMap() : EmptyItems;
+}
+
+const TMap<FGuid, FGaiaContainerInstance>& UGaiaInventoryReadModel::GetContainerMap(const UGaiaInventoryRPCComponent* RPCComp)
+{
+	static const TMap<FGuid, FGaiaContainerInstance> EmptyContainers;
+	return RPCComp ? RPCComp->GetCachedContainerMap() : EmptyContainers;
+}
@@ -0,0 +1,146 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/LocalPlayerSubsystem.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaInventoryReadModel.generated.h"
+
+class UGaiaInventoryRPCComponent;
+
+/**
+ * 库存客户端只读模型
+ *
+ * 职责：
+ * - 封装 RPC 组件的本地缓存和物品/容器定义缓存
+ * - 为所有UI代码提供统一的查询接口
+ *
+ * 设计理念：
+ * - UI 不直接读取 UGaiaInventorySubsystem（客户端上它没有权威数据）
+ * - 单机、监听服务器、客户端走同一条路径：
+ *   服务器通过 ClientReceiveInventoryData 填充本地玩家的缓存，UI 只读缓存
+ * - 定义查询直接返回数据注册表缓存中的指针，不拷贝
+ */
+UCLASS()
+class GAIAGAME_API UGaiaInventoryReadModel : public ULocalPlayerSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * 获取只读模型
+	 * @param ContextObject Widget / PlayerController / LocalPlayer，其他对象退化为World的第一个本地玩家
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory", meta = (WorldContext = "ContextObject"))
+	static UGaiaInventoryReadModel* Get(const UObject* ContextObject);
+
+	/** 获取本地玩家的RPC组件（缓存的持有者） */
+	UGaiaInventoryRPCComponent* GetRPCComponent() const;
+
+	// ========================================
+	// 实例查询
+	// ========================================
+
+	/** 查找物品（返回缓存中的指针，不存在返回nullptr） */
+	const FGaiaItemInstance* FindItem(const FGuid& ItemUID) const;
+
+	/** 查找容器（返回缓存中的指针，不存在返回nullptr） */
+	const FGaiaContainerInstance* FindContainer(const FGuid& ContainerUID) const;
+
+	/** 获取物品（蓝图版本，拷贝） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	bool GetItem(const FGuid& ItemUID, FGaiaItemInstance& OutItem) const;
+
+	/** 获取容器（蓝图版本，拷贝） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	bool GetContainer(const FGuid& ContainerUID, FGaiaContainerInstance& OutContainer) const;
+
+	/**
+	 * 获取容器的槽位数量
+	 * 优先使用容器定义，定义缺失时退化为缓存中的槽位数
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	int32 GetContainerSlotCount(const FGuid& ContainerUID) const;
+
+	// ========================================
+	// 定义查询
+	// ========================================
+
+	/** 查找物品定义（数据注册表缓存指针） */
+	static const FGaiaItemDefinition* FindItemDefinition(FName ItemDefID);
+
+	/** 查找容器定义（数据注册表缓存指针） */
+	static const FGaiaContainerDefinition* FindContainerDefinition(FName ContainerDefID);
+
+	/** 查找物品实例对应的定义 */
+	const FGaiaItemDefinition* FindItemDefinitionForItem(const FGuid& ItemUID) const;
+
+	/** 获取物品实例对应的定义（蓝图版本，拷贝） */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	bool GetItemDefinitionForItem(const FGuid& ItemUID, FGaiaItemDefinition& OutItemDef) const;
+
+	// ========================================
+	// 派生查询
+	// ========================================
+
+	/**
+	 * 预计算拖放目标（与服务器共用规则）
+	 * @see UGaiaInventorySubsystem::BuildDropTargetMap
+	 */
+	void BuildDropTargetMap(const FGuid& ItemUID, const TArray<FGuid>& TargetContainerUIDs, TMap<FGuid, FGaiaContainerDropTargets>& OutTargets) const;
+
+	/** 获取容器调试信息 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Debug")
+	FContainerUIDebugInfo GetContainerDebugInfo(const FGuid& ContainerUID) const;
+
+	// ========================================
+	// 搜索
+	// ========================================
+
+	/**
+	 * 在容器树中搜索物品
+	 * 查询走索引：标签查询和名称前缀只对缓存中出现的每种定义判断一次，
+	 * 命中定义的槽位直接从 定义 -> 槽位 索引取出，不遍历槽位、不拷贝定义。
+	 * 索引在缓存更新后的第一次查询时重建
+	 * @param RootContainerUID 根容器（包含其中嵌套的容器）
+	 * @param TagQuery 物品定义标签的查询（为空表示不过滤）
+	 * @param NamePrefix 本地化名称前缀，不区分大小写（为空表示不过滤）
+	 * @param OutSlots 输出命中的槽位（同一定义的槽位相邻）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void FindMatchingSlots(const FGuid& RootContainerUID, const FGameplayTagQuery& TagQuery, const FString& NamePrefix, TArray<FGaiaSlotRef>& OutSlots) const;
+
+private:
+	/** 获取缓存表（RPC组件不可用时返回空表） */
+	static const TMap<FGuid, FGaiaItemInstance>& GetItemMap(const UGaiaInventoryRPCComponent* RPCComp);
+	static const TMap<FGuid, FGaiaContainerInstance>& GetContainerMap(const UGaiaInventoryRPCComponent* RPCComp);
+
+	/** 缓存过期或语言切换时重建搜索索引 */
+	void UpdateSearchIndex(const UGaiaInventoryRPCComponent* RPCComp) const;
+
+	/** 容器是否在指定容器树中（沿父链最多走深度差那么多步） */
+	static bool IsContainerInTree(const FGaiaContainerInstance& Container, const FGaiaContainerInstance& Root, const TMap<FGuid, FGaiaContainerInstance>& ContainerMap);
+
+	/** 缓存的RPC组件（PlayerController切换时自动失效） */
+	mutable TWeakObjectPtr<UGaiaInventoryRPCComponent> CachedRPCComponent;
+
+	/** 搜索索引中的一种物品定义 */
+	struct FSearchDefinitionEntry
+	{
+		FName ItemDefID;
+		const FGaiaItemDefinition* ItemDef = nullptr;
+		TArray<FGaiaSlotRef> Slots;
+	};
+
+	/** 缓存中出现的物品定义及其所在槽位 */
+	mutable TArray<FSearchDefinitionEntry> SearchDefinitions;
+
+	/** 名称索引：小写本地化名称 -> SearchDefinitions 下标，按名称排序 */
+	mutable TArray<TPair<FString, int32>> SearchNameIndex;
+
+	/** 索引对应的RPC组件、缓存修订号和语言 */
+	mutable TWeakObjectPtr<const UGaiaInventoryRPCComponent> SearchIndexOwner;
+	mutable int32 SearchIndexRevision = INDEX_NONE;
+	mutable FString SearchIndexCulture;
+};
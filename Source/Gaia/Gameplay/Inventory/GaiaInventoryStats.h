@@ -0,0 +1,8 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+/** 库存系统的性能统计组（stat GaiaInventory），各文件在此组下声明自己的计数器 */
+DECLARE_STATS_GROUP(TEXT("Gaia Inventory"), STATGROUP_GaiaInventory, STATCAT_Advanced);
@@ -1,9 +1,19 @@
 #include "GaiaInventorySubsystem.h"
+#include "GaiaInventoryPersistence.h"
+#include "GaiaDefinitionDatabase.h"
 #include "GaiaLogChannels.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "TimerManager.h"
+#include "Async/Async.h"
 #include "DataRegistrySubsystem.h"
 #include "GameFramework/PlayerController.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/GameStateBase.h"
 #include "GaiaInventoryRPCComponent.h"
+#include "GaiaEquipmentComponent.h"
+#include "GaiaLootTable.h"
 #include "BehaviorTree/Tasks/BTTask_SetKeyValue.h"
 
 UGaiaInventorySubsystem::UGaiaInventorySubsystem()
@@ -19,15 +29,66 @@ void UGaiaInventorySubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	// 清空全局物品池和容器映射表
 	AllItems.Empty();
 	Containers.Empty();
+	
+	IdAllocator = GetDefaultIdAllocator();
+	
+	LifetimeTickInterval = FMath::Max(GetDefault<UGaiaInventoryManagerSettings>()->ItemLifetimeTickInterval, 0.1f);
+	LifetimeWheel.Reset(0);
+	
+	// 专用服务器首次初始化时挂载定义数据库（进程内共享，之后的World直接复用）
+	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+	if (IsRunningDedicatedServer() && Settings->bUseDefinitionDatabaseOnServer && !FGaiaDefinitionDatabase::Get())
+	{
+		const FString DatabasePath = FPaths::ProjectContentDir() / Settings->DefinitionDatabasePath;
+		FString Error;
+		if (!FGaiaDefinitionDatabase::Mount(DatabasePath, Error))
+		{
+			// GaiaServer 目标不扫描数据注册表，挂载失败时物品和容器定义都无法查询
+			UE_LOG(LogGaia, Error, TEXT("[定义数据库] 挂载失败（服务器配置不加载数据注册表）: %s"), *Error);
+		}
+	}
 }
 
 void UGaiaInventorySubsystem::Deinitialize()
 {
 	UE_LOG(LogGaia, Log, TEXT("GaiaInventorySubsystem 反初始化"));
 	
-	// 清理所有物品和容器
+	// 仍在线玩家的分片先保存，写完后移出（移除写入日志），最后一次快照只包含世界容器和保存失败的分片
+	TArray<FString> ShardIds;
+	ResidentPlayerShards.GenerateKeyArray(ShardIds);
+	for (const FString& ShardId : ShardIds)
+	{
+		UnloadPlayerShard(ShardId);
+	}
+	PendingShardSaves.GenerateKeyArray(ShardIds);
+	for (const FString& ShardId : ShardIds)
+	{
+		WaitForPendingShardSave(ShardId);
+	}
+	
+	// 关闭前压缩日志，并等待后台保存写完
+	StopJournal();
+	WaitForPendingSave();
+	
+	// 清理所有物品和容器（调试名称旁表是进程级的，只移除本World的条目）
+#if !UE_BUILD_SHIPPING
+	for (const auto& Pair : AllItems)
+	{
+		FGaiaInventoryDebugNames::Remove(Pair.Key);
+	}
+	for (const auto& Pair : Containers)
+	{
+		FGaiaInventoryDebugNames::Remove(Pair.Key);
+	}
+#endif
 	AllItems.Empty();
 	Containers.Empty();
+	WorldContainerCells.Empty();
+	WorldContainerLocations.Empty();
+	RootDefinitionCounts.Empty();
+	PendingRootCountChanges.Empty();
+	ContainerSlotFilters.Empty();
+	LifetimeWheel.Reset(0);
 	
 	Super::Deinitialize();
 }
@@ -47,65 +108,97 @@ UGaiaInventorySubsystem* UGaiaInventorySubsystem::Get(const UObject* WorldContex
 //~BEGIN 数据定义获取
 
 bool UGaiaInventorySubsystem::GetItemDefinition(FName ItemDefID, FGaiaItemDefinition& OutItemDef)
+{
+	if (const FGaiaItemDefinition* ItemDef = FindItemDefinition(ItemDefID))
+	{
+		OutItemDef = *ItemDef;
+		return true;
+	}
+	return false;
+}
+
+bool UGaiaInventorySubsystem::GetContainerDefinition(FName ContainerDefID, FGaiaContainerDefinition& OutContainerDef)
+{
+	if (const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(ContainerDefID))
+	{
+		OutContainerDef = *ContainerDef;
+		return true;
+	}
+	return false;
+}
+
+const FGaiaItemDefinition* UGaiaInventorySubsystem::FindItemDefinition(FName ItemDefID)
 {
 	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
 	if (!Settings)
 	{
 		UE_LOG(LogGaia, Error, TEXT("无法获取GaiaInventoryManagerSettings"));
-		return false;
+		return nullptr;
 	}
 	
 	if (ItemDefID == NAME_None)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("ItemDefID为空"));
-		return false;
+		return nullptr;
 	}
 	
-	if (UDataRegistrySubsystem* DataRegistry = GEngine->GetEngineSubsystem<UDataRegistrySubsystem>())
+	if (const FGaiaDefinitionDatabase* Database = FGaiaDefinitionDatabase::Get())
+	{
+		if (const FGaiaItemDefinition* ItemDef = Database->FindItemDefinition(ItemDefID))
+		{
+			return ItemDef;
+		}
+	}
+	else if (UDataRegistrySubsystem* DataRegistry = GEngine->GetEngineSubsystem<UDataRegistrySubsystem>())
 	{
 		const FGaiaItemDefinition* ItemDef = DataRegistry->GetCachedItem<FGaiaItemDefinition>(
 			FDataRegistryId(Settings->ItemDefinitionRegistryType, ItemDefID));
 		
 		if (ItemDef)
 		{
-			OutItemDef = *ItemDef;
-			return true;
+			return ItemDef;
 		}
 	}
 	
 	UE_LOG(LogGaia, Warning, TEXT("无法找到物品定义: %s"), *ItemDefID.ToString());
-	return false;
+	return nullptr;
 }
 
-bool UGaiaInventorySubsystem::GetContainerDefinition(FName ContainerDefID, FGaiaContainerDefinition& OutContainerDef)
+const FGaiaContainerDefinition* UGaiaInventorySubsystem::FindContainerDefinition(FName ContainerDefID)
 {
 	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
 	if (!Settings)
 	{
 		UE_LOG(LogGaia, Error, TEXT("无法获取GaiaInventoryManagerSettings"));
-		return false;
+		return nullptr;
 	}
 	
 	if (ContainerDefID == NAME_None)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("ContainerDefID为空"));
-		return false;
+		return nullptr;
 	}
 	
-	if (UDataRegistrySubsystem* DataRegistry = GEngine->GetEngineSubsystem<UDataRegistrySubsystem>())
+	if (const FGaiaDefinitionDatabase* Database = FGaiaDefinitionDatabase::Get())
+	{
+		if (const FGaiaContainerDefinition* ContainerDef = Database->FindContainerDefinition(ContainerDefID))
+		{
+			return ContainerDef;
+		}
+	}
+	else if (UDataRegistrySubsystem* DataRegistry = GEngine->GetEngineSubsystem<UDataRegistrySubsystem>())
 	{
 		const FGaiaContainerDefinition* ContainerDef = DataRegistry->GetCachedItem<FGaiaContainerDefinition>(
 			FDataRegistryId(Settings->ContainerDefinitionRegistryType, ContainerDefID));
 		
 		if (ContainerDef)
 		{
-			OutContainerDef = *ContainerDef;
-			return true;
+			return ContainerDef;
 		}
 	}
 	
 	UE_LOG(LogGaia, Warning, TEXT("无法找到容器定义: %s"), *ContainerDefID.ToString());
-	return false;
+	return nullptr;
 }
 
 //~END 数据定义获取
@@ -114,6 +207,8 @@ bool UGaiaInventorySubsystem::GetContainerDefinition(FName ContainerDefID, FGaia
 
 FGaiaItemInstance UGaiaInventorySubsystem::CreateItemInstance(FName ItemDefID, int32 Quantity)
 {
+	FMutationScope MutationScope(*this);
+	
 	FGaiaItemInstance NewItem;
 	
 	// 获取物品定义
@@ -124,31 +219,38 @@ FGaiaItemInstance UGaiaInventorySubsystem::CreateItemInstance(FName ItemDefID, i
 		return NewItem;
 	}
 	
-	// 生成唯一ID
-	NewItem.InstanceUID = FGuid::NewGuid();
-	NewItem.ItemDefinitionID = ItemDefID;
-	
 	// 设置数量（考虑堆叠规则）
 	// 注意：使用 IsStackable() 而不是 bStackable，因为带容器的物品强制不可堆叠
+	int32 ClampedQuantity = 1;
 	if (ItemDef.IsStackable())
 	{
-		NewItem.Quantity = FMath::Clamp(Quantity, 1, ItemDef.MaxStackSize);
+		ClampedQuantity = FMath::Clamp(Quantity, 1, ItemDef.MaxStackSize);
 	}
-	else
+	else if (Quantity > 1)
 	{
-		// 不可堆叠的物品，强制数量为1
-		NewItem.Quantity = 1;
-		
-		// 如果用户请求创建多个不可堆叠物品，给出警告
-		if (Quantity > 1)
-		{
-			UE_LOG(LogGaia, Warning, TEXT("创建物品: %s 不可堆叠（%s），数量从 %d 调整为 1"),
-				*ItemDefID.ToString(),
-				ItemDef.bHasContainer ? TEXT("带容器") : TEXT("定义设置"),
-				Quantity);
-		}
+		// 不可堆叠的物品强制数量为1，请求创建多个时给出警告
+		UE_LOG(LogGaia, Warning, TEXT("创建物品: %s 不可堆叠（%s），数量从 %d 调整为 1"),
+			*ItemDefID.ToString(),
+			ItemDef.bHasContainer ? TEXT("带容器") : TEXT("定义设置"),
+			Quantity);
 	}
 	
+	NewItem = CreateItemInstanceInternal(ItemDefID, ItemDef, ClampedQuantity);
+	
+	UE_LOG(LogGaia, Log, TEXT("创建物品实例: %s, UID: %s, 数量: %d"), 
+		*ItemDefID.ToString(), *NewItem.InstanceUID.ToString(), NewItem.Quantity);
+	
+	return NewItem;
+}
+
+FGaiaItemInstance& UGaiaInventorySubsystem::CreateItemInstanceInternal(FName ItemDefID, const FGaiaItemDefinition& ItemDef, int32 Quantity)
+{
+	FGaiaItemInstance NewItem;
+	NewItem.InstanceUID = AllocateUID();
+	NewItem.ItemDefinitionID = ItemDefID;
+	NewItem.Quantity = Quantity;
+	InitializeItemLifetime(NewItem, ItemDef);
+	
 	// 如果物品有容器，创建容器实例
 	if (ItemDef.bHasContainer && ItemDef.ContainerDefinitionID != NAME_None)
 	{
@@ -166,16 +268,46 @@ FGaiaItemInstance UGaiaInventorySubsystem::CreateItemInstance(FName ItemDefID, i
 	}
 	
 	// 添加物品到全局池
-	AllItems.Add(NewItem.InstanceUID, NewItem);
+	MarkItemChanged(NewItem.InstanceUID);
+	FGaiaItemInstance& AddedItem = AllItems.Add(NewItem.InstanceUID, MoveTemp(NewItem));
+	ScheduleItemExpiry(AddedItem);
+	return AddedItem;
+}
+
+bool UGaiaInventorySubsystem::RemoveItemRecord(const FGuid& ItemUID)
+{
+	if (AllItems.Remove(ItemUID) == 0)
+	{
+		return false;
+	}
 	
-	UE_LOG(LogGaia, Log, TEXT("创建物品实例: %s, UID: %s, 数量: %d"), 
-		*ItemDefID.ToString(), *NewItem.InstanceUID.ToString(), NewItem.Quantity);
+#if !UE_BUILD_SHIPPING
+	FGaiaInventoryDebugNames::Remove(ItemUID);
+#endif
+	MarkItemChanged(ItemUID);
+	return true;
+}
+
+bool UGaiaInventorySubsystem::RemoveContainerRecord(const FGuid& ContainerUID)
+{
+	FGaiaContainerInstance Container;
+	if (!Containers.RemoveAndCopyValue(ContainerUID, Container))
+	{
+		return false;
+	}
 	
-	return NewItem;
+	ApplyContainerToRootCounts(Container, -1);
+#if !UE_BUILD_SHIPPING
+	FGaiaInventoryDebugNames::Remove(ContainerUID);
+#endif
+	MarkContainerChanged(ContainerUID);
+	return true;
 }
 
 FGuid UGaiaInventorySubsystem::CreateContainerInstance(FName ContainerDefID)
 {
+	FMutationScope MutationScope(*this);
+	
 	FGaiaContainerDefinition ContainerDef;
 	if (!GetContainerDefinition(ContainerDefID, ContainerDef))
 	{
@@ -186,43 +318,105 @@ FGuid UGaiaInventorySubsystem::CreateContainerInstance(FName ContainerDefID)
 	FGaiaContainerInstance NewContainer;
 	
 	// 生成唯一ID
-	NewContainer.ContainerUID = FGuid::NewGuid();
+	NewContainer.ContainerUID = AllocateUID();
 	NewContainer.ContainerDefinitionID = ContainerDefID;
 	
-	// 初始化槽位
-	NewContainer.Slots.Reserve(ContainerDef.SlotCount);
-	for (int32 i = 0; i < ContainerDef.SlotCount; i++)
+	// 初始化槽位（网格布局每个格子一个槽位）
+	const int32 SlotCount = ContainerDef.GetSlotCount();
+	NewContainer.Slots.Reserve(SlotCount);
+	for (int32 i = 0; i < SlotCount; i++)
 	{
 		NewContainer.Slots.Add(FGaiaSlotInfo(i));
 	}
 	
+	if (ContainerDef.bUseGridLayout)
+	{
+		NewContainer.GridRows.SetNumZeroed(ContainerDef.GridHeight);
+	}
+	
+	// 空容器的统计值即为0，缓存从一开始就有效
+	NewContainer.bNeedRecalculate = false;
+	
 	// 添加到容器映射表
 	Containers.Add(NewContainer.ContainerUID, NewContainer);
+	MarkContainerChanged(NewContainer.ContainerUID);
 	
 	UE_LOG(LogGaia, Log, TEXT("创建容器实例: %s, UID: %s, 槽位数: %d"), 
-		*ContainerDefID.ToString(), *NewContainer.ContainerUID.ToString(), ContainerDef.SlotCount);
+		*ContainerDefID.ToString(), *NewContainer.ContainerUID.ToString(), SlotCount);
 	
 	return NewContainer.ContainerUID;
 }
 
+void UGaiaInventorySubsystem::SetIdAllocator(TSharedPtr<IGaiaInventoryIdAllocator> InAllocator)
+{
+	IdAllocator = InAllocator ? MoveTemp(InAllocator) : GetDefaultIdAllocator();
+	NotifyIdAllocatorOfUIDs(AllItems, Containers);
+}
+
 //~END 实例创建
 
+//~BEGIN UID分配
+
+FGuid UGaiaInventorySubsystem::AllocateUID()
+{
+	check(IdAllocator);
+	return IdAllocator->AllocateUID();
+}
+
+void UGaiaInventorySubsystem::NotifyIdAllocatorOfUIDs(const TMap<FGuid, FGaiaItemInstance>& ItemMap, const TMap<FGuid, FGaiaContainerInstance>& ContainerMap) const
+{
+	check(IdAllocator);
+	for (const auto& ItemPair : ItemMap)
+	{
+		IdAllocator->NotifyExistingUID(ItemPair.Key);
+	}
+	for (const auto& ContainerPair : ContainerMap)
+	{
+		IdAllocator->NotifyExistingUID(ContainerPair.Key);
+	}
+}
+
+TSharedPtr<IGaiaInventoryIdAllocator> UGaiaInventorySubsystem::GetDefaultIdAllocator()
+{
+	static TSharedPtr<IGaiaInventoryIdAllocator> DefaultAllocator;
+	if (!DefaultAllocator)
+	{
+		const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+		if (Settings->bUseBlockIdAllocator)
+		{
+			const FString StateFilePath = FPaths::Combine(FPaths::ProjectSavedDir(), Settings->IdAllocatorStateFile);
+			DefaultAllocator = MakeShared<FGaiaBlockIdAllocator>(static_cast<uint16>(FMath::Clamp(Settings->InventoryServerId, 0, 65535)), StateFilePath);
+		}
+		else
+		{
+			DefaultAllocator = MakeShared<FGaiaRandomGuidAllocator>();
+		}
+	}
+	return DefaultAllocator;
+}
+
+//~END UID分配
+
 //~BEGIN 调试辅助
 
 void UGaiaInventorySubsystem::SetItemDebugName(const FGuid& ItemUID, const FString& DebugName)
 {
-	if (FGaiaItemInstance* Item = AllItems.Find(ItemUID))
+#if !UE_BUILD_SHIPPING
+	if (AllItems.Contains(ItemUID))
 	{
-		Item->DebugDisplayName = DebugName;
+		FGaiaInventoryDebugNames::Set(ItemUID, DebugName);
 	}
+#endif
 }
 
 void UGaiaInventorySubsystem::SetContainerDebugName(const FGuid& ContainerUID, const FString& DebugName)
 {
-	if (FGaiaContainerInstance* Container = Containers.Find(ContainerUID))
+#if !UE_BUILD_SHIPPING
+	if (Containers.Contains(ContainerUID))
 	{
-		Container->DebugDisplayName = DebugName;
+		FGaiaInventoryDebugNames::Set(ContainerUID, DebugName);
 	}
+#endif
 }
 
 //~END 调试辅助
@@ -264,12 +458,20 @@ bool UGaiaInventorySubsystem::FindContainerByUID(const FGuid& ContainerUID, FGai
 	return true;
 }
 
+FGuid UGaiaInventorySubsystem::GetRootContainerUID(const FGuid& ContainerUID) const
+{
+	const FGaiaContainerInstance* Container = ContainerUID.IsValid() ? Containers.Find(ContainerUID) : nullptr;
+	return Container ? Container->GetRootContainerUID() : FGuid();
+}
+
 //~END 查询功能
 
 //~BEGIN 容器操作
 
 FAddItemResult UGaiaInventorySubsystem::TryAddItemToContainer(const FGuid& ItemUID, const FGuid& ContainerUID)
 {
+	FMutationScope MutationScope(*this);
+	
 	// 检查物品是否存在
 	FGaiaItemInstance* Item = AllItems.Find(ItemUID);
 	if (!Item)
@@ -294,15 +496,15 @@ FAddItemResult UGaiaInventorySubsystem::TryAddItemToContainer(const FGuid& ItemU
 	}
 	
 	// 所有检查通过，执行添加（传递指针，避免重复查找）
-	if (AddItemToContainer(Item, Container, AddItemResult.SlotID))
+	if (AddItemToContainer(Item, Container, AddItemResult.SlotID, AddItemResult.bRotated))
 	{
-		return FAddItemResult::Success(AddItemResult.SlotID);
+		return AddItemResult;
 	}
 	
 	return FAddItemResult::Failure(TEXT("添加物品失败（未知原因）"));
 }
 
-bool UGaiaInventorySubsystem::AddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container, const int32 SlotID)
+bool UGaiaInventorySubsystem::AddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container, const int32 SlotID, bool bRotated)
 {
 	// 参数已在调用者处验证，此处使用断言确保契约
 	check(Item);
@@ -312,6 +514,7 @@ bool UGaiaInventorySubsystem::AddItemToContainer(FGaiaItemInstance* Item, FGaiaC
 	// 更新物品位置信息
 	Item->CurrentContainerUID = Container->ContainerUID;
 	Item->CurrentSlotID = SlotID;
+	Item->bRotated = bRotated;
 	// 更新槽位信息
 	int32 SlotIndex = Container->GetSlotIndexByID(SlotID);
 	if (SlotIndex == INDEX_NONE)
@@ -320,16 +523,8 @@ bool UGaiaInventorySubsystem::AddItemToContainer(FGaiaItemInstance* Item, FGaiaC
 		return false;
 	}
 	Container->Slots[SlotIndex].ItemInstanceUID = Item->InstanceUID;
-	// 如果物品有容器，更新容器的父容器
-	if (Item->HasContainer())
-	{
-		if (FGaiaContainerInstance* ItemContainer = Containers.Find(Item->OwnedContainerUID))
-		{
-			ItemContainer->ParentContainerUID = Container->ContainerUID;
-		}
-	}
-	// 标记需要重新计算
-	Container->MarkDirty();
+	// 更新容器统计和嵌套信息
+	NotifyItemEnteredContainer(*Item, *Container);
 	UE_LOG(LogGaia, Verbose, TEXT("[AddItemToContainer] 添加成功: 物品 %s -> 容器 %s 槽位 %d"), 
 		*Item->InstanceUID.ToString(),
 		*Container->ContainerUID.ToString(),
@@ -339,6 +534,8 @@ bool UGaiaInventorySubsystem::AddItemToContainer(FGaiaItemInstance* Item, FGaiaC
 
 bool UGaiaInventorySubsystem::RemoveItemFromContainer(const FGuid& ItemUID)
 {
+	FMutationScope MutationScope(*this);
+	
 	if (!ItemUID.IsValid())
 	{
 		return false;
@@ -388,16 +585,6 @@ bool UGaiaInventorySubsystem::RemoveItemFromContainer(const FGuid& ItemUID)
 		UE_LOG(LogGaia, Error, TEXT("【移除物品】无法找到槽位索引: SlotID=%d"), Item->CurrentSlotID);
 	}
 	
-	// 如果物品有容器，清空容器的父容器引用
-	if (Item->HasContainer())
-	{
-		if (FGaiaContainerInstance* ItemContainer = Containers.Find(Item->OwnedContainerUID))
-		{
-			ItemContainer->ParentContainerUID = FGuid(); // 清空父容器引用
-			UE_LOG(LogGaia, Log, TEXT("清空物品容器的父容器引用: %s"), *Item->OwnedContainerUID.ToString());
-		}
-	}
-	
 	// 将物品设为游离状态（不删除物品）
 	FGuid OldContainerUID = Item->CurrentContainerUID;
 	int32 OldSlotID = Item->CurrentSlotID;
@@ -405,8 +592,8 @@ bool UGaiaInventorySubsystem::RemoveItemFromContainer(const FGuid& ItemUID)
 	Item->CurrentContainerUID = FGuid(); // 无效 = 游离状态
 	Item->CurrentSlotID = -1;
 	
-	// 标记需要重新计算
-	Container->MarkDirty();
+	// 更新容器统计，物品的容器成为顶层容器
+	NotifyItemLeftContainer(*Item, *Container);
 	
 	UE_LOG(LogGaia, Log, TEXT("从容器移除物品: %s (容器: %s, 槽位: %d) -> 游离状态"), 
 		*ItemUID.ToString(), *OldContainerUID.ToString(), OldSlotID);
@@ -415,6 +602,8 @@ bool UGaiaInventorySubsystem::RemoveItemFromContainer(const FGuid& ItemUID)
 
 bool UGaiaInventorySubsystem::DestroyItem(const FGuid& ItemUID)
 {
+	FMutationScope MutationScope(*this);
+	
 	if (!ItemUID.IsValid())
 	{
 		return false;
@@ -456,17 +645,46 @@ bool UGaiaInventorySubsystem::DestroyItem(const FGuid& ItemUID)
 		}
 		
 		// 删除容器本身
-		Containers.Remove(Item->OwnedContainerUID);
+		RemoveContainerRecord(Item->OwnedContainerUID);
 		UE_LOG(LogGaia, Log, TEXT("删除物品的容器: %s"), *Item->OwnedContainerUID.ToString());
 	}
 	
 	// 从全局池删除物品
-	AllItems.Remove(ItemUID);
+	RemoveItemRecord(ItemUID);
 	
 	UE_LOG(LogGaia, Warning, TEXT("【删除物品】完成: ItemUID=%s 已从AllItems中移除"), *ItemUID.ToString());
 	return true;
 }
 
+bool UGaiaInventorySubsystem::RotateItem(const FGuid& ItemUID)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaItemInstance* Item = AllItems.Find(ItemUID);
+	FGaiaContainerInstance* Container = (Item && Item->IsInContainer()) ? Containers.Find(Item->CurrentContainerUID) : nullptr;
+	const FGaiaContainerDefinition* ContainerDef = Container ? FindContainerDefinition(Container->ContainerDefinitionID) : nullptr;
+	const FGaiaItemDefinition* ItemDef = Item ? FindItemDefinition(Item->ItemDefinitionID) : nullptr;
+	if (!ContainerDef || !ContainerDef->bUseGridLayout || !ItemDef || !ItemDef->CanRotateInGrid())
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[网格] 物品不在网格容器中或不可旋转: %s"), *ItemUID.ToString());
+		return false;
+	}
+	
+	// 以左上角格子为轴，旋转后的占地不计物品自身
+	if (!CanPlaceItemAtSlot(*Container, *ContainerDef, *ItemDef, Item->CurrentSlotID, !Item->bRotated, Item, AllItems))
+	{
+		UE_LOG(LogGaia, Log, TEXT("[网格] 旋转后空间不足: %s"), *Item->GetDebugName());
+		return false;
+	}
+	
+	Item->bRotated = !Item->bRotated;
+	MarkItemChanged(Item->InstanceUID);
+	MarkContainerContentsChanged(Container->ContainerUID);
+	++Container->ContentRevision;
+	RebuildGridOccupancy(*Container, AllItems);
+	return true;
+}
+
 FAddItemResult UGaiaInventorySubsystem::CanAddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container) const
 {
 	check(Item);
@@ -492,79 +710,30 @@ FAddItemResult UGaiaInventorySubsystem::CanAddItemToContainer(FGaiaItemInstance*
 		return Result;
 	}
 	
-	// 检查物品标签是否允许
-	if (ContainerDef.AllowedItemTags.IsEmpty())
-	{
-		Result.ResultType = EMoveItemResult::TypeMismatch;
-		Result.ErrorMessage = FString::Printf(TEXT("容器没有任何标签 (%s-%s)"),
-			*ContainerDef.ContainerName.ToString(),
-			*Container->GetShortUID());
-		return Result;
-	}
-	bool bHasMatchingTag = false;
-	for (const FGameplayTag& ItemTag : ItemDef.ItemTags)
+	// 标签/嵌套/循环/体积规则
+	Result = CheckAddItemRules(*Item, ItemDef, *Container, ContainerDef, AllItems, Containers);
+	if (!Result.IsSuccess())
 	{
-		if (ContainerDef.HasAllowedTag(ItemTag))
-		{
-			bHasMatchingTag = true;
-			break;
-		}
-	}
-	if (!bHasMatchingTag)
-	{
-		Result.ResultType = EMoveItemResult::TypeMismatch;
-		Result.ErrorMessage = FString::Printf(TEXT("物品标签不匹配容器允许的标签 (ItemDefID: %s, 物品标签: %s, 允许标签: %s)"),
-			*Item->ItemDefinitionID.ToString(),
-			*ItemDef.ItemTags.ToStringSimple(),
-			*ContainerDef.AllowedItemTags.ToStringSimple());
 		return Result;
 	}
 	
-	// 如果是容器物品，进行额外检查
-	if (ItemDef.bHasContainer)
-	{
-		// 检查目标容器是否允许嵌套容器
-		if (!ContainerDef.bAllowNestedContainers)
-		{
-			Result.ResultType = EMoveItemResult::ContainerRejected;
-			Result.ErrorMessage = FString::Printf(TEXT("目标容器不允许嵌套 (%s-%s)"),
-				*ContainerDef.ContainerName.ToString(),
-				*Container->ContainerUID.ToString());
-			return Result;
-		}
-		
-		// 检查循环引用
-		if (Item->HasContainer())
-		{
-			if (WouldCreateCycle(Item->OwnedContainerUID, Container->ContainerUID))
-			{
-				Result.ResultType = EMoveItemResult::CycleDetected;
-				Result.ErrorMessage = FString::Printf(TEXT("会造成容器循环引用 (物品容器UID: %s, 目标容器UID: %s)"),
-					*Item->OwnedContainerUID.ToString(),
-					*Container->ContainerUID.ToString());
-				return Result;
-			}
-		}
-	}
-	// 检查体积限制
-	if (ContainerDef.bEnableVolumeLimit)
+	// 逐槽位限制（装备容器）：每个槽位只放一个，只放进接受该物品的空槽位
+	if (const TArray<FGameplayTagContainer>* SlotFilters = ContainerSlotFilters.Find(Container->ContainerUID))
 	{
-		int32 UsedVolume = GetContainerUsedVolume(Container->ContainerUID);
-		int32 ItemVolume = ItemDef.ItemVolume * Item->Quantity;
-		int32 AvailableVolume = ContainerDef.MaxVolume - UsedVolume;
-		if (UsedVolume + ItemVolume > ContainerDef.MaxVolume)
+		Result.bRotated = false;
+		Result.SlotID = Item->Quantity == 1 ? FindFilteredEmptySlot(*Container, *SlotFilters, ItemDef) : INDEX_NONE;
+		if (Result.SlotID == INDEX_NONE)
 		{
-			Result.ResultType = EMoveItemResult::VolumeExceeded;
-			Result.ErrorMessage = FString::Printf(TEXT("容器体积不足 (需要: %d, 剩余: %d, 总容量: %d)"),
-	          ItemDef.ItemVolume,
-	          AvailableVolume,
-	          ContainerDef.MaxVolume);
+			Result.ResultType = EMoveItemResult::TypeMismatch;
+			Result.ErrorMessage = FString::Printf(TEXT("没有可以放入该物品的空装备槽 (%s)"), *Item->GetDebugName());
 			return Result;
 		}
+		Result.ResultType = EMoveItemResult::Success;
+		return Result;
 	}
 
-	// 检查是否有空槽位
-	Result.SlotID = Container->FindEmptySlotID();
+	// 检查是否有空槽位（网格布局需要放得下物品的占地）
+	Result.SlotID = FindPlacementSlot(*Container, ContainerDef, ItemDef, Item->bRotated, Result.bRotated);
 	if (Result.SlotID == INDEX_NONE)
 	{
 		Result.ResultType = EMoveItemResult::ContainerFull;
@@ -578,988 +747,4601 @@ FAddItemResult UGaiaInventorySubsystem::CanAddItemToContainer(FGaiaItemInstance*
 	return Result;
 }
 
-//~END 容器操作
-
-//~BEGIN 嵌套检测
-
-bool UGaiaInventorySubsystem::WouldCreateCycle(const FGuid& ItemContainerUID, const FGuid& TargetContainerUID) const
+bool UGaiaInventorySubsystem::CheckSlotFiltersForMove(const FGaiaItemInstance& Item, const FGaiaContainerInstance& TargetContainer, int32& InOutTargetSlotID, int32 Quantity, FMoveItemResult& OutResult) const
 {
-	if (!ItemContainerUID.IsValid() || !TargetContainerUID.IsValid())
+	const TArray<FGameplayTagContainer>* TargetFilters = ContainerSlotFilters.Find(TargetContainer.ContainerUID);
+	const TArray<FGameplayTagContainer>* SourceFilters = ContainerSlotFilters.Find(Item.CurrentContainerUID);
+	if (!TargetFilters && !SourceFilters)
 	{
-		return false;
+		return true;
 	}
 	
-	// 向上遍历目标容器的所有父容器
-	FGuid CurrentUID = TargetContainerUID;
-	TSet<FGuid> Visited;  // 防止无限循环
+	const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item.ItemDefinitionID);
+	if (!ItemDef)
+	{
+		OutResult.Result = EMoveItemResult::InvalidDefinition;
+		OutResult.ErrorMessage = FString::Printf(TEXT("无法获取物品定义 (ItemDefID: %s)"), *Item.ItemDefinitionID.ToString());
+		return false;
+	}
 	
-	while (CurrentUID.IsValid())
+	if (TargetFilters && InOutTargetSlotID < 0)
 	{
-		// 检查是否已经访问过（检测循环）
-		if (Visited.Contains(CurrentUID))
-		{
-			UE_LOG(LogGaia, Warning, TEXT("检测到容器循环引用"));
-			return true;
-		}
-		
-		// 检查是否等于物品的容器（会造成循环）
-		if (CurrentUID == ItemContainerUID)
+		InOutTargetSlotID = FindFilteredEmptySlot(TargetContainer, *TargetFilters, *ItemDef);
+		if (InOutTargetSlotID == INDEX_NONE)
 		{
-			return true;
+			OutResult.Result = EMoveItemResult::TypeMismatch;
+			OutResult.ErrorMessage = FString::Printf(TEXT("没有可以放入该物品的空装备槽 (%s)"), *Item.GetDebugName());
+			return false;
 		}
-		
-		Visited.Add(CurrentUID);
-		
-		// 获取父容器
-		const FGaiaContainerInstance* Container = Containers.Find(CurrentUID);
-		if (!Container)
+	}
+	
+	const int32 TargetSlotIndex = InOutTargetSlotID >= 0 ? TargetContainer.GetSlotIndexByID(InOutTargetSlotID) : INDEX_NONE;
+	const FGaiaItemInstance* TargetItem = TargetSlotIndex != INDEX_NONE && !TargetContainer.Slots[TargetSlotIndex].IsEmpty()
+		? AllItems.Find(TargetContainer.Slots[TargetSlotIndex].ItemInstanceUID)
+		: nullptr;
+	
+	// 与 ProcessTargetSlotWithItem 的路由一致：同定义堆叠，目标带容器时放入其容器（不受装备槽限制），其余交换
+	const bool bStack = TargetItem && TargetItem->ItemDefinitionID == Item.ItemDefinitionID;
+	const bool bIntoTargetItem = TargetItem && !bStack && TargetItem->HasContainer();
+	
+	if (TargetFilters && !bIntoTargetItem)
+	{
+		if (!TargetFilters->IsValidIndex(InOutTargetSlotID) || !(*TargetFilters)[InOutTargetSlotID].HasAny(ItemDef->ItemTags))
 		{
-			break;
+			OutResult.Result = EMoveItemResult::TypeMismatch;
+			OutResult.ErrorMessage = FString::Printf(TEXT("装备槽 %d 不接受该物品 (%s)"), InOutTargetSlotID, *Item.GetDebugName());
+			return false;
 		}
-		
-		// 如果容器属于某个物品，继续向上查找
-		if (Container->OwnerItemUID.IsValid())
+		if (Quantity != 1 || bStack)
 		{
-			// 使用新架构：从AllItems查找拥有此容器的物品
-			const FGaiaItemInstance* OwnerItem = AllItems.Find(Container->OwnerItemUID);
-			
-			if (OwnerItem && OwnerItem->IsInContainer())
-			{
-				// 物品在容器中，继续向上遍历
-				CurrentUID = OwnerItem->CurrentContainerUID;
-			}
-			else
-			{
-				// 物品不在容器中（游离状态）或不存在，停止遍历
-				break;
-			}
+			OutResult.Result = EMoveItemResult::Failed;
+			OutResult.ErrorMessage = TEXT("每个装备槽只能放一个物品");
+			return false;
 		}
-		else
+	}
+	
+	// 交换：目标槽位的物品回到源槽位，源容器的限制同样适用
+	if (SourceFilters && TargetItem && !bStack && !bIntoTargetItem)
+	{
+		const FGaiaItemDefinition* TargetItemDef = FindItemDefinition(TargetItem->ItemDefinitionID);
+		if (!TargetItemDef || TargetItem->Quantity != 1 || !SourceFilters->IsValidIndex(Item.CurrentSlotID)
+			|| !(*SourceFilters)[Item.CurrentSlotID].HasAny(TargetItemDef->ItemTags))
 		{
-			// 容器不属于任何物品（顶层容器），没有父容器了
-			break;
+			OutResult.Result = EMoveItemResult::TypeMismatch;
+			OutResult.ErrorMessage = FString::Printf(TEXT("交换的物品不能放入装备槽 %d (%s)"), Item.CurrentSlotID, *TargetItem->GetDebugName());
+			return false;
 		}
 	}
 	
-	return false;  // 没有循环
+	return true;
 }
 
-//~END 嵌套检测
-
-//~BEGIN 体积/重量计算
-
-int32 UGaiaInventorySubsystem::GetItemTotalVolume(const FGaiaItemInstance& Item)
+int32 UGaiaInventorySubsystem::FindFilteredEmptySlot(const FGaiaContainerInstance& Container, const TArray<FGameplayTagContainer>& SlotFilters, const FGaiaItemDefinition& ItemDef) const
 {
-	FGaiaItemDefinition ItemDef;
-	if (!GetItemDefinition(Item.ItemDefinitionID, ItemDef))
+	for (int32 SlotID = 0; SlotID < SlotFilters.Num(); ++SlotID)
 	{
-		return 0;
+		const int32 SlotIndex = Container.GetSlotIndexByID(SlotID);
+		if (SlotIndex != INDEX_NONE && Container.Slots[SlotIndex].IsEmpty() && SlotFilters[SlotID].HasAny(ItemDef.ItemTags))
+		{
+			return SlotID;
+		}
 	}
-	return ItemDef.ItemVolume * Item.Quantity;
+	return INDEX_NONE;
 }
 
-int32 UGaiaInventorySubsystem::GetItemTotalWeight(const FGaiaItemInstance& Item) const
+void UGaiaInventorySubsystem::SetContainerSlotFilters(const FGuid& ContainerUID, const TArray<FGameplayTagContainer>& SlotAllowedItemTags)
 {
-	FGaiaItemDefinition ItemDef;
-	if (!GetItemDefinition(Item.ItemDefinitionID, ItemDef))
+	if (SlotAllowedItemTags.IsEmpty())
 	{
-		return 0;
+		ContainerSlotFilters.Remove(ContainerUID);
 	}
-	
-	int32 BaseWeight = ItemDef.ItemWeight * Item.Quantity;
-	
+	else
+	{
+		ContainerSlotFilters.Add(ContainerUID, SlotAllowedItemTags);
+	}
+}
+
+//~END 容器操作
+
+//~BEGIN 批量发放
+
+FGaiaGrantResult UGaiaInventorySubsystem::GrantItems(const TArray<FGaiaItemGrant>& Grants, const FGuid& TargetContainerUID, bool bIncludeNestedContainers)
+{
+	return GrantItemsInternal(Grants, TargetContainerUID, bIncludeNestedContainers, nullptr);
+}
+
+FGaiaGrantResult UGaiaInventorySubsystem::GrantItemsInternal(const TArray<FGaiaItemGrant>& Grants, const FGuid& TargetContainerUID, bool bIncludeNestedContainers, TMap<FGuid, int32>* OutToppedUpQuantities)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaGrantResult Result;
+	
+	// 1. 按定义合并请求，每种定义只解析一次
+	struct FPendingGrant
+	{
+		FName ItemDefID;
+		const FGaiaItemDefinition* ItemDef = nullptr;
+		int32 Remaining = 0;
+	};
+	TArray<FPendingGrant> PendingGrants;
+	TMap<FName, int32> PendingIndices;
+	for (const FGaiaItemGrant& Grant : Grants)
+	{
+		if (Grant.Quantity <= 0)
+		{
+			continue;
+		}
+		
+		if (const int32* Found = PendingIndices.Find(Grant.ItemDefinitionID))
+		{
+			PendingGrants[*Found].Remaining += Grant.Quantity;
+			continue;
+		}
+		
+		FPendingGrant& Pending = PendingGrants.AddDefaulted_GetRef();
+		Pending.ItemDefID = Grant.ItemDefinitionID;
+		Pending.ItemDef = FindItemDefinition(Grant.ItemDefinitionID);
+		Pending.Remaining = Grant.Quantity;
+		PendingIndices.Add(Grant.ItemDefinitionID, PendingGrants.Num() - 1);
+	}
+	
+	// 2. 遍历一次目标容器树：记录空槽位、剩余体积和可补充的未满堆叠
+	struct FGrantTarget
+	{
+		FGuid ContainerUID;
+		const FGaiaContainerDefinition* ContainerDef = nullptr;
+		TArray<int32> FreeSlotIndices;
+		int32 NextFreeSlot = 0;
+		int32 RemainingVolume = MAX_int32;
+	};
+	struct FOpenStack
+	{
+		int32 TargetIndex;
+		FGuid ItemUID;
+	};
+	TArray<FGrantTarget> Targets;
+	TMap<FName, TArray<FOpenStack>> OpenStacks;
+	
+	TArray<FGuid> PendingContainers = { TargetContainerUID };
+	TSet<FGuid> VisitedContainers;
+	for (int32 QueueIndex = 0; QueueIndex < PendingContainers.Num(); ++QueueIndex)
+	{
+		bool bAlreadyVisited = false;
+		VisitedContainers.Add(PendingContainers[QueueIndex], &bAlreadyVisited);
+		const FGaiaContainerInstance* Container = bAlreadyVisited ? nullptr : Containers.Find(PendingContainers[QueueIndex]);
+		const FGaiaContainerDefinition* ContainerDef = Container ? FindContainerDefinition(Container->ContainerDefinitionID) : nullptr;
+		if (!ContainerDef || HasContainerSlotFilters(Container->ContainerUID))
+		{
+			continue;
+		}
+		
+		const int32 TargetIndex = Targets.AddDefaulted();
+		FGrantTarget& Target = Targets[TargetIndex];
+		Target.ContainerUID = Container->ContainerUID;
+		Target.ContainerDef = ContainerDef;
+		if (ContainerDef->bEnableVolumeLimit)
+		{
+			Target.RemainingVolume = ContainerDef->MaxVolume - ComputeContainerUsedVolume(*Container, AllItems);
+		}
+		
+		for (int32 SlotIndex = 0; SlotIndex < Container->Slots.Num(); ++SlotIndex)
+		{
+			const FGaiaSlotInfo& Slot = Container->Slots[SlotIndex];
+			if (Slot.IsEmpty())
+			{
+				// 网格布局的空槽位可能被其他物品覆盖，放置时按占用位图查找
+				if (!ContainerDef->bUseGridLayout)
+				{
+					Target.FreeSlotIndices.Add(SlotIndex);
+				}
+				continue;
+			}
+			
+			const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID);
+			if (!Item)
+			{
+				continue;
+			}
+			
+			if (bIncludeNestedContainers && Item->HasContainer())
+			{
+				PendingContainers.Add(Item->OwnedContainerUID);
+			}
+			
+			const int32* PendingIndex = PendingIndices.Find(Item->ItemDefinitionID);
+			const FGaiaItemDefinition* ItemDef = PendingIndex ? PendingGrants[*PendingIndex].ItemDef : nullptr;
+			if (ItemDef && ItemDef->IsStackable() && Item->Quantity < ItemDef->MaxStackSize)
+			{
+				OpenStacks.FindOrAdd(Item->ItemDefinitionID).Add({ TargetIndex, Item->InstanceUID });
+			}
+		}
+	}
+	
+	TSet<FGuid> AffectedContainers;
+	
+	// 3. 逐种定义放置：先补满已有堆叠，再新建堆叠放入空槽位
+	for (FPendingGrant& Pending : PendingGrants)
+	{
+		const FGaiaItemDefinition* ItemDef = Pending.ItemDef;
+		if (!ItemDef)
+		{
+			UE_LOG(LogGaia, Warning, TEXT("[批量发放] 物品定义不存在: %s"), *Pending.ItemDefID.ToString());
+			Result.Overflow.Emplace(Pending.ItemDefID, Pending.Remaining);
+			continue;
+		}
+		
+		const bool bStackable = ItemDef->IsStackable();
+		const int32 MaxPerStack = bStackable ? FMath::Max(ItemDef->MaxStackSize, 1) : 1;
+		
+		// 体积限制下最多还能放入的数量
+		auto GetVolumeCapacity = [ItemDef](const FGrantTarget& Target)
+		{
+			return ItemDef->ItemVolume > 0 ? FMath::Max(Target.RemainingVolume, 0) / ItemDef->ItemVolume : MAX_int32;
+		};
+		
+		if (const TArray<FOpenStack>* Stacks = bStackable ? OpenStacks.Find(Pending.ItemDefID) : nullptr)
+		{
+			for (const FOpenStack& Stack : *Stacks)
+			{
+				if (Pending.Remaining <= 0)
+				{
+					break;
+				}
+				
+				FGrantTarget& Target = Targets[Stack.TargetIndex];
+				FGaiaItemInstance* Item = AllItems.Find(Stack.ItemUID);
+				const int32 ToAdd = Item ? FMath::Min3(Pending.Remaining, MaxPerStack - Item->Quantity, GetVolumeCapacity(Target)) : 0;
+				if (ToAdd <= 0)
+				{
+					continue;
+				}
+				
+				const int32 OldQuantity = Item->Quantity;
+				Item->Quantity += ToAdd;
+				NotifyItemQuantityChanged(*Item, OldQuantity);
+				
+				Pending.Remaining -= ToAdd;
+				Target.RemainingVolume -= ToAdd * ItemDef->ItemVolume;
+				Result.GrantedQuantity += ToAdd;
+				Result.ToppedUpItemUIDs.AddUnique(Stack.ItemUID);
+				AffectedContainers.Add(Target.ContainerUID);
+				if (OutToppedUpQuantities)
+				{
+					OutToppedUpQuantities->FindOrAdd(Stack.ItemUID) += ToAdd;
+				}
+			}
+		}
+		
+		for (FGrantTarget& Target : Targets)
+		{
+			if (Pending.Remaining <= 0)
+			{
+				break;
+			}
+			
+			// 与 CheckAddItemRules 相同的标签和嵌套规则（新建物品不会形成循环）
+			if (!Target.ContainerDef->HasAnyAllowedTag(ItemDef->ItemTags)
+				|| (ItemDef->bHasContainer && !Target.ContainerDef->bAllowNestedContainers))
+			{
+				continue;
+			}
+			
+			while (Pending.Remaining > 0)
+			{
+				const int32 StackQuantity = FMath::Min3(Pending.Remaining, MaxPerStack, GetVolumeCapacity(Target));
+				if (StackQuantity <= 0)
+				{
+					break;
+				}
+				
+				// 网格布局每次按当前占用位图找位置（位图随放入的物品更新）
+				int32 SlotIndex = INDEX_NONE;
+				bool bRotated = false;
+				if (Target.ContainerDef->bUseGridLayout)
+				{
+					const FGaiaContainerInstance& GridContainer = Containers.FindChecked(Target.ContainerUID);
+					SlotIndex = GridContainer.GetSlotIndexByID(FindPlacementSlot(GridContainer, *Target.ContainerDef, *ItemDef, false, bRotated));
+				}
+				else if (Target.NextFreeSlot < Target.FreeSlotIndices.Num())
+				{
+					SlotIndex = Target.FreeSlotIndices[Target.NextFreeSlot++];
+				}
+				if (SlotIndex == INDEX_NONE)
+				{
+					break;
+				}
+				
+				FGaiaItemInstance& NewItem = CreateItemInstanceInternal(Pending.ItemDefID, *ItemDef, StackQuantity);
+				
+				// 创建带容器的物品会向容器表添加元素，容器指针在此之后获取
+				FGaiaContainerInstance& Container = Containers.FindChecked(Target.ContainerUID);
+				NewItem.CurrentContainerUID = Container.ContainerUID;
+				NewItem.CurrentSlotID = Container.Slots[SlotIndex].SlotID;
+				NewItem.bRotated = bRotated;
+				Container.Slots[SlotIndex].ItemInstanceUID = NewItem.InstanceUID;
+				NotifyItemEnteredContainer(NewItem, Container);
+				
+				Pending.Remaining -= StackQuantity;
+				Target.RemainingVolume -= StackQuantity * ItemDef->ItemVolume;
+				Result.GrantedQuantity += StackQuantity;
+				Result.CreatedItemUIDs.Add(NewItem.InstanceUID);
+				AffectedContainers.Add(Target.ContainerUID);
+			}
+		}
+		
+		if (Pending.Remaining > 0)
+		{
+			Result.Overflow.Emplace(Pending.ItemDefID, Pending.Remaining);
+		}
+	}
+	
+	Result.AffectedContainerUIDs = AffectedContainers.Array();
+	
+	UE_LOG(LogGaia, Log, TEXT("[批量发放] 容器 %s: 发放 %d，新建物品 %d，补充堆叠 %d，溢出 %d 种"),
+		*TargetContainerUID.ToString(), Result.GrantedQuantity, Result.CreatedItemUIDs.Num(),
+		Result.ToppedUpItemUIDs.Num(), Result.Overflow.Num());
+	
+	return Result;
+}
+
+FGaiaGrantResult UGaiaInventorySubsystem::GrantLootTable(const UGaiaLootTable* LootTable, const FGuid& TargetContainerUID, int32 RandomSeed, bool bIncludeNestedContainers)
+{
+	if (!LootTable)
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[批量发放] 掉落表为空"));
+		return FGaiaGrantResult();
+	}
+	
+	FRandomStream RandomStream(RandomSeed);
+	if (RandomSeed == 0)
+	{
+		RandomStream.GenerateNewSeed();
+	}
+	
+	TArray<FGaiaItemGrant> Grants;
+	LootTable->RollGrants(RandomStream, Grants);
+	return GrantItems(Grants, TargetContainerUID, bIncludeNestedContainers);
+}
+
+bool UGaiaInventorySubsystem::ConsumeItems(const TArray<FGaiaItemGrant>& Costs, const FGuid& RootContainerUID, bool bIncludeNestedContainers)
+{
+	FMutationScope MutationScope(*this);
+	
+	TMap<FName, int32> Required;
+	TMap<FName, TArray<FGuid>> Stacks;
+	if (!FindConsumableStacks(Costs, RootContainerUID, bIncludeNestedContainers, Required, Stacks))
+	{
+		return false;
+	}
+	if (Required.IsEmpty())
+	{
+		return true;
+	}
+	
+	ConsumeStacks(Required, Stacks);
+	
+	UE_LOG(LogGaia, Log, TEXT("[批量扣除] 容器 %s: 扣除 %d 种物品"), *RootContainerUID.ToString(), Required.Num());
+	return true;
+}
+
+bool UGaiaInventorySubsystem::FindConsumableStacks(const TArray<FGaiaItemGrant>& Costs, const FGuid& RootContainerUID, bool bIncludeNestedContainers, TMap<FName, int32>& OutRequired, TMap<FName, TArray<FGuid>>& OutStacks) const
+{
+	// 1. 按定义合并请求
+	TMap<FName, int32>& Required = OutRequired;
+	for (const FGaiaItemGrant& Cost : Costs)
+	{
+		if (Cost.Quantity > 0)
+		{
+			Required.FindOrAdd(Cost.ItemDefinitionID) += Cost.Quantity;
+		}
+	}
+	if (Required.IsEmpty())
+	{
+		return true;
+	}
+	
+	// 整棵树时先用根容器数量索引快速排除（索引包含带容器的物品，只能用于排除）
+	const FGaiaContainerInstance* RootContainer = Containers.Find(RootContainerUID);
+	if (!RootContainer)
+	{
+		return false;
+	}
+	if (bIncludeNestedContainers && RootContainer->NestingDepth == 0)
+	{
+		for (const auto& RequiredPair : Required)
+		{
+			if (GetRootDefinitionCount(RootContainerUID, RequiredPair.Key) < RequiredPair.Value)
+			{
+				return false;
+			}
+		}
+	}
+	
+	// 2. 遍历一次容器树，按定义收集可扣除的堆叠（广度优先顺序）
+	TMap<FName, TArray<FGuid>>& Stacks = OutStacks;
+	TMap<FName, int32> Available;
+	TArray<FGuid> PendingContainers = { RootContainerUID };
+	TSet<FGuid> VisitedContainers;
+	for (int32 QueueIndex = 0; QueueIndex < PendingContainers.Num(); ++QueueIndex)
+	{
+		bool bAlreadyVisited = false;
+		VisitedContainers.Add(PendingContainers[QueueIndex], &bAlreadyVisited);
+		const FGaiaContainerInstance* Container = bAlreadyVisited ? nullptr : Containers.Find(PendingContainers[QueueIndex]);
+		if (!Container)
+		{
+			continue;
+		}
+		
+		for (const FGaiaSlotInfo& Slot : Container->Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			if (!Item)
+			{
+				continue;
+			}
+			
+			if (Item->HasContainer())
+			{
+				if (bIncludeNestedContainers)
+				{
+					PendingContainers.Add(Item->OwnedContainerUID);
+				}
+				continue;
+			}
+			
+			if (Required.Contains(Item->ItemDefinitionID))
+			{
+				Stacks.FindOrAdd(Item->ItemDefinitionID).Add(Item->InstanceUID);
+				Available.FindOrAdd(Item->ItemDefinitionID) += Item->Quantity;
+			}
+		}
+	}
+	
+	for (const auto& RequiredPair : Required)
+	{
+		const int32* Found = Available.Find(RequiredPair.Key);
+		if (!Found || *Found < RequiredPair.Value)
+		{
+			UE_LOG(LogGaia, Verbose, TEXT("[批量扣除] 容器 %s 中 %s 不足: 需要 %d, 拥有 %d"),
+				*RootContainerUID.ToString(), *RequiredPair.Key.ToString(), RequiredPair.Value, Found ? *Found : 0);
+			return false;
+		}
+	}
+	return true;
+}
+
+void UGaiaInventorySubsystem::ConsumeStacks(const TMap<FName, int32>& Required, const TMap<FName, TArray<FGuid>>& Stacks)
+{
+	// 3. 从靠后的堆叠开始扣除，扣空的物品删除
+	for (const auto& RequiredPair : Required)
+	{
+		int32 Remaining = RequiredPair.Value;
+		const TArray<FGuid>& DefinitionStacks = Stacks.FindChecked(RequiredPair.Key);
+		for (int32 StackIndex = DefinitionStacks.Num() - 1; StackIndex >= 0 && Remaining > 0; --StackIndex)
+		{
+			FGaiaItemInstance& Item = AllItems.FindChecked(DefinitionStacks[StackIndex]);
+			const int32 Take = FMath::Min(Item.Quantity, Remaining);
+			Remaining -= Take;
+			
+			if (Take < Item.Quantity)
+			{
+				const int32 OldQuantity = Item.Quantity;
+				Item.Quantity -= Take;
+				NotifyItemQuantityChanged(Item, OldQuantity);
+				continue;
+			}
+			
+			FGaiaContainerInstance& Container = Containers.FindChecked(Item.CurrentContainerUID);
+			const int32 SlotIndex = Container.GetSlotIndexByID(Item.CurrentSlotID);
+			if (SlotIndex != INDEX_NONE)
+			{
+				Container.Slots[SlotIndex].ItemInstanceUID = FGuid();
+			}
+			NotifyItemLeftContainer(Item, Container);
+			
+			const FGuid ItemUID = Item.InstanceUID;
+			RemoveItemRecord(ItemUID);
+		}
+	}
+}
+
+bool UGaiaInventorySubsystem::ExchangeItems(const TArray<FGaiaItemGrant>& Costs, const TArray<FGaiaItemGrant>& Grants, const FGuid& ContainerUID, FGaiaGrantResult& OutGrantResult, bool bIncludeNestedContainers)
+{
+	// 外层作用域让扣除和发放作为同一批写入日志
+	FMutationScope MutationScope(*this);
+	
+	OutGrantResult = FGaiaGrantResult();
+	
+	// 1. 先确认材料足够（不修改），堆叠在发放前收集，发放的产出不会被当作材料
+	TMap<FName, int32> Required;
+	TMap<FName, TArray<FGuid>> Stacks;
+	if (!FindConsumableStacks(Costs, ContainerUID, bIncludeNestedContainers, Required, Stacks))
+	{
+		return false;
+	}
+	
+	// 2. 发放产出，放不下时撤销发放，材料不扣除
+	TMap<FGuid, int32> ToppedUpQuantities;
+	OutGrantResult = GrantItemsInternal(Grants, ContainerUID, bIncludeNestedContainers, &ToppedUpQuantities);
+	if (!OutGrantResult.Overflow.IsEmpty())
+	{
+		for (const FGuid& ItemUID : OutGrantResult.CreatedItemUIDs)
+		{
+			DestroyItem(ItemUID);
+		}
+		for (const auto& ToppedUpPair : ToppedUpQuantities)
+		{
+			FGaiaItemInstance& Item = AllItems.FindChecked(ToppedUpPair.Key);
+			const int32 OldQuantity = Item.Quantity;
+			Item.Quantity -= ToppedUpPair.Value;
+			NotifyItemQuantityChanged(Item, OldQuantity);
+		}
+		
+		UE_LOG(LogGaia, Log, TEXT("[批量发放] 容器 %s 放不下全部产出（%d 种），兑换已撤销"), *ContainerUID.ToString(), OutGrantResult.Overflow.Num());
+		OutGrantResult.CreatedItemUIDs.Reset();
+		OutGrantResult.ToppedUpItemUIDs.Reset();
+		OutGrantResult.AffectedContainerUIDs.Reset();
+		OutGrantResult.GrantedQuantity = 0;
+		return false;
+	}
+	
+	// 3. 扣除材料（补充过的堆叠数量只增不减，收集到的堆叠仍然足够）
+	ConsumeStacks(Required, Stacks);
+	return true;
+}
+
+//~END 批量发放
+
+//~BEGIN 交易
+
+bool UGaiaInventorySubsystem::ValidateTradeOffers(const FGuid& RootContainerUID, const TArray<FGaiaTradeOffer>& Offers, FString& OutErrorMessage) const
+{
+	const FGaiaContainerInstance* RootContainer = Containers.Find(RootContainerUID);
+	if (!RootContainer || RootContainer->NestingDepth != 0)
+	{
+		OutErrorMessage = FString::Printf(TEXT("根容器无效 (ContainerUID: %s)"), *RootContainerUID.ToString());
+		return false;
+	}
+	
+	TSet<FGuid> OfferedItems;
+	for (const FGaiaTradeOffer& Offer : Offers)
+	{
+		bool bDuplicate = false;
+		OfferedItems.Add(Offer.ItemUID, &bDuplicate);
+		if (bDuplicate)
+		{
+			OutErrorMessage = FString::Printf(TEXT("同一物品重复报价 (ItemUID: %s)"), *Offer.ItemUID.ToString());
+			return false;
+		}
+		
+		const FGaiaItemInstance* Item = AllItems.Find(Offer.ItemUID);
+		const FGaiaContainerInstance* Container = (Item && Item->IsInContainer()) ? Containers.Find(Item->CurrentContainerUID) : nullptr;
+		if (!Container || Container->GetRootContainerUID() != RootContainerUID)
+		{
+			OutErrorMessage = FString::Printf(TEXT("物品不在报价方的容器树中 (ItemUID: %s)"), *Offer.ItemUID.ToString());
+			return false;
+		}
+		
+		if (Offer.Quantity <= 0 || Offer.Quantity > Item->Quantity)
+		{
+			OutErrorMessage = FString::Printf(TEXT("报价数量无效: %s 报价 %d"), *Item->GetDebugName(), Offer.Quantity);
+			return false;
+		}
+		
+		if (Item->HasContainer() && Offer.Quantity != Item->Quantity)
+		{
+			OutErrorMessage = FString::Printf(TEXT("带容器的物品必须整件交易: %s"), *Item->GetDebugName());
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+FGaiaTradeResult UGaiaInventorySubsystem::ExecuteTrade(const FGuid& RootContainerA, const TArray<FGaiaTradeOffer>& OffersA, const FGuid& RootContainerB, const TArray<FGaiaTradeOffer>& OffersB)
+{
+	// 取出、放入和撤销都在同一个作用域内，日志只写入最终状态
+	FMutationScope MutationScope(*this);
+	
+	if (RootContainerA == RootContainerB)
+	{
+		return FGaiaTradeResult::Failure(TEXT("交易双方的根容器相同"));
+	}
+	
+	FString ErrorMessage;
+	if (!ValidateTradeOffers(RootContainerA, OffersA, ErrorMessage) || !ValidateTradeOffers(RootContainerB, OffersB, ErrorMessage))
+	{
+		UE_LOG(LogGaia, Log, TEXT("[交易] 报价无效: %s"), *ErrorMessage);
+		return FGaiaTradeResult::Failure(ErrorMessage);
+	}
+	
+	// 取出的物品及撤销所需的原位置
+	struct FDetachedItem
+	{
+		FGuid ItemUID;
+		
+		/** 从堆叠中拆出时的来源物品（整件取出时无效） */
+		FGuid SourceItemUID;
+		
+		FGuid ContainerUID;
+		int32 SlotID = INDEX_NONE;
+		bool bRotated = false;
+		
+		/** 是否交给甲方 */
+		bool bToA = false;
+	};
+	TArray<FDetachedItem> DetachedItems;
+	DetachedItems.Reserve(OffersA.Num() + OffersB.Num());
+	
+	// 1. 取出双方报价的物品，取出后不属于任何一棵容器树（交出的背包不会成为放入目标）
+	auto DetachOffers = [this, &DetachedItems](const TArray<FGaiaTradeOffer>& Offers, bool bToA)
+	{
+		for (const FGaiaTradeOffer& Offer : Offers)
+		{
+			FGaiaItemInstance& Item = AllItems.FindChecked(Offer.ItemUID);
+			FDetachedItem& Detached = DetachedItems.AddDefaulted_GetRef();
+			Detached.bToA = bToA;
+			
+			if (Offer.Quantity < Item.Quantity)
+			{
+				const int32 OldQuantity = Item.Quantity;
+				Item.Quantity -= Offer.Quantity;
+				NotifyItemQuantityChanged(Item, OldQuantity);
+				
+				FGaiaItemInstance NewItem = Item;
+				NewItem.InstanceUID = AllocateUID();
+				NewItem.Quantity = Offer.Quantity;
+				NewItem.CurrentContainerUID = FGuid();
+				NewItem.CurrentSlotID = -1;
+				NewItem.bRotated = false;
+				Detached.ItemUID = NewItem.InstanceUID;
+				Detached.SourceItemUID = Item.InstanceUID;
+				
+				// AllItems.Add 可能导致重新分配，之后 Item 引用失效
+				const FGaiaItemInstance& AddedItem = AllItems.Add(NewItem.InstanceUID, NewItem);
+				MarkItemChanged(AddedItem.InstanceUID);
+				ScheduleItemExpiry(AddedItem);
+				continue;
+			}
+			
+			Detached.ItemUID = Item.InstanceUID;
+			Detached.ContainerUID = Item.CurrentContainerUID;
+			Detached.SlotID = Item.CurrentSlotID;
+			Detached.bRotated = Item.bRotated;
+			
+			FGaiaContainerInstance& Container = Containers.FindChecked(Item.CurrentContainerUID);
+			const int32 SlotIndex = Container.GetSlotIndexByID(Item.CurrentSlotID);
+			if (SlotIndex != INDEX_NONE)
+			{
+				Container.Slots[SlotIndex].ItemInstanceUID = FGuid();
+			}
+			Item.CurrentContainerUID = FGuid();
+			Item.CurrentSlotID = -1;
+			NotifyItemLeftContainer(Item, Container);
+		}
+	};
+	DetachOffers(OffersA, false);
+	DetachOffers(OffersB, true);
+	
+	// 2. 收集接收方的容器树（广度优先），放入时依次尝试
+	auto CollectTreeContainers = [this](const FGuid& RootContainerUID)
+	{
+		TArray<FGuid> TreeContainers = { RootContainerUID };
+		TSet<FGuid> VisitedContainers = { RootContainerUID };
+		for (int32 QueueIndex = 0; QueueIndex < TreeContainers.Num(); ++QueueIndex)
+		{
+			const FGaiaContainerInstance& Container = Containers.FindChecked(TreeContainers[QueueIndex]);
+			for (const FGaiaSlotInfo& Slot : Container.Slots)
+			{
+				const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+				if (!Item || !Item->HasContainer() || !Containers.Contains(Item->OwnedContainerUID))
+				{
+					continue;
+				}
+				
+				bool bAlreadyVisited = false;
+				VisitedContainers.Add(Item->OwnedContainerUID, &bAlreadyVisited);
+				if (!bAlreadyVisited)
+				{
+					TreeContainers.Add(Item->OwnedContainerUID);
+				}
+			}
+		}
+		return TreeContainers;
+	};
+	const TArray<FGuid> TreeContainersA = CollectTreeContainers(RootContainerA);
+	const TArray<FGuid> TreeContainersB = CollectTreeContainers(RootContainerB);
+	
+	// 3. 放入对方的容器树（只放入空槽位，撤销时只需要取出）
+	FGaiaTradeResult Result;
+	int32 NumPlaced = 0;
+	for (; NumPlaced < DetachedItems.Num(); ++NumPlaced)
+	{
+		const FDetachedItem& Detached = DetachedItems[NumPlaced];
+		FGaiaItemInstance* Item = AllItems.Find(Detached.ItemUID);
+		
+		bool bPlaced = false;
+		for (const FGuid& ContainerUID : Detached.bToA ? TreeContainersA : TreeContainersB)
+		{
+			FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+			const FAddItemResult AddResult = CanAddItemToContainer(Item, Container);
+			if (AddResult.IsSuccess() && AddItemToContainer(Item, Container, AddResult.SlotID, AddResult.bRotated))
+			{
+				bPlaced = true;
+				break;
+			}
+		}
+		
+		if (!bPlaced)
+		{
+			ErrorMessage = FString::Printf(TEXT("%s方的容器空间不足: %s"), Detached.bToA ? TEXT("甲") : TEXT("乙"), *Item->GetDebugName());
+			break;
+		}
+		(Detached.bToA ? Result.ReceivedItemUIDsA : Result.ReceivedItemUIDsB).Add(Detached.ItemUID);
+	}
+	
+	if (NumPlaced == DetachedItems.Num())
+	{
+		Result.bSuccess = true;
+		UE_LOG(LogGaia, Log, TEXT("[交易] 成交: 容器 %s 收到 %d 件，容器 %s 收到 %d 件"),
+			*RootContainerA.ToString(), Result.ReceivedItemUIDsA.Num(),
+			*RootContainerB.ToString(), Result.ReceivedItemUIDsB.Num());
+		return Result;
+	}
+	
+	// 4. 撤销：先取出已放入的物品，再按相反顺序放回原位（原槽位取出后没有被其他物品占用）
+	for (int32 Index = NumPlaced - 1; Index >= 0; --Index)
+	{
+		FGaiaItemInstance& Item = AllItems.FindChecked(DetachedItems[Index].ItemUID);
+		FGaiaContainerInstance& Container = Containers.FindChecked(Item.CurrentContainerUID);
+		const int32 SlotIndex = Container.GetSlotIndexByID(Item.CurrentSlotID);
+		if (SlotIndex != INDEX_NONE)
+		{
+			Container.Slots[SlotIndex].ItemInstanceUID = FGuid();
+		}
+		Item.CurrentContainerUID = FGuid();
+		Item.CurrentSlotID = -1;
+		NotifyItemLeftContainer(Item, Container);
+	}
+	
+	for (int32 Index = DetachedItems.Num() - 1; Index >= 0; --Index)
+	{
+		const FDetachedItem& Detached = DetachedItems[Index];
+		if (Detached.SourceItemUID.IsValid())
+		{
+			// 拆出的数量合并回来源堆叠，拆出的物品删除（过期时间与来源相同，时间轮中的条目到期时丢弃）
+			FGaiaItemInstance& SourceItem = AllItems.FindChecked(Detached.SourceItemUID);
+			const int32 OldQuantity = SourceItem.Quantity;
+			SourceItem.Quantity += AllItems.FindChecked(Detached.ItemUID).Quantity;
+			NotifyItemQuantityChanged(SourceItem, OldQuantity);
+			
+			RemoveItemRecord(Detached.ItemUID);
+			continue;
+		}
+		
+		if (!AddItemToContainer(&AllItems.FindChecked(Detached.ItemUID), &Containers.FindChecked(Detached.ContainerUID), Detached.SlotID, Detached.bRotated))
+		{
+			UE_LOG(LogGaia, Error, TEXT("[交易] 撤销时无法放回原位: %s"), *Detached.ItemUID.ToString());
+		}
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[交易] 未成交，已撤销: %s"), *ErrorMessage);
+	return FGaiaTradeResult::Failure(ErrorMessage);
+}
+
+//~END 交易
+
+//~BEGIN 整理
+
+bool UGaiaInventorySubsystem::SortContainer(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+	if (!Container)
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[整理] 容器不存在: %s"), *ContainerUID.ToString());
+		return false;
+	}
+	
+	// 逐槽位限制的容器每个槽位只接受特定物品，重排会破坏限制
+	if (HasContainerSlotFilters(ContainerUID))
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[整理] 容器有逐槽位限制，不能整理: %s"), *ContainerUID.ToString());
+		return false;
+	}
+	
+	struct FSortEntry
+	{
+		FGaiaItemInstance* Item;
+		const FGaiaItemDefinition* ItemDef;
+	};
+	
+	TArray<FSortEntry> Entries;
+	Entries.Reserve(Container->Slots.Num());
+	for (const FGaiaSlotInfo& Slot : Container->Slots)
+	{
+		if (FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID))
+		{
+			Entries.Add({ Item, FindItemDefinition(Item->ItemDefinitionID) });
+		}
+	}
+	
+	// 1. 按槽位顺序合并未满堆叠：每种物品记住最前面一个未满的堆叠，后面的往里倒
+	TArray<FGuid> EmptiedItemUIDs;
+	TMap<FName, int32> OpenStackIndices;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FSortEntry& Entry = Entries[Index];
+		if (!Entry.ItemDef || !Entry.ItemDef->IsStackable() || Entry.Item->HasContainer())
+		{
+			continue;
+		}
+		
+		const int32 MaxStackSize = Entry.ItemDef->MaxStackSize;
+		if (const int32* OpenIndex = OpenStackIndices.Find(Entry.Item->ItemDefinitionID))
+		{
+			FGaiaItemInstance& OpenStack = *Entries[*OpenIndex].Item;
+			const int32 Transfer = FMath::Min(MaxStackSize - OpenStack.Quantity, Entry.Item->Quantity);
+			OpenStack.Quantity += Transfer;
+			Entry.Item->Quantity -= Transfer;
+			MergeItemExpiry(OpenStack, *Entry.Item);
+			MarkItemChanged(OpenStack.InstanceUID);
+			MarkItemChanged(Entry.Item->InstanceUID);
+			
+			if (OpenStack.Quantity >= MaxStackSize)
+			{
+				OpenStackIndices.Remove(Entry.Item->ItemDefinitionID);
+			}
+		}
+		
+		if (Entry.Item->Quantity <= 0)
+		{
+			EmptiedItemUIDs.Add(Entry.Item->InstanceUID);
+			Entry.Item = nullptr;
+		}
+		else if (Entry.Item->Quantity < MaxStackSize && !OpenStackIndices.Contains(Entry.Item->ItemDefinitionID))
+		{
+			OpenStackIndices.Add(Entry.Item->ItemDefinitionID, Index);
+		}
+	}
+	
+	// 倒空的物品在槽位重写后统一删除
+	Entries.RemoveAll([](const FSortEntry& Entry) { return Entry.Item == nullptr; });
+	
+	// 2. 排序（没有定义的物品排在最后）
+	Entries.Sort([SortKey](const FSortEntry& A, const FSortEntry& B)
+	{
+		if ((A.ItemDef != nullptr) != (B.ItemDef != nullptr))
+		{
+			return A.ItemDef != nullptr;
+		}
+		
+		if (A.ItemDef && B.ItemDef)
+		{
+			int32 Order = 0;
+			switch (SortKey)
+			{
+			case EGaiaContainerSortKey::Tag:
+				Order = A.ItemDef->ItemTags.First().GetTagName().Compare(B.ItemDef->ItemTags.First().GetTagName());
+				break;
+			case EGaiaContainerSortKey::Weight:
+				Order = B.ItemDef->ItemWeight - A.ItemDef->ItemWeight;
+				break;
+			case EGaiaContainerSortKey::Quantity:
+				Order = B.Item->Quantity - A.Item->Quantity;
+				break;
+			default:
+				break;
+			}
+			if (Order != 0)
+			{
+				return Order < 0;
+			}
+		}
+		
+		if (const int32 DefOrder = A.Item->ItemDefinitionID.Compare(B.Item->ItemDefinitionID))
+		{
+			return DefOrder < 0;
+		}
+		if (A.Item->Quantity != B.Item->Quantity)
+		{
+			return A.Item->Quantity > B.Item->Quantity;
+		}
+		return A.Item->InstanceUID < B.Item->InstanceUID;
+	});
+	
+	// 3. 决定每个物品的新槽位：列表布局依次排列；网格布局按排序结果逐个找第一个能放下的位置，
+	//    有物品放不下时保留原布局（合并堆叠只会腾出格子，原位置一定仍然有效）
+	struct FPlacement
+	{
+		int32 SlotIndex;
+		bool bRotated;
+	};
+	TArray<FPlacement> Placements;
+	Placements.Reserve(Entries.Num());
+	
+	const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container->ContainerDefinitionID);
+	if (ContainerDef && ContainerDef->bUseGridLayout)
+	{
+		TArray<uint64> PackedRows;
+		PackedRows.SetNumZeroed(ContainerDef->GridHeight);
+		for (const FSortEntry& Entry : Entries)
+		{
+			const bool bCanRotate = Entry.ItemDef && Entry.ItemDef->CanRotateInGrid();
+			bool bPlaced = false;
+			for (const bool bRotated : { Entry.Item->bRotated, !Entry.Item->bRotated })
+			{
+				if (bRotated != Entry.Item->bRotated && !bCanRotate)
+				{
+					continue;
+				}
+				
+				const FIntPoint Footprint = Entry.ItemDef ? Entry.ItemDef->GetGridFootprint(bRotated) : FIntPoint(1, 1);
+				int32 X = 0;
+				int32 Y = 0;
+				if (FGaiaInventoryGrid::FindFreeArea(PackedRows, ContainerDef->GridWidth, Footprint.X, Footprint.Y, X, Y))
+				{
+					FGaiaInventoryGrid::MarkArea(PackedRows, X, Y, Footprint.X, Footprint.Y, true);
+					Placements.Add({ Container->GetSlotIndexByID(Y * ContainerDef->GridWidth + X), bRotated });
+					bPlaced = true;
+					break;
+				}
+			}
+			
+			if (!bPlaced)
+			{
+				UE_LOG(LogGaia, Log, TEXT("[整理] 网格容器 %s 无法按顺序重新排列，保留原布局"), *Container->GetDebugName());
+				Placements.Reset();
+				for (const FSortEntry& Unmoved : Entries)
+				{
+					Placements.Add({ Container->GetSlotIndexByID(Unmoved.Item->CurrentSlotID), Unmoved.Item->bRotated });
+				}
+				break;
+			}
+		}
+	}
+	else
+	{
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			Placements.Add({ Index, Entries[Index].Item->bRotated });
+		}
+	}
+	
+	// 4. 按新位置重写槽位（物品仍在同一容器中，嵌套信息不变）
+	for (FGaiaSlotInfo& Slot : Container->Slots)
+	{
+		Slot.ItemInstanceUID = FGuid();
+	}
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FGaiaItemInstance& Item = *Entries[Index].Item;
+		FGaiaSlotInfo& Slot = Container->Slots[Placements[Index].SlotIndex];
+		Slot.ItemInstanceUID = Item.InstanceUID;
+		if (Item.CurrentSlotID != Slot.SlotID || Item.bRotated != Placements[Index].bRotated)
+		{
+			Item.CurrentSlotID = Slot.SlotID;
+			Item.bRotated = Placements[Index].bRotated;
+			MarkItemChanged(Item.InstanceUID);
+		}
+	}
+	
+	for (const FGuid& ItemUID : EmptiedItemUIDs)
+	{
+		RemoveItemRecord(ItemUID);
+	}
+	
+	// 总重量/体积不变，只有已用槽位数和网格占用变化，统一全量重算一次
+	RecalculateLiveContainerAggregates(*Container);
+	++Container->ContentRevision;
+	MarkContainerContentsChanged(ContainerUID);
+	
+	UE_LOG(LogGaia, Log, TEXT("[整理] 容器 %s: %d 个物品，合并掉 %d 个堆叠"),
+		*Container->GetDebugName(), Entries.Num(), EmptiedItemUIDs.Num());
+	return true;
+}
+
+FGaiaConsolidateResult UGaiaInventorySubsystem::ConsolidateStacks(const FGuid& RootContainerUID, bool bIncludeNestedContainers)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaConsolidateResult Result;
+	
+	// 1. 遍历一次容器树：记录各容器剩余体积，按定义收集未满堆叠（广度优先顺序）
+	struct FStackTarget
+	{
+		FGuid ContainerUID;
+		int32 RemainingVolume = MAX_int32;
+	};
+	struct FOpenStack
+	{
+		int32 TargetIndex;
+		FGuid ItemUID;
+	};
+	TArray<FStackTarget> Targets;
+	TMap<FName, TArray<FOpenStack>> OpenStacks;
+	
+	TArray<FGuid> PendingContainers = { RootContainerUID };
+	TSet<FGuid> VisitedContainers;
+	for (int32 QueueIndex = 0; QueueIndex < PendingContainers.Num(); ++QueueIndex)
+	{
+		bool bAlreadyVisited = false;
+		VisitedContainers.Add(PendingContainers[QueueIndex], &bAlreadyVisited);
+		const FGaiaContainerInstance* Container = bAlreadyVisited ? nullptr : Containers.Find(PendingContainers[QueueIndex]);
+		const FGaiaContainerDefinition* ContainerDef = Container ? FindContainerDefinition(Container->ContainerDefinitionID) : nullptr;
+		if (!ContainerDef || HasContainerSlotFilters(Container->ContainerUID))
+		{
+			continue;
+		}
+		
+		const int32 TargetIndex = Targets.AddDefaulted();
+		Targets[TargetIndex].ContainerUID = Container->ContainerUID;
+		if (ContainerDef->bEnableVolumeLimit)
+		{
+			Targets[TargetIndex].RemainingVolume = ContainerDef->MaxVolume - ComputeContainerUsedVolume(*Container, AllItems);
+		}
+		
+		for (const FGaiaSlotInfo& Slot : Container->Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			if (!Item)
+			{
+				continue;
+			}
+			
+			if (bIncludeNestedContainers && Item->HasContainer())
+			{
+				PendingContainers.Add(Item->OwnedContainerUID);
+				continue;
+			}
+			
+			const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID);
+			if (ItemDef && ItemDef->IsStackable() && Item->Quantity < ItemDef->MaxStackSize)
+			{
+				OpenStacks.FindOrAdd(Item->ItemDefinitionID).Add({ TargetIndex, Item->InstanceUID });
+			}
+		}
+	}
+	
+	// 2. 每种定义：前面的堆叠作为目标，从最后一个堆叠往前倒
+	TSet<FGuid> ChangedItems;
+	TSet<FGuid> AffectedContainers;
+	for (const auto& StackPair : OpenStacks)
+	{
+		const TArray<FOpenStack>& Stacks = StackPair.Value;
+		if (Stacks.Num() < 2)
+		{
+			continue;
+		}
+		
+		const FGaiaItemDefinition* ItemDef = FindItemDefinition(StackPair.Key);
+		check(ItemDef);
+		
+		int32 DestIndex = 0;
+		int32 SourceIndex = Stacks.Num() - 1;
+		while (DestIndex < SourceIndex)
+		{
+			FStackTarget& DestTarget = Targets[Stacks[DestIndex].TargetIndex];
+			FStackTarget& SourceTarget = Targets[Stacks[SourceIndex].TargetIndex];
+			FGaiaItemInstance& Dest = AllItems.FindChecked(Stacks[DestIndex].ItemUID);
+			FGaiaItemInstance& Source = AllItems.FindChecked(Stacks[SourceIndex].ItemUID);
+			
+			// 同一容器内转移不改变体积
+			const bool bSameContainer = &DestTarget == &SourceTarget;
+			const int32 VolumeCapacity = bSameContainer || ItemDef->ItemVolume <= 0 ? MAX_int32 : FMath::Max(DestTarget.RemainingVolume, 0) / ItemDef->ItemVolume;
+			const int32 Transfer = FMath::Min3(ItemDef->MaxStackSize - Dest.Quantity, Source.Quantity, VolumeCapacity);
+			if (Transfer <= 0)
+			{
+				++DestIndex;
+				continue;
+			}
+			
+			const int32 OldDestQuantity = Dest.Quantity;
+			const int32 OldSourceQuantity = Source.Quantity;
+			Dest.Quantity += Transfer;
+			Source.Quantity -= Transfer;
+			MergeItemExpiry(Dest, Source);
+			NotifyItemQuantityChanged(Dest, OldDestQuantity);
+			NotifyItemQuantityChanged(Source, OldSourceQuantity);
+			if (!bSameContainer)
+			{
+				DestTarget.RemainingVolume -= Transfer * ItemDef->ItemVolume;
+				SourceTarget.RemainingVolume += Transfer * ItemDef->ItemVolume;
+			}
+			
+			Result.MovedQuantity += Transfer;
+			ChangedItems.Add(Dest.InstanceUID);
+			ChangedItems.Add(Source.InstanceUID);
+			AffectedContainers.Add(DestTarget.ContainerUID);
+			AffectedContainers.Add(SourceTarget.ContainerUID);
+			
+			if (Source.Quantity <= 0)
+			{
+				FGaiaContainerInstance& SourceContainer = Containers.FindChecked(SourceTarget.ContainerUID);
+				const int32 SlotIndex = SourceContainer.GetSlotIndexByID(Source.CurrentSlotID);
+				if (SlotIndex != INDEX_NONE)
+				{
+					SourceContainer.Slots[SlotIndex].ItemInstanceUID = FGuid();
+				}
+				NotifyItemLeftContainer(Source, SourceContainer);
+				
+				const FGuid SourceUID = Source.InstanceUID;
+				RemoveItemRecord(SourceUID);
+				ChangedItems.Remove(SourceUID);
+				Result.DestroyedItemUIDs.Add(SourceUID);
+				--SourceIndex;
+			}
+			if (Dest.Quantity >= ItemDef->MaxStackSize)
+			{
+				++DestIndex;
+			}
+		}
+	}
+	
+	Result.ChangedItemUIDs = ChangedItems.Array();
+	Result.AffectedContainerUIDs = AffectedContainers.Array();
+	
+	UE_LOG(LogGaia, Log, TEXT("[整理] 合并容器树 %s 的堆叠: 转移 %d，删除 %d 个堆叠，涉及 %d 个容器"),
+		*RootContainerUID.ToString(), Result.MovedQuantity, Result.DestroyedItemUIDs.Num(), Result.AffectedContainerUIDs.Num());
+	
+	return Result;
+}
+
+//~END 整理
+
+//~BEGIN 世界容器
+
+FIntVector UGaiaInventorySubsystem::GetWorldContainerCell(const FVector& Location) const
+{
+	const double CellSize = FMath::Max<double>(GetDefault<UGaiaInventoryManagerSettings>()->WorldContainerCellSize, 100.0);
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / CellSize),
+		FMath::FloorToInt32(Location.Y / CellSize),
+		FMath::FloorToInt32(Location.Z / CellSize));
+}
+
+void UGaiaInventorySubsystem::RegisterWorldContainer(const FGuid& ContainerUID, const FVector& Location)
+{
+	if (!ContainerUID.IsValid())
+	{
+		return;
+	}
+	
+	// 重复登记视为移动：先从旧网格移除
+	UnregisterWorldContainer(ContainerUID);
+	
+	WorldContainerLocations.Add(ContainerUID, Location);
+	WorldContainerCells.FindOrAdd(GetWorldContainerCell(Location)).Add(ContainerUID);
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[世界容器] 登记 %s 于 %s"), *ContainerUID.ToString(), *Location.ToString());
+}
+
+void UGaiaInventorySubsystem::UnregisterWorldContainer(const FGuid& ContainerUID)
+{
+	FVector OldLocation;
+	if (!WorldContainerLocations.RemoveAndCopyValue(ContainerUID, OldLocation))
+	{
+		return;
+	}
+	
+	const FIntVector Cell = GetWorldContainerCell(OldLocation);
+	if (TArray<FGuid>* CellContainers = WorldContainerCells.Find(Cell))
+	{
+		CellContainers->RemoveSwap(ContainerUID);
+		if (CellContainers->IsEmpty())
+		{
+			WorldContainerCells.Remove(Cell);
+		}
+	}
+}
+
+void UGaiaInventorySubsystem::FindWorldContainersInRadius(const FVector& Location, float Radius, TArray<FGuid>& OutContainerUIDs) const
+{
+	OutContainerUIDs.Reset();
+	if (Radius <= 0.0f || WorldContainerLocations.IsEmpty())
+	{
+		return;
+	}
+	
+	// 只检查半径包围盒覆盖的网格
+	const FIntVector MinCell = GetWorldContainerCell(Location - FVector(Radius));
+	const FIntVector MaxCell = GetWorldContainerCell(Location + FVector(Radius));
+	const double RadiusSquared = FMath::Square(static_cast<double>(Radius));
+	
+	TArray<TPair<double, FGuid>> Found;
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				const TArray<FGuid>* CellContainers = WorldContainerCells.Find(FIntVector(X, Y, Z));
+				if (!CellContainers)
+				{
+					continue;
+				}
+				
+				for (const FGuid& ContainerUID : *CellContainers)
+				{
+					const double DistSquared = FVector::DistSquared(WorldContainerLocations.FindChecked(ContainerUID), Location);
+					if (DistSquared <= RadiusSquared)
+					{
+						Found.Emplace(DistSquared, ContainerUID);
+					}
+				}
+			}
+		}
+	}
+	
+	Found.Sort([](const TPair<double, FGuid>& A, const TPair<double, FGuid>& B) { return A.Key < B.Key; });
+	
+	OutContainerUIDs.Reserve(Found.Num());
+	for (const TPair<double, FGuid>& Entry : Found)
+	{
+		OutContainerUIDs.Add(Entry.Value);
+	}
+}
+
+FGaiaConsolidateResult UGaiaInventorySubsystem::QuickStackToNearbyContainers(const FGuid& SourceContainerUID, const FVector& Location, float Radius, bool bIncludeNestedContainers)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaConsolidateResult Result;
+	
+	// 1. 遍历一次来源容器树，按定义收集可存入的堆叠（容器物品不存入）
+	TMap<FName, TArray<FGuid>> SourceStacks;
+	TArray<FGuid> PendingContainers = { SourceContainerUID };
+	TSet<FGuid> SourceContainers;
+	for (int32 QueueIndex = 0; QueueIndex < PendingContainers.Num(); ++QueueIndex)
+	{
+		bool bAlreadyVisited = false;
+		SourceContainers.Add(PendingContainers[QueueIndex], &bAlreadyVisited);
+		const FGaiaContainerInstance* Container = bAlreadyVisited ? nullptr : Containers.Find(PendingContainers[QueueIndex]);
+		if (!Container)
+		{
+			continue;
+		}
+		
+		for (const FGaiaSlotInfo& Slot : Container->Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			if (!Item)
+			{
+				continue;
+			}
+			
+			if (Item->HasContainer())
+			{
+				if (bIncludeNestedContainers)
+				{
+					PendingContainers.Add(Item->OwnedContainerUID);
+				}
+				continue;
+			}
+			
+			if (FindItemDefinition(Item->ItemDefinitionID))
+			{
+				SourceStacks.FindOrAdd(Item->ItemDefinitionID).Add(Item->InstanceUID);
+			}
+		}
+	}
+	
+	if (SourceStacks.IsEmpty())
+	{
+		return Result;
+	}
+	
+	// 2. 由近到远处理附近的容器
+	TArray<FGuid> NearbyContainerUIDs;
+	FindWorldContainersInRadius(Location, Radius, NearbyContainerUIDs);
+	
+	TSet<FGuid> ChangedItems;
+	TSet<FGuid> AffectedContainers;
+	for (const FGuid& TargetUID : NearbyContainerUIDs)
+	{
+		FGaiaContainerInstance* Target = SourceContainers.Contains(TargetUID) || HasContainerSlotFilters(TargetUID) ? nullptr : Containers.Find(TargetUID);
+		const FGaiaContainerDefinition* ContainerDef = Target ? FindContainerDefinition(Target->ContainerDefinitionID) : nullptr;
+		if (!ContainerDef)
+		{
+			continue;
+		}
+		
+		if (!Target->HasValidAggregates())
+		{
+			RecalculateLiveContainerAggregates(*Target);
+		}
+		
+		// 通过定义数量索引匹配，目标中没有的定义不需要扫描槽位
+		TArray<FName> MatchedDefinitions;
+		for (const auto& SourcePair : SourceStacks)
+		{
+			if (!SourcePair.Value.IsEmpty() && Target->GetCachedDefinitionCount(SourcePair.Key) > 0)
+			{
+				MatchedDefinitions.Add(SourcePair.Key);
+			}
+		}
+		if (MatchedDefinitions.IsEmpty())
+		{
+			continue;
+		}
+		
+		// 扫描一次目标槽位：匹配定义的未满堆叠和空槽位
+		TMap<FName, TArray<FGuid>> OpenStacks;
+		TArray<int32> EmptySlotIDs;
+		for (const FGaiaSlotInfo& Slot : Target->Slots)
+		{
+			if (Slot.IsEmpty())
+			{
+				EmptySlotIDs.Add(Slot.SlotID);
+				continue;
+			}
+			
+			const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID);
+			const FGaiaItemDefinition* ItemDef = Item && MatchedDefinitions.Contains(Item->ItemDefinitionID) ? FindItemDefinition(Item->ItemDefinitionID) : nullptr;
+			if (ItemDef && ItemDef->IsStackable() && Item->Quantity < ItemDef->MaxStackSize)
+			{
+				OpenStacks.FindOrAdd(Item->ItemDefinitionID).Add(Item->InstanceUID);
+			}
+		}
+		
+		int32 RemainingVolume = ContainerDef->bEnableVolumeLimit ? ContainerDef->MaxVolume - Target->CachedTotalVolume : MAX_int32;
+		int32 NextEmptySlot = 0;
+		
+		for (const FName& ItemDefID : MatchedDefinitions)
+		{
+			const FGaiaItemDefinition* ItemDef = FindItemDefinition(ItemDefID);
+			check(ItemDef);
+			
+			TArray<FGuid>& Stacks = SourceStacks.FindChecked(ItemDefID);
+			TArray<FGuid>& DestStacks = OpenStacks.FindOrAdd(ItemDefID);
+			
+			int32 DestIndex = 0;
+			int32 SourceIndex = 0;
+			while (SourceIndex < Stacks.Num())
+			{
+				FGaiaItemInstance& Source = AllItems.FindChecked(Stacks[SourceIndex]);
+				FGaiaContainerInstance& SourceContainer = Containers.FindChecked(Source.CurrentContainerUID);
+				
+				// 先补满目标中的未满堆叠
+				if (DestIndex < DestStacks.Num())
+				{
+					FGaiaItemInstance& Dest = AllItems.FindChecked(DestStacks[DestIndex]);
+					const int32 VolumeCapacity = ItemDef->ItemVolume <= 0 ? MAX_int32 : FMath::Max(RemainingVolume, 0) / ItemDef->ItemVolume;
+					if (VolumeCapacity <= 0)
+					{
+						break;
+					}
+					
+					const int32 Transfer = FMath::Min3(ItemDef->MaxStackSize - Dest.Quantity, Source.Quantity, VolumeCapacity);
+					if (Transfer <= 0)
+					{
+						++DestIndex;
+						continue;
+					}
+					
+					const int32 OldDestQuantity = Dest.Quantity;
+					const int32 OldSourceQuantity = Source.Quantity;
+					Dest.Quantity += Transfer;
+					Source.Quantity -= Transfer;
+					MergeItemExpiry(Dest, Source);
+					NotifyItemQuantityChanged(Dest, OldDestQuantity);
+					NotifyItemQuantityChanged(Source, OldSourceQuantity);
+					RemainingVolume -= Transfer * ItemDef->ItemVolume;
+					
+					Result.MovedQuantity += Transfer;
+					ChangedItems.Add(Dest.InstanceUID);
+					ChangedItems.Add(Source.InstanceUID);
+					AffectedContainers.Add(TargetUID);
+					AffectedContainers.Add(SourceContainer.ContainerUID);
+					
+					if (Source.Quantity <= 0)
+					{
+						const int32 SlotIndex = SourceContainer.GetSlotIndexByID(Source.CurrentSlotID);
+						if (SlotIndex != INDEX_NONE)
+						{
+							SourceContainer.Slots[SlotIndex].ItemInstanceUID = FGuid();
+						}
+						NotifyItemLeftContainer(Source, SourceContainer);
+						
+						const FGuid SourceUID = Source.InstanceUID;
+						RemoveItemRecord(SourceUID);
+						ChangedItems.Remove(SourceUID);
+						Result.DestroyedItemUIDs.Add(SourceUID);
+						++SourceIndex;
+					}
+					if (Dest.Quantity >= ItemDef->MaxStackSize)
+					{
+						++DestIndex;
+					}
+					continue;
+				}
+				
+				// 没有可补的堆叠，整堆移入空槽位（规则检查包含标签和体积，网格布局按占用位图找位置）
+				bool bRotated = Source.bRotated;
+				const int32 EmptySlotID = ContainerDef->bUseGridLayout
+					? FindPlacementSlot(*Target, *ContainerDef, *ItemDef, Source.bRotated, bRotated)
+					: (NextEmptySlot < EmptySlotIDs.Num() ? EmptySlotIDs[NextEmptySlot] : INDEX_NONE);
+				if (EmptySlotID == INDEX_NONE)
+				{
+					break;
+				}
+				const FAddItemResult CheckResult = CheckAddItemRules(Source, *ItemDef, *Target, *ContainerDef, AllItems, Containers);
+				if (!CheckResult.IsSuccess())
+				{
+					break;
+				}
+				
+				const int32 SlotIndex = SourceContainer.GetSlotIndexByID(Source.CurrentSlotID);
+				if (SlotIndex != INDEX_NONE)
+				{
+					SourceContainer.Slots[SlotIndex].ItemInstanceUID = FGuid();
+				}
+				NotifyItemLeftContainer(Source, SourceContainer);
+				AddItemToContainer(&Source, Target, EmptySlotID, bRotated);
+				if (!ContainerDef->bUseGridLayout)
+				{
+					++NextEmptySlot;
+				}
+				RemainingVolume -= Source.Quantity * ItemDef->ItemVolume;
+				
+				Result.MovedQuantity += Source.Quantity;
+				ChangedItems.Add(Source.InstanceUID);
+				AffectedContainers.Add(TargetUID);
+				AffectedContainers.Add(SourceContainer.ContainerUID);
+				
+				// 移入的堆叠未满时，后面的同定义堆叠继续补到它上面
+				if (ItemDef->IsStackable() && Source.Quantity < ItemDef->MaxStackSize)
+				{
+					DestStacks.Add(Source.InstanceUID);
+				}
+				++SourceIndex;
+			}
+			
+			// 已删除或已移走的来源堆叠不再参与后面的容器
+			Stacks.RemoveAt(0, SourceIndex, EAllowShrinking::No);
+		}
+	}
+	
+	Result.ChangedItemUIDs = ChangedItems.Array();
+	Result.AffectedContainerUIDs = AffectedContainers.Array();
+	
+	UE_LOG(LogGaia, Log, TEXT("[快速堆放] 容器 %s -> 附近 %d 个容器: 转移 %d，删除 %d 个堆叠，涉及 %d 个容器"),
+		*SourceContainerUID.ToString(), NearbyContainerUIDs.Num(), Result.MovedQuantity, Result.DestroyedItemUIDs.Num(), Result.AffectedContainerUIDs.Num());
+	
+	return Result;
+}
+
+//~END 世界容器
+
+//~BEGIN 数量索引
+
+int32 UGaiaInventorySubsystem::GetRootDefinitionCount(const FGuid& RootContainerUID, FName ItemDefID) const
+{
+	const TMap<FName, int32>* RootCounts = RootDefinitionCounts.Find(RootContainerUID);
+	const int32* Count = RootCounts ? RootCounts->Find(ItemDefID) : nullptr;
+	return Count ? *Count : 0;
+}
+
+const TMap<FName, int32>* UGaiaInventorySubsystem::FindRootDefinitionCounts(const FGuid& RootContainerUID) const
+{
+	return RootDefinitionCounts.Find(RootContainerUID);
+}
+
+//~END 数量索引
+
+//~BEGIN 物品寿命
+
+bool UGaiaInventorySubsystem::SetItemLifetime(const FGuid& ItemUID, float LifetimeSeconds)
+{
+	FMutationScope MutationScope(*this);
+	
+	FGaiaItemInstance* Item = AllItems.Find(ItemUID);
+	if (!Item)
+	{
+		return false;
+	}
+	
+	// 旧的时间轮条目不删除，到期时按物品当前的过期时间校验后丢弃
+	Item->ExpireTime = LifetimeSeconds > 0.0f ? GetLifetimeClock() + LifetimeSeconds : 0.0;
+	MarkItemChanged(ItemUID);
+	ScheduleItemExpiry(*Item);
+	return true;
+}
+
+bool UGaiaInventorySubsystem::GetItemRemainingLifetime(const FGuid& ItemUID, float& OutRemainingSeconds) const
+{
+	const FGaiaItemInstance* Item = AllItems.Find(ItemUID);
+	if (!Item || !Item->HasLifetime())
+	{
+		return false;
+	}
+	
+	OutRemainingSeconds = FMath::Max(static_cast<float>(Item->ExpireTime - GetLifetimeClock()), 0.0f);
+	return true;
+}
+
+double UGaiaInventorySubsystem::GetLifetimeClock() const
+{
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		return 0.0;
+	}
+	
+	// 服务器上与 GetTimeSeconds 相同；客户端加上与服务器的时间差
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void UGaiaInventorySubsystem::InitializeItemLifetime(FGaiaItemInstance& Item, const FGaiaItemDefinition& ItemDef) const
+{
+	Item.ExpireTime = ItemDef.LifetimeSeconds > 0.0f ? GetLifetimeClock() + ItemDef.LifetimeSeconds : 0.0;
+}
+
+void UGaiaInventorySubsystem::ScheduleItemExpiry(const FGaiaItemInstance& Item)
+{
+	if (!Item.HasLifetime())
+	{
+		return;
+	}
+	
+	// 空时间轮可能停在很早的刻度上（定时器已停止），先对齐到当前时间
+	if (LifetimeWheel.IsEmpty())
+	{
+		LifetimeWheel.Reset(GetLifetimeTick(GetLifetimeClock(), false));
+	}
+	LifetimeWheel.Schedule(Item.InstanceUID, GetLifetimeTick(Item.ExpireTime, true));
+	
+	UWorld* World = GetWorld();
+	if (World && !World->GetTimerManager().IsTimerActive(LifetimeTimerHandle))
+	{
+		World->GetTimerManager().SetTimer(LifetimeTimerHandle, this, &UGaiaInventorySubsystem::ProcessExpiredItems,
+			static_cast<float>(LifetimeTickInterval), true);
+	}
+}
+
+void UGaiaInventorySubsystem::MergeItemExpiry(FGaiaItemInstance& Dest, const FGaiaItemInstance& Source)
+{
+	if (Source.HasLifetime() && (!Dest.HasLifetime() || Source.ExpireTime < Dest.ExpireTime))
+	{
+		Dest.ExpireTime = Source.ExpireTime;
+		MarkItemChanged(Dest.InstanceUID);
+		ScheduleItemExpiry(Dest);
+	}
+}
+
+void UGaiaInventorySubsystem::RebuildLifetimeWheel()
+{
+	LifetimeWheel.Reset(GetLifetimeTick(GetLifetimeClock(), false));
+	for (const auto& ItemPair : AllItems)
+	{
+		ScheduleItemExpiry(ItemPair.Value);
+	}
+}
+
+void UGaiaInventorySubsystem::ProcessExpiredItems()
+{
+	const double Now = GetLifetimeClock();
+	
+	// 推进的开销只与到期条目数有关，不遍历 AllItems
+	TArray<FGaiaTimerWheel::FEntry> ExpiredEntries;
+	LifetimeWheel.Advance(GetLifetimeTick(Now, false), ExpiredEntries);
+	
+	if (LifetimeWheel.IsEmpty())
+	{
+		if (UWorld* World = GetWorld())
+		{
+			World->GetTimerManager().ClearTimer(LifetimeTimerHandle);
+		}
+	}
+	
+	if (ExpiredEntries.IsEmpty())
+	{
+		return;
+	}
+	
+	TArray<FGuid> DestroyedItemUIDs;
+	TArray<FGuid> TransformedItemUIDs;
+	TArray<FGuid> OrphanedItemUIDs;
+	{
+		// 整批在一个修改作用域内完成：一次日志提交，每个根容器一次数量变化通知
+		FMutationScope MutationScope(*this);
+		
+		for (const FGaiaTimerWheel::FEntry& Entry : ExpiredEntries)
+		{
+			// 已删除、已取消或重新调度到更晚时间的物品留下的条目直接丢弃
+			FGaiaItemInstance* Item = AllItems.Find(Entry.Key);
+			if (!Item || !Item->HasLifetime() || Item->ExpireTime > Now)
+			{
+				continue;
+			}
+			
+			const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID);
+			const FName ExpiredDefID = ItemDef ? ItemDef->ExpiredItemDefinitionID : NAME_None;
+			const FGaiaItemDefinition* ExpiredDef = ExpiredDefID.IsNone() ? nullptr : FindItemDefinition(ExpiredDefID);
+			if (ExpiredDef && TransformExpiredItem(*Item, ExpiredDefID, *ExpiredDef))
+			{
+				TransformedItemUIDs.Add(Entry.Key);
+				continue;
+			}
+			
+			// 只有到期的物品本身被删除，容器中的物品先移出
+			if (Item->HasContainer())
+			{
+				SpillContainedItems(*Item, OrphanedItemUIDs);
+			}
+			if (DestroyItem(Entry.Key))
+			{
+				DestroyedItemUIDs.Add(Entry.Key);
+			}
+		}
+	}
+	
+	if (DestroyedItemUIDs.IsEmpty() && TransformedItemUIDs.IsEmpty())
+	{
+		return;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[物品寿命] 过期 %d 个物品: 删除 %d, 转变 %d (时间轮剩余条目 %d)"),
+		DestroyedItemUIDs.Num() + TransformedItemUIDs.Num(), DestroyedItemUIDs.Num(), TransformedItemUIDs.Num(), LifetimeWheel.Num());
+	UE_CLOG(!OrphanedItemUIDs.IsEmpty(), LogGaia, Warning, TEXT("[物品寿命] 到期容器中的 %d 个物品放不回所在的容器树，成为游离物品"), OrphanedItemUIDs.Num());
+	
+	OnItemsExpired.Broadcast(DestroyedItemUIDs, TransformedItemUIDs);
+	BroadcastContainerUpdate(FGuid());
+}
+
+bool UGaiaInventorySubsystem::TransformExpiredItem(FGaiaItemInstance& Item, FName ExpiredDefID, const FGaiaItemDefinition& ExpiredDef)
+{
+	// 带容器的物品转变后，容器中的物品无处安放
+	if (Item.HasContainer() || ExpiredDef.bHasContainer)
+	{
+		return false;
+	}
+	
+	const bool bRotated = Item.bRotated && ExpiredDef.CanRotateInGrid();
+	FGaiaContainerInstance* Container = Item.IsInContainer() ? Containers.Find(Item.CurrentContainerUID) : nullptr;
+	if (Container)
+	{
+		// 网格容器中新定义的占地必须能放在原位置（不计物品自身）
+		const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container->ContainerDefinitionID);
+		if (ContainerDef && ContainerDef->bUseGridLayout
+			&& !CanPlaceItemAtSlot(*Container, *ContainerDef, ExpiredDef, Item.CurrentSlotID, bRotated, &Item, AllItems))
+		{
+			return false;
+		}
+		NotifyItemLeftContainer(Item, *Container);
+	}
+	
+	Item.ItemDefinitionID = ExpiredDefID;
+	Item.Quantity = FMath::Min(Item.Quantity, ExpiredDef.IsStackable() ? FMath::Max(ExpiredDef.MaxStackSize, 1) : 1);
+	Item.bRotated = bRotated;
+	InitializeItemLifetime(Item, ExpiredDef);
+	ScheduleItemExpiry(Item);
+	
+	if (Container)
+	{
+		NotifyItemEnteredContainer(Item, *Container);
+	}
+	else
+	{
+		MarkItemChanged(Item.InstanceUID);
+	}
+	return true;
+}
+
+void UGaiaInventorySubsystem::SpillContainedItems(const FGaiaItemInstance& ContainerItem, TArray<FGuid>& OutOrphanedItemUIDs)
+{
+	const FGaiaContainerInstance* OwnedContainer = Containers.Find(ContainerItem.OwnedContainerUID);
+	if (!OwnedContainer)
+	{
+		return;
+	}
+	
+	TArray<FGuid> ContainedItemUIDs;
+	for (const FGaiaSlotInfo& Slot : OwnedContainer->Slots)
+	{
+		if (!Slot.IsEmpty())
+		{
+			ContainedItemUIDs.Add(Slot.ItemInstanceUID);
+		}
+	}
+	if (ContainedItemUIDs.IsEmpty())
+	{
+		return;
+	}
+	
+	// 接收的容器树：到期物品所在的整棵树，跳过到期物品自己的子树；只收入存在的容器（OwnedContainerUID 可能已失效）
+	TArray<FGuid> TargetContainerUIDs;
+	const FGaiaContainerInstance* ParentContainer = ContainerItem.IsInContainer() ? Containers.Find(ContainerItem.CurrentContainerUID) : nullptr;
+	if (ParentContainer && Containers.Contains(ParentContainer->GetRootContainerUID()))
+	{
+		TargetContainerUIDs.Add(ParentContainer->GetRootContainerUID());
+		TSet<FGuid> VisitedContainers = { ParentContainer->GetRootContainerUID(), ContainerItem.OwnedContainerUID };
+		for (int32 QueueIndex = 0; QueueIndex < TargetContainerUIDs.Num(); ++QueueIndex)
+		{
+			const FGaiaContainerInstance* Container = Containers.Find(TargetContainerUIDs[QueueIndex]);
+			if (!Container)
+			{
+				continue;
+			}
+			
+			for (const FGaiaSlotInfo& Slot : Container->Slots)
+			{
+				const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+				if (!Item || !Item->HasContainer())
+				{
+					continue;
+				}
+				
+				bool bAlreadyVisited = false;
+				VisitedContainers.Add(Item->OwnedContainerUID, &bAlreadyVisited);
+				if (!bAlreadyVisited && Containers.Contains(Item->OwnedContainerUID))
+				{
+					TargetContainerUIDs.Add(Item->OwnedContainerUID);
+				}
+			}
+		}
+	}
+	
+	for (const FGuid& ItemUID : ContainedItemUIDs)
+	{
+		RemoveItemFromContainer(ItemUID);
+		
+		FGaiaItemInstance* Item = AllItems.Find(ItemUID);
+		bool bPlaced = false;
+		for (const FGuid& ContainerUID : TargetContainerUIDs)
+		{
+			FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+			if (!Item || !Container)
+			{
+				continue;
+			}
+			
+			const FAddItemResult AddResult = CanAddItemToContainer(Item, Container);
+			if (AddResult.IsSuccess() && AddItemToContainer(Item, Container, AddResult.SlotID, AddResult.bRotated))
+			{
+				bPlaced = true;
+				break;
+			}
+		}
+		
+		if (!bPlaced)
+		{
+			OutOrphanedItemUIDs.Add(ItemUID);
+		}
+	}
+}
+
+//~END 物品寿命
+
+//~BEGIN 嵌套检测
+
+bool UGaiaInventorySubsystem::WouldCreateCycle(const FGuid& ItemContainerUID, const FGuid& TargetContainerUID) const
+{
+	return WouldCreateCycle(ItemContainerUID, TargetContainerUID, Containers);
+}
+
+void UGaiaInventorySubsystem::UpdateNestingInfo(FGaiaContainerInstance& Container, const FGaiaContainerInstance* ParentContainer)
+{
+	// 换根时定义数量随容器从旧根移到新根
+	const FGuid OldRootUID = Container.GetRootContainerUID();
+	const FGuid NewRootUID = ParentContainer ? ParentContainer->GetRootContainerUID() : Container.ContainerUID;
+	const FGuid OldParentUID = Container.ParentContainerUID;
+	if (OldRootUID != NewRootUID)
+	{
+		ApplyContainerToRootCounts(Container, -1);
+	}
+	
+	Container.ParentContainerUID = ParentContainer ? ParentContainer->ContainerUID : FGuid();
+	Container.NestingDepth = ParentContainer ? ParentContainer->NestingDepth + 1 : 0;
+	Container.RootContainerUID = ParentContainer ? ParentContainer->GetRootContainerUID() : FGuid();
+	
+	if (OldRootUID != NewRootUID)
+	{
+		ApplyContainerToRootCounts(Container, 1);
+	}
+	
+	// 整棵子树随之移动，深度和根一起更新（代价与子树大小成正比，只在嵌套/取出时发生）
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+		if (FGaiaContainerInstance* NestedContainer = Item && Item->HasContainer() ? Containers.Find(Item->OwnedContainerUID) : nullptr)
+		{
+			UpdateNestingInfo(*NestedContainer, &Container);
+		}
+	}
+	
+	// 子树高度只在父容器变化时更新（向下递归时父容器不变）：旧父链可能降低，新父链可能升高
+	if (OldParentUID != Container.ParentContainerUID)
+	{
+		RefreshNestedHeight(OldParentUID);
+		RefreshNestedHeight(Container.ParentContainerUID);
+	}
+}
+
+void UGaiaInventorySubsystem::RefreshNestedHeight(const FGuid& ContainerUID)
+{
+	FGaiaContainerInstance* Current = ContainerUID.IsValid() ? Containers.Find(ContainerUID) : nullptr;
+	while (Current)
+	{
+		int32 Height = 0;
+		for (const FGaiaSlotInfo& Slot : Current->Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			if (const FGaiaContainerInstance* NestedContainer = Item && Item->HasContainer() ? Containers.Find(Item->OwnedContainerUID) : nullptr)
+			{
+				Height = FMath::Max(Height, NestedContainer->NestedHeight + 1);
+			}
+		}
+		
+		if (Height == Current->NestedHeight)
+		{
+			break;
+		}
+		Current->NestedHeight = Height;
+		Current = Current->ParentContainerUID.IsValid() ? Containers.Find(Current->ParentContainerUID) : nullptr;
+	}
+}
+
+//~END 嵌套检测
+
+//~BEGIN 共享规则
+
+FAddItemResult UGaiaInventorySubsystem::CheckAddItemRules(
+	const FGaiaItemInstance& Item,
+	const FGaiaItemDefinition& ItemDef,
+	const FGaiaContainerInstance& Container,
+	const FGaiaContainerDefinition& ContainerDef,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+{
+	FAddItemResult Result;
+	
+	// 检查物品标签是否允许
+	if (ContainerDef.AllowedItemTags.IsEmpty())
+	{
+		Result.ResultType = EMoveItemResult::TypeMismatch;
+		Result.ErrorMessage = FString::Printf(TEXT("容器没有任何标签 (%s-%s)"),
+			*ContainerDef.ContainerName.ToString(),
+			*Container.GetShortUID());
+		return Result;
+	}
+	bool bHasMatchingTag = false;
+	for (const FGameplayTag& ItemTag : ItemDef.ItemTags)
+	{
+		if (ContainerDef.HasAllowedTag(ItemTag))
+		{
+			bHasMatchingTag = true;
+			break;
+		}
+	}
+	if (!bHasMatchingTag)
+	{
+		Result.ResultType = EMoveItemResult::TypeMismatch;
+		Result.ErrorMessage = FString::Printf(TEXT("物品标签不匹配容器允许的标签 (ItemDefID: %s, 物品标签: %s, 允许标签: %s)"),
+			*Item.ItemDefinitionID.ToString(),
+			*ItemDef.ItemTags.ToStringSimple(),
+			*ContainerDef.AllowedItemTags.ToStringSimple());
+		return Result;
+	}
+	
+	// 如果是容器物品，进行额外检查
+	if (ItemDef.bHasContainer)
+	{
+		// 检查目标容器是否允许嵌套容器
+		if (!ContainerDef.bAllowNestedContainers)
+		{
+			Result.ResultType = EMoveItemResult::ContainerRejected;
+			Result.ErrorMessage = FString::Printf(TEXT("目标容器不允许嵌套 (%s-%s)"),
+				*ContainerDef.ContainerName.ToString(),
+				*Container.ContainerUID.ToString());
+			return Result;
+		}
+		
+		// 检查循环引用
+		if (Item.HasContainer())
+		{
+			if (WouldCreateCycle(Item.OwnedContainerUID, Container.ContainerUID, ContainerMap))
+			{
+				Result.ResultType = EMoveItemResult::CycleDetected;
+				Result.ErrorMessage = FString::Printf(TEXT("会造成容器循环引用 (物品容器UID: %s, 目标容器UID: %s)"),
+					*Item.OwnedContainerUID.ToString(),
+					*Container.ContainerUID.ToString());
+				return Result;
+			}
+			
+			// 检查嵌套深度：物品的容器放入后深度为目标深度+1，其中嵌套的容器随之加深
+			const int32 MaxNestingDepth = GetDefault<UGaiaInventoryManagerSettings>()->MaxNestingDepth;
+			const FGaiaContainerInstance* ItemContainer = MaxNestingDepth > 0 ? ContainerMap.Find(Item.OwnedContainerUID) : nullptr;
+			if (ItemContainer)
+			{
+				const int32 NewDepth = Container.NestingDepth + 1 + ItemContainer->NestedHeight;
+				if (NewDepth > MaxNestingDepth)
+				{
+					Result.ResultType = EMoveItemResult::ContainerRejected;
+					Result.ErrorMessage = FString::Printf(TEXT("超过最大嵌套深度 (放入后: %d, 上限: %d)"),
+						NewDepth,
+						MaxNestingDepth);
+					return Result;
+				}
+			}
+		}
+	}
+	
+	// 检查体积限制
+	if (ContainerDef.bEnableVolumeLimit)
+	{
+		int32 UsedVolume = ComputeContainerUsedVolume(Container, ItemMap);
+		int32 ItemVolume = ItemDef.ItemVolume * Item.Quantity;
+		int32 AvailableVolume = ContainerDef.MaxVolume - UsedVolume;
+		if (UsedVolume + ItemVolume > ContainerDef.MaxVolume)
+		{
+			Result.ResultType = EMoveItemResult::VolumeExceeded;
+			Result.ErrorMessage = FString::Printf(TEXT("容器体积不足 (需要: %d, 剩余: %d, 总容量: %d)"),
+				ItemVolume,
+				AvailableVolume,
+				ContainerDef.MaxVolume);
+			return Result;
+		}
+	}
+	
+	Result.ResultType = EMoveItemResult::Success;
+	return Result;
+}
+
+bool UGaiaInventorySubsystem::WouldCreateCycle(
+	const FGuid& ItemContainerUID,
+	const FGuid& TargetContainerUID,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+{
+	if (!ItemContainerUID.IsValid() || !TargetContainerUID.IsValid())
+	{
+		return false;
+	}
+	
+	// 放入自身
+	if (ItemContainerUID == TargetContainerUID)
+	{
+		return true;
+	}
+	
+	const FGaiaContainerInstance* ItemContainer = ContainerMap.Find(ItemContainerUID);
+	const FGaiaContainerInstance* TargetContainer = ContainerMap.Find(TargetContainerUID);
+	if (!ItemContainer || !TargetContainer)
+	{
+		return false;
+	}
+	
+	// 只有物品容器是目标的祖先才会成环：祖先必定同根且更浅
+	if (TargetContainer->NestingDepth <= ItemContainer->NestingDepth
+		|| TargetContainer->GetRootContainerUID() != ItemContainer->GetRootContainerUID())
+	{
+		return false;
+	}
+	
+	// 向上走深度差那么多步，看是否到达物品容器
+	const FGaiaContainerInstance* Current = TargetContainer;
+	for (int32 Steps = TargetContainer->NestingDepth - ItemContainer->NestingDepth; Steps > 0 && Current; --Steps)
+	{
+		Current = ContainerMap.Find(Current->ParentContainerUID);
+	}
+	
+	return Current == ItemContainer;
+}
+
+int32 UGaiaInventorySubsystem::ComputeContainerUsedVolume(const FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap)
+{
+	// 优先使用增量维护的缓存
+	if (Container.HasValidAggregates())
+	{
+		return Container.CachedTotalVolume;
+	}
+	
+	int32 TotalVolume = 0;
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		if (!Slot.IsEmpty())
+		{
+			if (const FGaiaItemInstance* Item = ItemMap.Find(Slot.ItemInstanceUID))
+			{
+				TotalVolume += GetItemTotalVolume(*Item);
+			}
+		}
+	}
+	return TotalVolume;
+}
+
+void UGaiaInventorySubsystem::BuildDropTargetMap(
+	const FGaiaItemInstance& Item,
+	const TArray<FGuid>& TargetContainerUIDs,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+	TMap<FGuid, FGaiaContainerDropTargets>& OutTargets)
+{
+	OutTargets.Reset();
+	
+	// 定义只查一次，后续所有槽位共用
+	FGaiaItemDefinition ItemDef;
+	if (!GetItemDefinition(Item.ItemDefinitionID, ItemDef))
+	{
+		return;
+	}
+	
+	const FGaiaContainerInstance* SourceContainer = ContainerMap.Find(Item.CurrentContainerUID);
+	FGaiaContainerDefinition SourceContainerDef;
+	const bool bHasSourceDef = SourceContainer && GetContainerDefinition(SourceContainer->ContainerDefinitionID, SourceContainerDef);
+	
+	// 交换时目标物品需要放回源容器，按物品定义缓存结果（同定义的物品规则结果相同，体积除外）
+	TMap<FName, FGaiaItemDefinition> OtherItemDefs;
+	auto FindOtherItemDef = [&OtherItemDefs](FName DefID) -> const FGaiaItemDefinition*
+	{
+		if (const FGaiaItemDefinition* Found = OtherItemDefs.Find(DefID))
+		{
+			return Found;
+		}
+		FGaiaItemDefinition Def;
+		if (!GetItemDefinition(DefID, Def))
+		{
+			return nullptr;
+		}
+		return &OtherItemDefs.Add(DefID, MoveTemp(Def));
+	};
+	
+	for (const FGuid& ContainerUID : TargetContainerUIDs)
+	{
+		const FGaiaContainerInstance* TargetContainer = ContainerMap.Find(ContainerUID);
+		if (!TargetContainer || OutTargets.Contains(ContainerUID))
+		{
+			continue;
+		}
+		
+		FGaiaContainerDropTargets& Targets = OutTargets.Add(ContainerUID);
+		Targets.Slots.SetNum(TargetContainer->Slots.Num());
+		
+		FGaiaContainerDefinition TargetContainerDef;
+		if (!GetContainerDefinition(TargetContainer->ContainerDefinitionID, TargetContainerDef))
+		{
+			for (FGaiaDropTargetInfo& Info : Targets.Slots)
+			{
+				Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidDefinition, TEXT("无法获取容器定义"));
+			}
+			continue;
+		}
+		
+		const bool bSameContainer = (ContainerUID == Item.CurrentContainerUID);
+		
+		// 跨容器放入的规则结果对该容器所有空槽位相同，只计算一次
+		const FAddItemResult AddRules = bSameContainer
+			? FAddItemResult::Success(INDEX_NONE)
+			: CheckAddItemRules(Item, ItemDef, *TargetContainer, TargetContainerDef, ItemMap, ContainerMap);
+		
+		// 网格布局：先标出每个格子被哪个物品覆盖，落在覆盖格子上等同于落在该物品上
+		TArray<FGuid> GridCellItems;
+		if (TargetContainerDef.bUseGridLayout && TargetContainer->Slots.Num() == TargetContainerDef.GetSlotCount())
+		{
+			GridCellItems.SetNum(TargetContainer->Slots.Num());
+			for (const FGaiaSlotInfo& Slot : TargetContainer->Slots)
+			{
+				const FGaiaItemInstance* CellItem = Slot.IsEmpty() ? nullptr : ItemMap.Find(Slot.ItemInstanceUID);
+				const FGaiaItemDefinition* CellItemDef = CellItem ? FindItemDefinition(CellItem->ItemDefinitionID) : nullptr;
+				const FIntPoint Footprint = CellItemDef ? CellItemDef->GetGridFootprint(CellItem->bRotated) : FIntPoint(1, 1);
+				const int32 AnchorX = Slot.SlotID % TargetContainerDef.GridWidth;
+				const int32 AnchorY = Slot.SlotID / TargetContainerDef.GridWidth;
+				for (int32 Y = AnchorY; CellItem && Y < FMath::Min(AnchorY + Footprint.Y, TargetContainerDef.GridHeight); ++Y)
+				{
+					for (int32 X = AnchorX; X < FMath::Min(AnchorX + Footprint.X, TargetContainerDef.GridWidth); ++X)
+					{
+						GridCellItems[Y * TargetContainerDef.GridWidth + X] = CellItem->InstanceUID;
+					}
+				}
+			}
+		}
+		
+		for (int32 SlotIndex = 0; SlotIndex < TargetContainer->Slots.Num(); ++SlotIndex)
+		{
+			const FGaiaSlotInfo& Slot = TargetContainer->Slots[SlotIndex];
+			FGaiaDropTargetInfo& Info = Targets.Slots[SlotIndex];
+			const FGuid SlotItemUID = GridCellItems.IsValidIndex(Slot.SlotID) ? GridCellItems[Slot.SlotID] : Slot.ItemInstanceUID;
+			
+			// 源槽位本身
+			if (SlotItemUID == Item.InstanceUID && (!bSameContainer || Slot.SlotID == Item.CurrentSlotID))
+			{
+				Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidTarget, TEXT("不能拖放到自己"));
+				continue;
+			}
+			
+			// 空槽位（或同容器内自身覆盖的格子）：移动，网格布局还要放得下占地
+			if (!SlotItemUID.IsValid() || SlotItemUID == Item.InstanceUID)
+			{
+				if (!AddRules.IsSuccess())
+				{
+					Info = FGaiaDropTargetInfo(AddRules.ResultType, AddRules.ErrorMessage);
+				}
+				else if (TargetContainerDef.bUseGridLayout
+					&& !CanPlaceItemAtSlot(*TargetContainer, TargetContainerDef, ItemDef, Slot.SlotID, Item.bRotated, bSameContainer ? &Item : nullptr, ItemMap))
+				{
+					Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidTarget, TEXT("目标位置放不下该物品"));
+				}
+				else
+				{
+					Info = FGaiaDropTargetInfo(EGaiaDropOutcome::Move);
+				}
+				continue;
+			}
+			
+			const FGaiaItemInstance* TargetItem = ItemMap.Find(SlotItemUID);
+			if (!TargetItem)
+			{
+				Info = FGaiaDropTargetInfo(EMoveItemResult::Failed, TEXT("目标槽位数据异常：物品不存在"));
+				continue;
+			}
+			
+			// 相同类型：堆叠
+			if (TargetItem->ItemDefinitionID == Item.ItemDefinitionID)
+			{
+				Info = (ItemDef.IsStackable() && TargetItem->Quantity < ItemDef.MaxStackSize)
+					? FGaiaDropTargetInfo(EGaiaDropOutcome::Stack)
+					: FGaiaDropTargetInfo(EMoveItemResult::StackLimitReached, TEXT("目标物品堆叠已满"));
+				continue;
+			}
+			
+			// 跨容器且目标物品有容器：放入嵌套容器（同容器内为交换）
+			if (!bSameContainer && TargetItem->HasContainer())
+			{
+				const FGaiaContainerInstance* NestedContainer = ContainerMap.Find(TargetItem->OwnedContainerUID);
+				FGaiaContainerDefinition NestedContainerDef;
+				if (!NestedContainer || !GetContainerDefinition(NestedContainer->ContainerDefinitionID, NestedContainerDef))
+				{
+					Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidTarget, TEXT("无法找到容器物品的容器"));
+					continue;
+				}
+				
+				const FAddItemResult NestRules = CheckAddItemRules(Item, ItemDef, *NestedContainer, NestedContainerDef, ItemMap, ContainerMap);
+				bool bNestedRotated = false;
+				if (!NestRules.IsSuccess())
+				{
+					Info = FGaiaDropTargetInfo(EMoveItemResult::ContainerRejected, NestRules.ErrorMessage);
+				}
+				else if (FindPlacementSlot(*NestedContainer, NestedContainerDef, ItemDef, Item.bRotated, bNestedRotated) == INDEX_NONE)
+				{
+					Info = FGaiaDropTargetInfo(EMoveItemResult::ContainerFull, TEXT("容器已满"));
+				}
+				else
+				{
+					Info = FGaiaDropTargetInfo(EGaiaDropOutcome::Nest);
+				}
+				continue;
+			}
+			
+			// 其他情况：交换（网格布局下交换后双方都要放得下）
+			if (!CanSwapItemFootprints(Item, *TargetItem, ItemMap, ContainerMap))
+			{
+				Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidTarget, TEXT("交换后网格空间不足"));
+				continue;
+			}
+			
+			if (bSameContainer)
+			{
+				Info = FGaiaDropTargetInfo(EGaiaDropOutcome::Swap);
+				continue;
+			}
+			
+			if (!AddRules.IsSuccess())
+			{
+				Info = FGaiaDropTargetInfo(AddRules.ResultType, AddRules.ErrorMessage);
+				continue;
+			}
+			
+			const FGaiaItemDefinition* TargetItemDef = FindOtherItemDef(TargetItem->ItemDefinitionID);
+			if (!SourceContainer || !bHasSourceDef || !TargetItemDef)
+			{
+				Info = FGaiaDropTargetInfo(EMoveItemResult::InvalidDefinition, TEXT("无法获取物品或容器定义"));
+				continue;
+			}
+			
+			const FAddItemResult SwapBackRules = CheckAddItemRules(*TargetItem, *TargetItemDef, *SourceContainer, SourceContainerDef, ItemMap, ContainerMap);
+			Info = SwapBackRules.IsSuccess()
+				? FGaiaDropTargetInfo(EGaiaDropOutcome::Swap)
+				: FGaiaDropTargetInfo(SwapBackRules.ResultType, SwapBackRules.ErrorMessage);
+		}
+	}
+}
+
+FContainerUIDebugInfo UGaiaInventorySubsystem::BuildContainerDebugInfo(const FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap, bool bIncludeItemList)
+{
+	FContainerUIDebugInfo DebugInfo;
+	DebugInfo.ContainerUID = Container.ContainerUID;
+	
+	// 基础信息
+	DebugInfo.ContainerDefID = Container.ContainerDefinitionID;
+	
+	// 获取容器定义（用于获取限制值）
+	const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container.ContainerDefinitionID);
+	
+	// 统计值：缓存有效时直接使用增量结果，否则在副本上全量重算
+	int32 UsedSlots = Container.CachedUsedSlotCount;
+	int32 TotalWeight = Container.CachedTotalWeight;
+	int32 TotalVolume = Container.CachedTotalVolume;
+	if (!Container.HasValidAggregates())
+	{
+		FGaiaContainerInstance Recalculated = Container;
+		RecalculateContainerAggregates(Recalculated, ItemMap);
+		UsedSlots = Recalculated.CachedUsedSlotCount;
+		TotalWeight = Recalculated.CachedTotalWeight;
+		TotalVolume = Recalculated.CachedTotalVolume;
+	}
+	
+	// 槽位使用情况
+	const int32 MaxSlots = ContainerDef ? ContainerDef->GetSlotCount() : Container.Slots.Num();
+	
+	DebugInfo.SlotUsage = FString::Printf(TEXT("%d / %d (%.1f%%)"),
+		UsedSlots,
+		MaxSlots,
+		MaxSlots > 0 ? (float)UsedSlots / MaxSlots * 100.0f : 0.0f
+	);
+	
+	// 注意：当前项目没有实现MaxWeight限制，只有MaxVolume
+	const int32 MaxVolume = ContainerDef ? ContainerDef->MaxVolume : 0;
+	const bool bVolumeEnabled = ContainerDef && ContainerDef->bEnableVolumeLimit;
+	
+	DebugInfo.WeightInfo = FString::Printf(TEXT("%d (总重量)"), TotalWeight);
+	
+	DebugInfo.VolumeInfo = bVolumeEnabled
+		? FString::Printf(TEXT("%d / %d (%.1f%%)"),
+			TotalVolume,
+			MaxVolume,
+			MaxVolume > 0 ? (float)TotalVolume / MaxVolume * 100.0f : 0.0f
+		)
+		: FString::Printf(TEXT("%d (无限制)"), TotalVolume);
+	
+	// 物品列表（只遍历容器自身的槽位，不扫描全部物品）
+	if (bIncludeItemList)
+	{
+		DebugInfo.ItemList.Reserve(UsedSlots);
+		for (const FGaiaSlotInfo& Slot : Container.Slots)
+		{
+			if (Slot.IsEmpty())
+			{
+				continue;
+			}
+			
+			if (const FGaiaItemInstance* Item = ItemMap.Find(Slot.ItemInstanceUID))
+			{
+				DebugInfo.ItemList.Add(FString::Printf(TEXT("槽位%d: %s x%d (UID: %s)"),
+					Item->CurrentSlotID,
+					*Item->ItemDefinitionID.ToString(),
+					Item->Quantity,
+					*Item->InstanceUID.ToString().Left(8) // 只显示前8位
+				));
+			}
+		}
+	}
+	
+	return DebugInfo;
+}
+
+void UGaiaInventorySubsystem::RecalculateContainerAggregates(FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap)
+{
+	Container.CachedUsedSlotCount = 0;
+	Container.CachedTotalWeight = 0;
+	Container.CachedTotalVolume = 0;
+	Container.CachedDefinitionCounts.Reset();
+	
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		if (Slot.IsEmpty())
+		{
+			continue;
+		}
+		
+		++Container.CachedUsedSlotCount;
+		
+		if (const FGaiaItemInstance* Item = ItemMap.Find(Slot.ItemInstanceUID))
+		{
+			Container.CachedDefinitionCounts.FindOrAdd(Item->ItemDefinitionID) += Item->Quantity;
+			if (const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID))
+			{
+				Container.CachedTotalWeight += ItemDef->ItemWeight * Item->Quantity;
+				Container.CachedTotalVolume += ItemDef->ItemVolume * Item->Quantity;
+			}
+		}
+	}
+	
+	RebuildGridOccupancy(Container, ItemMap);
+	Container.bNeedRecalculate = false;
+}
+
+void UGaiaInventorySubsystem::RebuildGridOccupancy(FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap)
+{
+	const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container.ContainerDefinitionID);
+	if (!ContainerDef || !ContainerDef->bUseGridLayout)
+	{
+		Container.GridRows.Reset();
+		return;
+	}
+	
+	Container.GridRows.Reset();
+	Container.GridRows.SetNumZeroed(ContainerDef->GridHeight);
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : ItemMap.Find(Slot.ItemInstanceUID);
+		if (!Item)
+		{
+			continue;
+		}
+		
+		// 占地超出网格的部分（例如定义尺寸改大后）截掉，只标记网格内的格子
+		const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID);
+		const FIntPoint Footprint = ItemDef ? ItemDef->GetGridFootprint(Item->bRotated) : FIntPoint(1, 1);
+		const int32 X = Slot.SlotID % ContainerDef->GridWidth;
+		const int32 Y = Slot.SlotID / ContainerDef->GridWidth;
+		FGaiaInventoryGrid::MarkArea(Container.GridRows, X, Y, FMath::Min(Footprint.X, ContainerDef->GridWidth - X), Footprint.Y, true);
+	}
+}
+
+int32 UGaiaInventorySubsystem::FindPlacementSlot(
+	const FGaiaContainerInstance& Container,
+	const FGaiaContainerDefinition& ContainerDef,
+	const FGaiaItemDefinition& ItemDef,
+	bool bPreferRotated,
+	bool& bOutRotated)
+{
+	bOutRotated = bPreferRotated;
+	if (!ContainerDef.bUseGridLayout)
+	{
+		return Container.FindEmptySlotID();
+	}
+	
+	for (const bool bRotated : { bPreferRotated, !bPreferRotated })
+	{
+		if (bRotated != bPreferRotated && !ItemDef.CanRotateInGrid())
+		{
+			break;
+		}
+		
+		const FIntPoint Footprint = ItemDef.GetGridFootprint(bRotated);
+		int32 X = 0;
+		int32 Y = 0;
+		if (FGaiaInventoryGrid::FindFreeArea(Container.GridRows, ContainerDef.GridWidth, Footprint.X, Footprint.Y, X, Y))
+		{
+			bOutRotated = bRotated;
+			return Y * ContainerDef.GridWidth + X;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool UGaiaInventorySubsystem::CanPlaceItemAtSlot(
+	const FGaiaContainerInstance& Container,
+	const FGaiaContainerDefinition& ContainerDef,
+	const FGaiaItemDefinition& ItemDef,
+	int32 SlotID,
+	bool bRotated,
+	const FGaiaItemInstance* IgnoredItem,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap)
+{
+	const int32 SlotIndex = Container.GetSlotIndexByID(SlotID);
+	if (SlotIndex == INDEX_NONE)
+	{
+		return false;
+	}
+	
+	const bool bIgnoredInContainer = IgnoredItem && IgnoredItem->CurrentContainerUID == Container.ContainerUID;
+	if (!ContainerDef.bUseGridLayout)
+	{
+		const FGuid& SlotItemUID = Container.Slots[SlotIndex].ItemInstanceUID;
+		return !SlotItemUID.IsValid() || (bIgnoredInContainer && SlotItemUID == IgnoredItem->InstanceUID);
+	}
+	
+	const int32 X = SlotID % ContainerDef.GridWidth;
+	const int32 Y = SlotID / ContainerDef.GridWidth;
+	const FIntPoint Footprint = ItemDef.GetGridFootprint(bRotated);
+	if (!bIgnoredInContainer)
+	{
+		return FGaiaInventoryGrid::IsAreaFree(Container.GridRows, ContainerDef.GridWidth, X, Y, Footprint.X, Footprint.Y);
+	}
+	
+	// 在位图副本上去掉被忽略物品的占地再检查（位图只有网格高度个 uint64）
+	TArray<uint64, TInlineAllocator<FGaiaInventoryGrid::MaxHeight>> Rows(Container.GridRows);
+	const FGaiaItemDefinition* IgnoredItemDef = FindItemDefinition(IgnoredItem->ItemDefinitionID);
+	const FIntPoint IgnoredFootprint = IgnoredItemDef ? IgnoredItemDef->GetGridFootprint(IgnoredItem->bRotated) : FIntPoint(1, 1);
+	const int32 IgnoredX = IgnoredItem->CurrentSlotID % ContainerDef.GridWidth;
+	const int32 IgnoredY = IgnoredItem->CurrentSlotID / ContainerDef.GridWidth;
+	FGaiaInventoryGrid::MarkArea(Rows, IgnoredX, IgnoredY, FMath::Min(IgnoredFootprint.X, ContainerDef.GridWidth - IgnoredX), IgnoredFootprint.Y, false);
+	return FGaiaInventoryGrid::IsAreaFree(Rows, ContainerDef.GridWidth, X, Y, Footprint.X, Footprint.Y);
+}
+
+FGuid UGaiaInventorySubsystem::FindItemCoveringSlot(
+	const FGaiaContainerInstance& Container,
+	const FGaiaContainerDefinition& ContainerDef,
+	int32 SlotID,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap)
+{
+	const int32 SlotIndex = Container.GetSlotIndexByID(SlotID);
+	if (SlotIndex == INDEX_NONE)
+	{
+		return FGuid();
+	}
+	
+	if (!ContainerDef.bUseGridLayout || !Container.Slots[SlotIndex].IsEmpty())
+	{
+		return Container.Slots[SlotIndex].ItemInstanceUID;
+	}
+	
+	// 位图中空闲的格子不需要查找
+	const int32 CellX = SlotID % ContainerDef.GridWidth;
+	const int32 CellY = SlotID / ContainerDef.GridWidth;
+	if (FGaiaInventoryGrid::IsAreaFree(Container.GridRows, ContainerDef.GridWidth, CellX, CellY, 1, 1))
+	{
+		return FGuid();
+	}
+	
+	// 覆盖者的左上角一定在格子的左上方
+	for (const FGaiaSlotInfo& Slot : Container.Slots)
+	{
+		const int32 AnchorX = Slot.SlotID % ContainerDef.GridWidth;
+		const int32 AnchorY = Slot.SlotID / ContainerDef.GridWidth;
+		const FGaiaItemInstance* Item = (Slot.IsEmpty() || AnchorX > CellX || AnchorY > CellY) ? nullptr : ItemMap.Find(Slot.ItemInstanceUID);
+		const FGaiaItemDefinition* ItemDef = Item ? FindItemDefinition(Item->ItemDefinitionID) : nullptr;
+		if (!ItemDef)
+		{
+			continue;
+		}
+		
+		const FIntPoint Footprint = ItemDef->GetGridFootprint(Item->bRotated);
+		if (CellX < AnchorX + Footprint.X && CellY < AnchorY + Footprint.Y)
+		{
+			return Item->InstanceUID;
+		}
+	}
+	return FGuid();
+}
+
+bool UGaiaInventorySubsystem::CanSwapItemFootprints(
+	const FGaiaItemInstance& Item1,
+	const FGaiaItemInstance& Item2,
+	const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+	const TMap<FGuid, FGaiaContainerInstance>& ContainerMap)
+{
+	const FGaiaContainerInstance* Container1 = ContainerMap.Find(Item1.CurrentContainerUID);
+	const FGaiaContainerInstance* Container2 = ContainerMap.Find(Item2.CurrentContainerUID);
+	const FGaiaContainerDefinition* ContainerDef1 = Container1 ? FindContainerDefinition(Container1->ContainerDefinitionID) : nullptr;
+	const FGaiaContainerDefinition* ContainerDef2 = Container2 ? FindContainerDefinition(Container2->ContainerDefinitionID) : nullptr;
+	const bool bGrid1 = ContainerDef1 && ContainerDef1->bUseGridLayout;
+	const bool bGrid2 = ContainerDef2 && ContainerDef2->bUseGridLayout;
+	if (!bGrid1 && !bGrid2)
+	{
+		return true;
+	}
+	
+	const FGaiaItemDefinition* ItemDef1 = FindItemDefinition(Item1.ItemDefinitionID);
+	const FGaiaItemDefinition* ItemDef2 = FindItemDefinition(Item2.ItemDefinitionID);
+	if (!ItemDef1 || !ItemDef2)
+	{
+		return false;
+	}
+	
+	// 同一网格内各自占据对方的位置，占地相同才不会与对方重叠
+	if (Container1 == Container2)
+	{
+		return ItemDef1->GetGridFootprint(Item1.bRotated) == ItemDef2->GetGridFootprint(Item2.bRotated);
+	}
+	
+	return (!bGrid2 || CanPlaceItemAtSlot(*Container2, *ContainerDef2, *ItemDef1, Item2.CurrentSlotID, Item1.bRotated, &Item2, ItemMap))
+		&& (!bGrid1 || CanPlaceItemAtSlot(*Container1, *ContainerDef1, *ItemDef2, Item1.CurrentSlotID, Item2.bRotated, &Item1, ItemMap));
+}
+
+void UGaiaInventorySubsystem::BuildDropTargetMap(const FGuid& ItemUID, const TArray<FGuid>& TargetContainerUIDs, TMap<FGuid, FGaiaContainerDropTargets>& OutTargets) const
+{
+	OutTargets.Reset();
+	
+	if (const FGaiaItemInstance* Item = AllItems.Find(ItemUID))
+	{
+		BuildDropTargetMap(*Item, TargetContainerUIDs, AllItems, Containers, OutTargets);
+	}
+}
+
+//~END 共享规则
+
+//~BEGIN 体积/重量计算
+
+int32 UGaiaInventorySubsystem::GetItemTotalVolume(const FGaiaItemInstance& Item)
+{
+	FGaiaItemDefinition ItemDef;
+	if (!GetItemDefinition(Item.ItemDefinitionID, ItemDef))
+	{
+		return 0;
+	}
+	return ItemDef.ItemVolume * Item.Quantity;
+}
+
+int32 UGaiaInventorySubsystem::GetItemTotalWeight(const FGaiaItemInstance& Item) const
+{
+	FGaiaItemDefinition ItemDef;
+	if (!GetItemDefinition(Item.ItemDefinitionID, ItemDef))
+	{
+		return 0;
+	}
+	
+	int32 BaseWeight = ItemDef.ItemWeight * Item.Quantity;
+	
 	// 如果物品有容器，递归计算内容物重量
 	if (Item.HasContainer())
 	{
-		int32 ContainerWeight = GetContainerUsedWeight(Item.OwnedContainerUID);
-		BaseWeight += ContainerWeight;
+		int32 ContainerWeight = GetContainerUsedWeight(Item.OwnedContainerUID);
+		BaseWeight += ContainerWeight;
+	}
+	
+	return BaseWeight;
+}
+
+int32 UGaiaInventorySubsystem::GetContainerUsedVolume(const FGuid& ContainerUID) const
+{
+	const FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+	if (!Container)
+	{
+		return 0;
+	}
+	
+	// 缓存有效时直接返回增量维护的结果
+	return ComputeContainerUsedVolume(*Container, AllItems);
+}
+
+int32 UGaiaInventorySubsystem::GetContainerUsedWeight(const FGuid& ContainerUID) const
+{
+	const FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+	if (!Container)
+	{
+		return 0;
+	}
+	
+	// 缓存有效时直接内容物的重量已知，只需累加嵌套容器的内容物
+	if (Container->HasValidAggregates())
+	{
+		int32 TotalWeight = Container->CachedTotalWeight;
+		for (const FGaiaSlotInfo& Slot : Container->Slots)
+		{
+			if (!Slot.IsEmpty())
+			{
+				const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID);
+				if (Item && Item->HasContainer())
+				{
+					TotalWeight += GetContainerUsedWeight(Item->OwnedContainerUID);
+				}
+			}
+		}
+		return TotalWeight;
+	}
+	
+	// 遍历容器中的所有槽位，计算物品总重量
+	int32 TotalWeight = 0;
+	for (const FGaiaSlotInfo& Slot : Container->Slots)
+	{
+		if (!Slot.IsEmpty())
+		{
+			if (const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID))
+			{
+				TotalWeight += GetItemTotalWeight(*Item);
+			}
+		}
+	}
+	
+	return TotalWeight;
+}
+
+//~END 体积/重量计算
+
+//~BEGIN 物品移动
+
+FMoveItemResult UGaiaInventorySubsystem::TryMoveItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 TargetSlotID, int32 Quantity)
+{
+	FMutationScope MutationScope(*this);
+	
+	FMoveItemResult Result;
+	
+	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 开始移动物品: ItemUID=%s, TargetContainer=%s, TargetSlot=%d, Quantity=%d"), 
+		*ItemUID.ToString(), *TargetContainerUID.ToString(), TargetSlotID, Quantity);
+	
+	// 检查源物品是否存在
+	FGaiaItemInstance* SourceItem = AllItems.Find(ItemUID);
+	if (!SourceItem)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("无法找到源物品 (ItemUID: %s)"), *ItemUID.ToString());
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到源物品: %s (数量: %d)"), 
+		*SourceItem->ItemDefinitionID.ToString(), SourceItem->Quantity);
+	
+	// 检查目标容器是否存在
+	FGaiaContainerInstance* TargetContainer = Containers.Find(TargetContainerUID);
+	if (!TargetContainer)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("无法找到目标容器 (ContainerUID: %s)"), *TargetContainerUID.ToString());
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到目标容器: %s (槽位数: %d)"), 
+		*TargetContainer->ContainerDefinitionID.ToString(), TargetContainer->Slots.Num());
+	
+	// 设置默认数量（移动全部）
+	if (Quantity <= 0)
+	{
+		Quantity = SourceItem->Quantity;
+		UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 设置移动数量为全部: %d"), Quantity);
+	}
+	
+	// 检查数量是否有效
+	if (Quantity > SourceItem->Quantity)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("移动数量 (%d) 超过源物品数量 (%d)"), Quantity, SourceItem->Quantity);
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 移动数量验证通过: %d"), Quantity);
+	
+	// 检查源物品是否在容器中
+	if (!SourceItem->IsInContainer())
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("源物品不在任何容器中 (ItemUID: %s)"), *ItemUID.ToString());
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Error, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到源物品位置: Container=%s, SlotID=%d"), 
+		*SourceItem->CurrentContainerUID.ToString(), SourceItem->CurrentSlotID);
+	
+	// 装备容器的逐槽位限制（自动分配槽位时在这里选定接受该物品的空槽位）
+	if (!CheckSlotFiltersForMove(*SourceItem, *TargetContainer, TargetSlotID, Quantity, Result))
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	// 执行移动（传递指针，避免重复查找）
+	return MoveItem(SourceItem, TargetContainer, TargetSlotID, Quantity);
+}
+
+FMoveItemResult UGaiaInventorySubsystem::MoveItem(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item);
+	check(TargetContainer);
+	check(Item->IsInContainer());
+	check(Quantity > 0 && Quantity <= Item->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 获取源容器
+	FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID);
+	if (!SourceContainer)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("无法找到源容器 (ContainerUID: %s)"), *Item->CurrentContainerUID.ToString());
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Error, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	// 如果是同一个容器内的移动，需要特殊处理
+	if (Item->CurrentContainerUID == TargetContainer->ContainerUID)
+	{
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 执行容器内移动"));
+		return MoveItemWithinContainer(Item, TargetSlotID, Quantity);
+	}
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 执行跨容器移动: %s -> %s"), 
+		*Item->CurrentContainerUID.ToString(), *TargetContainer->ContainerUID.ToString());
+	
+	// 检查目标槽位
+	if (TargetSlotID >= 0)
+	{
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 指定目标槽位: %d"), TargetSlotID);
+		
+		// 指定槽位移动
+		int32 TargetSlotIndex = TargetContainer->GetSlotIndexByID(TargetSlotID);
+		if (TargetSlotIndex == INDEX_NONE)
+		{
+			Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效 (SlotID: %d)"), TargetSlotID);
+			Result.Result = EMoveItemResult::InvalidTarget;
+			UE_LOG(LogGaia, Warning, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
+			return Result;
+		}
+		
+		// 网格布局中落点可能被左上角在别处的物品覆盖，此时按该物品处理（堆叠/放入容器/交换）
+		const FGaiaContainerDefinition* TargetContainerDef = FindContainerDefinition(TargetContainer->ContainerDefinitionID);
+		const FGuid TargetItemUID = TargetContainerDef
+			? FindItemCoveringSlot(*TargetContainer, *TargetContainerDef, TargetSlotID, AllItems)
+			: TargetContainer->Slots[TargetSlotIndex].ItemInstanceUID;
+		
+		if (!TargetItemUID.IsValid())
+		{
+			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 目标槽位为空，执行直接移动"));
+			return MoveToEmptySlot(Item, TargetContainer, TargetSlotID, Quantity, Item->bRotated);
+		}
+		else
+		{
+			// 目标槽位有物品，需要处理
+			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 目标槽位有物品: %s"), *TargetItemUID.ToString());
+			
+			FGaiaItemInstance* TargetItem = AllItems.Find(TargetItemUID);
+			if (!TargetItem)
+			{
+				Result.ErrorMessage = FString::Printf(TEXT("无法找到目标槽位中的物品 (ItemUID: %s)"), *TargetItemUID.ToString());
+				Result.Result = EMoveItemResult::Failed;
+				UE_LOG(LogGaia, Error, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
+				return Result;
+			}
+			
+			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 找到目标物品: %s (数量: %d)"), 
+				*TargetItem->ItemDefinitionID.ToString(), TargetItem->Quantity);
+			
+			return ProcessTargetSlotWithItem(Item, TargetItem, TargetContainer, TargetItem->CurrentSlotID, Quantity);
+		}
+	}
+	else
+	{
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 自动分配槽位移动"));
+		return MoveItemAutoSlot(Item, TargetContainer, Quantity);
+	}
+}
+
+FMoveItemResult UGaiaInventorySubsystem::QuickMoveItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 TargetSlotID)
+{
+	return TryMoveItem(ItemUID, TargetContainerUID, TargetSlotID, -1); // -1 表示移动全部
+}
+
+FMoveItemResult UGaiaInventorySubsystem::SplitItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 Quantity, int32 TargetSlotID)
+{
+	if (Quantity <= 0)
+	{
+		FMoveItemResult Result;
+		Result.ErrorMessage = TEXT("拆分数量必须大于0");
+		Result.Result = EMoveItemResult::Failed;
+		return Result;
+	}
+	
+	return TryMoveItem(ItemUID, TargetContainerUID, TargetSlotID, Quantity);
+}
+
+//~END 物品移动
+
+//~BEGIN 移动辅助函数
+
+FMoveItemResult UGaiaInventorySubsystem::StackItems(FGaiaItemInstance* SourceItem, FGaiaItemInstance* TargetItem, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(SourceItem);
+	check(TargetItem);
+	check(Quantity > 0);
+	check(Quantity <= SourceItem->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 获取物品定义（用于获取堆叠上限）
+	FGaiaItemDefinition ItemDef;
+	if (!GetItemDefinition(SourceItem->ItemDefinitionID, ItemDef))
+	{
+		Result.ErrorMessage = TEXT("无法获取物品定义");
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Error, TEXT("[StackItems] 无法获取物品定义 - %s"), *SourceItem->ItemDefinitionID.ToString());
+		return Result;
+	}
+	
+	// 计算可堆叠的数量
+	int32 AvailableSpace = ItemDef.MaxStackSize - TargetItem->Quantity;
+	int32 StackQuantity = FMath::Min(Quantity, AvailableSpace);
+	
+	if (StackQuantity <= 0)
+	{
+		Result.ErrorMessage = TEXT("目标物品堆叠已满");
+		Result.Result = EMoveItemResult::StackLimitReached;
+		UE_LOG(LogGaia, Warning, TEXT("[StackItems] 目标物品堆叠已满 - 当前数量: %d, 最大堆叠: %d"), 
+			TargetItem->Quantity, ItemDef.MaxStackSize);
+		return Result;
+	}
+	
+	// 更新目标物品数量
+	int32 OldTargetQuantity = TargetItem->Quantity;
+	TargetItem->Quantity += StackQuantity;
+	MergeItemExpiry(*TargetItem, *SourceItem);
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[StackItems] 更新目标物品数量: %d -> %d"), 
+		OldTargetQuantity, TargetItem->Quantity);
+	
+	// 更新源物品数量
+	int32 OldSourceQuantity = SourceItem->Quantity;
+	SourceItem->Quantity -= StackQuantity;
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[StackItems] 更新源物品数量: %d -> %d"), 
+		OldSourceQuantity, SourceItem->Quantity);
+	
+	// 更新目标容器统计
+	NotifyItemQuantityChanged(*TargetItem, OldTargetQuantity);
+	
+	// 如果源物品数量为0，删除源物品
+	if (SourceItem->Quantity <= 0)
+	{
+		// 先记录UID，DestroyItem 之后 SourceItem 指针失效
+		const FGuid SourceItemUID = SourceItem->InstanceUID;
+		
+		UE_LOG(LogGaia, Log, TEXT("[StackItems] 源物品数量为0，准备删除: UID=%s, 容器=%s, 槽位=%d"), 
+			*SourceItemUID.ToString(), 
+			*SourceItem->CurrentContainerUID.ToString(), 
+			SourceItem->CurrentSlotID);
+		
+		// 恢复原数量再删除，离开容器时按原数量扣减统计
+		SourceItem->Quantity = OldSourceQuantity;
+		DestroyItem(SourceItemUID);
+		
+		UE_LOG(LogGaia, Log, TEXT("[StackItems] 源物品已删除: UID=%s"), *SourceItemUID.ToString());
+	}
+	else
+	{
+		// 更新源容器统计
+		NotifyItemQuantityChanged(*SourceItem, OldSourceQuantity);
+	}
+	
+	// 设置结果
+	Result.Result = (StackQuantity == Quantity) ? EMoveItemResult::Success : EMoveItemResult::PartialSuccess;
+	Result.MovedQuantity = StackQuantity;
+	Result.RemainingQuantity = Quantity - StackQuantity;
+	Result.TargetContainerUID = TargetItem->CurrentContainerUID;
+	
+	UE_LOG(LogGaia, Log, TEXT("[StackItems] 堆叠完成: 移动了 %d 个物品（请求 %d）"), 
+		StackQuantity, Quantity);
+	
+	return Result;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::MoveToItemContainer(FGaiaItemInstance* Item, FGaiaItemInstance* ContainerItem, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item);
+	check(ContainerItem);
+	check(ContainerItem->HasContainer());
+	check(Quantity > 0 && Quantity <= Item->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 获取容器物品的容器
+	FGaiaContainerInstance* TargetContainer = Containers.Find(ContainerItem->OwnedContainerUID);
+	if (!TargetContainer)
+	{
+		Result.ErrorMessage = TEXT("无法找到容器物品的容器");
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Error, TEXT("[MoveToItemContainer] 容器物品的容器不存在: %s"), *ContainerItem->OwnedContainerUID.ToString());
+		return Result;
+	}
+	
+	// 检查放入规则并找到空槽位（与拖放预计算使用相同规则）
+	const FAddItemResult AddResult = CanAddItemToContainer(Item, TargetContainer);
+	if (!AddResult.IsSuccess())
+	{
+		Result.ErrorMessage = AddResult.ErrorMessage;
+		Result.Result = AddResult.ResultType;
+		UE_LOG(LogGaia, Warning, TEXT("[MoveToItemContainer] 无法放入: %s"), *AddResult.ErrorMessage);
+		return Result;
+	}
+	const int32 EmptySlotID = AddResult.SlotID;
+	
+	// 先从源容器移除槽位引用
+	if (Item->IsInContainer())
+	{
+		if (FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID))
+		{
+			int32 SlotIndex = SourceContainer->GetSlotIndexByID(Item->CurrentSlotID);
+			if (SlotIndex != INDEX_NONE)
+			{
+				SourceContainer->Slots[SlotIndex].ItemInstanceUID = FGuid();
+				NotifyItemLeftContainer(*Item, *SourceContainer);
+				UE_LOG(LogGaia, Verbose, TEXT("[MoveToItemContainer] 清空源槽位引用: 容器=%s, 槽位=%d"),
+					*Item->CurrentContainerUID.ToString(), Item->CurrentSlotID);
+			}
+		}
+	}
+	
+	// 添加物品到目标容器
+	if (AddItemToContainer(Item, TargetContainer, EmptySlotID, AddResult.bRotated))
+	{
+		Result.Result = EMoveItemResult::Success;
+		Result.MovedQuantity = Quantity;
+		Result.RemainingQuantity = 0;
+		Result.bMovedToContainer = true;
+		Result.TargetContainerUID = ContainerItem->OwnedContainerUID;
+		UE_LOG(LogGaia, Log, TEXT("[MoveToItemContainer] 成功将物品放入容器物品的容器 (数量: %d)"), Quantity);
+		return Result;
+	}
+	
+	Result.ErrorMessage = TEXT("添加物品到容器失败");
+	Result.Result = EMoveItemResult::Failed;
+	UE_LOG(LogGaia, Error, TEXT("[MoveToItemContainer] 添加物品到容器失败"));
+	return Result;
+}
+
+bool UGaiaInventorySubsystem::SwapItems(FGaiaItemInstance* Item1, FGaiaItemInstance* Item2)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item1);
+	check(Item2);
+	check(Item1->IsInContainer());
+	check(Item2->IsInContainer());
+	
+	// 获取原始位置
+	FGuid Container1UID = Item1->CurrentContainerUID;
+	int32 Slot1ID = Item1->CurrentSlotID;
+	FGuid Container2UID = Item2->CurrentContainerUID;
+	int32 Slot2ID = Item2->CurrentSlotID;
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] 交换物品位置: Item1在容器%s槽位%d <-> Item2在容器%s槽位%d"), 
+		*Container1UID.ToString(), Slot1ID,
+		*Container2UID.ToString(), Slot2ID);
+	
+	// 获取容器
+	FGaiaContainerInstance* Container1 = Containers.Find(Container1UID);
+	FGaiaContainerInstance* Container2 = Containers.Find(Container2UID);
+	
+	if (!Container1 || !Container2)
+	{
+		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到容器"));
+		return false;
+	}
+	
+	// 交换物品的位置信息
+	Item1->CurrentContainerUID = Container2UID;
+	Item1->CurrentSlotID = Slot2ID;
+	Item2->CurrentContainerUID = Container1UID;
+	Item2->CurrentSlotID = Slot1ID;
+	
+	// 交换槽位引用
+	int32 SlotIndex1 = Container1->GetSlotIndexByID(Slot1ID);
+	int32 SlotIndex2 = Container2->GetSlotIndexByID(Slot2ID);
+	
+	if (SlotIndex1 != INDEX_NONE)
+	{
+		Container1->Slots[SlotIndex1].ItemInstanceUID = Item2->InstanceUID;
+		UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] Container1槽位%d更新: %s -> %s"), 
+			Slot1ID, *Item1->InstanceUID.ToString(), *Item2->InstanceUID.ToString());
+	}
+	else
+	{
+		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到Container1的槽位索引，SlotID: %d"), Slot1ID);
+		return false;
+	}
+	
+	if (SlotIndex2 != INDEX_NONE)
+	{
+		Container2->Slots[SlotIndex2].ItemInstanceUID = Item1->InstanceUID;
+		UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] Container2槽位%d更新: %s -> %s"), 
+			Slot2ID, *Item2->InstanceUID.ToString(), *Item1->InstanceUID.ToString());
+	}
+	else
+	{
+		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到Container2的槽位索引，SlotID: %d"), Slot2ID);
+		return false;
+	}
+	
+	// 更新容器统计和嵌套信息（同容器交换时增减相互抵消，只递增修订号）
+	NotifyItemLeftContainer(*Item1, *Container1);
+	NotifyItemLeftContainer(*Item2, *Container2);
+	NotifyItemEnteredContainer(*Item1, *Container2);
+	NotifyItemEnteredContainer(*Item2, *Container1);
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] 交换成功: %s <-> %s"), 
+		*Item1->InstanceUID.ToString(), *Item2->InstanceUID.ToString());
+	
+	return true;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::CanSwapItems(FGaiaItemInstance* Item1, FGaiaItemInstance* Item2) const
+{
+	check(Item1);
+	check(Item2);
+	
+	FMoveItemResult Result;
+	
+	// 检查是否都在容器中
+	if (!Item1->IsInContainer() || !Item2->IsInContainer())
+	{
+		Result.Result = EMoveItemResult::Failed;
+		Result.ErrorMessage = FString::Printf(TEXT("物品不在容器中 (Item1在容器: %s, Item2在容器: %s)"),
+			Item1->IsInContainer() ? TEXT("是") : TEXT("否"),
+			Item2->IsInContainer() ? TEXT("是") : TEXT("否"));
+		return Result;
+	}
+	
+	// 网格布局下交换后双方都要放得下
+	if (!CanSwapItemFootprints(*Item1, *Item2, AllItems, Containers))
+	{
+		Result.Result = EMoveItemResult::InvalidTarget;
+		Result.ErrorMessage = TEXT("交换后网格空间不足");
+		return Result;
+	}
+	
+	// 如果在同一个容器中，直接允许交换（同容器内交换不会造成循环）
+	if (Item1->CurrentContainerUID == Item2->CurrentContainerUID)
+	{
+		Result.Result = EMoveItemResult::Success;
+		return Result;
+	}
+	
+	// 跨容器交换，需要检查是否可以添加到对方的容器
+	const FGaiaContainerInstance* Container1 = Containers.Find(Item1->CurrentContainerUID);
+	const FGaiaContainerInstance* Container2 = Containers.Find(Item2->CurrentContainerUID);
+	
+	if (!Container1 || !Container2)
+	{
+		Result.Result = EMoveItemResult::InvalidTarget;
+		Result.ErrorMessage = FString::Printf(TEXT("无法找到容器 (Container1: %s, Container2: %s)"),
+			Container1 ? TEXT("存在") : TEXT("不存在"),
+			Container2 ? TEXT("存在") : TEXT("不存在"));
+		return Result;
+	}
+	
+	// 检查双方是否可以放入对方的容器（交换会腾出槽位，因此只检查规则，不要求空槽位）
+	FGaiaItemDefinition ItemDef1;
+	FGaiaItemDefinition ItemDef2;
+	FGaiaContainerDefinition ContainerDef1;
+	FGaiaContainerDefinition ContainerDef2;
+	if (!GetItemDefinition(Item1->ItemDefinitionID, ItemDef1) || !GetItemDefinition(Item2->ItemDefinitionID, ItemDef2)
+		|| !GetContainerDefinition(Container1->ContainerDefinitionID, ContainerDef1)
+		|| !GetContainerDefinition(Container2->ContainerDefinitionID, ContainerDef2))
+	{
+		Result.Result = EMoveItemResult::InvalidDefinition;
+		Result.ErrorMessage = TEXT("无法获取物品或容器定义");
+		return Result;
+	}
+	
+	// 检查 Item1 是否可以放入 Container2
+	FAddItemResult CanAdd1To2 = CheckAddItemRules(*Item1, ItemDef1, *Container2, ContainerDef2, AllItems, Containers);
+	if (!CanAdd1To2.IsSuccess())
+	{
+		Result.Result = EMoveItemResult::Failed;
+		Result.ErrorMessage = FString::Printf(TEXT("Item1无法放入Container2: %s"), *CanAdd1To2.ErrorMessage);
+		return Result;
+	}
+	
+	// 检查 Item2 是否可以放入 Container1
+	FAddItemResult CanAdd2To1 = CheckAddItemRules(*Item2, ItemDef2, *Container1, ContainerDef1, AllItems, Containers);
+	if (!CanAdd2To1.IsSuccess())
+	{
+		Result.Result = EMoveItemResult::Failed;
+		Result.ErrorMessage = FString::Printf(TEXT("Item2无法放入Container1: %s"), *CanAdd2To1.ErrorMessage);
+		return Result;
+	}
+	
+	Result.Result = EMoveItemResult::Success;
+	return Result;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::MoveToEmptySlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity, bool bRotated)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item);
+	check(TargetContainer);
+	check(TargetSlotID >= 0);
+	check(Quantity > 0 && Quantity <= Item->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 找到目标槽位
+	int32 TargetSlotIndex = TargetContainer->GetSlotIndexByID(TargetSlotID);
+	if (TargetSlotIndex == INDEX_NONE)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效 (SlotID: %d)"), TargetSlotID);
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Error, TEXT("[MoveToEmptySlot] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	// 如果是部分移动，创建新物品实例
+	bool bIsPartialMove = (Quantity < Item->Quantity);
+	
+	// 网格布局：占地必须在网格内且空闲（整体移动时不计物品自身的原位置）
+	const FGaiaContainerDefinition* TargetContainerDef = FindContainerDefinition(TargetContainer->ContainerDefinitionID);
+	if (TargetContainerDef && TargetContainerDef->bUseGridLayout)
+	{
+		const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID);
+		const FGaiaItemInstance* IgnoredItem = bIsPartialMove ? nullptr : Item;
+		if (!ItemDef || !CanPlaceItemAtSlot(*TargetContainer, *TargetContainerDef, *ItemDef, TargetSlotID, bRotated, IgnoredItem, AllItems))
+		{
+			Result.ErrorMessage = FString::Printf(TEXT("目标位置放不下该物品 (SlotID: %d)"), TargetSlotID);
+			Result.Result = EMoveItemResult::InvalidTarget;
+			UE_LOG(LogGaia, Warning, TEXT("[MoveToEmptySlot] %s"), *Result.ErrorMessage);
+			return Result;
+		}
+	}
+	
+	if (bIsPartialMove)
+	{
+		// 部分移动：先减少源物品数量（AllItems.Add 可能导致重新分配，之后 Item 指针失效）
+		const FGuid SourceItemUID = Item->InstanceUID;
+		const int32 OldSourceQuantity = Item->Quantity;
+		Item->Quantity -= Quantity;
+		NotifyItemQuantityChanged(*Item, OldSourceQuantity);
+		
+		// 创建新物品
+		FGaiaItemInstance NewItem = *Item;
+		NewItem.InstanceUID = AllocateUID();
+		NewItem.Quantity = Quantity;
+		NewItem.CurrentContainerUID = TargetContainer->ContainerUID;
+		NewItem.CurrentSlotID = TargetSlotID;
+		NewItem.bRotated = bRotated;
+		
+		// 添加新物品到AllItems
+		const FGaiaItemInstance& AddedItem = AllItems.Add(NewItem.InstanceUID, NewItem);
+		ScheduleItemExpiry(AddedItem);
+		
+		// 更新目标槽位引用
+		TargetContainer->Slots[TargetSlotIndex].ItemInstanceUID = AddedItem.InstanceUID;
+		NotifyItemEnteredContainer(AddedItem, *TargetContainer);
+		
+		Item = AllItems.Find(SourceItemUID);
+		check(Item);
+		
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveToEmptySlot] 部分移动: 原UID=%s (剩余%d), 新UID=%s (移动%d)"), 
+			*Item->InstanceUID.ToString(), Item->Quantity, *NewItem.InstanceUID.ToString(), Quantity);
+	}
+	else
+	{
+		// 完全移动：直接更新物品位置
+		// 先从源容器移除
+		if (Item->IsInContainer())
+		{
+			if (FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID))
+			{
+				int32 SourceSlotIndex = SourceContainer->GetSlotIndexByID(Item->CurrentSlotID);
+				if (SourceSlotIndex != INDEX_NONE)
+				{
+					SourceContainer->Slots[SourceSlotIndex].ItemInstanceUID = FGuid();
+				}
+				NotifyItemLeftContainer(*Item, *SourceContainer);
+			}
+		}
+		
+		// 更新物品位置
+		Item->CurrentContainerUID = TargetContainer->ContainerUID;
+		Item->CurrentSlotID = TargetSlotID;
+		Item->bRotated = bRotated;
+		
+		// 更新目标槽位引用
+		TargetContainer->Slots[TargetSlotIndex].ItemInstanceUID = Item->InstanceUID;
+		NotifyItemEnteredContainer(*Item, *TargetContainer);
+		
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveToEmptySlot] 完全移动: UID=%s, 数量=%d"), 
+			*Item->InstanceUID.ToString(), Quantity);
+	}
+	
+	Result.Result = EMoveItemResult::Success;
+	Result.MovedQuantity = Quantity;
+	Result.RemainingQuantity = bIsPartialMove ? Item->Quantity : 0;
+	Result.TargetContainerUID = TargetContainer->ContainerUID;
+	
+	return Result;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::MoveItemWithinContainer(FGaiaItemInstance* Item, int32 TargetSlotID, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item);
+	check(Item->IsInContainer());
+	check(TargetSlotID >= 0);
+	check(Quantity > 0 && Quantity <= Item->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 获取容器
+	FGaiaContainerInstance* Container = Containers.Find(Item->CurrentContainerUID);
+	if (!Container)
+	{
+		Result.ErrorMessage = TEXT("无法找到容器");
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] 无法找到容器: %s"), *Item->CurrentContainerUID.ToString());
+		return Result;
+	}
+	
+	// 获取目标槽位
+	int32 TargetSlotIndex = Container->GetSlotIndexByID(TargetSlotID);
+	if (TargetSlotIndex == INDEX_NONE)
+	{
+		Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效: %d"), TargetSlotID);
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	
+	// 网格布局中落点可能被其他物品覆盖（按该物品处理），也可能被物品自身覆盖（平移，按空位处理）
+	const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container->ContainerDefinitionID);
+	const FGuid TargetItemUID = ContainerDef
+		? FindItemCoveringSlot(*Container, *ContainerDef, TargetSlotID, AllItems)
+		: Container->Slots[TargetSlotIndex].ItemInstanceUID;
+	
+	if (!TargetItemUID.IsValid() || (TargetItemUID == Item->InstanceUID && TargetSlotID != Item->CurrentSlotID))
+	{
+		// 目标槽位为空，调用 MoveToEmptySlot 处理
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveItemWithinContainer] 目标槽位为空，调用 MoveToEmptySlot"));
+		return MoveToEmptySlot(Item, Container, TargetSlotID, Quantity, Item->bRotated);
+	}
+	
+	// 目标槽位有物品，需要处理
+	if (FGaiaItemInstance* TargetItem = AllItems.Find(TargetItemUID))
+	{
+		// 检查是否为相同类型（尝试堆叠）
+		if (Item->ItemDefinitionID == TargetItem->ItemDefinitionID)
+		{
+			// TODO: 需要添加堆叠检查逻辑
+			return StackItems(Item, TargetItem, Quantity);
+		}
+		
+		// 不同类型，尝试交换位置（网格布局要求两者占地相同）
+		if (!CanSwapItemFootprints(*Item, *TargetItem, AllItems, Containers))
+		{
+			Result.ErrorMessage = TEXT("物品占地不同，无法交换");
+			Result.Result = EMoveItemResult::InvalidTarget;
+			return Result;
+		}
+		if (!SwapItems(Item, TargetItem))
+		{
+			Result.ErrorMessage = TEXT("交换物品失败");
+			Result.Result = EMoveItemResult::Failed;
+			return Result;
+		}
+		
+		Result.Result = EMoveItemResult::SwapPerformed;
+		Result.bWasSwapped = true;
+		Result.SwappedItemUID = TargetItem->InstanceUID;
+		UE_LOG(LogGaia, Log, TEXT("[MoveItemWithinContainer] 交换成功: %s <-> %s"), 
+			*Item->InstanceUID.ToString(), *TargetItem->InstanceUID.ToString());
+		return Result;
+	}
+	
+	// 无法找到目标物品（数据不一致）
+	Result.ErrorMessage = TEXT("目标槽位数据异常：物品不存在");
+	Result.Result = EMoveItemResult::Failed;
+	UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] 无法找到目标物品: %s"),
+		*TargetItemUID.ToString());
+	
+	return Result;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::ProcessTargetSlotWithItem(FGaiaItemInstance* SourceItem, FGaiaItemInstance* TargetItem, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(SourceItem);
+	check(TargetItem);
+	check(TargetContainer);
+	check(TargetSlotID >= 0);
+	check(Quantity > 0 && Quantity <= SourceItem->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 检查是否为相同类型（尝试堆叠）
+	if (SourceItem->ItemDefinitionID == TargetItem->ItemDefinitionID)
+	{
+		// TODO: 需要添加堆叠检查逻辑
+		UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 相同类型，尝试堆叠"));
+		return StackItems(SourceItem, TargetItem, Quantity);
+	}
+	
+	// 检查目标物品是否有容器（尝试放入容器）
+	if (TargetItem->HasContainer())
+	{
+		UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 目标物品有容器，尝试放入"));
+		FMoveItemResult ContainerResult = MoveToItemContainer(SourceItem, TargetItem, Quantity);
+		if (ContainerResult.Result == EMoveItemResult::Success)
+		{
+			return ContainerResult;
+		}
+		// 如果放入容器失败，不交换位置，直接返回失败
+		Result.ErrorMessage = TEXT("无法放入目标物品的容器");
+		Result.Result = EMoveItemResult::ContainerRejected;
+		UE_LOG(LogGaia, Warning, TEXT("[ProcessTargetSlotWithItem] 放入容器失败"));
+		return Result;
+	}
+	
+	// 不同类型且目标无容器，尝试交换位置
+	UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 尝试交换位置"));
+	if (!CanSwapItemFootprints(*SourceItem, *TargetItem, AllItems, Containers))
+	{
+		Result.ErrorMessage = TEXT("交换后网格空间不足");
+		Result.Result = EMoveItemResult::InvalidTarget;
+		UE_LOG(LogGaia, Warning, TEXT("[ProcessTargetSlotWithItem] %s"), *Result.ErrorMessage);
+		return Result;
+	}
+	if (!SwapItems(SourceItem, TargetItem))
+	{
+		Result.ErrorMessage = TEXT("交换物品失败");
+		Result.Result = EMoveItemResult::Failed;
+		UE_LOG(LogGaia, Error, TEXT("[ProcessTargetSlotWithItem] 交换失败"));
+		return Result;
+	}
+	
+	Result.Result = EMoveItemResult::SwapPerformed;
+	Result.bWasSwapped = true;
+	Result.SwappedItemUID = TargetItem->InstanceUID;
+	UE_LOG(LogGaia, Log, TEXT("[ProcessTargetSlotWithItem] 交换成功: %s <-> %s"), 
+		*SourceItem->InstanceUID.ToString(), *TargetItem->InstanceUID.ToString());
+	return Result;
+}
+
+FMoveItemResult UGaiaInventorySubsystem::MoveItemAutoSlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 Quantity)
+{
+	// 参数已在调用者处验证，此处使用断言确保契约
+	check(Item);
+	check(TargetContainer);
+	check(Quantity > 0 && Quantity <= Item->Quantity);
+	
+	FMoveItemResult Result;
+	
+	// 1. 优先查找空槽位（网格布局在占用位图中查找放得下的位置，必要时旋转）
+	const FGaiaContainerDefinition* TargetContainerDef = FindContainerDefinition(TargetContainer->ContainerDefinitionID);
+	const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item->ItemDefinitionID);
+	bool bRotated = Item->bRotated;
+	int32 EmptySlotID = (TargetContainerDef && ItemDef)
+		? FindPlacementSlot(*TargetContainer, *TargetContainerDef, *ItemDef, Item->bRotated, bRotated)
+		: TargetContainer->FindEmptySlotID();
+	if (EmptySlotID != INDEX_NONE)
+	{
+		UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 找到空槽位: %d"), EmptySlotID);
+		return MoveToEmptySlot(Item, TargetContainer, EmptySlotID, Quantity, bRotated);
+	}
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 无空槽位，尝试堆叠或放入嵌套容器"));
+	
+	// 2. 没有空槽位，遍历所有槽位尝试堆叠或放入嵌套容器
+	for (const FGaiaSlotInfo& Slot : TargetContainer->Slots)
+	{
+		if (Slot.IsEmpty())
+			continue;
+			
+		FGaiaItemInstance* TargetItem = AllItems.Find(Slot.ItemInstanceUID);
+		if (!TargetItem)
+			continue;
+		
+		// 2.1 尝试堆叠（相同类型）
+		if (Item->ItemDefinitionID == TargetItem->ItemDefinitionID)
+		{
+			// TODO: 需要添加堆叠检查逻辑
+			UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 尝试堆叠到物品: %s"), *TargetItem->InstanceUID.ToString());
+			FMoveItemResult StackResult = StackItems(Item, TargetItem, Quantity);
+			if (StackResult.IsSuccess())
+			{
+				UE_LOG(LogGaia, Log, TEXT("[MoveItemAutoSlot] 堆叠成功"));
+				return StackResult;
+			}
+		}
+		
+		// 2.2 尝试放入嵌套容器
+		if (TargetItem->HasContainer())
+		{
+			UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 尝试放入嵌套容器: %s"), *TargetItem->InstanceUID.ToString());
+			FMoveItemResult ContainerResult = MoveToItemContainer(Item, TargetItem, Quantity);
+			if (ContainerResult.Result == EMoveItemResult::Success)
+			{
+				UE_LOG(LogGaia, Log, TEXT("[MoveItemAutoSlot] 成功放入嵌套容器"));
+				return ContainerResult;
+			}
+		}
+	}
+	
+	// 3. 无法找到合适的位置
+	Result.ErrorMessage = TEXT("无法找到合适的位置移动物品");
+	Result.Result = EMoveItemResult::ContainerFull;
+	UE_LOG(LogGaia, Warning, TEXT("[MoveItemAutoSlot] 容器已满，无法移动"));
+	return Result;
+}
+
+//~END 移动辅助函数
+
+//~BEGIN 增量统计
+
+void UGaiaInventorySubsystem::NotifyItemEnteredContainer(const FGaiaItemInstance& Item, FGaiaContainerInstance& Container)
+{
+	MarkItemChanged(Item.InstanceUID);
+	MarkContainerContentsChanged(Container.ContainerUID);
+	ApplyItemToAggregates(Container, Item, Item.Quantity, 1);
+	
+	if (FGaiaContainerInstance* OwnedContainer = Item.HasContainer() ? Containers.Find(Item.OwnedContainerUID) : nullptr)
+	{
+		UpdateNestingInfo(*OwnedContainer, &Container);
 	}
-	
-	return BaseWeight;
 }
 
-int32 UGaiaInventorySubsystem::GetContainerUsedVolume(const FGuid& ContainerUID) const
+void UGaiaInventorySubsystem::NotifyItemLeftContainer(const FGaiaItemInstance& Item, FGaiaContainerInstance& Container)
 {
-	const FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
-	if (!Container)
+	MarkItemChanged(Item.InstanceUID);
+	MarkContainerContentsChanged(Container.ContainerUID);
+	ApplyItemToAggregates(Container, Item, -Item.Quantity, -1);
+	
+	if (FGaiaContainerInstance* OwnedContainer = Item.HasContainer() ? Containers.Find(Item.OwnedContainerUID) : nullptr)
 	{
-		return 0;
+		UpdateNestingInfo(*OwnedContainer, nullptr);
 	}
+}
+
+void UGaiaInventorySubsystem::NotifyItemQuantityChanged(const FGaiaItemInstance& Item, int32 OldQuantity)
+{
+	MarkItemChanged(Item.InstanceUID);
 	
-	// 使用缓存（如果有效）
-	if (!Container->bNeedRecalculate && Container->CachedTotalVolume > 0)
+	if (!Item.IsInContainer())
 	{
-		return Container->CachedTotalVolume;
+		return;
 	}
 	
-	// 遍历容器中的所有槽位，计算物品总体积
-	int32 TotalVolume = 0;
-	for (const FGaiaSlotInfo& Slot : Container->Slots)
+	if (FGaiaContainerInstance* Container = Containers.Find(Item.CurrentContainerUID))
 	{
-		if (!Slot.IsEmpty())
-		{
-			if (const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID))
-			{
-				TotalVolume += GetItemTotalVolume(*Item);
-			}
-		}
+		MarkContainerContentsChanged(Container->ContainerUID);
+		ApplyItemToAggregates(*Container, Item, Item.Quantity - OldQuantity, 0);
 	}
-	
-	// 更新缓存（注意：这里是const函数，实际实现可能需要mutable）
-	// Container->CachedTotalVolume = TotalVolume;
-	// Container->bNeedRecalculate = false;
-	
-	return TotalVolume;
 }
 
-int32 UGaiaInventorySubsystem::GetContainerUsedWeight(const FGuid& ContainerUID) const
+void UGaiaInventorySubsystem::ApplyItemToAggregates(FGaiaContainerInstance& Container, const FGaiaItemInstance& Item, int32 QuantityDelta, int32 SlotDelta)
 {
-	const FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
-	if (!Container)
+	++Container.ContentRevision;
+	
+	// 缓存已失效时增量无意义，直接全量重算（槽位引用已是最新状态）
+	if (!Container.HasValidAggregates())
 	{
-		return 0;
+		RecalculateLiveContainerAggregates(Container);
+		return;
+	}
+	
+	Container.CachedUsedSlotCount += SlotDelta;
+	
+	// 槽位引用已是最新状态，网格占用按槽位重建（交换时物品位置先于通知更新，无法按物品增量修改）
+	if (SlotDelta != 0 && !Container.GridRows.IsEmpty())
+	{
+		RebuildGridOccupancy(Container, AllItems);
 	}
 	
-	// 使用缓存（如果有效）
-	if (!Container->bNeedRecalculate && Container->CachedTotalWeight > 0)
+	if (const FGaiaItemDefinition* ItemDef = FindItemDefinition(Item.ItemDefinitionID))
 	{
-		return Container->CachedTotalWeight;
+		Container.CachedTotalWeight += ItemDef->ItemWeight * QuantityDelta;
+		Container.CachedTotalVolume += ItemDef->ItemVolume * QuantityDelta;
 	}
 	
-	// 遍历容器中的所有槽位，计算物品总重量
-	int32 TotalWeight = 0;
-	for (const FGaiaSlotInfo& Slot : Container->Slots)
+	if (QuantityDelta != 0)
 	{
-		if (!Slot.IsEmpty())
+		int32& Count = Container.CachedDefinitionCounts.FindOrAdd(Item.ItemDefinitionID);
+		Count += QuantityDelta;
+		if (Count <= 0)
 		{
-			if (const FGaiaItemInstance* Item = AllItems.Find(Slot.ItemInstanceUID))
-			{
-				TotalWeight += GetItemTotalWeight(*Item);
-			}
+			Container.CachedDefinitionCounts.Remove(Item.ItemDefinitionID);
 		}
+		AdjustRootDefinitionCount(Container.GetRootContainerUID(), Item.ItemDefinitionID, QuantityDelta);
+	}
+}
+
+void UGaiaInventorySubsystem::RecalculateLiveContainerAggregates(FGaiaContainerInstance& Container)
+{
+	ApplyContainerToRootCounts(Container, -1);
+	RecalculateContainerAggregates(Container, AllItems);
+	ApplyContainerToRootCounts(Container, 1);
+}
+
+void UGaiaInventorySubsystem::AdjustRootDefinitionCount(const FGuid& RootContainerUID, FName ItemDefID, int32 Delta)
+{
+	if (Delta == 0)
+	{
+		return;
 	}
 	
-	// 更新缓存
-	// Container->CachedTotalWeight = TotalWeight;
-	// Container->bNeedRecalculate = false;
+	TMap<FName, int32>& RootCounts = RootDefinitionCounts.FindOrAdd(RootContainerUID);
+	int32& Count = RootCounts.FindOrAdd(ItemDefID);
+	Count += Delta;
+	if (Count <= 0)
+	{
+		RootCounts.Remove(ItemDefID);
+		if (RootCounts.IsEmpty())
+		{
+			RootDefinitionCounts.Remove(RootContainerUID);
+		}
+	}
 	
-	return TotalWeight;
+	PendingRootCountChanges.FindOrAdd(RootContainerUID).Add(ItemDefID);
 }
 
-//~END 体积/重量计算
-
-//~BEGIN 物品移动
+void UGaiaInventorySubsystem::ApplyContainerToRootCounts(const FGaiaContainerInstance& Container, int32 Sign)
+{
+	const FGuid RootUID = Container.GetRootContainerUID();
+	for (const auto& CountPair : Container.CachedDefinitionCounts)
+	{
+		AdjustRootDefinitionCount(RootUID, CountPair.Key, CountPair.Value * Sign);
+	}
+}
 
-FMoveItemResult UGaiaInventorySubsystem::TryMoveItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 TargetSlotID, int32 Quantity)
+void UGaiaInventorySubsystem::RebuildRootDefinitionCounts()
 {
-	FMoveItemResult Result;
-	
-	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 开始移动物品: ItemUID=%s, TargetContainer=%s, TargetSlot=%d, Quantity=%d"), 
-		*ItemUID.ToString(), *TargetContainerUID.ToString(), TargetSlotID, Quantity);
+	RootDefinitionCounts.Reset();
+	for (const auto& ContainerPair : Containers)
+	{
+		ApplyContainerToRootCounts(ContainerPair.Value, 1);
+	}
 	
-	// 检查源物品是否存在
-	FGaiaItemInstance* SourceItem = AllItems.Find(ItemUID);
-	if (!SourceItem)
+	// 订阅者全部重新读取，不再逐项广播
+	PendingRootCountChanges.Reset();
+	OnRootDefinitionCountsReset.Broadcast();
+}
+
+void UGaiaInventorySubsystem::BroadcastRootDefinitionCountChanges()
+{
+	if (PendingRootCountChanges.IsEmpty())
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("无法找到源物品 (ItemUID: %s)"), *ItemUID.ToString());
-		Result.Result = EMoveItemResult::InvalidTarget;
-		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
-		return Result;
+		return;
 	}
 	
-	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到源物品: %s (数量: %d)"), 
-		*SourceItem->ItemDefinitionID.ToString(), SourceItem->Quantity);
+	// 先取出再广播，订阅者在回调中修改库存时会开始新的一批
+	TMap<FGuid, TSet<FName>> Changes = MoveTemp(PendingRootCountChanges);
+	PendingRootCountChanges.Reset();
 	
-	// 检查目标容器是否存在
-	FGaiaContainerInstance* TargetContainer = Containers.Find(TargetContainerUID);
-	if (!TargetContainer)
+	if (!OnRootDefinitionCountsChanged.IsBound())
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("无法找到目标容器 (ContainerUID: %s)"), *TargetContainerUID.ToString());
-		Result.Result = EMoveItemResult::InvalidTarget;
-		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
-		return Result;
+		return;
 	}
 	
-	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到目标容器: %s (槽位数: %d)"), 
-		*TargetContainer->ContainerDefinitionID.ToString(), TargetContainer->Slots.Num());
-	
-	// 设置默认数量（移动全部）
-	if (Quantity <= 0)
+	for (const auto& ChangePair : Changes)
 	{
-		Quantity = SourceItem->Quantity;
-		UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 设置移动数量为全部: %d"), Quantity);
+		OnRootDefinitionCountsChanged.Broadcast(ChangePair.Key, ChangePair.Value.Array());
+	}
+}
+
+//~END 增量统计
+
+//~BEGIN 操作日志
+
+void UGaiaInventorySubsystem::CommitJournal()
+{
+	if (!Journal || (JournalDirtyItems.IsEmpty() && JournalDirtyContainers.IsEmpty()))
+	{
+		return;
 	}
 	
-	// 检查数量是否有效
-	if (Quantity > SourceItem->Quantity)
+	// 新建的容器先写，物品记录才能引用到
+	for (const FGuid& ContainerUID : JournalDirtyContainers)
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("移动数量 (%d) 超过源物品数量 (%d)"), Quantity, SourceItem->Quantity);
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Warning, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
-		return Result;
+		if (const FGaiaContainerInstance* Container = Containers.Find(ContainerUID))
+		{
+			Journal->WriteContainerState(*Container);
+		}
 	}
 	
-	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 移动数量验证通过: %d"), Quantity);
+	// 物品的过期时间按当前时钟换算为剩余寿命写入
+	const double LifetimeClock = GetLifetimeClock();
+	for (const FGuid& ItemUID : JournalDirtyItems)
+	{
+		if (const FGaiaItemInstance* Item = AllItems.Find(ItemUID))
+		{
+			Journal->WriteItemState(*Item, LifetimeClock);
+		}
+		else
+		{
+			Journal->WriteItemRemoved(ItemUID);
+		}
+	}
 	
-	// 检查源物品是否在容器中
-	if (!SourceItem->IsInContainer())
+	// 删除的容器最后写，其中的物品已先行删除
+	for (const FGuid& ContainerUID : JournalDirtyContainers)
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("源物品不在任何容器中 (ItemUID: %s)"), *ItemUID.ToString());
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Error, TEXT("[TryMoveItem] %s"), *Result.ErrorMessage);
-		return Result;
+		if (!Containers.Contains(ContainerUID))
+		{
+			Journal->WriteContainerRemoved(ContainerUID);
+		}
 	}
 	
-	UE_LOG(LogGaia, Log, TEXT("[TryMoveItem] 找到源物品位置: Container=%s, SlotID=%d"), 
-		*SourceItem->CurrentContainerUID.ToString(), SourceItem->CurrentSlotID);
+	JournalDirtyItems.Reset();
+	JournalDirtyContainers.Reset();
 	
-	// 执行移动（传递指针，避免重复查找）
-	return MoveItem(SourceItem, TargetContainer, TargetSlotID, Quantity);
+	if (!Journal->Commit())
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存日志] 提交失败，后续修改不会记录，直到下一次压缩成功"));
+	}
 }
 
-FMoveItemResult UGaiaInventorySubsystem::MoveItem(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity)
+FString UGaiaInventorySubsystem::GetSnapshotFilePath() const
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item);
-	check(TargetContainer);
-	check(Item->IsInContainer());
-	check(Quantity > 0 && Quantity <= Item->Quantity);
+	return FPaths::Combine(JournalDirectory, TEXT("Inventory.snapshot"));
+}
+
+FString UGaiaInventorySubsystem::GetJournalFilePath(int32 Segment) const
+{
+	return FPaths::Combine(JournalDirectory, FString::Printf(TEXT("Inventory.%d.journal"), Segment));
+}
+
+void UGaiaInventorySubsystem::FindJournalSegments(TArray<int32>& OutSegments) const
+{
+	OutSegments.Reset();
 	
-	FMoveItemResult Result;
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *FPaths::Combine(JournalDirectory, TEXT("Inventory.*.journal")), true, false);
 	
-	// 获取源容器
-	FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID);
-	if (!SourceContainer)
+	for (const FString& FileName : FileNames)
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("无法找到源容器 (ContainerUID: %s)"), *Item->CurrentContainerUID.ToString());
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Error, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
-		return Result;
+		// Inventory.<序号>.journal
+		const FString SegmentString = FPaths::GetBaseFilename(FileName).RightChop(FCString::Strlen(TEXT("Inventory.")));
+		if (SegmentString.IsNumeric())
+		{
+			OutSegments.Add(FCString::Atoi(*SegmentString));
+		}
 	}
 	
-	// 如果是同一个容器内的移动，需要特殊处理
-	if (Item->CurrentContainerUID == TargetContainer->ContainerUID)
+	OutSegments.Sort();
+}
+
+//~END 操作日志
+
+//~BEGIN 查询辅助
+
+TArray<FGaiaItemInstance> UGaiaInventorySubsystem::GetItemsInContainer(const FGuid& ContainerUID) const
+{
+	TArray<FGaiaItemInstance> Items;
+	
+	for (const auto& Pair : AllItems)
 	{
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 执行容器内移动"));
-		return MoveItemWithinContainer(Item, TargetSlotID, Quantity);
+		if (Pair.Value.CurrentContainerUID == ContainerUID)
+		{
+			Items.Add(Pair.Value);
+		}
 	}
 	
-	UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 执行跨容器移动: %s -> %s"), 
-		*Item->CurrentContainerUID.ToString(), *TargetContainer->ContainerUID.ToString());
+	return Items;
+}
+
+TArray<FGaiaItemInstance> UGaiaInventorySubsystem::GetOrphanItems() const
+{
+	TArray<FGaiaItemInstance> Items;
 	
-	// 检查目标槽位
-	if (TargetSlotID >= 0)
+	for (const auto& Pair : AllItems)
 	{
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 指定目标槽位: %d"), TargetSlotID);
-		
-		// 指定槽位移动
-		int32 TargetSlotIndex = TargetContainer->GetSlotIndexByID(TargetSlotID);
-		if (TargetSlotIndex == INDEX_NONE)
-		{
-			Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效 (SlotID: %d)"), TargetSlotID);
-			Result.Result = EMoveItemResult::InvalidTarget;
-			UE_LOG(LogGaia, Warning, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
-			return Result;
-		}
-		
-		FGaiaSlotInfo& TargetSlot = TargetContainer->Slots[TargetSlotIndex];
-		
-		if (TargetSlot.IsEmpty())
+		if (Pair.Value.IsOrphan())
 		{
-			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 目标槽位为空，执行直接移动"));
-			return MoveToEmptySlot(Item, TargetContainer, TargetSlotID, Quantity);
+			Items.Add(Pair.Value);
 		}
-		else
+	}
+	
+	return Items;
+}
+
+void UGaiaInventorySubsystem::GetAllContainers(TArray<FGaiaContainerInstance>& OutContainers) const
+{
+	OutContainers.Empty();
+	Containers.GenerateValueArray(OutContainers);
+}
+
+int32 UGaiaInventorySubsystem::CountItemsByType(FName ItemDefID) const
+{
+	int32 Count = 0;
+	
+	for (const auto& Pair : AllItems)
+	{
+		if (Pair.Value.ItemDefinitionID == ItemDefID)
 		{
-			// 目标槽位有物品，需要处理
-			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 目标槽位有物品: %s"), *TargetSlot.ItemInstanceUID.ToString());
-			
-			FGaiaItemInstance* TargetItem = AllItems.Find(TargetSlot.ItemInstanceUID);
-			if (!TargetItem)
-			{
-				Result.ErrorMessage = FString::Printf(TEXT("无法找到目标槽位中的物品 (ItemUID: %s)"), *TargetSlot.ItemInstanceUID.ToString());
-				Result.Result = EMoveItemResult::Failed;
-				UE_LOG(LogGaia, Error, TEXT("[MoveItem] %s"), *Result.ErrorMessage);
-				return Result;
-			}
-			
-			UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 找到目标物品: %s (数量: %d)"), 
-				*TargetItem->ItemDefinitionID.ToString(), TargetItem->Quantity);
-			
-			return ProcessTargetSlotWithItem(Item, TargetItem, TargetContainer, TargetSlotID, Quantity);
+			Count += Pair.Value.Quantity;
 		}
 	}
-	else
+	
+	return Count;
+}
+
+//~END 查询辅助
+
+//~BEGIN 持久化
+
+bool UGaiaInventorySubsystem::SaveInventoryToMemory(TArray<uint8>& OutData) const
+{
+	const double StartTime = FPlatformTime::Seconds();
+	
+	FString Error;
+	if (!FGaiaInventorySerializer::Save(AllItems, Containers, OutData, Error, GetLifetimeClock()))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] 保存失败: %s"), *Error);
+		return false;
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[库存存档] 保存完成: 物品 %d, 容器 %d, %d 字节, 耗时 %.2fms"),
+		AllItems.Num(), Containers.Num(), OutData.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+bool UGaiaInventorySubsystem::LoadInventoryFromMemory(const TArray<uint8>& Data)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	
+	// 先加载到临时表，成功后再替换，失败时不破坏当前数据
+	TMap<FGuid, FGaiaItemInstance> LoadedItems;
+	TMap<FGuid, FGaiaContainerInstance> LoadedContainers;
+	FString Error;
+	if (!FGaiaInventorySerializer::Load(Data, LoadedItems, LoadedContainers, Error, GetLifetimeClock()))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] 加载失败: %s"), *Error);
+		return false;
+	}
+	
+	NotifyIdAllocatorOfUIDs(LoadedItems, LoadedContainers);
+	AllItems = MoveTemp(LoadedItems);
+	Containers = MoveTemp(LoadedContainers);
+	RebuildRootDefinitionCounts();
+	RebuildLifetimeWheel();
+	InvalidateIncrementalSave();
+	
+	UE_LOG(LogGaia, Log, TEXT("[库存存档] 加载完成: 物品 %d, 容器 %d, 耗时 %.2fms"),
+		AllItems.Num(), Containers.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	
+	// 日志基于旧数据，立即以新数据为起点压缩
+	if (Journal)
 	{
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveItem] 自动分配槽位移动"));
-		return MoveItemAutoSlot(Item, TargetContainer, Quantity);
+		CompactJournalInternal(true);
 	}
+	
+	// 数据整体替换，通知所有客户端刷新
+	BroadcastContainerUpdate(FGuid());
+	return true;
 }
 
-FMoveItemResult UGaiaInventorySubsystem::QuickMoveItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 TargetSlotID)
+bool UGaiaInventorySubsystem::SaveInventoryToFile(const FString& FilePath) const
 {
-	return TryMoveItem(ItemUID, TargetContainerUID, TargetSlotID, -1); // -1 表示移动全部
+	TArray<uint8> Data;
+	if (!SaveInventoryToMemory(Data))
+	{
+		return false;
+	}
+	
+	FGaiaInventorySaveStats Stats;
+	if (!FGaiaInventorySerializer::WriteToFile(Data, FilePath, Stats))
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] %s"), *Stats.Error);
+		return false;
+	}
+	return true;
 }
 
-FMoveItemResult UGaiaInventorySubsystem::SplitItem(const FGuid& ItemUID, const FGuid& TargetContainerUID, int32 Quantity, int32 TargetSlotID)
+bool UGaiaInventorySubsystem::LoadInventoryFromFile(const FString& FilePath)
 {
-	if (Quantity <= 0)
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath))
 	{
-		FMoveItemResult Result;
-		Result.ErrorMessage = TEXT("拆分数量必须大于0");
-		Result.Result = EMoveItemResult::Failed;
-		return Result;
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] 无法读取文件: %s"), *FilePath);
+		return false;
 	}
 	
-	return TryMoveItem(ItemUID, TargetContainerUID, TargetSlotID, Quantity);
+	return LoadInventoryFromMemory(Data);
 }
 
-//~END 物品移动
+bool UGaiaInventorySubsystem::SaveInventoryAsync(const FString& FilePath, FGaiaInventorySaveComplete OnComplete)
+{
+	if (IsSaveInProgress())
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[库存存档] 上一次保存尚未完成，忽略: %s"), *FilePath);
+		return false;
+	}
+	
+	const double StartTime = FPlatformTime::Seconds();
+	
+	FGaiaInventorySnapshot Snapshot;
+	FGaiaInventorySerializer::CaptureSnapshot(AllItems, Containers, Snapshot, GetLifetimeClock());
+	
+	FGaiaInventorySaveStats Stats;
+	Stats.CaptureMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	
+	StartAsyncSave(Stats, [Snapshot = MoveTemp(Snapshot), FilePath](FGaiaInventorySaveStats& InOutStats)
+	{
+		TArray<uint8> Data;
+		return FGaiaInventorySerializer::SerializeSnapshot(Snapshot, Data, InOutStats)
+			&& FGaiaInventorySerializer::WriteToFile(Data, FilePath, InOutStats);
+	}, MoveTemp(OnComplete));
+	return true;
+}
 
-//~BEGIN 移动辅助函数
+bool UGaiaInventorySubsystem::SaveInventoryIncremental(const FString& Directory, FGaiaInventorySaveComplete OnComplete)
+{
+	if (IsSaveInProgress())
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[库存存档] 上一次保存尚未完成，忽略: %s"), *Directory);
+		return false;
+	}
+	
+	const double StartTime = FPlatformTime::Seconds();
+	
+	const bool bFullRewrite = !bTrackIncrementalChanges || Directory != IncrementalSaveDirectory;
+	FGaiaInventoryStoreChanges Changes;
+	CaptureIncrementalChanges(bFullRewrite, Changes);
+	IncrementalSaveDirectory = Directory;
+	
+	FGaiaInventorySaveStats Stats;
+	Stats.CaptureMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	
+	UE_LOG(LogGaia, Verbose, TEXT("[库存存档] 增量保存%s: 容器桶 %d, 删除 %d, 游离物品桶 %s, 捕获 %.2fms"),
+		bFullRewrite ? TEXT("（全量）") : TEXT(""), Changes.ContainerBuckets.Num(), Changes.RemovedContainerUIDs.Num(),
+		Changes.OrphanBucket.IsSet() ? TEXT("是") : TEXT("否"), Stats.CaptureMs);
+	
+	// 写入失败时已清空的脏标记无法找回，下一次改为全量重写
+	FGaiaInventorySaveComplete Completion = FGaiaInventorySaveComplete::CreateWeakLambda(this,
+		[this, OnComplete = MoveTemp(OnComplete)](const FGaiaInventorySaveStats& SaveStats)
+		{
+			if (!SaveStats.bSuccess)
+			{
+				InvalidateIncrementalSave();
+			}
+			OnComplete.ExecuteIfBound(SaveStats);
+		});
+	
+	StartAsyncSave(Stats, [Changes = MoveTemp(Changes), Directory](FGaiaInventorySaveStats& InOutStats)
+	{
+		return FGaiaInventoryContainerStore::SaveChanges(Directory, Changes, InOutStats);
+	}, MoveTemp(Completion));
+	return true;
+}
 
-FMoveItemResult UGaiaInventorySubsystem::StackItems(FGaiaItemInstance* SourceItem, FGaiaItemInstance* TargetItem, int32 Quantity)
+bool UGaiaInventorySubsystem::LoadInventoryFromDirectory(const FString& Directory)
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(SourceItem);
-	check(TargetItem);
-	check(Quantity > 0);
-	check(Quantity <= SourceItem->Quantity);
+	const double StartTime = FPlatformTime::Seconds();
 	
-	FMoveItemResult Result;
+	// 目录可能正在被后台保存写入
+	WaitForPendingSave();
 	
-	// 获取物品定义（用于获取堆叠上限）
-	FGaiaItemDefinition ItemDef;
-	if (!GetItemDefinition(SourceItem->ItemDefinitionID, ItemDef))
+	TMap<FGuid, FGaiaItemInstance> LoadedItems;
+	TMap<FGuid, FGaiaContainerInstance> LoadedContainers;
+	FString Error;
+	if (!FGaiaInventoryContainerStore::Load(Directory, LoadedItems, LoadedContainers, Error, GetLifetimeClock()))
 	{
-		Result.ErrorMessage = TEXT("无法获取物品定义");
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Error, TEXT("[StackItems] 无法获取物品定义 - %s"), *SourceItem->ItemDefinitionID.ToString());
-		return Result;
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] 加载失败: %s"), *Error);
+		return false;
 	}
 	
-	// 计算可堆叠的数量
-	int32 AvailableSpace = ItemDef.MaxStackSize - TargetItem->Quantity;
-	int32 StackQuantity = FMath::Min(Quantity, AvailableSpace);
+	NotifyIdAllocatorOfUIDs(LoadedItems, LoadedContainers);
+	AllItems = MoveTemp(LoadedItems);
+	Containers = MoveTemp(LoadedContainers);
 	
-	if (StackQuantity <= 0)
+	StoredOrphanItemUIDs.Reset();
+	for (const auto& ItemPair : AllItems)
 	{
-		Result.ErrorMessage = TEXT("目标物品堆叠已满");
-		Result.Result = EMoveItemResult::StackLimitReached;
-		UE_LOG(LogGaia, Warning, TEXT("[StackItems] 目标物品堆叠已满 - 当前数量: %d, 最大堆叠: %d"), 
-			TargetItem->Quantity, ItemDef.MaxStackSize);
-		return Result;
+		if (ItemPair.Value.IsOrphan())
+		{
+			StoredOrphanItemUIDs.Add(ItemPair.Key);
+		}
 	}
 	
-	// 更新目标物品数量
-	int32 OldTargetQuantity = TargetItem->Quantity;
-	TargetItem->Quantity += StackQuantity;
+	for (auto& ContainerPair : Containers)
+	{
+		RecalculateContainerAggregates(ContainerPair.Value, AllItems);
+	}
+	RebuildRootDefinitionCounts();
+	RebuildLifetimeWheel();
 	
-	UE_LOG(LogGaia, Verbose, TEXT("[StackItems] 更新目标物品数量: %d -> %d"), 
-		OldTargetQuantity, TargetItem->Quantity);
+	// 内存与目录一致，之后只写变化
+	InvalidateIncrementalSave();
+	bTrackIncrementalChanges = true;
+	IncrementalSaveDirectory = Directory;
 	
-	// 更新源物品数量
-	int32 OldSourceQuantity = SourceItem->Quantity;
-	SourceItem->Quantity -= StackQuantity;
+	UE_LOG(LogGaia, Log, TEXT("[库存存档] 从目录加载完成: 物品 %d, 容器 %d, 耗时 %.2fms"),
+		AllItems.Num(), Containers.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
 	
-	UE_LOG(LogGaia, Verbose, TEXT("[StackItems] 更新源物品数量: %d -> %d"), 
-		OldSourceQuantity, SourceItem->Quantity);
+	if (Journal)
+	{
+		CompactJournalInternal(true);
+	}
 	
-	// 如果源物品数量为0，删除源物品
-	if (SourceItem->Quantity <= 0)
+	BroadcastContainerUpdate(FGuid());
+	return true;
+}
+
+void UGaiaInventorySubsystem::CaptureIncrementalChanges(bool bFullRewrite, FGaiaInventoryStoreChanges& OutChanges)
+{
+	OutChanges.bFullRewrite = bFullRewrite;
+	const double LifetimeClock = GetLifetimeClock();
+	
+	if (bFullRewrite)
 	{
-		UE_LOG(LogGaia, Log, TEXT("[StackItems] 源物品数量为0，准备删除: UID=%s, 容器=%s, 槽位=%d"), 
-			*SourceItem->InstanceUID.ToString(), 
-			*SourceItem->CurrentContainerUID.ToString(), 
-			SourceItem->CurrentSlotID);
-		
-		DestroyItem(SourceItem->InstanceUID);
+		OutChanges.ContainerBuckets.Reserve(Containers.Num());
+		for (const auto& ContainerPair : Containers)
+		{
+			FGaiaInventoryContainerStore::CaptureContainerBucket(ContainerPair.Value, AllItems, OutChanges.ContainerBuckets.AddDefaulted_GetRef(), LifetimeClock);
+		}
 		
-		UE_LOG(LogGaia, Log, TEXT("[StackItems] 源物品已删除: UID=%s"), *SourceItem->InstanceUID.ToString());
+		StoredOrphanItemUIDs.Reset();
+		for (const auto& ItemPair : AllItems)
+		{
+			if (ItemPair.Value.IsOrphan())
+			{
+				StoredOrphanItemUIDs.Add(ItemPair.Key);
+			}
+		}
+		OutChanges.OrphanBucket.Emplace();
 	}
 	else
 	{
-		// 标记源容器需要重新计算
-		if (SourceItem->IsInContainer())
+		// 只处理上次保存后变化过的容器，代价与玩家活动量成正比
+		for (const FGuid& ContainerUID : IncrementalDirtyContainers)
 		{
-			if (FGaiaContainerInstance* SourceContainer = Containers.Find(SourceItem->CurrentContainerUID))
+			if (const FGaiaContainerInstance* Container = Containers.Find(ContainerUID))
 			{
-				SourceContainer->MarkDirty();
+				FGaiaInventoryContainerStore::CaptureContainerBucket(*Container, AllItems, OutChanges.ContainerBuckets.AddDefaulted_GetRef(), LifetimeClock);
 			}
+			else
+			{
+				OutChanges.RemovedContainerUIDs.Add(ContainerUID);
+			}
+		}
+		
+		// 游离物品桶：有物品变为/仍是游离状态，或原来游离的物品离开了
+		bool bOrphansChanged = false;
+		for (const FGuid& ItemUID : IncrementalDirtyItems)
+		{
+			const FGaiaItemInstance* Item = AllItems.Find(ItemUID);
+			if (Item && Item->IsOrphan())
+			{
+				StoredOrphanItemUIDs.Add(ItemUID);
+				bOrphansChanged = true;
+			}
+			else if (StoredOrphanItemUIDs.Remove(ItemUID) > 0)
+			{
+				bOrphansChanged = true;
+			}
+		}
+		
+		if (bOrphansChanged)
+		{
+			OutChanges.OrphanBucket.Emplace();
 		}
 	}
 	
-	// 标记目标容器需要重新计算
-	if (TargetItem->IsInContainer())
+	if (OutChanges.OrphanBucket.IsSet())
 	{
-		if (FGaiaContainerInstance* TargetContainer = Containers.Find(TargetItem->CurrentContainerUID))
+		FGaiaInventorySnapshot& OrphanBucket = OutChanges.OrphanBucket.GetValue();
+		OrphanBucket.Items.Reserve(StoredOrphanItemUIDs.Num());
+		for (const FGuid& ItemUID : StoredOrphanItemUIDs)
 		{
-			TargetContainer->MarkDirty();
+			const FGaiaItemInstance& Item = AllItems.FindChecked(ItemUID);
+			FGaiaInventorySnapshot::FItemRecord& Record = OrphanBucket.Items.AddDefaulted_GetRef();
+			Record.InstanceUID = Item.InstanceUID;
+			Record.ItemDefinitionID = Item.ItemDefinitionID;
+			Record.Quantity = Item.Quantity;
+			Record.OwnedContainerUID = Item.OwnedContainerUID;
+			Record.RemainingLifetime = Item.HasLifetime() ? FMath::Max(static_cast<float>(Item.ExpireTime - LifetimeClock), UE_KINDA_SMALL_NUMBER) : 0.0f;
 		}
 	}
 	
-	// 设置结果
-	Result.Result = (StackQuantity == Quantity) ? EMoveItemResult::Success : EMoveItemResult::PartialSuccess;
-	Result.MovedQuantity = StackQuantity;
-	Result.RemainingQuantity = Quantity - StackQuantity;
-	Result.TargetContainerUID = TargetItem->CurrentContainerUID;
-	
-	UE_LOG(LogGaia, Log, TEXT("[StackItems] 堆叠完成: 移动了 %d 个物品（请求 %d）"), 
-		StackQuantity, Quantity);
-	
-	return Result;
+	IncrementalDirtyContainers.Reset();
+	IncrementalDirtyItems.Reset();
+	bTrackIncrementalChanges = true;
 }
 
-FMoveItemResult UGaiaInventorySubsystem::MoveToItemContainer(FGaiaItemInstance* Item, FGaiaItemInstance* ContainerItem, int32 Quantity)
+void UGaiaInventorySubsystem::WaitForPendingSave()
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item);
-	check(ContainerItem);
-	check(ContainerItem->HasContainer());
-	check(Quantity > 0 && Quantity <= Item->Quantity);
-	
-	FMoveItemResult Result;
-	
-	// 获取容器物品的容器
-	FGaiaContainerInstance* TargetContainer = Containers.Find(ContainerItem->OwnedContainerUID);
-	if (!TargetContainer)
+	if (PendingSaveTask.IsValid())
 	{
-		Result.ErrorMessage = TEXT("无法找到容器物品的容器");
-		Result.Result = EMoveItemResult::InvalidTarget;
-		UE_LOG(LogGaia, Error, TEXT("[MoveToItemContainer] 容器物品的容器不存在: %s"), *ContainerItem->OwnedContainerUID.ToString());
-		return Result;
+		PendingSaveTask.Wait();
+		FinishPendingSave();
 	}
+}
+
+bool UGaiaInventorySubsystem::IsSaveInProgress() const
+{
+	return PendingSaveTask.IsValid();
+}
+
+void UGaiaInventorySubsystem::StartAsyncSave(const FGaiaInventorySaveStats& Stats, TUniqueFunction<bool(FGaiaInventorySaveStats&)>&& Work, FGaiaInventorySaveComplete OnComplete)
+{
+	check(!PendingSaveTask.IsValid());
 	
-	// 找到空槽位
-	const int32 EmptySlotID = TargetContainer->FindEmptySlotID();
-	if (EmptySlotID == INDEX_NONE)
-	{
-		Result.ErrorMessage = TEXT("容器已满");
-		Result.Result = EMoveItemResult::ContainerFull;
-		UE_LOG(LogGaia, Warning, TEXT("[MoveToItemContainer] 容器已满"));
-		return Result;
-	}
+	PendingSaveCallback = MoveTemp(OnComplete);
 	
-	// 先从源容器移除槽位引用
-	if (Item->IsInContainer())
-	{
-		if (FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID))
+	TWeakObjectPtr<UGaiaInventorySubsystem> WeakThis(this);
+	PendingSaveTask = Async(EAsyncExecution::ThreadPool,
+		[Stats, Work = MoveTemp(Work)]() mutable
 		{
-			int32 SlotIndex = SourceContainer->GetSlotIndexByID(Item->CurrentSlotID);
-			if (SlotIndex != INDEX_NONE)
+			Stats.bSuccess = Work(Stats);
+			return Stats;
+		},
+		// 结果写入后调用，回到游戏线程回收
+		[WeakThis]()
+		{
+			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
 			{
-				SourceContainer->Slots[SlotIndex].ItemInstanceUID = FGuid();
-				SourceContainer->MarkDirty();
-				UE_LOG(LogGaia, Verbose, TEXT("[MoveToItemContainer] 清空源槽位引用: 容器=%s, 槽位=%d"),
-					*Item->CurrentContainerUID.ToString(), Item->CurrentSlotID);
-			}
-		}
+				if (UGaiaInventorySubsystem* Subsystem = WeakThis.Get())
+				{
+					Subsystem->FinishPendingSave();
+				}
+			});
+		});
+}
+
+void UGaiaInventorySubsystem::FinishPendingSave()
+{
+	// WaitForPendingSave 可能已经提前回收
+	if (!PendingSaveTask.IsValid() || !PendingSaveTask.IsReady())
+	{
+		return;
 	}
 	
-	// 添加物品到目标容器
-	if (AddItemToContainer(Item, TargetContainer, EmptySlotID))
+	LastSaveStats = PendingSaveTask.Get();
+	PendingSaveTask.Reset();
+	
+	if (LastSaveStats.bSuccess)
 	{
-		Result.Result = EMoveItemResult::Success;
-		Result.MovedQuantity = Quantity;
-		Result.RemainingQuantity = 0;
-		Result.bMovedToContainer = true;
-		Result.TargetContainerUID = ContainerItem->OwnedContainerUID;
-		UE_LOG(LogGaia, Log, TEXT("[MoveToItemContainer] 成功将物品放入容器物品的容器 (数量: %d)"), Quantity);
-		return Result;
+		UE_LOG(LogGaia, Log, TEXT("[库存存档] 后台保存完成: 物品 %d, 容器 %d, %lld -> %lld 字节, 捕获 %.2fms, 序列化 %.2fms, 压缩 %.2fms, 写入 %.2fms"),
+			LastSaveStats.NumItems, LastSaveStats.NumContainers, LastSaveStats.RawBytes, LastSaveStats.StoredBytes,
+			LastSaveStats.CaptureMs, LastSaveStats.SerializeMs, LastSaveStats.CompressMs, LastSaveStats.WriteMs);
+	}
+	else
+	{
+		UE_LOG(LogGaia, Error, TEXT("[库存存档] 后台保存失败: %s"), *LastSaveStats.Error);
 	}
 	
-	Result.ErrorMessage = TEXT("添加物品到容器失败");
-	Result.Result = EMoveItemResult::Failed;
-	UE_LOG(LogGaia, Error, TEXT("[MoveToItemContainer] 添加物品到容器失败"));
-	return Result;
+	// 回调中可能发起新的保存，先取出
+	FGaiaInventorySaveComplete Callback = MoveTemp(PendingSaveCallback);
+	PendingSaveCallback.Unbind();
+	Callback.ExecuteIfBound(LastSaveStats);
 }
 
-bool UGaiaInventorySubsystem::SwapItems(FGaiaItemInstance* Item1, FGaiaItemInstance* Item2)
+bool UGaiaInventorySubsystem::StartJournal(const FString& SaveDirectory)
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item1);
-	check(Item2);
-	check(Item1->IsInContainer());
-	check(Item2->IsInContainer());
-	
-	// 获取原始位置
-	FGuid Container1UID = Item1->CurrentContainerUID;
-	int32 Slot1ID = Item1->CurrentSlotID;
-	FGuid Container2UID = Item2->CurrentContainerUID;
-	int32 Slot2ID = Item2->CurrentSlotID;
-	
-	UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] 交换物品位置: Item1在容器%s槽位%d <-> Item2在容器%s槽位%d"), 
-		*Container1UID.ToString(), Slot1ID,
-		*Container2UID.ToString(), Slot2ID);
-	
-	// 获取容器
-	FGaiaContainerInstance* Container1 = Containers.Find(Container1UID);
-	FGaiaContainerInstance* Container2 = Containers.Find(Container2UID);
+	StopJournal();
+	WaitForPendingSave();
 	
-	if (!Container1 || !Container2)
-	{
-		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到容器"));
-		return false;
-	}
+	JournalDirectory = SaveDirectory;
+	IFileManager::Get().MakeDirectory(*JournalDirectory, true);
 	
-	// 交换物品的位置信息
-	Item1->CurrentContainerUID = Container2UID;
-	Item1->CurrentSlotID = Slot2ID;
-	Item2->CurrentContainerUID = Container1UID;
-	Item2->CurrentSlotID = Slot1ID;
+	// 1. 恢复：加载最新快照，再按顺序重放所有日志段
+	TArray<uint8> SnapshotData;
+	const bool bHasSnapshot = FFileHelper::LoadFileToArray(SnapshotData, *GetSnapshotFilePath(), FILEREAD_Silent);
 	
-	// 交换槽位引用
-	int32 SlotIndex1 = Container1->GetSlotIndexByID(Slot1ID);
-	int32 SlotIndex2 = Container2->GetSlotIndexByID(Slot2ID);
+	TArray<int32> Segments;
+	FindJournalSegments(Segments);
 	
-	if (SlotIndex1 != INDEX_NONE)
-	{
-		Container1->Slots[SlotIndex1].ItemInstanceUID = Item2->InstanceUID;
-		UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] Container1槽位%d更新: %s -> %s"), 
-			Slot1ID, *Item1->InstanceUID.ToString(), *Item2->InstanceUID.ToString());
-	}
-	else
+	if (bHasSnapshot || Segments.Num() > 0)
 	{
-		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到Container1的槽位索引，SlotID: %d"), Slot1ID);
-		return false;
+		const double StartTime = FPlatformTime::Seconds();
+		
+		TMap<FGuid, FGaiaItemInstance> RecoveredItems;
+		TMap<FGuid, FGaiaContainerInstance> RecoveredContainers;
+		FString Error;
+		
+		if (bHasSnapshot && !FGaiaInventorySerializer::Load(SnapshotData, RecoveredItems, RecoveredContainers, Error, GetLifetimeClock()))
+		{
+			UE_LOG(LogGaia, Error, TEXT("[库存日志] 快照损坏，无法恢复: %s"), *Error);
+			return false;
+		}
+		
+		// 快照写完到旧日志段删除之间崩溃时，已被快照覆盖的日志段也还在。
+		// 记录都是整体状态且日志段按升序删除，重放后结果与快照之后的状态一致。
+		int32 NumBatches = 0;
+		for (const int32 Segment : Segments)
+		{
+			TArray<uint8> JournalData;
+			if (!FFileHelper::LoadFileToArray(JournalData, *GetJournalFilePath(Segment), FILEREAD_Silent))
+			{
+				continue;
+			}
+			
+			int32 SegmentBatches = 0;
+			const bool bReplayed = FGaiaInventoryJournal::Replay(JournalData, RecoveredItems, RecoveredContainers, SegmentBatches, Error, GetLifetimeClock());
+			NumBatches += SegmentBatches;
+			if (!bReplayed)
+			{
+				// 已重放的批次保留，之后的操作丢失
+				UE_LOG(LogGaia, Error, TEXT("[库存日志] 日志段 %d 重放中断（已重放 %d 个批次）: %s"), Segment, SegmentBatches, *Error);
+				break;
+			}
+		}
+		
+		// 槽位引用和父子关系以物品位置为准重建，统计缓存统一重算
+		FGaiaInventorySerializer::RebuildDerivedData(RecoveredItems, RecoveredContainers);
+		
+		NotifyIdAllocatorOfUIDs(RecoveredItems, RecoveredContainers);
+		AllItems = MoveTemp(RecoveredItems);
+		Containers = MoveTemp(RecoveredContainers);
+		InvalidateIncrementalSave();
+		
+		for (auto& ContainerPair : Containers)
+		{
+			RecalculateContainerAggregates(ContainerPair.Value, AllItems);
+		}
+		RebuildRootDefinitionCounts();
+		RebuildLifetimeWheel();
+		
+		UE_LOG(LogGaia, Log, TEXT("[库存日志] 恢复完成: 物品 %d, 容器 %d, 日志段 %d, 重放批次 %d, 耗时 %.2fms"),
+			AllItems.Num(), Containers.Num(), Segments.Num(), NumBatches, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		
+		BroadcastContainerUpdate(FGuid());
 	}
 	
-	if (SlotIndex2 != INDEX_NONE)
-	{
-		Container2->Slots[SlotIndex2].ItemInstanceUID = Item1->InstanceUID;
-		UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] Container2槽位%d更新: %s -> %s"), 
-			Slot2ID, *Item2->InstanceUID.ToString(), *Item1->InstanceUID.ToString());
-	}
-	else
+	// 2. 以当前数据为起点写入快照并打开新日志段（序号接在已有日志段之后）
+	JournalSegment = Segments.Num() > 0 ? Segments.Last() : 0;
+	Journal = MakeUnique<FGaiaInventoryJournal>();
+	CompactJournalInternal(true);
+	if (!Journal->IsOpen())
 	{
-		UE_LOG(LogGaia, Error, TEXT("[SwapItems] 无法找到Container2的槽位索引，SlotID: %d"), Slot2ID);
+		Journal.Reset();
 		return false;
 	}
 	
-	// 更新嵌套容器的父容器（如果有）
-	if (Item1->HasContainer())
-	{
-		if (FGaiaContainerInstance* Item1Container = Containers.Find(Item1->OwnedContainerUID))
-		{
-			Item1Container->ParentContainerUID = Container2UID;
-		}
-	}
-	
-	if (Item2->HasContainer())
+	// 3. 定期压缩
+	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+	UWorld* World = GetWorld();
+	if (World && Settings && Settings->JournalCompactionInterval > 0.0f)
 	{
-		if (FGaiaContainerInstance* Item2Container = Containers.Find(Item2->OwnedContainerUID))
-		{
-			Item2Container->ParentContainerUID = Container1UID;
-		}
+		World->GetTimerManager().SetTimer(JournalCompactionTimerHandle, this, &UGaiaInventorySubsystem::CompactJournal,
+			Settings->JournalCompactionInterval, true);
 	}
 	
-	// 标记需要重新计算
-	Container1->MarkDirty();
-	Container2->MarkDirty();
-	
-	UE_LOG(LogGaia, Verbose, TEXT("[SwapItems] 交换成功: %s <-> %s"), 
-		*Item1->InstanceUID.ToString(), *Item2->InstanceUID.ToString());
-	
+	UE_LOG(LogGaia, Log, TEXT("[库存日志] 已启用: %s"), *JournalDirectory);
 	return true;
 }
 
-FMoveItemResult UGaiaInventorySubsystem::CanSwapItems(FGaiaItemInstance* Item1, FGaiaItemInstance* Item2) const
+void UGaiaInventorySubsystem::StopJournal()
 {
-	check(Item1);
-	check(Item2);
-	
-	FMoveItemResult Result;
+	if (!Journal)
+	{
+		return;
+	}
 	
-	// 检查是否都在容器中
-	if (!Item1->IsInContainer() || !Item2->IsInContainer())
+	if (UWorld* World = GetWorld())
 	{
-		Result.Result = EMoveItemResult::Failed;
-		Result.ErrorMessage = FString::Printf(TEXT("物品不在容器中 (Item1在容器: %s, Item2在容器: %s)"),
-			Item1->IsInContainer() ? TEXT("是") : TEXT("否"),
-			Item2->IsInContainer() ? TEXT("是") : TEXT("否"));
-		return Result;
+		World->GetTimerManager().ClearTimer(JournalCompactionTimerHandle);
 	}
 	
-	// 如果在同一个容器中，直接允许交换（同容器内交换不会造成循环）
-	if (Item1->CurrentContainerUID == Item2->CurrentContainerUID)
+	if (Journal->GetCommittedBytes() > 0)
 	{
-		Result.Result = EMoveItemResult::Success;
-		return Result;
+		CompactJournalInternal(true);
+		WaitForPendingSave();
 	}
 	
-	// 跨容器交换，需要检查是否可以添加到对方的容器
-	const FGaiaContainerInstance* Container1 = Containers.Find(Item1->CurrentContainerUID);
-	const FGaiaContainerInstance* Container2 = Containers.Find(Item2->CurrentContainerUID);
+	Journal.Reset();
+	JournalDirtyItems.Reset();
+	JournalDirtyContainers.Reset();
 	
-	if (!Container1 || !Container2)
+	UE_LOG(LogGaia, Log, TEXT("[库存日志] 已停用"));
+}
+
+void UGaiaInventorySubsystem::CompactJournal()
+{
+	CompactJournalInternal(false);
+}
+
+void UGaiaInventorySubsystem::CompactJournalInternal(bool bWaitForPendingSave)
+{
+	if (!Journal)
 	{
-		Result.Result = EMoveItemResult::InvalidTarget;
-		Result.ErrorMessage = FString::Printf(TEXT("无法找到容器 (Container1: %s, Container2: %s)"),
-			Container1 ? TEXT("存在") : TEXT("不存在"),
-			Container2 ? TEXT("存在") : TEXT("不存在"));
-		return Result;
+		return;
 	}
 	
-	// 检查 Item1 是否可以放入 Container2
-	FAddItemResult CanAdd1To2 = CanAddItemToContainer(Item1, const_cast<FGaiaContainerInstance*>(Container2));
-	if (!CanAdd1To2.IsSuccess())
+	// 修改进行中不压缩（正常情况下定时器不会在修改中途触发）
+	if (MutationScopeDepth > 0)
 	{
-		Result.Result = EMoveItemResult::Failed;
-		Result.ErrorMessage = FString::Printf(TEXT("Item1无法放入Container2: %s"), *CanAdd1To2.ErrorMessage);
-		return Result;
+		return;
 	}
 	
-	// 检查 Item2 是否可以放入 Container1
-	FAddItemResult CanAdd2To1 = CanAddItemToContainer(Item2, const_cast<FGaiaContainerInstance*>(Container1));
-	if (!CanAdd2To1.IsSuccess())
+	if (IsSaveInProgress())
 	{
-		Result.Result = EMoveItemResult::Failed;
-		Result.ErrorMessage = FString::Printf(TEXT("Item2无法放入Container1: %s"), *CanAdd2To1.ErrorMessage);
-		return Result;
+		if (!bWaitForPendingSave)
+		{
+			UE_LOG(LogGaia, Verbose, TEXT("[库存日志] 上一次快照仍在写入，跳过本次压缩"));
+			return;
+		}
+		WaitForPendingSave();
 	}
 	
-	Result.Result = EMoveItemResult::Success;
-	return Result;
-}
-
-FMoveItemResult UGaiaInventorySubsystem::MoveToEmptySlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity)
-{
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item);
-	check(TargetContainer);
-	check(TargetSlotID >= 0);
-	check(Quantity > 0 && Quantity <= Item->Quantity);
+	// 1. 游戏线程：捕获快照并切换日志段（两步之间没有修改，新日志段恰好从快照之后开始）
+	const double StartTime = FPlatformTime::Seconds();
 	
-	FMoveItemResult Result;
+	FGaiaInventorySnapshot Snapshot;
+	FGaiaInventorySerializer::CaptureSnapshot(AllItems, Containers, Snapshot, GetLifetimeClock());
 	
-	// 找到目标槽位
-	int32 TargetSlotIndex = TargetContainer->GetSlotIndexByID(TargetSlotID);
-	if (TargetSlotIndex == INDEX_NONE)
+	FGaiaInventorySaveStats Stats;
+	Stats.CaptureMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	
+	const int32 CoveredSegment = JournalSegment;
+	const int64 CoveredBytes = Journal->GetCommittedBytes();
+	if (!Journal->Open(GetJournalFilePath(++JournalSegment)))
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效 (SlotID: %d)"), TargetSlotID);
-		Result.Result = EMoveItemResult::InvalidTarget;
-		UE_LOG(LogGaia, Error, TEXT("[MoveToEmptySlot] %s"), *Result.ErrorMessage);
-		return Result;
+		UE_LOG(LogGaia, Error, TEXT("[库存日志] 无法打开新日志段，后续修改不会记录"));
+		return;
 	}
 	
-	// 如果是部分移动，创建新物品实例
-	bool bIsPartialMove = (Quantity < Item->Quantity);
-	
-	if (bIsPartialMove)
+	// 2. 工作线程：写入快照，成功后按升序删除已被覆盖的日志段（失败时保留，下次启动照常重放）
+	TArray<FString> CoveredSegmentPaths;
+	TArray<int32> Segments;
+	FindJournalSegments(Segments);
+	for (const int32 Segment : Segments)
 	{
-		// 部分移动：创建新物品
-		FGaiaItemInstance NewItem = *Item;
-		NewItem.InstanceUID = FGuid::NewGuid();
-		NewItem.Quantity = Quantity;
-		NewItem.CurrentContainerUID = TargetContainer->ContainerUID;
-		NewItem.CurrentSlotID = TargetSlotID;
-		
-		// 添加新物品到AllItems
-		AllItems.Add(NewItem.InstanceUID, NewItem);
-		
-		// 更新目标槽位引用
-		TargetContainer->Slots[TargetSlotIndex].ItemInstanceUID = NewItem.InstanceUID;
-		
-		// 减少源物品数量
-		Item->Quantity -= Quantity;
-		
-		// 标记容器需要重新计算
-		if (Item->IsInContainer())
+		if (Segment <= CoveredSegment)
 		{
-			if (FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID))
-			{
-				SourceContainer->MarkDirty();
-			}
+			CoveredSegmentPaths.Add(GetJournalFilePath(Segment));
 		}
-		TargetContainer->MarkDirty();
-		
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveToEmptySlot] 部分移动: 原UID=%s (剩余%d), 新UID=%s (移动%d)"), 
-			*Item->InstanceUID.ToString(), Item->Quantity, *NewItem.InstanceUID.ToString(), Quantity);
 	}
-	else
-	{
-		// 完全移动：直接更新物品位置
-		// 先从源容器移除
-		if (Item->IsInContainer())
+	
+	StartAsyncSave(Stats,
+		[Snapshot = MoveTemp(Snapshot), SnapshotPath = GetSnapshotFilePath(), CoveredSegmentPaths = MoveTemp(CoveredSegmentPaths)](FGaiaInventorySaveStats& InOutStats)
 		{
-			if (FGaiaContainerInstance* SourceContainer = Containers.Find(Item->CurrentContainerUID))
+			TArray<uint8> Data;
+			if (!FGaiaInventorySerializer::SerializeSnapshot(Snapshot, Data, InOutStats)
+				|| !FGaiaInventorySerializer::WriteToFile(Data, SnapshotPath, InOutStats))
 			{
-				int32 SourceSlotIndex = SourceContainer->GetSlotIndexByID(Item->CurrentSlotID);
-				if (SourceSlotIndex != INDEX_NONE)
-				{
-					SourceContainer->Slots[SourceSlotIndex].ItemInstanceUID = FGuid();
-				}
-				SourceContainer->MarkDirty();
+				return false;
 			}
-		}
-		
-		// 更新物品位置
-		Item->CurrentContainerUID = TargetContainer->ContainerUID;
-		Item->CurrentSlotID = TargetSlotID;
-		
-		// 更新目标槽位引用
-		TargetContainer->Slots[TargetSlotIndex].ItemInstanceUID = Item->InstanceUID;
-		TargetContainer->MarkDirty();
-		
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveToEmptySlot] 完全移动: UID=%s, 数量=%d"), 
-			*Item->InstanceUID.ToString(), Quantity);
-	}
-	
-	Result.Result = EMoveItemResult::Success;
-	Result.MovedQuantity = Quantity;
-	Result.RemainingQuantity = bIsPartialMove ? Item->Quantity : 0;
-	Result.TargetContainerUID = TargetContainer->ContainerUID;
+			
+			for (const FString& SegmentPath : CoveredSegmentPaths)
+			{
+				IFileManager::Get().Delete(*SegmentPath, false, false, true);
+			}
+			return true;
+		},
+		FGaiaInventorySaveComplete());
 	
-	return Result;
+	UE_LOG(LogGaia, Log, TEXT("[库存日志] 开始压缩: 捕获 %.2fms, 覆盖日志段 %d（%lld 字节）"), Stats.CaptureMs, CoveredSegment, CoveredBytes);
 }
 
-FMoveItemResult UGaiaInventorySubsystem::MoveItemWithinContainer(FGaiaItemInstance* Item, int32 TargetSlotID, int32 Quantity)
+bool UGaiaInventorySubsystem::IsJournalActive() const
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item);
-	check(Item->IsInContainer());
-	check(TargetSlotID >= 0);
-	check(Quantity > 0 && Quantity <= Item->Quantity);
-	
-	FMoveItemResult Result;
-	
-	// 获取容器
-	FGaiaContainerInstance* Container = Containers.Find(Item->CurrentContainerUID);
-	if (!Container)
+	return Journal && Journal->IsOpen();
+}
+
+//~END 持久化
+
+//~BEGIN 玩家分片
+
+void UGaiaInventorySubsystem::HandlePlayerLogin(APlayerController* PlayerController)
+{
+	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+	if (!PlayerController || !Settings || !Settings->bEnablePlayerShards)
 	{
-		Result.ErrorMessage = TEXT("无法找到容器");
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] 无法找到容器: %s"), *Item->CurrentContainerUID.ToString());
-		return Result;
+		return;
 	}
 	
-	// 获取目标槽位
-	int32 TargetSlotIndex = Container->GetSlotIndexByID(TargetSlotID);
-	if (TargetSlotIndex == INDEX_NONE)
+	UGaiaInventoryRPCComponent* RPCComp = PlayerController->FindComponentByClass<UGaiaInventoryRPCComponent>();
+	const FString ShardId = GetPlayerShardId(PlayerController);
+	if (!RPCComp || ShardId.IsEmpty())
 	{
-		Result.ErrorMessage = FString::Printf(TEXT("目标槽位无效: %d"), TargetSlotID);
-		Result.Result = EMoveItemResult::InvalidTarget;
-		UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] %s"), *Result.ErrorMessage);
-		return Result;
+		UE_LOG(LogGaia, Warning, TEXT("[玩家分片] %s 没有RPC组件或玩家ID，跳过分片加载"), *GetNameSafe(PlayerController));
+		return;
 	}
 	
-	FGaiaSlotInfo& TargetSlot = Container->Slots[TargetSlotIndex];
+	TArray<FGuid> RootContainerUIDs;
+	if (!LoadPlayerShard(ShardId, RootContainerUIDs))
+	{
+		return;
+	}
 	
-	if (TargetSlot.IsEmpty())
+	// 先设置分片ID，之后登记的容器（包括新玩家的初始背包）都会归入分片
+	RPCComp->SetInventoryShardId(ShardId);
+	for (const FGuid& ContainerUID : RootContainerUIDs)
 	{
-		// 目标槽位为空，调用 MoveToEmptySlot 处理
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveItemWithinContainer] 目标槽位为空，调用 MoveToEmptySlot"));
-		return MoveToEmptySlot(Item, Container, TargetSlotID, Quantity);
+		RPCComp->AddOwnedContainerUID(ContainerUID);
 	}
 	
-	// 目标槽位有物品，需要处理
-	if (FGaiaItemInstance* TargetItem = AllItems.Find(TargetSlot.ItemInstanceUID))
+	// 装备容器是分片的根容器之一，按容器定义找回（新玩家在这里创建，分片ID已设置，会归入分片）
+	if (UGaiaEquipmentComponent* EquipmentComp = RPCComp->FindEquipmentComponent())
 	{
-		// 检查是否为相同类型（尝试堆叠）
-		if (Item->ItemDefinitionID == TargetItem->ItemDefinitionID)
-		{
-			// TODO: 需要添加堆叠检查逻辑
-			return StackItems(Item, TargetItem, Quantity);
-		}
-		
-		// 不同类型，尝试交换位置
-		if (!SwapItems(Item, TargetItem))
-		{
-			Result.ErrorMessage = TEXT("交换物品失败");
-			Result.Result = EMoveItemResult::Failed;
-			return Result;
-		}
-		
-		Result.Result = EMoveItemResult::SwapPerformed;
-		Result.bWasSwapped = true;
-		Result.SwappedItemUID = TargetItem->InstanceUID;
-		UE_LOG(LogGaia, Log, TEXT("[MoveItemWithinContainer] 交换成功: %s <-> %s"), 
-			*Item->InstanceUID.ToString(), *TargetItem->InstanceUID.ToString());
-		return Result;
+		EquipmentComp->RestoreEquipmentContainer(RootContainerUIDs);
+		RPCComp->AddOwnedContainerUID(EquipmentComp->GetEquipmentContainerUID());
 	}
 	
-	// 无法找到目标物品（数据不一致）
-	Result.ErrorMessage = TEXT("目标槽位数据异常：物品不存在");
-	Result.Result = EMoveItemResult::Failed;
-	UE_LOG(LogGaia, Error, TEXT("[MoveItemWithinContainer] 无法找到目标物品: %s"),
-		*TargetSlot.ItemInstanceUID.ToString());
+	// 驻留分片的根容器列表可能来自过时的存档（崩溃恢复），登录前组件已登记的容器也不在其中
+	SetPlayerShardRoots(ShardId, RPCComp->GetOwnedContainerUIDs());
+}
+
+void UGaiaInventorySubsystem::HandlePlayerLogout(APlayerController* PlayerController)
+{
+	UGaiaInventoryRPCComponent* RPCComp = PlayerController ? PlayerController->FindComponentByClass<UGaiaInventoryRPCComponent>() : nullptr;
+	if (!RPCComp || RPCComp->GetInventoryShardId().IsEmpty())
+	{
+		return;
+	}
 	
-	return Result;
+	SetPlayerShardRoots(RPCComp->GetInventoryShardId(), RPCComp->GetOwnedContainerUIDs());
+	UnloadPlayerShard(RPCComp->GetInventoryShardId());
+	RPCComp->SetInventoryShardId(FString());
 }
 
-FMoveItemResult UGaiaInventorySubsystem::ProcessTargetSlotWithItem(FGaiaItemInstance* SourceItem, FGaiaItemInstance* TargetItem, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity)
+bool UGaiaInventorySubsystem::LoadPlayerShard(const FString& ShardId, TArray<FGuid>& OutRootContainerUIDs)
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(SourceItem);
-	check(TargetItem);
-	check(TargetContainer);
-	check(TargetSlotID >= 0);
-	check(Quantity > 0 && Quantity <= SourceItem->Quantity);
+	// 同一玩家刚登出时，上一次的分片可能还在写（写入失败时分片重新驻留）
+	WaitForPendingShardSave(ShardId);
 	
-	FMoveItemResult Result;
+	if (const TArray<FGuid>* Resident = ResidentPlayerShards.Find(ShardId))
+	{
+		OutRootContainerUIDs = *Resident;
+		return true;
+	}
 	
-	// 检查是否为相同类型（尝试堆叠）
-	if (SourceItem->ItemDefinitionID == TargetItem->ItemDefinitionID)
+	const double StartTime = FPlatformTime::Seconds();
+	
+	OutRootContainerUIDs.Reset();
+	
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *GetPlayerShardFilePath(ShardId), FILEREAD_Silent))
 	{
-		// TODO: 需要添加堆叠检查逻辑
-		UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 相同类型，尝试堆叠"));
-		return StackItems(SourceItem, TargetItem, Quantity);
+		// 新玩家
+		ResidentPlayerShards.Add(ShardId);
+		UE_LOG(LogGaia, Log, TEXT("[玩家分片] %s 没有存档，创建空分片"), *ShardId);
+		return true;
 	}
 	
-	// 检查目标物品是否有容器（尝试放入容器）
-	if (TargetItem->HasContainer())
+	TMap<FGuid, FGaiaItemInstance> LoadedItems;
+	TMap<FGuid, FGaiaContainerInstance> LoadedContainers;
+	FString Error;
+	if (!FGaiaInventorySerializer::Load(Data, LoadedItems, LoadedContainers, Error, GetLifetimeClock()))
 	{
-		// TODO: 需要添加容器检查逻辑
-		UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 目标物品有容器，尝试放入"));
-		FMoveItemResult ContainerResult = MoveToItemContainer(SourceItem, TargetItem, Quantity);
-		if (ContainerResult.Result == EMoveItemResult::Success)
+		UE_LOG(LogGaia, Error, TEXT("[玩家分片] %s 的存档损坏: %s"), *ShardId, *Error);
+		return false;
+	}
+	
+	for (const auto& ContainerPair : LoadedContainers)
+	{
+		if (!ContainerPair.Value.OwnerItemUID.IsValid())
 		{
-			return ContainerResult;
+			OutRootContainerUIDs.Add(ContainerPair.Key);
 		}
-		// 如果放入容器失败，不交换位置，直接返回失败
-		Result.ErrorMessage = TEXT("无法放入目标物品的容器");
-		Result.Result = EMoveItemResult::ContainerRejected;
-		UE_LOG(LogGaia, Warning, TEXT("[ProcessTargetSlotWithItem] 放入容器失败"));
-		return Result;
 	}
 	
-	// 不同类型且目标无容器，尝试交换位置
-	UE_LOG(LogGaia, Verbose, TEXT("[ProcessTargetSlotWithItem] 尝试交换位置"));
-	if (!SwapItems(SourceItem, TargetItem))
+	NotifyIdAllocatorOfUIDs(LoadedItems, LoadedContainers);
+	
+	// 崩溃恢复时，上次在线期间的数据已经随世界日志恢复到内存中，且比分片存档新
+	const bool bAlreadyResident = OutRootContainerUIDs.ContainsByPredicate([this](const FGuid& ContainerUID)
 	{
-		Result.ErrorMessage = TEXT("交换物品失败");
-		Result.Result = EMoveItemResult::Failed;
-		UE_LOG(LogGaia, Error, TEXT("[ProcessTargetSlotWithItem] 交换失败"));
-		return Result;
+		return Containers.Contains(ContainerUID);
+	});
+	
+	if (bAlreadyResident)
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[玩家分片] %s 的数据已在内存中（崩溃恢复），忽略分片存档"), *ShardId);
+	}
+	else
+	{
+		// 合并到权威数据，同时写入世界日志，在线期间崩溃可以恢复
+		FMutationScope MutationScope(*this);
+		
+		Containers.Reserve(Containers.Num() + LoadedContainers.Num());
+		for (auto& ContainerPair : LoadedContainers)
+		{
+			MarkContainerChanged(ContainerPair.Key);
+			ApplyContainerToRootCounts(ContainerPair.Value, 1);
+			Containers.Add(ContainerPair.Key, MoveTemp(ContainerPair.Value));
+		}
+		
+		AllItems.Reserve(AllItems.Num() + LoadedItems.Num());
+		for (auto& ItemPair : LoadedItems)
+		{
+			MarkItemChanged(ItemPair.Key);
+			ScheduleItemExpiry(AllItems.Add(ItemPair.Key, MoveTemp(ItemPair.Value)));
+		}
 	}
 	
-	Result.Result = EMoveItemResult::SwapPerformed;
-	Result.bWasSwapped = true;
-	Result.SwappedItemUID = TargetItem->InstanceUID;
-	UE_LOG(LogGaia, Log, TEXT("[ProcessTargetSlotWithItem] 交换成功: %s <-> %s"), 
-		*SourceItem->InstanceUID.ToString(), *TargetItem->InstanceUID.ToString());
-	return Result;
+	ResidentPlayerShards.Add(ShardId, OutRootContainerUIDs);
+	
+	UE_LOG(LogGaia, Log, TEXT("[玩家分片] 加载 %s: 物品 %d, 容器 %d, 耗时 %.2fms"),
+		*ShardId, LoadedItems.Num(), LoadedContainers.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
 }
 
-FMoveItemResult UGaiaInventorySubsystem::MoveItemAutoSlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 Quantity)
+bool UGaiaInventorySubsystem::UnloadPlayerShard(const FString& ShardId)
 {
-	// 参数已在调用者处验证，此处使用断言确保契约
-	check(Item);
-	check(TargetContainer);
-	check(Quantity > 0 && Quantity <= Item->Quantity);
+	TArray<FGuid> RootContainerUIDs;
+	if (!ResidentPlayerShards.RemoveAndCopyValue(ShardId, RootContainerUIDs))
+	{
+		return false;
+	}
 	
-	FMoveItemResult Result;
+	// 驻留的分片不会同时在保存（保存结束前分片不驻留，重新加载前会等待保存结束）
+	check(!PendingShardSaves.Contains(ShardId));
 	
-	// 1. 优先查找空槽位
-	int32 EmptySlotID = TargetContainer->FindEmptySlotID();
-	if (EmptySlotID != INDEX_NONE)
+	FPendingShardSave& PendingSave = PendingShardSaves.Add(ShardId);
+	PendingSave.RootContainerUIDs = RootContainerUIDs;
+	CollectShardContents(RootContainerUIDs, PendingSave.ContainerUIDs, PendingSave.ItemUIDs);
+	
+	// 数据在写入落盘前仍留在权威数据中（世界日志和快照照常包含它），工作线程使用拷贝
+	TMap<FGuid, FGaiaItemInstance> ShardItems;
+	ShardItems.Reserve(PendingSave.ItemUIDs.Num());
+	for (const FGuid& ItemUID : PendingSave.ItemUIDs)
 	{
-		UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 找到空槽位: %d"), EmptySlotID);
-		return MoveToEmptySlot(Item, TargetContainer, EmptySlotID, Quantity);
+		ShardItems.Add(ItemUID, AllItems.FindChecked(ItemUID));
+		PendingShardMembers.Add(ItemUID, ShardId);
 	}
 	
-	UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 无空槽位，尝试堆叠或放入嵌套容器"));
-	
-	// 2. 没有空槽位，遍历所有槽位尝试堆叠或放入嵌套容器
-	for (const FGaiaSlotInfo& Slot : TargetContainer->Slots)
+	TMap<FGuid, FGaiaContainerInstance> ShardContainers;
+	ShardContainers.Reserve(PendingSave.ContainerUIDs.Num());
+	for (const FGuid& ContainerUID : PendingSave.ContainerUIDs)
 	{
-		if (Slot.IsEmpty())
-			continue;
-			
-		FGaiaItemInstance* TargetItem = AllItems.Find(Slot.ItemInstanceUID);
-		if (!TargetItem)
-			continue;
-		
-		// 2.1 尝试堆叠（相同类型）
-		if (Item->ItemDefinitionID == TargetItem->ItemDefinitionID)
+		ShardContainers.Add(ContainerUID, Containers.FindChecked(ContainerUID));
+		PendingShardMembers.Add(ContainerUID, ShardId);
+	}
+	
+	TWeakObjectPtr<UGaiaInventorySubsystem> WeakThis(this);
+	PendingSave.Future = Async(EAsyncExecution::ThreadPool,
+		[ShardItems = MoveTemp(ShardItems), ShardContainers = MoveTemp(ShardContainers), FilePath = GetPlayerShardFilePath(ShardId), LifetimeClock = GetLifetimeClock()]()
 		{
-			// TODO: 需要添加堆叠检查逻辑
-			UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 尝试堆叠到物品: %s"), *TargetItem->InstanceUID.ToString());
-			FMoveItemResult StackResult = StackItems(Item, TargetItem, Quantity);
-			if (StackResult.IsSuccess())
-			{
-				UE_LOG(LogGaia, Log, TEXT("[MoveItemAutoSlot] 堆叠成功"));
-				return StackResult;
-			}
-		}
-		
-		// 2.2 尝试放入嵌套容器
-		if (TargetItem->HasContainer())
+			FGaiaInventorySaveStats Stats;
+			TArray<uint8> Data;
+			Stats.bSuccess = FGaiaInventorySerializer::Save(ShardItems, ShardContainers, Data, Stats.Error, LifetimeClock)
+				&& FGaiaInventorySerializer::WriteToFile(Data, FilePath, Stats);
+			return Stats;
+		},
+		[WeakThis, ShardId]()
 		{
-			// TODO: 需要添加容器检查逻辑
-			UE_LOG(LogGaia, Verbose, TEXT("[MoveItemAutoSlot] 尝试放入嵌套容器: %s"), *TargetItem->InstanceUID.ToString());
-			FMoveItemResult ContainerResult = MoveToItemContainer(Item, TargetItem, Quantity);
-			if (ContainerResult.Result == EMoveItemResult::Success)
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, ShardId]()
 			{
-				UE_LOG(LogGaia, Log, TEXT("[MoveItemAutoSlot] 成功放入嵌套容器"));
-				return ContainerResult;
-			}
-		}
-	}
+				if (UGaiaInventorySubsystem* Subsystem = WeakThis.Get())
+				{
+					Subsystem->FinishPendingShardSave(ShardId, true);
+				}
+			});
+		});
 	
-	// 3. 无法找到合适的位置
-	Result.ErrorMessage = TEXT("无法找到合适的位置移动物品");
-	Result.Result = EMoveItemResult::ContainerFull;
-	UE_LOG(LogGaia, Warning, TEXT("[MoveItemAutoSlot] 容器已满，无法移动"));
-	return Result;
+	return true;
 }
 
-//~END 移动辅助函数
+void UGaiaInventorySubsystem::AddPlayerShardRoot(const FString& ShardId, const FGuid& ContainerUID)
+{
+	if (TArray<FGuid>* RootContainerUIDs = ResidentPlayerShards.Find(ShardId))
+	{
+		RootContainerUIDs->AddUnique(ContainerUID);
+	}
+}
 
-//~BEGIN 查询辅助
+void UGaiaInventorySubsystem::SetPlayerShardRoots(const FString& ShardId, const TArray<FGuid>& RootContainerUIDs)
+{
+	if (TArray<FGuid>* ResidentRootUIDs = ResidentPlayerShards.Find(ShardId))
+	{
+		*ResidentRootUIDs = RootContainerUIDs;
+	}
+}
 
-TArray<FGaiaItemInstance> UGaiaInventorySubsystem::GetItemsInContainer(const FGuid& ContainerUID) const
+bool UGaiaInventorySubsystem::IsPlayerShardResident(const FString& ShardId) const
 {
-	TArray<FGaiaItemInstance> Items;
-	
-	for (const auto& Pair : AllItems)
+	return ResidentPlayerShards.Contains(ShardId);
+}
+
+FString UGaiaInventorySubsystem::GetPlayerShardId(const APlayerController* PlayerController)
+{
+	const APlayerState* PlayerState = PlayerController ? PlayerController->GetPlayerState<APlayerState>() : nullptr;
+	if (!PlayerState)
 	{
-		if (Pair.Value.CurrentContainerUID == ContainerUID)
-		{
-			Items.Add(Pair.Value);
-		}
+		return FString();
 	}
 	
-	return Items;
+	const FUniqueNetIdRepl& UniqueId = PlayerState->GetUniqueId();
+	return FPaths::MakeValidFileName(UniqueId.IsValid() ? UniqueId.ToString() : PlayerState->GetPlayerName());
 }
 
-TArray<FGaiaItemInstance> UGaiaInventorySubsystem::GetOrphanItems() const
+FString UGaiaInventorySubsystem::GetPlayerShardFilePath(const FString& ShardId) const
 {
-	TArray<FGaiaItemInstance> Items;
+	const UGaiaInventoryManagerSettings* Settings = GetDefault<UGaiaInventoryManagerSettings>();
+	return FPaths::Combine(FPaths::ProjectSavedDir(), Settings->PlayerShardDirectory, ShardId + TEXT(".inventory"));
+}
+
+void UGaiaInventorySubsystem::CollectShardContents(const TArray<FGuid>& RootContainerUIDs, TArray<FGuid>& OutContainerUIDs, TArray<FGuid>& OutItemUIDs) const
+{
+	OutContainerUIDs.Reset();
+	OutItemUIDs.Reset();
 	
-	for (const auto& Pair : AllItems)
+	TSet<FGuid> VisitedContainers;
+	for (const FGuid& RootUID : RootContainerUIDs)
 	{
-		if (Pair.Value.IsOrphan())
+		// 挂在分片外物品上的容器（例如放进了世界箱子的背包）属于世界，不移出
+		const FGaiaContainerInstance* Root = Containers.Find(RootUID);
+		if (Root && !Root->OwnerItemUID.IsValid())
 		{
-			Items.Add(Pair.Value);
+			VisitedContainers.Add(RootUID);
+			OutContainerUIDs.Add(RootUID);
 		}
 	}
 	
-	return Items;
+	// 逐层展开：容器槽位 -> 物品 -> 物品拥有的容器
+	for (int32 Index = 0; Index < OutContainerUIDs.Num(); ++Index)
+	{
+		const FGaiaContainerInstance& Container = Containers.FindChecked(OutContainerUIDs[Index]);
+		for (const FGaiaSlotInfo& Slot : Container.Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			if (!Item)
+			{
+				continue;
+			}
+			
+			OutItemUIDs.Add(Item->InstanceUID);
+			
+			bool bAlreadyVisited = false;
+			if (Item->HasContainer() && Containers.Contains(Item->OwnedContainerUID))
+			{
+				VisitedContainers.Add(Item->OwnedContainerUID, &bAlreadyVisited);
+				if (!bAlreadyVisited)
+				{
+					OutContainerUIDs.Add(Item->OwnedContainerUID);
+				}
+			}
+		}
+	}
 }
 
-void UGaiaInventorySubsystem::GetAllContainers(TArray<FGaiaContainerInstance>& OutContainers) const
+void UGaiaInventorySubsystem::WaitForPendingShardSave(const FString& ShardId)
 {
-	OutContainers.Empty();
-	Containers.GenerateValueArray(OutContainers);
+	if (FPendingShardSave* PendingSave = PendingShardSaves.Find(ShardId))
+	{
+		PendingSave->Future.Wait();
+		FinishPendingShardSave(ShardId, false);
+	}
 }
 
-int32 UGaiaInventorySubsystem::CountItemsByType(FName ItemDefID) const
+void UGaiaInventorySubsystem::FinishPendingShardSave(const FString& ShardId, bool bRetryIfChanged)
 {
-	int32 Count = 0;
+	// WaitForPendingShardSave 可能已经提前回收
+	FPendingShardSave* PendingSave = PendingShardSaves.Find(ShardId);
+	if (!PendingSave || !PendingSave->Future.IsReady())
+	{
+		return;
+	}
 	
-	for (const auto& Pair : AllItems)
+	const FGaiaInventorySaveStats Stats = PendingSave->Future.Get();
+	FPendingShardSave FinishedSave = MoveTemp(*PendingSave);
+	PendingShardSaves.Remove(ShardId);
+	
+	for (const FGuid& ContainerUID : FinishedSave.ContainerUIDs)
 	{
-		if (Pair.Value.ItemDefinitionID == ItemDefID)
+		PendingShardMembers.Remove(ContainerUID);
+	}
+	for (const FGuid& ItemUID : FinishedSave.ItemUIDs)
+	{
+		PendingShardMembers.Remove(ItemUID);
+	}
+	
+	if (!Stats.bSuccess)
+	{
+		// 数据还在内存和世界日志中，分片重新驻留，下次登出或关闭时重试
+		UE_LOG(LogGaia, Error, TEXT("[玩家分片] 保存 %s 失败，分片保留在内存中: %s"), *ShardId, *Stats.Error);
+		ResidentPlayerShards.Add(ShardId, MoveTemp(FinishedSave.RootContainerUIDs));
+		return;
+	}
+	
+	if (FinishedSave.bChangedSinceSnapshot)
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[玩家分片] %s 在保存期间被修改，存档已过时，%s"),
+			*ShardId, bRetryIfChanged ? TEXT("重新保存") : TEXT("分片保留在内存中"));
+		ResidentPlayerShards.Add(ShardId, MoveTemp(FinishedSave.RootContainerUIDs));
+		if (bRetryIfChanged)
 		{
-			Count += Pair.Value.Quantity;
+			UnloadPlayerShard(ShardId);
 		}
+		return;
 	}
 	
-	return Count;
+	// 存档已落盘，移出权威数据（移除同样写入世界日志）
+	{
+		FMutationScope MutationScope(*this);
+		
+		for (const FGuid& ItemUID : FinishedSave.ItemUIDs)
+		{
+			RemoveItemRecord(ItemUID);
+		}
+		
+		for (const FGuid& ContainerUID : FinishedSave.ContainerUIDs)
+		{
+			RemoveContainerRecord(ContainerUID);
+		}
+	}
+	
+	UE_LOG(LogGaia, Log, TEXT("[玩家分片] 保存并移出 %s: 物品 %d, 容器 %d, %lld 字节, 写入 %.2fms（剩余物品 %d, 容器 %d）"),
+		*ShardId, FinishedSave.ItemUIDs.Num(), FinishedSave.ContainerUIDs.Num(), Stats.StoredBytes, Stats.WriteMs, AllItems.Num(), Containers.Num());
 }
 
-//~END 查询辅助
+void UGaiaInventorySubsystem::NotePendingShardChange(const FGuid& UID)
+{
+	if (const FString* ShardId = PendingShardMembers.Find(UID))
+	{
+		if (FPendingShardSave* PendingSave = PendingShardSaves.Find(*ShardId))
+		{
+			PendingSave->bChangedSinceSnapshot = true;
+		}
+	}
+}
+
+//~END 玩家分片
 
 //~BEGIN 数据验证
 
@@ -1654,6 +5436,107 @@ bool UGaiaInventorySubsystem::ValidateDataIntegrity() const
 		}
 	}
 	
+	// 3. 验证统计缓存
+	for (const auto& ContainerPair : Containers)
+	{
+		const FGaiaContainerInstance& Container = ContainerPair.Value;
+		if (!Container.HasValidAggregates())
+		{
+			continue;
+		}
+		
+		FGaiaContainerInstance Recalculated = Container;
+		RecalculateContainerAggregates(Recalculated, AllItems);
+		if (Recalculated.CachedUsedSlotCount != Container.CachedUsedSlotCount
+			|| Recalculated.CachedTotalWeight != Container.CachedTotalWeight
+			|| Recalculated.CachedTotalVolume != Container.CachedTotalVolume)
+		{
+			UE_LOG(LogGaia, Error, TEXT("[验证失败] 容器 %s 统计缓存不一致：槽位 %d/%d, 重量 %d/%d, 体积 %d/%d（缓存/实际）"),
+				*Container.ContainerUID.ToString(),
+				Container.CachedUsedSlotCount, Recalculated.CachedUsedSlotCount,
+				Container.CachedTotalWeight, Recalculated.CachedTotalWeight,
+				Container.CachedTotalVolume, Recalculated.CachedTotalVolume);
+			bIsValid = false;
+			ErrorCount++;
+		}
+		
+		if (!Recalculated.CachedDefinitionCounts.OrderIndependentCompareEqual(Container.CachedDefinitionCounts))
+		{
+			UE_LOG(LogGaia, Error, TEXT("[验证失败] 容器 %s 的定义数量索引与实际内容不一致"), *Container.ContainerUID.ToString());
+			bIsValid = false;
+			ErrorCount++;
+		}
+		
+		if (Recalculated.GridRows != Container.GridRows)
+		{
+			UE_LOG(LogGaia, Error, TEXT("[验证失败] 容器 %s 的网格占用位图与槽位不一致"), *Container.ContainerUID.ToString());
+			bIsValid = false;
+			ErrorCount++;
+		}
+	}
+	
+	// 3.1 验证网格容器中的物品占地在网格内且互不重叠
+	for (const auto& ContainerPair : Containers)
+	{
+		const FGaiaContainerInstance& Container = ContainerPair.Value;
+		const FGaiaContainerDefinition* ContainerDef = FindContainerDefinition(Container.ContainerDefinitionID);
+		if (!ContainerDef || !ContainerDef->bUseGridLayout)
+		{
+			continue;
+		}
+		
+		TArray<uint64> Rows;
+		Rows.SetNumZeroed(ContainerDef->GridHeight);
+		for (const FGaiaSlotInfo& Slot : Container.Slots)
+		{
+			const FGaiaItemInstance* Item = Slot.IsEmpty() ? nullptr : AllItems.Find(Slot.ItemInstanceUID);
+			const FGaiaItemDefinition* ItemDef = Item ? FindItemDefinition(Item->ItemDefinitionID) : nullptr;
+			if (!ItemDef)
+			{
+				continue;
+			}
+			
+			const FIntPoint Footprint = ItemDef->GetGridFootprint(Item->bRotated);
+			const int32 X = Slot.SlotID % ContainerDef->GridWidth;
+			const int32 Y = Slot.SlotID / ContainerDef->GridWidth;
+			if (!FGaiaInventoryGrid::IsAreaFree(Rows, ContainerDef->GridWidth, X, Y, Footprint.X, Footprint.Y))
+			{
+				UE_LOG(LogGaia, Error, TEXT("[验证失败] 网格容器 %s 中的物品 %s 超出网格或与其他物品重叠（槽位 %d）"),
+					*Container.ContainerUID.ToString(), *Item->InstanceUID.ToString(), Slot.SlotID);
+				bIsValid = false;
+				ErrorCount++;
+				continue;
+			}
+			FGaiaInventoryGrid::MarkArea(Rows, X, Y, Footprint.X, Footprint.Y, true);
+		}
+	}
+	
+	// 4. 验证根容器数量索引（应等于树中各容器定义数量之和）
+	TMap<FGuid, TMap<FName, int32>> ExpectedRootCounts;
+	for (const auto& ContainerPair : Containers)
+	{
+		for (const auto& CountPair : ContainerPair.Value.CachedDefinitionCounts)
+		{
+			ExpectedRootCounts.FindOrAdd(ContainerPair.Value.GetRootContainerUID()).FindOrAdd(CountPair.Key) += CountPair.Value;
+		}
+	}
+	for (const auto& RootPair : ExpectedRootCounts)
+	{
+		const TMap<FName, int32>* RootCounts = RootDefinitionCounts.Find(RootPair.Key);
+		if (!RootCounts || !RootCounts->OrderIndependentCompareEqual(RootPair.Value))
+		{
+			UE_LOG(LogGaia, Error, TEXT("[验证失败] 根容器 %s 的数量索引与容器树内容不一致"), *RootPair.Key.ToString());
+			bIsValid = false;
+			ErrorCount++;
+		}
+	}
+	if (ExpectedRootCounts.Num() != RootDefinitionCounts.Num())
+	{
+		UE_LOG(LogGaia, Error, TEXT("[验证失败] 数量索引中有 %d 个根容器，实际 %d 个"), RootDefinitionCounts.Num(), ExpectedRootCounts.Num());
+		bIsValid = false;
+		ErrorCount++;
+	}
+	
 	if (bIsValid)
 	{
 		UE_LOG(LogGaia, Log, TEXT("库存数据一致性验证通过！"));
@@ -1668,6 +5551,8 @@ bool UGaiaInventorySubsystem::ValidateDataIntegrity() const
 
 void UGaiaInventorySubsystem::RepairDataIntegrity()
 {
+	FMutationScope MutationScope(*this);
+	
 	UE_LOG(LogGaia, Log, TEXT("开始修复库存数据一致性..."));
 	
 	int32 RepairCount = 0;
@@ -1694,6 +5579,7 @@ void UGaiaInventorySubsystem::RepairDataIntegrity()
 						
 						Item->CurrentContainerUID = Container.ContainerUID;
 						Item->CurrentSlotID = Slot.SlotID;
+						MarkItemChanged(Item->InstanceUID);
 						RepairCount++;
 					}
 				}
@@ -1706,6 +5592,27 @@ void UGaiaInventorySubsystem::RepairDataIntegrity()
 		}
 	}
 	
+	// 父子关系、嵌套深度和根容器以物品位置为准重建
+	for (const auto& ItemPair : AllItems)
+	{
+		if (FGaiaContainerInstance* OwnedContainer = ItemPair.Value.HasContainer() ? Containers.Find(ItemPair.Value.OwnedContainerUID) : nullptr)
+		{
+			OwnedContainer->ParentContainerUID = ItemPair.Value.CurrentContainerUID;
+		}
+	}
+	FGaiaInventorySerializer::RebuildNestingInfo(Containers);
+	
+	// 统计缓存一律全量重算
+	for (auto& ContainerPair : Containers)
+	{
+		RecalculateContainerAggregates(ContainerPair.Value, AllItems);
+		++ContainerPair.Value.ContentRevision;
+	}
+	RebuildRootDefinitionCounts();
+	
+	// 修复可能改动任意容器的槽位，下一次增量保存全量重写
+	InvalidateIncrementalSave();
+	
 	UE_LOG(LogGaia, Log, TEXT("库存数据一致性修复完成！共修复 %d 个问题"), RepairCount);
 }
 
@@ -1738,78 +5645,17 @@ void UGaiaInventorySubsystem::BroadcastContainerUpdate(const FGuid& ContainerUID
 
 FContainerUIDebugInfo UGaiaInventorySubsystem::GetContainerDebugInfo(const FGuid& ContainerUID)
 {
-	FContainerUIDebugInfo DebugInfo;
-	DebugInfo.ContainerUID = ContainerUID;
-	
 	// 查找容器
-	FGaiaContainerInstance Container;
-	if (!FindContainerByUID(ContainerUID, Container))
+	const FGaiaContainerInstance* Container = Containers.Find(ContainerUID);
+	if (!Container)
 	{
+		FContainerUIDebugInfo DebugInfo;
+		DebugInfo.ContainerUID = ContainerUID;
 		DebugInfo.SlotUsage = TEXT("容器不存在");
 		return DebugInfo;
 	}
 	
-	// 基础信息
-	DebugInfo.ContainerDefID = Container.ContainerDefinitionID;
-	
-	// 获取容器定义（用于获取限制值）
-	FGaiaContainerDefinition ContainerDef;
-	bool bFoundDef = GetContainerDefinition(Container.ContainerDefinitionID, ContainerDef);
-	
-	// 槽位使用情况
-	int32 UsedSlots = 0;
-	TArray<FGaiaItemInstance> ItemsInContainer = GetItemsInContainer(ContainerUID);
-	UsedSlots = ItemsInContainer.Num();
-	
-	int32 MaxSlots = bFoundDef ? ContainerDef.SlotCount : Container.Slots.Num();
-	
-	DebugInfo.SlotUsage = FString::Printf(TEXT("%d / %d (%.1f%%)"),
-		UsedSlots,
-		MaxSlots,
-		MaxSlots > 0 ? (float)UsedSlots / MaxSlots * 100.0f : 0.0f
-	);
-	
-	// 重量和体积信息
-	int32 TotalWeight = 0;
-	int32 TotalVolume = 0;
-	
-	for (const FGaiaItemInstance& Item : ItemsInContainer)
-	{
-		FGaiaItemDefinition ItemDef;
-		if (GetItemDefinition(Item.ItemDefinitionID, ItemDef))
-		{
-			TotalWeight += ItemDef.ItemWeight * Item.Quantity;
-			TotalVolume += ItemDef.ItemVolume * Item.Quantity;
-		}
-	}
-	
-	// 注意：当前项目没有实现MaxWeight限制，只有MaxVolume
-	int32 MaxVolume = bFoundDef ? ContainerDef.MaxVolume : 0;
-	bool bVolumeEnabled = bFoundDef && ContainerDef.bEnableVolumeLimit;
-	
-	DebugInfo.WeightInfo = FString::Printf(TEXT("%d (总重量)"), TotalWeight);
-	
-	DebugInfo.VolumeInfo = bVolumeEnabled
-		? FString::Printf(TEXT("%d / %d (%.1f%%)"),
-			TotalVolume,
-			MaxVolume,
-			MaxVolume > 0 ? (float)TotalVolume / MaxVolume * 100.0f : 0.0f
-		)
-		: FString::Printf(TEXT("%d (无限制)"), TotalVolume);
-	
-	// 物品列表
-	for (const FGaiaItemInstance& Item : ItemsInContainer)
-	{
-		FString ItemStr = FString::Printf(TEXT("槽位%d: %s x%d (UID: %s)"),
-			Item.CurrentSlotID,
-			*Item.ItemDefinitionID.ToString(),
-			Item.Quantity,
-			*Item.InstanceUID.ToString().Left(8) // 只显示前8位
-		);
-		DebugInfo.ItemList.Add(ItemStr);
-	}
-	
-	return DebugInfo;
+	return BuildContainerDebugInfo(*Container, AllItems);
 }
 
 //~END 网络/多人游戏支持
@@ -2,10 +2,33 @@
 
 #include "Subsystems/WorldSubsystem.h"
 #include "GaiaInventoryTypes.h"
+#include "GaiaInventoryPersistence.h"
+#include "GaiaInventoryIdAllocator.h"
+#include "GaiaInventoryTimerWheel.h"
+#include "Engine/TimerHandle.h"
+#include "Async/Future.h"
 #include "GaiaInventorySubsystem.generated.h"
 
 #define UE_API GAIAGAME_API
 
+class APlayerController;
+class UGaiaLootTable;
+class UGaiaCraftingRecipe;
+
+/**
+ * 根容器的物品定义数量发生变化（修改作用域结束时每个根容器广播一次）
+ * @param RootContainerUID 根容器
+ * @param ChangedDefinitionIDs 数量变化的物品定义
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FGaiaOnRootDefinitionCountsChanged, const FGuid& /*RootContainerUID*/, const TArray<FName>& /*ChangedDefinitionIDs*/);
+
+/**
+ * 一批物品过期（时间轮每次推进最多广播一次，删除/转变已完成）
+ * @param DestroyedItemUIDs 过期后删除的物品
+ * @param TransformedItemUIDs 过期后原地转变为 ExpiredItemDefinitionID 的物品
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FGaiaOnItemsExpired, const TArray<FGuid>& /*DestroyedItemUIDs*/, const TArray<FGuid>& /*TransformedItemUIDs*/);
+
 /**
  * Gaia库存管理器设置
  * 用于配置库存系统的全局参数
@@ -25,6 +48,58 @@ public:
 	/** 容器定义数据注册表类型 */
 	UPROPERTY(config, EditAnywhere, Category = "Data Registry")
 	FName ContainerDefinitionRegistryType;
+	
+	/** 专用服务器挂载烘焙生成的定义数据库，定义查询不再经过数据注册表 */
+	UPROPERTY(config, EditAnywhere, Category = "Data Registry")
+	bool bUseDefinitionDatabaseOnServer = true;
+	
+	/** 定义数据库文件（相对于 Content 目录），由 GaiaDefinitionBlob 命令行工具生成 */
+	UPROPERTY(config, EditAnywhere, Category = "Data Registry", meta = (EditCondition = "bUseDefinitionDatabaseOnServer"))
+	FString DefinitionDatabasePath = TEXT("ServerData/GaiaDefinitions.bin");
+	
+	/** 使用按块预留的64位递增UID；关闭时每个物品/容器调用 FGuid::NewGuid */
+	UPROPERTY(config, EditAnywhere, Category = "Identifiers")
+	bool bUseBlockIdAllocator = true;
+	
+	/** 服务器ID（0-65535），多台服务器共享存档或交换物品时必须互不相同 */
+	UPROPERTY(config, EditAnywhere, Category = "Identifiers", meta = (ClampMin = "0", ClampMax = "65535", EditCondition = "bUseBlockIdAllocator"))
+	int32 InventoryServerId = 0;
+	
+	/** UID高水位状态文件（相对于 Saved 目录） */
+	UPROPERTY(config, EditAnywhere, Category = "Identifiers", meta = (EditCondition = "bUseBlockIdAllocator"))
+	FString IdAllocatorStateFile = TEXT("Inventory/IdAllocator.state");
+
+	/** 容器最大嵌套深度（放在顶层容器中的背包深度为1）；0 表示不限制 */
+	UPROPERTY(config, EditAnywhere, Category = "Rules", meta = (ClampMin = "0"))
+	int32 MaxNestingDepth = 0;
+	
+	/** 世界容器空间索引的网格边长（厘米），接近常用查询半径时效率最高 */
+	UPROPERTY(config, EditAnywhere, Category = "World Containers", meta = (ClampMin = "100", Units = "cm"))
+	float WorldContainerCellSize = 2000.0f;
+	
+	/** 快速堆放到附近容器的最大半径（厘米），客户端请求的半径会被限制到此值 */
+	UPROPERTY(config, EditAnywhere, Category = "World Containers", meta = (ClampMin = "0", Units = "cm"))
+	float MaxQuickStackRadius = 1500.0f;
+	
+	/** 物品寿命时间轮的刻度（秒）：过期检查的间隔，也是过期时间的精度 */
+	UPROPERTY(config, EditAnywhere, Category = "Lifetime", meta = (ClampMin = "0.1", Units = "s"))
+	float ItemLifetimeTickInterval = 1.0f;
+	
+	/** 制作配方，世界开始时由 UGaiaCraftingSubsystem 加载 */
+	UPROPERTY(config, EditAnywhere, Category = "Crafting")
+	TArray<TSoftObjectPtr<UGaiaCraftingRecipe>> CraftingRecipes;
+	
+	/** 操作日志压缩间隔（秒），到时写入新快照并截断日志；0 表示只在启动和关闭时压缩 */
+	UPROPERTY(config, EditAnywhere, Category = "Persistence", meta = (ClampMin = "0", Units = "s"))
+	float JournalCompactionInterval = 300.0f;
+	
+	/** 按玩家分片：玩家登录时加载其拥有的容器，登出时保存并从内存移除；世界容器始终驻留 */
+	UPROPERTY(config, EditAnywhere, Category = "Persistence")
+	bool bEnablePlayerShards = false;
+	
+	/** 玩家分片存档目录（相对于 Saved 目录） */
+	UPROPERTY(config, EditAnywhere, Category = "Persistence", meta = (EditCondition = "bEnablePlayerShards"))
+	FString PlayerShardDirectory = TEXT("Inventory/Players");
 };
 
 /**
@@ -63,6 +138,19 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
 	static UE_API bool GetContainerDefinition(FName ContainerDefID, FGaiaContainerDefinition& OutContainerDef);
 	
+	/**
+	 * 查找物品定义（直接返回数据注册表缓存或定义数据库中的指针，不拷贝）
+	 * 定义数据库挂载后只查数据库，其中的定义不含文本、图标和菜单字段
+	 * @return 定义不存在时返回nullptr
+	 */
+	static UE_API const FGaiaItemDefinition* FindItemDefinition(FName ItemDefID);
+	
+	/**
+	 * 查找容器定义（直接返回数据注册表缓存或定义数据库中的指针，不拷贝）
+	 * @return 定义不存在时返回nullptr
+	 */
+	static UE_API const FGaiaContainerDefinition* FindContainerDefinition(FName ContainerDefID);
+	
 	//~END 数据定义获取
 	
 	//~BEGIN 实例创建
@@ -73,14 +161,23 @@ public:
 	/** 创建容器实例 */
 	UE_API FGuid CreateContainerInstance(FName ContainerDefID);
 	
+	/**
+	 * 替换UID分配器（为空时恢复默认分配器）
+	 * 替换后会用当前已有的UID通知新分配器
+	 */
+	UE_API void SetIdAllocator(TSharedPtr<IGaiaInventoryIdAllocator> InAllocator);
+	
+	/** 按设置创建的默认分配器（进程内共享，同一进程的多个World和离线工具不会发放重复UID） */
+	static UE_API TSharedPtr<IGaiaInventoryIdAllocator> GetDefaultIdAllocator();
+	
 	//~END 实例创建
 	
 	//~BEGIN 调试辅助
 	
-	/** 设置物品的调试显示名称 */
+	/** 设置物品的调试显示名称（写入调试名称旁表，发行版本中为空操作） */
 	UE_API void SetItemDebugName(const FGuid& ItemUID, const FString& DebugName);
 	
-	/** 设置容器的调试显示名称 */
+	/** 设置容器的调试显示名称（写入调试名称旁表，发行版本中为空操作） */
 	UE_API void SetContainerDebugName(const FGuid& ContainerUID, const FString& DebugName);
 	
 	//~END 调试辅助
@@ -114,6 +211,9 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
 	UE_API bool FindContainerByUID(const FGuid& ContainerUID, FGaiaContainerInstance& OutContainer);
 	
+	/** 获取容器所在容器树的根容器（容器不存在时返回无效UID） */
+	UE_API FGuid GetRootContainerUID(const FGuid& ContainerUID) const;
+	
 	//~END 查询功能
 
 	//~BEGIN 容器操作
@@ -153,9 +253,356 @@ public:
 	/** 删除物品（完全从系统中移除） */
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
 	UE_API bool DestroyItem(const FGuid& ItemUID);
+	
+	/**
+	 * 在网格容器中原地旋转物品（左上角格子不变，宽高互换）
+	 * 旋转后的占地必须仍在网格内且不与其他物品重叠；列表容器中的物品无法旋转
+	 * @return 是否旋转成功
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API bool RotateItem(const FGuid& ItemUID);
+	
+	/**
+	 * 设置容器的逐槽位限制（装备容器由 UGaiaEquipmentComponent 设置，仅服务器，不保存）
+	 * 有限制的容器中槽位ID为 N 的槽位只接受标签匹配 SlotAllowedItemTags[N] 的物品，且每个槽位只放一个；
+	 * 所有移入途径（移动、添加、交易）都遵守，批量发放、批量转移和整理跳过这类容器
+	 * @param ContainerUID 容器UID
+	 * @param SlotAllowedItemTags 每个槽位允许的物品标签（空数组表示取消限制）
+	 */
+	UE_API void SetContainerSlotFilters(const FGuid& ContainerUID, const TArray<FGameplayTagContainer>& SlotAllowedItemTags);
+	
+	/** 容器是否有逐槽位限制 */
+	bool HasContainerSlotFilters(const FGuid& ContainerUID) const { return ContainerSlotFilters.Contains(ContainerUID); }
 
 	//~END 容器操作
 
+	//~BEGIN 批量发放
+	
+	/**
+	 * 批量发放物品到容器树
+	 * 同一物品的请求先合并；先补满树中已有的未满堆叠，再按最大堆叠数拆分新建物品放入空槽位。
+	 * 目标容器树只遍历一次，标签/嵌套/体积规则与 TryAddItemToContainer 一致
+	 * @param Grants 发放列表
+	 * @param TargetContainerUID 目标根容器
+	 * @param bIncludeNestedContainers 是否也放入树中嵌套的容器（按广度优先顺序）
+	 * @return 发放结果（放不下的部分在 Overflow 中）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API FGaiaGrantResult GrantItems(const TArray<FGaiaItemGrant>& Grants, const FGuid& TargetContainerUID, bool bIncludeNestedContainers = true);
+	
+	/**
+	 * 按掉落表掷骰并批量发放
+	 * @param RandomSeed 随机种子（0 表示随机）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API FGaiaGrantResult GrantLootTable(const UGaiaLootTable* LootTable, const FGuid& TargetContainerUID, int32 RandomSeed = 0, bool bIncludeNestedContainers = true);
+	
+	/**
+	 * 从容器树中批量扣除物品（全部足够才扣除，否则不做任何修改）
+	 * 同一物品的请求先合并，容器树只遍历一次，从靠后的堆叠开始扣，扣空的物品删除。
+	 * 自身带容器的物品不会被扣除
+	 * @param Costs 扣除列表
+	 * @param RootContainerUID 根容器
+	 * @param bIncludeNestedContainers 是否也从树中嵌套的容器扣除
+	 * @return 是否扣除成功
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API bool ConsumeItems(const TArray<FGaiaItemGrant>& Costs, const FGuid& RootContainerUID, bool bIncludeNestedContainers = true);
+	
+	/**
+	 * 在一次修改中扣除并发放（制作等），两步作为同一批写入操作日志
+	 * 材料不足或产出放不下时什么都不做；产出只能放入扣除前已有的空间（扣除腾出的槽位不计入）
+	 * @param Costs 扣除列表
+	 * @param Grants 发放列表
+	 * @param ContainerUID 扣除和发放所在的根容器
+	 * @param OutGrantResult 发放结果（失败时 Overflow 为放不下的部分）
+	 * @param bIncludeNestedContainers 是否包含树中嵌套的容器
+	 * @return 是否成功（失败时容器树不变）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API bool ExchangeItems(const TArray<FGaiaItemGrant>& Costs, const TArray<FGaiaItemGrant>& Grants, const FGuid& ContainerUID, FGaiaGrantResult& OutGrantResult, bool bIncludeNestedContainers = true);
+	
+	//~END 批量发放
+
+	//~BEGIN 交易
+	
+	/**
+	 * 检查报价是否有效：物品存在且在根容器的树中、数量不超过堆叠数量、带容器的物品整件给出、没有重复的物品
+	 * @param RootContainerUID 报价方的根容器
+	 * @param Offers 报价
+	 * @param OutErrorMessage 无效时的原因
+	 */
+	UE_API bool ValidateTradeOffers(const FGuid& RootContainerUID, const TArray<FGaiaTradeOffer>& Offers, FString& OutErrorMessage) const;
+	
+	/**
+	 * 在两棵容器树之间一次性交换物品（玩家交易）
+	 * 先取出双方报价的物品（部分数量从堆叠中拆出），再放入对方的容器树（按广度优先顺序放入空槽位，
+	 * 不与已有堆叠合并，标签/嵌套/体积规则与 TryAddItemToContainer 一致）。
+	 * 任何一件放不下时撤销全部修改，物品回到原来的槽位。整个交易是一次修改，日志只写入最终状态
+	 * @param RootContainerA 甲方根容器
+	 * @param OffersA 甲方给出的物品
+	 * @param RootContainerB 乙方根容器
+	 * @param OffersB 乙方给出的物品
+	 * @return 交易结果（失败时两棵容器树保持原样）
+	 */
+	UE_API FGaiaTradeResult ExecuteTrade(const FGuid& RootContainerA, const TArray<FGaiaTradeOffer>& OffersA, const FGuid& RootContainerB, const TArray<FGaiaTradeOffer>& OffersB);
+	
+	//~END 交易
+
+	//~BEGIN 整理
+	
+	/**
+	 * 整理容器：合并同一物品的未满堆叠，再按排序方式重写所有槽位
+	 * 排序一次完成（O(n log n)），统计缓存只重算一次，容器只产生一次变更
+	 * @param ContainerUID 要整理的容器
+	 * @param SortKey 排序方式（相同时依次按定义ID、数量排序）
+	 * @return 容器不存在或有逐槽位限制（装备容器）时返回false，布局不变
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API bool SortContainer(const FGuid& ContainerUID, EGaiaContainerSortKey SortKey = EGaiaContainerSortKey::Definition);
+	
+	/**
+	 * 合并容器树中同一物品的未满堆叠
+	 * 遍历一次容器树按定义分组，从后往前把靠后（通常更深）的堆叠倒入靠前的堆叠，补满到最大堆叠数，
+	 * 倒空的物品删除。跨容器转移遵守目标容器的体积限制
+	 * @param RootContainerUID 根容器
+	 * @param bIncludeNestedContainers 是否包含树中嵌套的容器（按广度优先顺序）
+	 * @return 合并结果
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API FGaiaConsolidateResult ConsolidateStacks(const FGuid& RootContainerUID, bool bIncludeNestedContainers = true);
+	
+	//~END 整理
+
+	//~BEGIN 世界容器
+	
+	/**
+	 * 登记世界中的容器（箱子等）的位置，重复登记时更新位置
+	 * 按网格哈希索引，半径查询只检查覆盖到的网格
+	 * @param ContainerUID 容器UID
+	 * @param Location 世界坐标
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API void RegisterWorldContainer(const FGuid& ContainerUID, const FVector& Location);
+	
+	/** 取消登记世界容器 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API void UnregisterWorldContainer(const FGuid& ContainerUID);
+	
+	/**
+	 * 查找半径内已登记的世界容器
+	 * @param Location 查询中心
+	 * @param Radius 查询半径
+	 * @param OutContainerUIDs 输出容器UID（由近到远）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API void FindWorldContainersInRadius(const FVector& Location, float Radius, TArray<FGuid>& OutContainerUIDs) const;
+	
+	/**
+	 * 快速堆放：把来源容器中与附近世界容器已有内容同定义的物品全部存入这些容器
+	 * 按定义数量索引匹配，由近到远先补满目标中的未满堆叠，剩余部分整堆移入空槽位，
+	 * 遵守目标容器的标签/体积规则。自身带容器的物品（背包等）不会被存入
+	 * @param SourceContainerUID 来源容器（通常是玩家背包）
+	 * @param Location 查询中心（通常是玩家位置）
+	 * @param Radius 查询半径
+	 * @param bIncludeNestedContainers 是否包含来源容器中嵌套的容器
+	 * @return 堆放结果
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	UE_API FGaiaConsolidateResult QuickStackToNearbyContainers(const FGuid& SourceContainerUID, const FVector& Location, float Radius, bool bIncludeNestedContainers = true);
+	
+	//~END 世界容器
+
+	//~BEGIN 数量索引
+	
+	/**
+	 * 获取容器树中指定物品定义的总数量（按根容器增量维护，O(1)）
+	 * @param RootContainerUID 根容器（嵌套容器返回0）
+	 * @param ItemDefID 物品定义ID
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	UE_API int32 GetRootDefinitionCount(const FGuid& RootContainerUID, FName ItemDefID) const;
+	
+	/** 获取容器树中各物品定义的总数量（不存在时返回nullptr） */
+	UE_API const TMap<FName, int32>* FindRootDefinitionCounts(const FGuid& RootContainerUID) const;
+	
+	/** 根容器的定义数量变化（修改作用域结束时广播） */
+	FGaiaOnRootDefinitionCountsChanged OnRootDefinitionCountsChanged;
+	
+	/** 数量索引整体重建（加载存档、恢复日志、修复数据之后），订阅者需要全部重新读取 */
+	FSimpleMulticastDelegate OnRootDefinitionCountsReset;
+	
+	//~END 数量索引
+
+	//~BEGIN 物品寿命
+	
+	/**
+	 * 设置物品从现在起的剩余寿命（临时物品、冷却中的物品等；定义了 LifetimeSeconds 的物品创建时自动设置）
+	 * 到期后按定义的 ExpiredItemDefinitionID 原地转变，未配置时删除
+	 * @param ItemUID 物品UID
+	 * @param LifetimeSeconds 剩余寿命（秒），0 表示取消过期
+	 * @return 物品不存在时返回false
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Lifetime")
+	UE_API bool SetItemLifetime(const FGuid& ItemUID, float LifetimeSeconds);
+	
+	/**
+	 * 获取物品的剩余寿命
+	 * @return 物品不存在或永不过期时返回false
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory|Lifetime")
+	UE_API bool GetItemRemainingLifetime(const FGuid& ItemUID, float& OutRemainingSeconds) const;
+	
+	/**
+	 * 物品寿命时钟（服务器世界时间，秒），FGaiaItemInstance::ExpireTime 以它为准
+	 * 客户端返回 GameState 同步的服务器时间，可直接与复制下来的 ExpireTime 比较
+	 */
+	UE_API double GetLifetimeClock() const;
+	
+	/** 时间轮中等待到期的条目数（含已取消、尚未丢弃的条目） */
+	int32 GetNumScheduledExpirations() const { return LifetimeWheel.Num(); }
+	
+	/** 一批物品过期 */
+	FGaiaOnItemsExpired OnItemsExpired;
+	
+	//~END 物品寿命
+
+	//~BEGIN 持久化
+	
+	/**
+	 * 将所有物品和容器序列化为二进制存档
+	 * @see FGaiaInventorySerializer
+	 * @param OutData 输出：存档字节
+	 * @return 是否成功
+	 */
+	UE_API bool SaveInventoryToMemory(TArray<uint8>& OutData) const;
+	
+	/**
+	 * 从二进制存档恢复（替换当前所有物品和容器）
+	 * 槽位引用、父子关系和统计缓存在加载时一次重建；失败时当前数据保持不变
+	 * @param Data 存档字节
+	 * @return 是否成功
+	 */
+	UE_API bool LoadInventoryFromMemory(const TArray<uint8>& Data);
+	
+	/** 保存到文件 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API bool SaveInventoryToFile(const FString& FilePath) const;
+	
+	/** 从文件加载（替换当前所有物品和容器） */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API bool LoadInventoryFromFile(const FString& FilePath);
+	
+	/**
+	 * 异步保存到文件
+	 * 游戏线程只做快照捕获（线性拷贝），序列化、压缩和写文件在工作线程进行
+	 * @param FilePath 存档路径
+	 * @param OnComplete 完成回调（游戏线程）
+	 * @return 已有保存在进行中时返回false
+	 */
+	UE_API bool SaveInventoryAsync(const FString& FilePath, FGaiaInventorySaveComplete OnComplete = FGaiaInventorySaveComplete());
+	
+	/** 阻塞等待进行中的异步保存完成（完成回调在返回前调用） */
+	UE_API void WaitForPendingSave();
+	
+	/** 是否有异步保存在进行中 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory|Persistence")
+	UE_API bool IsSaveInProgress() const;
+	
+	/** 最近一次异步保存的统计 */
+	const FGaiaInventorySaveStats& GetLastSaveStats() const { return LastSaveStats; }
+	
+	/**
+	 * 增量保存到按容器寻址的存档目录（后台写入）
+	 * 只重写上次保存后内容变化过的容器（及其中的物品）和游离物品；
+	 * 第一次保存、换目录或加载/修复数据之后做一次全量重写
+	 * @see FGaiaInventoryContainerStore
+	 * @param Directory 存档目录
+	 * @param OnComplete 完成回调（游戏线程）
+	 * @return 已有保存在进行中时返回false
+	 */
+	UE_API bool SaveInventoryIncremental(const FString& Directory, FGaiaInventorySaveComplete OnComplete = FGaiaInventorySaveComplete());
+	
+	/**
+	 * 从按容器寻址的存档目录加载（替换当前所有物品和容器）
+	 * 加载后以该目录为增量保存目标，下一次保存只写变化
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API bool LoadInventoryFromDirectory(const FString& Directory);
+	
+	/**
+	 * 启用操作日志（服务器启动时调用）
+	 * 目录中有快照/日志时先恢复：加载快照 -> 按顺序重放所有日志段 -> 立即压缩；没有时以当前数据为起点。
+	 * 之后每次已提交的修改都会追加到日志，并按 JournalCompactionInterval 定期压缩。
+	 * @param SaveDirectory 快照和日志所在目录
+	 * @return 是否成功
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API bool StartJournal(const FString& SaveDirectory);
+	
+	/** 停用操作日志（先压缩一次，保证下次启动无需重放） */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API void StopJournal();
+	
+	/**
+	 * 写入新快照并丢弃已被快照覆盖的日志段
+	 * 快照在后台写入；上一次快照仍在写入时本次跳过
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|Persistence")
+	UE_API void CompactJournal();
+	
+	/** 操作日志是否启用 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory|Persistence")
+	UE_API bool IsJournalActive() const;
+	
+	//~END 持久化
+
+	//~BEGIN 玩家分片
+	
+	/**
+	 * 玩家登录：加载玩家分片并把根容器注册到玩家的RPC组件
+	 * 由 GameMode::PostLogin 调用，未启用 bEnablePlayerShards 时不做任何事
+	 */
+	UE_API void HandlePlayerLogin(APlayerController* PlayerController);
+	
+	/** 玩家登出：保存玩家分片并从内存移除（由 GameMode::Logout 调用） */
+	UE_API void HandlePlayerLogout(APlayerController* PlayerController);
+	
+	/**
+	 * 加载玩家分片（合并到当前数据）
+	 * 分片已驻留（包括上次移出时保存失败）时直接返回；存档不存在时视为新玩家，登记一个空分片
+	 * @param ShardId 分片ID（通常是玩家的 UniqueNetId）
+	 * @param OutRootContainerUIDs 输出：分片的根容器（玩家直接拥有的容器）
+	 * @return 是否成功（存档损坏时返回false，数据保持不变）
+	 */
+	UE_API bool LoadPlayerShard(const FString& ShardId, TArray<FGuid>& OutRootContainerUIDs);
+	
+	/**
+	 * 保存并移除玩家分片
+	 * 分片由根容器及其中物品拥有的嵌套容器组成；存档在后台写入，
+	 * 写入成功落盘后才从内存移除（移除同时写入世界日志）。写入失败或保存期间数据又被修改时分片保持驻留
+	 * @param ShardId 分片ID
+	 * @return 分片未驻留时返回false
+	 */
+	UE_API bool UnloadPlayerShard(const FString& ShardId);
+	
+	/** 把容器登记为玩家分片的根容器（玩家获得新容器时由RPC组件调用） */
+	UE_API void AddPlayerShardRoot(const FString& ShardId, const FGuid& ContainerUID);
+	
+	/** 用玩家RPC组件拥有的容器重建分片的根容器列表（登录和登出时调用，组件的列表是权威的） */
+	UE_API void SetPlayerShardRoots(const FString& ShardId, const TArray<FGuid>& RootContainerUIDs);
+	
+	/** 分片是否已加载 */
+	UE_API bool IsPlayerShardResident(const FString& ShardId) const;
+	
+	/** 已加载的玩家分片数量 */
+	int32 GetNumResidentPlayerShards() const { return ResidentPlayerShards.Num(); }
+	
+	/** 获取玩家的分片ID（PlayerState 不存在时返回空字符串） */
+	static UE_API FString GetPlayerShardId(const APlayerController* PlayerController);
+	
+	//~END 玩家分片
+
 	//~BEGIN 数据验证
 	
 	/** 验证数据一致性（物品位置和槽位引用是否匹配） */
@@ -168,6 +615,129 @@ public:
 	
 	//~END 数据验证
 
+	//~BEGIN 共享规则
+	
+	/**
+	 * 纯规则检查：物品能否放入容器（标签、嵌套、循环引用、嵌套深度、体积）
+	 * 不查找空槽位，也不关心数据来源，服务器权威数据与客户端缓存共用同一套规则
+	 * @param Item 物品实例
+	 * @param ItemDef 物品定义
+	 * @param Container 目标容器
+	 * @param ContainerDef 目标容器定义
+	 * @param ItemMap 物品数据源（用于体积统计和循环检测）
+	 * @param ContainerMap 容器数据源（用于循环检测）
+	 * @return 检查结果（成功时SlotID为INDEX_NONE，由调用者决定槽位）
+	 */
+	static UE_API FAddItemResult CheckAddItemRules(
+		const FGaiaItemInstance& Item,
+		const FGaiaItemDefinition& ItemDef,
+		const FGaiaContainerInstance& Container,
+		const FGaiaContainerDefinition& ContainerDef,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap);
+	
+	/**
+	 * 在指定数据源中检查是否会造成循环引用
+	 * 只有目标容器与物品容器同根且更深时才沿父链向上走深度差那么多步，不分配内存
+	 */
+	static UE_API bool WouldCreateCycle(
+		const FGuid& ItemContainerUID,
+		const FGuid& TargetContainerUID,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap);
+	
+	/** 在指定数据源中计算容器已使用体积 */
+	static UE_API int32 ComputeContainerUsedVolume(const FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap);
+	
+	/**
+	 * 预计算拖放目标
+	 * 为每个目标容器的每个槽位给出 移动/堆叠/交换/嵌套 结果，
+	 * 规则与 CanAddItemToContainer / CanSwapItems / TryMoveItem 的路由保持一致
+	 * @param Item 被拖拽的物品
+	 * @param TargetContainerUIDs 需要计算的容器（通常是所有打开的窗口）
+	 * @param ItemMap 物品数据源
+	 * @param ContainerMap 容器数据源
+	 * @param OutTargets 输出：ContainerUID -> 各槽位结果（按SlotID索引）
+	 */
+	static UE_API void BuildDropTargetMap(
+		const FGaiaItemInstance& Item,
+		const TArray<FGuid>& TargetContainerUIDs,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap,
+		TMap<FGuid, FGaiaContainerDropTargets>& OutTargets);
+	
+	/**
+	 * 根据指定数据源生成容器调试信息
+	 * 统计值直接取容器的增量缓存，缓存失效时才遍历槽位
+	 * @param Container 容器实例
+	 * @param ItemMap 物品数据源
+	 * @param bIncludeItemList 是否生成逐物品的描述列表
+	 */
+	static UE_API FContainerUIDebugInfo BuildContainerDebugInfo(const FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap, bool bIncludeItemList = true);
+	
+	/**
+	 * 全量重算容器的统计缓存（已用槽位、体积、重量、网格占用）
+	 * @param Container 容器实例
+	 * @param ItemMap 物品数据源
+	 */
+	static UE_API void RecalculateContainerAggregates(FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap);
+	
+	/** 按槽位引用重建网格容器的占用位图（列表布局清空位图） */
+	static UE_API void RebuildGridOccupancy(FGaiaContainerInstance& Container, const TMap<FGuid, FGaiaItemInstance>& ItemMap);
+	
+	/**
+	 * 查找能放下物品的槽位
+	 * 列表布局取第一个空槽位；网格布局在占用位图中查找能容纳物品占地的左上角格子，
+	 * 优先使用 bPreferRotated 指定的朝向，放不下且物品允许旋转时再尝试另一个朝向
+	 * @param bOutRotated 输出：放在该槽位时的朝向
+	 * @return 槽位ID，放不下返回 INDEX_NONE
+	 */
+	static UE_API int32 FindPlacementSlot(
+		const FGaiaContainerInstance& Container,
+		const FGaiaContainerDefinition& ContainerDef,
+		const FGaiaItemDefinition& ItemDef,
+		bool bPreferRotated,
+		bool& bOutRotated);
+	
+	/**
+	 * 物品能否以指定朝向放在指定槽位
+	 * 列表布局要求槽位存在且为空；网格布局要求占地在网格内且不与其他物品重叠
+	 * @param IgnoredItem 检查时视为不在容器中的物品（整体移动时传入物品自身，可以与原位置重叠）
+	 */
+	static UE_API bool CanPlaceItemAtSlot(
+		const FGaiaContainerInstance& Container,
+		const FGaiaContainerDefinition& ContainerDef,
+		const FGaiaItemDefinition& ItemDef,
+		int32 SlotID,
+		bool bRotated,
+		const FGaiaItemInstance* IgnoredItem,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap);
+	
+	/**
+	 * 查找占用指定槽位的物品
+	 * 列表布局即槽位引用的物品；网格布局中格子可能被左上角在别处的物品覆盖
+	 * @return 物品UID，格子空闲时无效
+	 */
+	static UE_API FGuid FindItemCoveringSlot(
+		const FGaiaContainerInstance& Container,
+		const FGaiaContainerDefinition& ContainerDef,
+		int32 SlotID,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap);
+	
+	/**
+	 * 交换两个物品后双方的占地是否都放得下（不涉及网格容器时总是成立）
+	 * 同一网格容器内要求两者占地相同；跨容器时各自放到对方的左上角格子，不计被换出的物品
+	 */
+	static UE_API bool CanSwapItemFootprints(
+		const FGaiaItemInstance& Item1,
+		const FGaiaItemInstance& Item2,
+		const TMap<FGuid, FGaiaItemInstance>& ItemMap,
+		const TMap<FGuid, FGaiaContainerInstance>& ContainerMap);
+	
+	/** 使用权威数据预计算拖放目标（服务器/单机） */
+	UE_API void BuildDropTargetMap(const FGuid& ItemUID, const TArray<FGuid>& TargetContainerUIDs, TMap<FGuid, FGaiaContainerDropTargets>& OutTargets) const;
+	
+	//~END 共享规则
+
 	/** 获取物品总体积（含内容物） */
 	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
 	static UE_API int32 GetItemTotalVolume(const FGaiaItemInstance& Item);
@@ -195,15 +765,26 @@ private:
      */
 	UE_API FAddItemResult CanAddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container) const;
 	
+	/**
+	 * 检查移动是否符合源容器和目标容器的逐槽位限制（没有限制时直接通过）
+	 * @param InOutTargetSlotID 目标槽位，自动分配（-1）时改为第一个接受该物品的空槽位
+	 * @return 是否通过，失败时 OutResult 包含原因
+	 */
+	UE_API bool CheckSlotFiltersForMove(const FGaiaItemInstance& Item, const FGaiaContainerInstance& TargetContainer, int32& InOutTargetSlotID, int32 Quantity, FMoveItemResult& OutResult) const;
+	
+	/** 有逐槽位限制的容器中第一个接受该物品的空槽位ID（没有返回 INDEX_NONE） */
+	UE_API int32 FindFilteredEmptySlot(const FGaiaContainerInstance& Container, const TArray<FGameplayTagContainer>& SlotFilters, const FGaiaItemDefinition& ItemDef) const;
+	
 	/** 
 	 * 添加物品到容器（内部函数，不做检查，直接操作指针）
 	 * @warning 仅在 TryAddItemToContainer 内部调用，已通过所有检查
 	 * @param Item 物品指针（非空，已验证）
 	 * @param Container 容器指针（非空，已验证）
 	 * @param SlotID 目标槽位
+	 * @param bRotated 放入网格容器时的朝向
 	 * @return 是否成功添加
 	 */
-	UE_API bool AddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container, const int32 SlotID = INDEX_NONE);
+	UE_API bool AddItemToContainer(FGaiaItemInstance* Item, FGaiaContainerInstance* Container, const int32 SlotID = INDEX_NONE, bool bRotated = false);
 
 	/** 
      * 检查是否可以交换物品（优化版本 - 直接使用指针）
@@ -258,11 +839,12 @@ private:
 	 * @warning 仅在 MoveItem 内部调用，已通过所有检查
 	 * @param Item 源物品指针（非空，已验证）
 	 * @param TargetContainer 目标容器指针（非空，已验证）
-	 * @param TargetSlotID 目标槽位ID（已验证有效且为空）
+	 * @param TargetSlotID 目标槽位ID（已验证有效且为空，网格布局在此检查占地）
 	 * @param Quantity 移动数量（已验证）
+	 * @param bRotated 放入后的朝向（网格布局）
 	 * @return 移动结果
 	 */
-	UE_API FMoveItemResult MoveToEmptySlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity);
+	UE_API FMoveItemResult MoveToEmptySlot(FGaiaItemInstance* Item, FGaiaContainerInstance* TargetContainer, int32 TargetSlotID, int32 Quantity, bool bRotated);
 	
 	/** 
 	 * 容器内移动物品（内部函数，不做检查，直接操作指针）
@@ -301,6 +883,278 @@ private:
 	/** 检查是否会造成循环引用 */
 	UE_API bool WouldCreateCycle(const FGuid& ItemContainerUID, const FGuid& TargetContainerUID) const;
 
+	/**
+	 * 更新容器的父容器、嵌套深度和根容器，并向下传递给其中嵌套的容器；新旧父链的子树高度随之更新
+	 * @param Container 被放入或取出的物品所拥有的容器
+	 * @param ParentContainer 新的父容器（nullptr 表示成为顶层容器）
+	 */
+	UE_API void UpdateNestingInfo(FGaiaContainerInstance& Container, const FGaiaContainerInstance* ParentContainer);
+
+	/** 按直接内容重算容器的子树高度，变化时沿父链继续向上（代价与路径长度成正比） */
+	UE_API void RefreshNestedHeight(const FGuid& ContainerUID);
+
+	/**
+	 * 创建物品实例并加入全局池（定义已解析、数量已按堆叠规则确定）
+	 * @return 全局池中的物品（下一次加入物品前有效）
+	 */
+	UE_API FGaiaItemInstance& CreateItemInstanceInternal(FName ItemDefID, const FGaiaItemDefinition& ItemDef, int32 Quantity);
+
+	/**
+	 * 从全局池删除物品记录，同时移除调试名称并记录变化
+	 * 不处理槽位引用和容器统计（调用者已让物品离开容器）
+	 * @return 物品是否存在
+	 */
+	UE_API bool RemoveItemRecord(const FGuid& ItemUID);
+
+	/**
+	 * 删除容器记录，同时从根容器定义数量中减去其内容、移除调试名称并记录变化
+	 * 不处理其中的物品
+	 * @return 容器是否存在
+	 */
+	UE_API bool RemoveContainerRecord(const FGuid& ContainerUID);
+
+	/**
+	 * 批量发放的实现
+	 * @param OutToppedUpQuantities 可选：补充的堆叠 -> 补充的数量（撤销发放用）
+	 */
+	UE_API FGaiaGrantResult GrantItemsInternal(const TArray<FGaiaItemGrant>& Grants, const FGuid& TargetContainerUID, bool bIncludeNestedContainers, TMap<FGuid, int32>* OutToppedUpQuantities);
+
+	/**
+	 * 按定义合并扣除列表，并收集容器树中可扣除的堆叠（不修改数据）
+	 * @param OutRequired 合并后的扣除数量
+	 * @param OutStacks 定义 -> 可扣除的堆叠（广度优先顺序）
+	 * @return 是否全部足够
+	 */
+	UE_API bool FindConsumableStacks(const TArray<FGaiaItemGrant>& Costs, const FGuid& RootContainerUID, bool bIncludeNestedContainers, TMap<FName, int32>& OutRequired, TMap<FName, TArray<FGuid>>& OutStacks) const;
+
+	/** 从收集到的堆叠中扣除（从靠后的堆叠开始，扣空的物品删除），数量必须已确认足够 */
+	UE_API void ConsumeStacks(const TMap<FName, int32>& Required, const TMap<FName, TArray<FGuid>>& Stacks);
+
+	//~BEGIN UID分配
+	
+	/** 分配新的物品/容器UID */
+	UE_API FGuid AllocateUID();
+	
+	/** 把载入的UID告知分配器，避免之后重复发放 */
+	UE_API void NotifyIdAllocatorOfUIDs(const TMap<FGuid, FGaiaItemInstance>& ItemMap, const TMap<FGuid, FGaiaContainerInstance>& ContainerMap) const;
+	
+	//~END UID分配
+	
+	//~BEGIN 增量统计
+	
+	/**
+	 * 物品进入容器后调用（槽位引用已写入）
+	 * 所有改变容器内容的操作都必须经过这三个入口，统计缓存才能保持正确
+	 */
+	UE_API void NotifyItemEnteredContainer(const FGaiaItemInstance& Item, FGaiaContainerInstance& Container);
+	
+	/** 物品离开容器后调用（槽位引用已清空） */
+	UE_API void NotifyItemLeftContainer(const FGaiaItemInstance& Item, FGaiaContainerInstance& Container);
+	
+	/** 物品数量变化后调用（Item.Quantity 已是新值） */
+	UE_API void NotifyItemQuantityChanged(const FGaiaItemInstance& Item, int32 OldQuantity);
+	
+	/** 按单个物品对容器统计做增量调整 */
+	UE_API void ApplyItemToAggregates(FGaiaContainerInstance& Container, const FGaiaItemInstance& Item, int32 QuantityDelta, int32 SlotDelta);
+	
+	/** 全量重算权威数据中的容器统计，定义数量的差值同步到根容器 */
+	UE_API void RecalculateLiveContainerAggregates(FGaiaContainerInstance& Container);
+	
+	/** 调整根容器的定义数量，并记录到本次修改的变化中 */
+	UE_API void AdjustRootDefinitionCount(const FGuid& RootContainerUID, FName ItemDefID, int32 Delta);
+	
+	/** 把容器的定义数量计入（Sign=1）或移出（Sign=-1）其根容器 */
+	UE_API void ApplyContainerToRootCounts(const FGaiaContainerInstance& Container, int32 Sign);
+	
+	/** 按所有容器重建根容器数量索引并广播重建事件 */
+	UE_API void RebuildRootDefinitionCounts();
+	
+	/** 广播本次修改中变化的根容器数量 */
+	UE_API void BroadcastRootDefinitionCountChanges();
+	
+	//~END 增量统计
+
+	//~BEGIN 物品寿命辅助
+	
+	/** 按定义的寿命设置新物品的过期时间 */
+	UE_API void InitializeItemLifetime(FGaiaItemInstance& Item, const FGaiaItemDefinition& ItemDef) const;
+	
+	/** 把物品的过期时间放入时间轮（永不过期的物品忽略），需要时启动过期定时器 */
+	UE_API void ScheduleItemExpiry(const FGaiaItemInstance& Item);
+	
+	/** 合并堆叠：目标堆叠取两者中较早的过期时间（不能靠合并延长寿命） */
+	UE_API void MergeItemExpiry(FGaiaItemInstance& Dest, const FGaiaItemInstance& Source);
+	
+	/** 数据整体替换（加载、恢复）后按所有物品重建时间轮 */
+	UE_API void RebuildLifetimeWheel();
+	
+	/** 过期定时器：推进时间轮，在一个修改作用域内批量删除或转变到期的物品 */
+	UE_API void ProcessExpiredItems();
+	
+	/**
+	 * 把到期物品原地转变为过期后的定义（UID和位置不变，数量按新定义的堆叠上限截断）
+	 * @return 带容器的物品或网格中放不下时返回false，由调用者删除
+	 */
+	UE_API bool TransformExpiredItem(FGaiaItemInstance& Item, FName ExpiredDefID, const FGaiaItemDefinition& ExpiredDef);
+	
+	/**
+	 * 删除带容器的到期物品前，把容器中的物品移到物品所在的容器树（广度优先，不含它自己的子树）
+	 * @param OutOrphanedItemUIDs 放不下而成为游离物品的部分（追加）
+	 */
+	UE_API void SpillContainedItems(const FGaiaItemInstance& ContainerItem, TArray<FGuid>& OutOrphanedItemUIDs);
+	
+	/** 时间对应的刻度（过期时间向上取整，物品不会提前过期） */
+	int64 GetLifetimeTick(double Time, bool bRoundUp) const
+	{
+		const double Ticks = Time / LifetimeTickInterval;
+		return bRoundUp ? FMath::CeilToInt64(Ticks) : FMath::FloorToInt64(Ticks);
+	}
+	
+	//~END 物品寿命辅助
+
+	//~BEGIN 操作日志
+	
+	/**
+	 * 一次完整修改的作用域
+	 * 修改过程中只记录受影响的物品/容器，离开最外层作用域时才把它们的最终状态写入日志，
+	 * 中间状态（如交换时的半完成状态）不会落盘
+	 */
+	struct FMutationScope
+	{
+		explicit FMutationScope(UGaiaInventorySubsystem& InSubsystem)
+			: Subsystem(InSubsystem)
+		{
+			++Subsystem.MutationScopeDepth;
+		}
+		
+		~FMutationScope()
+		{
+			if (--Subsystem.MutationScopeDepth == 0)
+			{
+				Subsystem.CommitJournal();
+				Subsystem.BroadcastRootDefinitionCountChanges();
+			}
+		}
+		
+		UGaiaInventorySubsystem& Subsystem;
+	};
+	
+	/** 记录物品在本次修改中发生变化（创建、移动、数量变化、删除） */
+	void MarkItemChanged(const FGuid& ItemUID)
+	{
+		if (Journal)
+		{
+			JournalDirtyItems.Add(ItemUID);
+		}
+		if (bTrackIncrementalChanges)
+		{
+			IncrementalDirtyItems.Add(ItemUID);
+		}
+		if (!PendingShardMembers.IsEmpty())
+		{
+			NotePendingShardChange(ItemUID);
+		}
+	}
+	
+	/** 记录容器在本次修改中被创建或删除 */
+	void MarkContainerChanged(const FGuid& ContainerUID)
+	{
+		if (Journal)
+		{
+			JournalDirtyContainers.Add(ContainerUID);
+		}
+		MarkContainerContentsChanged(ContainerUID);
+	}
+	
+	/** 记录容器的内容发生变化（只影响增量保存，日志以物品为单位记录） */
+	void MarkContainerContentsChanged(const FGuid& ContainerUID)
+	{
+		if (bTrackIncrementalChanges)
+		{
+			IncrementalDirtyContainers.Add(ContainerUID);
+		}
+		if (!PendingShardMembers.IsEmpty())
+		{
+			NotePendingShardChange(ContainerUID);
+		}
+	}
+	
+	/** 把本次修改涉及的物品/容器最终状态写入日志 */
+	UE_API void CommitJournal();
+	
+	/** 快照文件路径 */
+	UE_API FString GetSnapshotFilePath() const;
+	
+	/** 日志段文件路径 */
+	UE_API FString GetJournalFilePath(int32 Segment) const;
+	
+	/** 查找目录中已有的日志段序号（升序） */
+	UE_API void FindJournalSegments(TArray<int32>& OutSegments) const;
+	
+	/**
+	 * 压缩日志：捕获快照并切换到新日志段，快照写入成功后删除旧日志段
+	 * @param bWaitForPendingSave 上一次保存仍在进行时是否等待（否则跳过本次）
+	 */
+	UE_API void CompactJournalInternal(bool bWaitForPendingSave);
+	
+	/**
+	 * 在工作线程执行保存
+	 * @param Stats 已填写捕获耗时的统计
+	 * @param Work 工作线程执行的保存（只能访问已捕获的数据），返回是否成功
+	 * @param OnComplete 完成回调（游戏线程）
+	 */
+	UE_API void StartAsyncSave(const FGaiaInventorySaveStats& Stats, TUniqueFunction<bool(FGaiaInventorySaveStats&)>&& Work, FGaiaInventorySaveComplete OnComplete);
+	
+	/** 捕获增量保存的变更集并清空脏标记 */
+	UE_API void CaptureIncrementalChanges(bool bFullRewrite, FGaiaInventoryStoreChanges& OutChanges);
+	
+	/** 数据被整体替换（加载、修复）后，下一次增量保存需要全量重写 */
+	void InvalidateIncrementalSave()
+	{
+		bTrackIncrementalChanges = false;
+		IncrementalDirtyContainers.Reset();
+		IncrementalDirtyItems.Reset();
+	}
+	
+	/** 回收已完成的异步保存（记录统计并调用完成回调） */
+	UE_API void FinishPendingSave();
+	
+	//~END 操作日志
+
+	//~BEGIN 玩家分片辅助
+	
+	/** 玩家分片存档路径 */
+	UE_API FString GetPlayerShardFilePath(const FString& ShardId) const;
+	
+	/**
+	 * 收集分片包含的容器和物品（根容器 + 其中物品拥有的嵌套容器，逐层展开）
+	 * @param RootContainerUIDs 根容器
+	 * @param OutContainerUIDs 输出：分片中的容器
+	 * @param OutItemUIDs 输出：分片中的物品
+	 */
+	UE_API void CollectShardContents(const TArray<FGuid>& RootContainerUIDs, TArray<FGuid>& OutContainerUIDs, TArray<FGuid>& OutItemUIDs) const;
+	
+	/** 等待指定分片的后台保存完成（同一玩家快速重连时，先写完再读） */
+	UE_API void WaitForPendingShardSave(const FString& ShardId);
+	
+	/**
+	 * 回收已完成的分片保存：成功时把分片移出内存，失败时分片重新驻留
+	 * @param bRetryIfChanged 保存期间分片数据又被修改时是否立即重新保存（同步等待时不重试）
+	 */
+	UE_API void FinishPendingShardSave(const FString& ShardId, bool bRetryIfChanged);
+	
+	/** 保存中的分片成员被修改（由 Mark* 调用） */
+	UE_API void NotePendingShardChange(const FGuid& UID);
+	
+	//~END 玩家分片辅助
+
+	//~BEGIN 世界容器辅助
+	
+	/** 世界坐标所在的网格 */
+	UE_API FIntVector GetWorldContainerCell(const FVector& Location) const;
+	
+	//~END 世界容器辅助
+
 public:
 	//~BEGIN 查询辅助
 	
@@ -329,6 +1183,103 @@ private:
 	/** 所有容器实例的映射表（FGuid -> 容器实例） */
 	UPROPERTY()
 	TMap<FGuid, FGaiaContainerInstance> Containers;
+	
+	/** UID分配器 */
+	TSharedPtr<IGaiaInventoryIdAllocator> IdAllocator;
+	
+	/** 操作日志（未启用时为空） */
+	TUniquePtr<FGaiaInventoryJournal> Journal;
+	
+	/** 快照和日志所在目录 */
+	FString JournalDirectory;
+	
+	/** 本次修改中变化的物品 */
+	TSet<FGuid> JournalDirtyItems;
+	
+	/** 本次修改中创建或删除的容器 */
+	TSet<FGuid> JournalDirtyContainers;
+	
+	/** 当前修改作用域嵌套深度 */
+	int32 MutationScopeDepth = 0;
+	
+	/** 定期压缩定时器 */
+	FTimerHandle JournalCompactionTimerHandle;
+	
+	/** 当前写入的日志段序号 */
+	int32 JournalSegment = 0;
+	
+	/** 进行中的异步保存 */
+	TFuture<FGaiaInventorySaveStats> PendingSaveTask;
+	
+	/** 容器的逐槽位限制（容器UID -> 每个槽位允许的物品标签） */
+	TMap<FGuid, TArray<FGameplayTagContainer>> ContainerSlotFilters;
+	
+	/** 进行中的异步保存的完成回调 */
+	FGaiaInventorySaveComplete PendingSaveCallback;
+	
+	/** 最近一次异步保存的统计 */
+	FGaiaInventorySaveStats LastSaveStats;
+	
+	/** 是否在记录增量保存的脏数据（第一次增量保存之后开启） */
+	bool bTrackIncrementalChanges = false;
+	
+	/** 增量保存的目标目录 */
+	FString IncrementalSaveDirectory;
+	
+	/** 上次保存后内容变化过（或被删除）的容器 */
+	TSet<FGuid> IncrementalDirtyContainers;
+	
+	/** 上次保存后变化过的物品（只用于判断游离物品桶是否需要重写） */
+	TSet<FGuid> IncrementalDirtyItems;
+	
+	/** 游离物品桶中已保存的物品 */
+	TSet<FGuid> StoredOrphanItemUIDs;
+	
+	/** 已加载的玩家分片（分片ID -> 根容器） */
+	TMap<FString, TArray<FGuid>> ResidentPlayerShards;
+	
+	/** 进行中的分片保存：数据在写入落盘前仍留在内存中 */
+	struct FPendingShardSave
+	{
+		TFuture<FGaiaInventorySaveStats> Future;
+		
+		/** 保存时的根容器（失败时重新驻留） */
+		TArray<FGuid> RootContainerUIDs;
+		
+		/** 快照中的容器和物品（成功时移出） */
+		TArray<FGuid> ContainerUIDs;
+		TArray<FGuid> ItemUIDs;
+		
+		/** 快照之后分片数据又被修改过（存档已过时，不能移出） */
+		bool bChangedSinceSnapshot = false;
+	};
+	
+	/** 进行中的分片保存（分片ID -> 保存任务） */
+	TMap<FString, FPendingShardSave> PendingShardSaves;
+	
+	/** 保存中的分片成员（物品或容器UID -> 分片ID） */
+	TMap<FGuid, FString> PendingShardMembers;
+	
+	/** 世界容器网格索引（网格坐标 -> 容器UID） */
+	TMap<FIntVector, TArray<FGuid>> WorldContainerCells;
+	
+	/** 世界容器登记的位置 */
+	TMap<FGuid, FVector> WorldContainerLocations;
+	
+	/** 各根容器的物品定义总数量（容器树中所有容器的 CachedDefinitionCounts 之和） */
+	TMap<FGuid, TMap<FName, int32>> RootDefinitionCounts;
+	
+	/** 本次修改中数量变化的根容器和定义 */
+	TMap<FGuid, TSet<FName>> PendingRootCountChanges;
+	
+	/** 物品过期时间轮（条目以物品UID为键，到期时按物品当前的过期时间校验） */
+	FGaiaTimerWheel LifetimeWheel;
+	
+	/** 时间轮的刻度长度（秒，初始化时从设置读取） */
+	double LifetimeTickInterval = 1.0;
+	
+	/** 过期定时器（时间轮为空时停止） */
+	FTimerHandle LifetimeTimerHandle;
 };
 
 #undef UE_API
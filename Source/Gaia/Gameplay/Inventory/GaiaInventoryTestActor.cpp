@@ -1,8 +1,12 @@
 #include "GaiaInventoryTestActor.h"
 #include "GaiaInventorySubsystem.h"
 #include "GaiaInventoryTypes.h"
+#include "GaiaInventoryPersistence.h"
 #include "TimerManager.h"
 #include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogGaiaInventoryTest, Log, All);
 
@@ -63,6 +67,11 @@ void AGaiaInventoryTestActor::RunAllTests()
 		RunPerformanceTests();
 	}
 
+	if (bTestPersistenceAndTrade)
+	{
+		RunPersistenceAndTradeTests();
+	}
+
 	LogSeparator(FString::Printf(TEXT("测试完成: %d/%d 通过"), PassedTests, TotalTests));
 	
 	if (FailedTests > 0)
@@ -150,6 +159,17 @@ void AGaiaInventoryTestActor::RunPerformanceTests()
 	CleanupTestData();
 }
 
+void AGaiaInventoryTestActor::RunPersistenceAndTradeTests()
+{
+	LogSeparator(TEXT("持久化和交易测试"));
+	
+	Test_SaveLoadRoundTrip();
+	Test_JournalReplayAfterCrash();
+	Test_TradeRollbackWhenReceiverFull();
+	
+	CleanupTestData();
+}
+
 // ========================================
 // 基础功能测试实现
 // ========================================
@@ -1187,6 +1207,338 @@ bool AGaiaInventoryTestActor::Test_Performance_SearchEfficiency()
 	return true;
 }
 
+// ========================================
+// 持久化和交易测试实现
+// ========================================
+
+bool AGaiaInventoryTestActor::Test_SaveLoadRoundTrip()
+{
+	TotalTests++;
+	
+	UGaiaInventorySubsystem* InvSys = GetWorld()->GetSubsystem<UGaiaInventorySubsystem>();
+	if (!InvSys)
+	{
+		LogTestResult(TEXT("存档往返"), false, TEXT("无法获取库存子系统"));
+		FailedTests++;
+		return false;
+	}
+
+	// 创建测试数据
+	FGuid ContainerUID = InvSys->CreateContainerInstance(TEXT("PlayerBackpack"));
+	FGaiaItemInstance Item1 = InvSys->CreateItemInstance(TEXT("Wood"), 10);
+	FGaiaItemInstance Item2 = InvSys->CreateItemInstance(TEXT("Sword"), 1);
+
+	TestContainerUIDs.Add(ContainerUID);
+	TestItemUIDs.Add(Item1.InstanceUID);
+	TestItemUIDs.Add(Item2.InstanceUID);
+
+	InvSys->TryAddItemToContainer(Item1.InstanceUID, ContainerUID);
+	InvSys->TryAddItemToContainer(Item2.InstanceUID, ContainerUID);
+
+	TArray<FGaiaItemInstance> ItemsBefore = InvSys->GetItemsInContainer(ContainerUID);
+	if (ItemsBefore.Num() != 2)
+	{
+		LogTestResult(TEXT("存档往返"), false, 
+			FString::Printf(TEXT("容器中应有2个物品，实际有%d个"), ItemsBefore.Num()));
+		FailedTests++;
+		return false;
+	}
+
+	// 保存
+	TArray<uint8> SaveData;
+	if (!InvSys->SaveInventoryToMemory(SaveData))
+	{
+		LogTestResult(TEXT("存档往返"), false, TEXT("保存失败"));
+		FailedTests++;
+		return false;
+	}
+
+	// 保存之后的修改应被加载覆盖
+	InvSys->DestroyItem(Item1.InstanceUID);
+
+	if (!InvSys->LoadInventoryFromMemory(SaveData))
+	{
+		LogTestResult(TEXT("存档往返"), false, TEXT("加载失败"));
+		FailedTests++;
+		return false;
+	}
+
+	// 验证物品和槽位引用
+	FGaiaContainerInstance Container;
+	if (!InvSys->FindContainerByUID(ContainerUID, Container))
+	{
+		LogTestResult(TEXT("存档往返"), false, TEXT("加载后找不到容器"));
+		FailedTests++;
+		return false;
+	}
+
+	for (const FGaiaItemInstance& Before : ItemsBefore)
+	{
+		FGaiaItemInstance After;
+		if (!InvSys->FindItemByUID(Before.InstanceUID, After))
+		{
+			LogTestResult(TEXT("存档往返"), false, 
+				FString::Printf(TEXT("加载后找不到物品 %s"), *Before.ItemDefinitionID.ToString()));
+			FailedTests++;
+			return false;
+		}
+
+		if (After.ItemDefinitionID != Before.ItemDefinitionID || After.Quantity != Before.Quantity
+			|| After.CurrentContainerUID != Before.CurrentContainerUID || After.CurrentSlotID != Before.CurrentSlotID)
+		{
+			LogTestResult(TEXT("存档往返"), false, 
+				FString::Printf(TEXT("物品 %s 加载后数据不一致"), *Before.ItemDefinitionID.ToString()));
+			FailedTests++;
+			return false;
+		}
+
+		const int32 SlotIndex = Container.GetSlotIndexByID(After.CurrentSlotID);
+		if (SlotIndex == INDEX_NONE || Container.Slots[SlotIndex].ItemInstanceUID != After.InstanceUID)
+		{
+			LogTestResult(TEXT("存档往返"), false, 
+				FString::Printf(TEXT("槽位%d未引用物品 %s"), After.CurrentSlotID, *After.ItemDefinitionID.ToString()));
+			FailedTests++;
+			return false;
+		}
+	}
+
+	LogTestResult(TEXT("存档往返"), true, 
+		FString::Printf(TEXT("存档 %d 字节，物品和槽位引用一致"), SaveData.Num()));
+	PassedTests++;
+	return true;
+}
+
+bool AGaiaInventoryTestActor::Test_JournalReplayAfterCrash()
+{
+	TotalTests++;
+	
+	UGaiaInventorySubsystem* InvSys = GetWorld()->GetSubsystem<UGaiaInventorySubsystem>();
+	if (!InvSys)
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("无法获取库存子系统"));
+		FailedTests++;
+		return false;
+	}
+
+	// 快照：一个容器和其中的一个物品
+	FGuid ContainerUID = InvSys->CreateContainerInstance(TEXT("PlayerBackpack"));
+	FGaiaItemInstance Item = InvSys->CreateItemInstance(TEXT("Wood"), 10);
+
+	TestContainerUIDs.Add(ContainerUID);
+	TestItemUIDs.Add(Item.InstanceUID);
+
+	InvSys->TryAddItemToContainer(Item.InstanceUID, ContainerUID);
+
+	FGaiaContainerInstance Container;
+	if (!InvSys->FindContainerByUID(ContainerUID, Container) || !InvSys->FindItemByUID(Item.InstanceUID, Item))
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("创建测试数据失败"));
+		FailedTests++;
+		return false;
+	}
+
+	const FString TestDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("GaiaInventoryTest"));
+	const FString CommittedPath = FPaths::Combine(TestDirectory, TEXT("Committed.journal"));
+	const FString TornPath = FPaths::Combine(TestDirectory, TEXT("Torn.journal"));
+	IFileManager::Get().MakeDirectory(*TestDirectory, true);
+
+	// 已提交的批次：数量改为7
+	FGaiaItemInstance CommittedItem = Item;
+	CommittedItem.Quantity = 7;
+	{
+		FGaiaInventoryJournal Journal;
+		if (!Journal.Open(CommittedPath))
+		{
+			LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("无法打开日志文件"));
+			FailedTests++;
+			return false;
+		}
+		Journal.WriteItemState(CommittedItem);
+		Journal.Commit();
+	}
+
+	// 崩溃时写了一半的批次：数量改为3，只取批次的前一部分
+	FGaiaItemInstance TornItem = Item;
+	TornItem.Quantity = 3;
+	int64 TornBatchBytes = 0;
+	{
+		FGaiaInventoryJournal Journal;
+		if (!Journal.Open(TornPath))
+		{
+			LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("无法打开日志文件"));
+			FailedTests++;
+			return false;
+		}
+		Journal.WriteItemState(TornItem);
+		Journal.Commit();
+		TornBatchBytes = Journal.GetCommittedBytes();
+	}
+
+	TArray<uint8> JournalData;
+	TArray<uint8> TornData;
+	const bool bLoaded = FFileHelper::LoadFileToArray(JournalData, *CommittedPath)
+		&& FFileHelper::LoadFileToArray(TornData, *TornPath);
+	IFileManager::Get().DeleteDirectory(*TestDirectory, false, true);
+
+	if (!bLoaded || TornBatchBytes <= 4 || TornData.Num() < TornBatchBytes)
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("读取日志文件失败"));
+		FailedTests++;
+		return false;
+	}
+
+	const int32 TornBatchStart = TornData.Num() - static_cast<int32>(TornBatchBytes);
+	JournalData.Append(TornData.GetData() + TornBatchStart, static_cast<int32>(TornBatchBytes) - 4);
+
+	// 在快照上重放
+	TMap<FGuid, FGaiaItemInstance> ItemMap;
+	TMap<FGuid, FGaiaContainerInstance> ContainerMap;
+	ItemMap.Add(Item.InstanceUID, Item);
+	ContainerMap.Add(ContainerUID, Container);
+
+	int32 NumBatches = 0;
+	FString Error;
+	if (!FGaiaInventoryJournal::Replay(JournalData, ItemMap, ContainerMap, NumBatches, Error))
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, FString::Printf(TEXT("重放失败: %s"), *Error));
+		FailedTests++;
+		return false;
+	}
+	FGaiaInventorySerializer::RebuildDerivedData(ItemMap, ContainerMap);
+
+	// 已提交的批次生效，写了一半的批次被丢弃
+	const FGaiaItemInstance* ReplayedItem = ItemMap.Find(Item.InstanceUID);
+	if (NumBatches != 1 || !ReplayedItem || ReplayedItem->Quantity != CommittedItem.Quantity)
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, 
+			FString::Printf(TEXT("应重放1个批次、数量为%d，实际重放%d个批次、数量为%d"), 
+				CommittedItem.Quantity, NumBatches, ReplayedItem ? ReplayedItem->Quantity : 0));
+		FailedTests++;
+		return false;
+	}
+
+	const FGaiaContainerInstance& ReplayedContainer = ContainerMap.FindChecked(ContainerUID);
+	const int32 SlotIndex = ReplayedContainer.GetSlotIndexByID(ReplayedItem->CurrentSlotID);
+	if (SlotIndex == INDEX_NONE || ReplayedContainer.Slots[SlotIndex].ItemInstanceUID != ReplayedItem->InstanceUID)
+	{
+		LogTestResult(TEXT("崩溃后重放日志"), false, TEXT("重放后槽位未引用物品"));
+		FailedTests++;
+		return false;
+	}
+
+	LogTestResult(TEXT("崩溃后重放日志"), true, TEXT("已提交的批次生效，末尾不完整的批次被丢弃"));
+	PassedTests++;
+	return true;
+}
+
+bool AGaiaInventoryTestActor::Test_TradeRollbackWhenReceiverFull()
+{
+	TotalTests++;
+	
+	UGaiaInventorySubsystem* InvSys = GetWorld()->GetSubsystem<UGaiaInventorySubsystem>();
+	if (!InvSys)
+	{
+		LogTestResult(TEXT("接收方已满时交易撤销"), false, TEXT("无法获取库存子系统"));
+		FailedTests++;
+		return false;
+	}
+
+	// 甲方：一堆木头和一块石头
+	FGuid ContainerA = InvSys->CreateContainerInstance(TEXT("PlayerBackpack"));
+	FGaiaItemInstance Wood = InvSys->CreateItemInstance(TEXT("Wood"), 10);
+	FGaiaItemInstance Stone = InvSys->CreateItemInstance(TEXT("Stone"), 5);
+
+	TestContainerUIDs.Add(ContainerA);
+	TestItemUIDs.Add(Wood.InstanceUID);
+	TestItemUIDs.Add(Stone.InstanceUID);
+
+	InvSys->TryAddItemToContainer(Wood.InstanceUID, ContainerA);
+	InvSys->TryAddItemToContainer(Stone.InstanceUID, ContainerA);
+	InvSys->FindItemByUID(Wood.InstanceUID, Wood);
+	InvSys->FindItemByUID(Stone.InstanceUID, Stone);
+
+	// 乙方：每个槽位都放一把剑
+	FGuid ContainerB = InvSys->CreateContainerInstance(TEXT("PlayerBackpack"));
+	TestContainerUIDs.Add(ContainerB);
+
+	FGaiaContainerInstance ReceiverContainer;
+	InvSys->FindContainerByUID(ContainerB, ReceiverContainer);
+	for (int32 i = 0; i < ReceiverContainer.Slots.Num(); i++)
+	{
+		FGaiaItemInstance Sword = InvSys->CreateItemInstance(TEXT("Sword"), 1);
+		TestItemUIDs.Add(Sword.InstanceUID);
+		if (!InvSys->TryAddItemToContainer(Sword.InstanceUID, ContainerB).IsSuccess())
+		{
+			break;
+		}
+	}
+
+	InvSys->FindContainerByUID(ContainerB, ReceiverContainer);
+	for (const FGaiaSlotInfo& Slot : ReceiverContainer.Slots)
+	{
+		if (Slot.IsEmpty())
+		{
+			LogTestResult(TEXT("接收方已满时交易撤销"), false, TEXT("无法填满接收方容器"));
+			FailedTests++;
+			return false;
+		}
+	}
+
+	const int32 NumReceiverItems = InvSys->GetItemsInContainer(ContainerB).Num();
+
+	// 甲方拆出部分木头并整件给出石头，乙方没有空槽位
+	TArray<FGaiaTradeOffer> OffersA;
+	OffersA.Add(FGaiaTradeOffer(Wood.InstanceUID, 4));
+	OffersA.Add(FGaiaTradeOffer(Stone.InstanceUID, Stone.Quantity));
+
+	FGaiaTradeResult TradeResult = InvSys->ExecuteTrade(ContainerA, OffersA, ContainerB, TArray<FGaiaTradeOffer>());
+	if (TradeResult.bSuccess)
+	{
+		LogTestResult(TEXT("接收方已满时交易撤销"), false, TEXT("交易应该失败但成功了"));
+		FailedTests++;
+		return false;
+	}
+
+	// 验证甲方的物品回到原位，没有残留拆出的物品
+	TArray<FGaiaItemInstance> ItemsA = InvSys->GetItemsInContainer(ContainerA);
+	if (ItemsA.Num() != 2)
+	{
+		LogTestResult(TEXT("接收方已满时交易撤销"), false, 
+			FString::Printf(TEXT("甲方容器应有2个物品，实际有%d个"), ItemsA.Num()));
+		FailedTests++;
+		return false;
+	}
+
+	const TArray<FGaiaItemInstance> ItemsBefore = { Wood, Stone };
+	for (const FGaiaItemInstance& Before : ItemsBefore)
+	{
+		FGaiaItemInstance After;
+		if (!InvSys->FindItemByUID(Before.InstanceUID, After)
+			|| After.Quantity != Before.Quantity
+			|| After.CurrentContainerUID != Before.CurrentContainerUID
+			|| After.CurrentSlotID != Before.CurrentSlotID)
+		{
+			LogTestResult(TEXT("接收方已满时交易撤销"), false, 
+				FString::Printf(TEXT("物品 %s 未回到原位"), *Before.ItemDefinitionID.ToString()));
+			FailedTests++;
+			return false;
+		}
+	}
+
+	// 验证乙方没有变化
+	if (InvSys->GetItemsInContainer(ContainerB).Num() != NumReceiverItems)
+	{
+		LogTestResult(TEXT("接收方已满时交易撤销"), false, TEXT("乙方容器的物品数量发生了变化"));
+		FailedTests++;
+		return false;
+	}
+
+	LogTestResult(TEXT("接收方已满时交易撤销"), true, 
+		FString::Printf(TEXT("交易失败（%s），双方保持原样"), *TradeResult.ErrorMessage));
+	PassedTests++;
+	return true;
+}
+
 // ========================================
 // 辅助函数实现
 // ========================================
@@ -13,6 +13,7 @@
  * 3. 容器嵌套测试
  * 4. 物品移动测试（各种场景）
  * 5. 性能测试
+ * 6. 持久化和交易测试
  * 
  * 使用方法：
  * - 在关卡中放置此Actor
@@ -75,6 +76,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Test Categories")
 	bool bTestPerformance = false;
 
+	/** 持久化和交易测试 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Test Categories")
+	bool bTestPersistenceAndTrade = true;
+
 	// ========================================
 	// 性能测试设置
 	// ========================================
@@ -119,6 +124,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Test|Performance")
 	void RunPerformanceTests();
 
+	/** 运行持久化和交易测试 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Test|Persistence")
+	void RunPersistenceAndTradeTests();
+
 protected:
 	// ========================================
 	// 基础功能测试
@@ -225,6 +234,19 @@ protected:
 	/** 性能测试：查找效率 */
 	bool Test_Performance_SearchEfficiency();
 
+	// ========================================
+	// 持久化和交易测试
+	// ========================================
+	
+	/** 测试：存档保存后加载，物品和槽位不变 */
+	bool Test_SaveLoadRoundTrip();
+
+	/** 测试：模拟崩溃（日志末尾写了一半的批次）后重放日志 */
+	bool Test_JournalReplayAfterCrash();
+
+	/** 测试：接收方放不下时交易撤销，双方不变 */
+	bool Test_TradeRollbackWhenReceiverFull();
+
 	// ========================================
 	// 辅助函数
 	// ========================================
@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaInventoryTimerWheel.h"
+
+void FGaiaTimerWheel::Reset(int64 InCurrentTick)
+{
+	for (int32 Level = 0; Level < NumLevels; ++Level)
+	{
+		for (TArray<FEntry>& Slot : Slots[Level])
+		{
+			Slot.Empty();
+		}
+		Occupancy[Level] = 0;
+	}
+	CurrentTick = InCurrentTick;
+	NumEntries = 0;
+}
+
+void FGaiaTimerWheel::Schedule(const FGuid& Key, int64 Tick)
+{
+	// 当前刻度的槽位已经处理过，已到期的条目放到下一个刻度
+	Insert({ Key, FMath::Max(Tick, CurrentTick + 1) });
+}
+
+void FGaiaTimerWheel::Insert(const FEntry& Entry)
+{
+	// 超出最远距离的条目先按最远距离放置，保留真实刻度，到期时再重新放入
+	const int64 Tick = FMath::Min(Entry.Tick, CurrentTick + MaxDelta);
+	const int64 Delta = FMath::Max<int64>(Tick - CurrentTick, 0);
+
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= (int64(1) << (SlotBits * (Level + 1))))
+	{
+		++Level;
+	}
+
+	const int32 Index = static_cast<int32>((Tick >> (SlotBits * Level)) & (NumSlots - 1));
+	Slots[Level][Index].Add(Entry);
+	Occupancy[Level] |= uint64(1) << Index;
+	++NumEntries;
+}
+
+int32 FGaiaTimerWheel::Cascade(int32 Level)
+{
+	const int32 Index = static_cast<int32>((CurrentTick >> (SlotBits * Level)) & (NumSlots - 1));
+	if (Occupancy[Level] & (uint64(1) << Index))
+	{
+		TArray<FEntry> Entries = MoveTemp(Slots[Level][Index]);
+		Occupancy[Level] &= ~(uint64(1) << Index);
+		NumEntries -= Entries.Num();
+		for (const FEntry& Entry : Entries)
+		{
+			Insert(Entry);
+		}
+	}
+	return Index;
+}
+
+void FGaiaTimerWheel::Advance(int64 NowTick, TArray<FEntry>& OutExpired)
+{
+	while (CurrentTick < NowTick)
+	{
+		if (NumEntries == 0)
+		{
+			CurrentTick = NowTick;
+			break;
+		}
+
+		// 本圈剩余的第0层槽位中找下一个非空槽位，没有则跳到下一个级联边界
+		const int32 Index = static_cast<int32>(CurrentTick & (NumSlots - 1));
+		const uint64 Ahead = Index == NumSlots - 1 ? 0 : (Occupancy[0] & (~uint64(0) << (Index + 1)));
+		const int64 NextTick = Ahead != 0
+			? (CurrentTick & ~int64(NumSlots - 1)) + static_cast<int64>(FMath::CountTrailingZeros64(Ahead))
+			: (CurrentTick | (NumSlots - 1)) + 1;
+		if (NextTick > NowTick)
+		{
+			CurrentTick = NowTick;
+			break;
+		}
+		CurrentTick = NextTick;
+
+		// 第0层转完一圈：逐层级联，直到某一层不在边界上
+		const int32 NextIndex = static_cast<int32>(CurrentTick & (NumSlots - 1));
+		if (NextIndex == 0)
+		{
+			for (int32 Level = 1; Level < NumLevels && Cascade(Level) == 0; ++Level)
+			{
+			}
+		}
+
+		if (Occupancy[0] & (uint64(1) << NextIndex))
+		{
+			TArray<FEntry> Entries = MoveTemp(Slots[0][NextIndex]);
+			Occupancy[0] &= ~(uint64(1) << NextIndex);
+			NumEntries -= Entries.Num();
+			for (const FEntry& Entry : Entries)
+			{
+				if (Entry.Tick > CurrentTick)
+				{
+					Insert(Entry);
+				}
+				else
+				{
+					OutExpired.Add(Entry);
+				}
+			}
+		}
+	}
+}
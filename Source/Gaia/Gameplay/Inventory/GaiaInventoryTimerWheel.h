@@ -0,0 +1,72 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 分层时间轮（游戏线程）
+ *
+ * 5 层，每层 64 个槽位，第 L 层一个槽位覆盖 64^L 个刻度，最远可调度约 2^30 个刻度。
+ * 条目按到期刻度与当前刻度的差值放入最低能容纳的层；低层转完一圈时，把高层当前槽位的条目
+ * 重新分配到低层（级联）。每层用一个 uint64 记录非空槽位，推进时直接跳到下一个非空槽位或级联边界，
+ * 所以推进的开销只与到期条目数和跨过的边界数有关，与时间轮中的条目总数无关。
+ *
+ * 不支持删除：调用者在到期时自行校验条目是否仍然有效（被取消或重新调度的条目直接丢弃）。
+ */
+class GAIAGAME_API FGaiaTimerWheel
+{
+public:
+	/** 每层槽位数的位数 */
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 NumSlots = 1 << SlotBits;
+	static constexpr int32 NumLevels = 5;
+
+	/** 最远的调度距离（刻度），更远的条目先放在最高层，到期时再按剩余距离重新放入 */
+	static constexpr int64 MaxDelta = (int64(1) << (SlotBits * NumLevels)) - 1;
+
+	struct FEntry
+	{
+		FGuid Key;
+		int64 Tick = 0;
+	};
+
+	/** 清空并把当前刻度设置为 InCurrentTick */
+	void Reset(int64 InCurrentTick);
+
+	/**
+	 * 调度条目
+	 * @param Key 条目标识
+	 * @param Tick 到期刻度（不晚于当前刻度的条目在下一次推进时到期）
+	 */
+	void Schedule(const FGuid& Key, int64 Tick);
+
+	/**
+	 * 推进到 NowTick，输出期间到期的条目（按到期刻度升序）
+	 * @param NowTick 目标刻度（不大于当前刻度时什么也不做）
+	 * @param OutExpired 输出：到期的条目（追加）
+	 */
+	void Advance(int64 NowTick, TArray<FEntry>& OutExpired);
+
+	int64 GetCurrentTick() const { return CurrentTick; }
+	int32 Num() const { return NumEntries; }
+	bool IsEmpty() const { return NumEntries == 0; }
+
+private:
+	/** 按与当前刻度的差值放入对应层的槽位 */
+	void Insert(const FEntry& Entry);
+
+	/**
+	 * 把第 Level 层当前槽位的条目重新分配到低层
+	 * @return 该层的当前槽位下标（为0时上一层也到了边界）
+	 */
+	int32 Cascade(int32 Level);
+
+	TArray<FEntry> Slots[NumLevels][NumSlots];
+
+	/** 每层非空槽位的位图 */
+	uint64 Occupancy[NumLevels] = {};
+
+	int64 CurrentTick = 0;
+	int32 NumEntries = 0;
+};
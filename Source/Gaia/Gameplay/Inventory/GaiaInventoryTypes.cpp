@@ -1 +1,98 @@
 #include "GaiaInventoryTypes.h"
+#include "Misc/ScopeLock.h"
+
+#if !UE_BUILD_SHIPPING
+namespace GaiaInventoryDebugNames
+{
+	static FCriticalSection Lock;
+	static TMap<FGuid, FString> Names;
+}
+
+void FGaiaInventoryDebugNames::Set(const FGuid& UID, const FString& DebugName)
+{
+	FScopeLock ScopeLock(&GaiaInventoryDebugNames::Lock);
+	if (DebugName.IsEmpty())
+	{
+		GaiaInventoryDebugNames::Names.Remove(UID);
+	}
+	else
+	{
+		GaiaInventoryDebugNames::Names.Add(UID, DebugName);
+	}
+}
+
+FString FGaiaInventoryDebugNames::Get(const FGuid& UID)
+{
+	FScopeLock ScopeLock(&GaiaInventoryDebugNames::Lock);
+	const FString* DebugName = GaiaInventoryDebugNames::Names.Find(UID);
+	return DebugName ? *DebugName : FString();
+}
+
+void FGaiaInventoryDebugNames::Remove(const FGuid& UID)
+{
+	FScopeLock ScopeLock(&GaiaInventoryDebugNames::Lock);
+	GaiaInventoryDebugNames::Names.Remove(UID);
+}
+#endif
+
+bool FGaiaInventoryGrid::IsAreaFree(TConstArrayView<uint64> Rows, int32 GridWidth, int32 X, int32 Y, int32 Width, int32 Height)
+{
+	if (X < 0 || Y < 0 || Width <= 0 || Height <= 0 || X + Width > FMath::Min(GridWidth, MaxWidth) || Y + Height > Rows.Num())
+	{
+		return false;
+	}
+	
+	const uint64 Mask = MakeRowMask(X, Width);
+	for (int32 Row = Y; Row < Y + Height; ++Row)
+	{
+		if (Rows[Row] & Mask)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FGaiaInventoryGrid::FindFreeArea(TConstArrayView<uint64> Rows, int32 GridWidth, int32 Width, int32 Height, int32& OutX, int32& OutY)
+{
+	GridWidth = FMath::Min(GridWidth, MaxWidth);
+	if (Width <= 0 || Height <= 0 || Width > GridWidth || Height > Rows.Num())
+	{
+		return false;
+	}
+	
+	const uint64 GridMask = MakeRowMask(0, GridWidth);
+	for (int32 Y = 0; Y + Height <= Rows.Num(); ++Y)
+	{
+		uint64 Occupied = 0;
+		for (int32 Row = Y; Row < Y + Height; ++Row)
+		{
+			Occupied |= Rows[Row];
+		}
+		
+		// 网格外的高位为0，右移补进来的也是0，因此越界的起点会被自然排除
+		const uint64 Free = ~Occupied & GridMask;
+		uint64 Fits = Free;
+		for (int32 Shift = 1; Shift < Width && Fits; ++Shift)
+		{
+			Fits &= Free >> Shift;
+		}
+		
+		if (Fits)
+		{
+			OutX = FMath::CountTrailingZeros64(Fits);
+			OutY = Y;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FGaiaInventoryGrid::MarkArea(TArrayView<uint64> Rows, int32 X, int32 Y, int32 Width, int32 Height, bool bOccupied)
+{
+	const uint64 Mask = MakeRowMask(X, Width);
+	for (int32 Row = FMath::Max(Y, 0); Row < FMath::Min(Y + Height, Rows.Num()); ++Row)
+	{
+		Rows[Row] = bOccupied ? (Rows[Row] | Mask) : (Rows[Row] & ~Mask);
+	}
+}
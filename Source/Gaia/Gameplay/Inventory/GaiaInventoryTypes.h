@@ -5,6 +5,7 @@
 #include "GaiaInventoryTypes.generated.h"
 
 class UGaiaContainerWindowWidget;
+class APlayerState;
 
 // ========================================
 // 网络同步事件委托
@@ -22,6 +23,9 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnContainerOpened, const FGuid&, Co
 /** 容器关闭事件 */
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnContainerClosed, const FGuid&, ContainerUID);
 
+/** 可制作配方变化事件（配方下标即 UGaiaCraftingSubsystem 中的注册下标） */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnCraftableRecipesChanged, const FGuid&, RootContainerUID, const TArray<int32>&, ChangedRecipeIndices);
+
 // ========================================
 // 枚举定义
 // ========================================
@@ -93,6 +97,44 @@ enum class EItemContextAction : uint8
 	Custom UMETA(DisplayName = "Custom")
 };
 
+/**
+ * 容器整理的排序方式
+ */
+UENUM(BlueprintType)
+enum class EGaiaContainerSortKey : uint8
+{
+	/** 按物品定义ID */
+	Definition UMETA(DisplayName = "Definition"),
+	
+	/** 按物品的第一个标签 */
+	Tag UMETA(DisplayName = "Tag"),
+	
+	/** 按单件重量（重的在前） */
+	Weight UMETA(DisplayName = "Weight"),
+	
+	/** 按堆叠数量（多的在前） */
+	Quantity UMETA(DisplayName = "Quantity")
+};
+
+/**
+ * 交易会话状态
+ */
+UENUM(BlueprintType)
+enum class EGaiaTradeState : uint8
+{
+	/** 已发出邀请，等待对方接受 */
+	Pending UMETA(DisplayName = "Pending"),
+	
+	/** 双方正在报价 */
+	Open UMETA(DisplayName = "Open"),
+	
+	/** 已成交（会话结束） */
+	Completed UMETA(DisplayName = "Completed"),
+	
+	/** 已取消（会话结束） */
+	Cancelled UMETA(DisplayName = "Cancelled")
+};
+
 /**
  * 移动物品操作的结果类型
  */
@@ -165,6 +207,10 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Add Result")
 	int32 SlotID = INDEX_NONE;
 
+	/** 放入网格容器时是否旋转（由查找位置的调用者填写） */
+	UPROPERTY(BlueprintReadOnly, Category = "Add Result")
+	bool bRotated = false;
+
 	/** 构造函数 */
 	FAddItemResult() = default;
 	
@@ -262,6 +308,198 @@ public:
 	}
 };
 
+/** 批量发放请求：一种物品及其数量 */
+USTRUCT(BlueprintType)
+struct FGaiaItemGrant
+{
+	GENERATED_BODY()
+
+public:
+	/** 物品定义ID */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grant")
+	FName ItemDefinitionID = NAME_None;
+
+	/** 数量（可超过最大堆叠数，发放时自动拆分） */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grant", meta = (ClampMin = "1"))
+	int32 Quantity = 1;
+
+	FGaiaItemGrant() = default;
+
+	FGaiaItemGrant(FName InItemDefinitionID, int32 InQuantity)
+		: ItemDefinitionID(InItemDefinitionID)
+		, Quantity(InQuantity)
+	{}
+};
+
+/** 批量发放结果 */
+USTRUCT(BlueprintType)
+struct FGaiaGrantResult
+{
+	GENERATED_BODY()
+
+public:
+	/** 新创建并放入容器的物品 */
+	UPROPERTY(BlueprintReadOnly, Category = "Grant Result")
+	TArray<FGuid> CreatedItemUIDs;
+
+	/** 被补充数量的已有堆叠 */
+	UPROPERTY(BlueprintReadOnly, Category = "Grant Result")
+	TArray<FGuid> ToppedUpItemUIDs;
+
+	/** 内容发生变化的容器（用于广播） */
+	UPROPERTY(BlueprintReadOnly, Category = "Grant Result")
+	TArray<FGuid> AffectedContainerUIDs;
+
+	/** 放不下或定义无效的部分（按定义合并） */
+	UPROPERTY(BlueprintReadOnly, Category = "Grant Result")
+	TArray<FGaiaItemGrant> Overflow;
+
+	/** 实际发放的总数量 */
+	UPROPERTY(BlueprintReadOnly, Category = "Grant Result")
+	int32 GrantedQuantity = 0;
+
+	/** 是否全部发放 */
+	bool IsCompleteSuccess() const
+	{
+		return Overflow.IsEmpty();
+	}
+};
+
+/** 堆叠合并/快速堆放结果（一次操作的全部变化） */
+USTRUCT(BlueprintType)
+struct FGaiaConsolidateResult
+{
+	GENERATED_BODY()
+
+public:
+	/** 数量发生变化且仍然存在的堆叠 */
+	UPROPERTY(BlueprintReadOnly, Category = "Consolidate Result")
+	TArray<FGuid> ChangedItemUIDs;
+
+	/** 被倒空并删除的堆叠 */
+	UPROPERTY(BlueprintReadOnly, Category = "Consolidate Result")
+	TArray<FGuid> DestroyedItemUIDs;
+
+	/** 内容发生变化的容器（用于广播） */
+	UPROPERTY(BlueprintReadOnly, Category = "Consolidate Result")
+	TArray<FGuid> AffectedContainerUIDs;
+
+	/** 在堆叠之间转移的总数量 */
+	UPROPERTY(BlueprintReadOnly, Category = "Consolidate Result")
+	int32 MovedQuantity = 0;
+
+	/** 是否有任何变化 */
+	bool HasChanges() const
+	{
+		return MovedQuantity > 0;
+	}
+};
+
+/**
+ * 拖放目标的预期结果
+ * 拖拽开始时按服务器规则预先计算，悬停时直接查表
+ */
+UENUM(BlueprintType)
+enum class EGaiaDropOutcome : uint8
+{
+	Invalid,                   // 不可放置
+	Move,                      // 移动到空槽位
+	Stack,                     // 堆叠到同类物品
+	Swap,                      // 与目标物品交换
+	Nest                       // 放入目标物品的容器
+};
+
+/** 单个槽位的拖放目标信息 */
+USTRUCT(BlueprintType)
+struct FGaiaDropTargetInfo
+{
+	GENERATED_BODY()
+
+	/** 预期结果 */
+	UPROPERTY(BlueprintReadOnly, Category = "Drop Target")
+	EGaiaDropOutcome Outcome = EGaiaDropOutcome::Invalid;
+
+	/** 不可放置的原因（Outcome为Invalid时有效） */
+	UPROPERTY(BlueprintReadOnly, Category = "Drop Target")
+	EMoveItemResult Reason = EMoveItemResult::Failed;
+
+	/** 详细错误信息 */
+	UPROPERTY(BlueprintReadOnly, Category = "Drop Target")
+	FString ErrorMessage;
+
+	FGaiaDropTargetInfo() = default;
+
+	FGaiaDropTargetInfo(EGaiaDropOutcome InOutcome)
+		: Outcome(InOutcome)
+		, Reason(EMoveItemResult::Success)
+	{}
+
+	FGaiaDropTargetInfo(EMoveItemResult InReason, const FString& InErrorMessage)
+		: Outcome(EGaiaDropOutcome::Invalid)
+		, Reason(InReason)
+		, ErrorMessage(InErrorMessage)
+	{}
+
+	bool IsValid() const
+	{
+		return Outcome != EGaiaDropOutcome::Invalid;
+	}
+};
+
+/** 单个容器所有槽位的拖放目标信息（按SlotID索引） */
+USTRUCT(BlueprintType)
+struct FGaiaContainerDropTargets
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Drop Target")
+	TArray<FGaiaDropTargetInfo> Slots;
+};
+
+/** 槽位引用（搜索结果等只需要定位槽位的场合，不拷贝物品） */
+USTRUCT(BlueprintType)
+struct FGaiaSlotRef
+{
+	GENERATED_BODY()
+
+	/** 容器UID */
+	UPROPERTY(BlueprintReadOnly, Category = "Slot Ref")
+	FGuid ContainerUID;
+
+	/** 槽位ID */
+	UPROPERTY(BlueprintReadOnly, Category = "Slot Ref")
+	int32 SlotID = INDEX_NONE;
+
+	FGaiaSlotRef() = default;
+
+	FGaiaSlotRef(const FGuid& InContainerUID, int32 InSlotID)
+		: ContainerUID(InContainerUID)
+		, SlotID(InSlotID)
+	{}
+};
+
+/**
+ * 属性修正
+ * 装备在装备槽中的物品对角色属性的修正，同一属性的修正按 (基础值 + 加值之和) * (1 + 乘数加成之和) 汇总
+ */
+USTRUCT(BlueprintType)
+struct FGaiaStatModifier
+{
+	GENERATED_BODY()
+
+	/** 属性标签（如 Stat.Armor） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Stat Modifier")
+	FGameplayTag StatTag;
+
+	/** 加值 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Stat Modifier")
+	float Additive = 0.0f;
+
+	/** 乘数加成（0.1 表示 +10%） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Stat Modifier")
+	float Multiplicative = 0.0f;
+};
+
 /**
  * 物品定义
  * 定义物品的静态属性，存储在DataRegistry中
@@ -305,6 +543,30 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Properties")
 	FGameplayTagContainer ItemTags;
 
+	/** 在网格容器中占用的宽度（格子数，列表容器中忽略） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grid", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 GridWidth = 1;
+
+	/** 在网格容器中占用的高度（格子数，列表容器中忽略） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grid", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 GridHeight = 1;
+
+	/** 是否允许在网格容器中旋转90度 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Grid")
+	bool bAllowGridRotation = true;
+
+	/** 装备时的属性修正（由 UGaiaEquipmentComponent 汇总） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Equipment")
+	TArray<FGaiaStatModifier> StatModifiers;
+
+	/** 物品实例创建后的存活时间（秒，腐坏/临时物品），0 表示永不过期 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lifetime", meta = (ClampMin = "0", Units = "s"))
+	float LifetimeSeconds = 0.0f;
+
+	/** 过期后转变成的物品定义（如腐烂的食物），为空时过期物品被删除 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lifetime", meta = (EditCondition = "LifetimeSeconds > 0"))
+	FName ExpiredItemDefinitionID = NAME_None;
+
 	/** 是否有容器功能 */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container")
 	bool bHasContainer = false;
@@ -349,6 +611,19 @@ public:
 		// 其他情况，可以堆叠
 		return true;
 	}
+
+	/** 在网格容器中的占地（X=宽，Y=高，旋转时宽高互换） */
+	FIntPoint GetGridFootprint(bool bRotated) const
+	{
+		const FIntPoint Footprint(FMath::Max(GridWidth, 1), FMath::Max(GridHeight, 1));
+		return bRotated ? FIntPoint(Footprint.Y, Footprint.X) : Footprint;
+	}
+
+	/** 旋转后占地是否不同（正方形旋转没有意义） */
+	bool CanRotateInGrid() const
+	{
+		return bAllowGridRotation && GridWidth != GridHeight;
+	}
 };
 
 /**
@@ -374,10 +649,26 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Info")
 	TSoftObjectPtr<UTexture2D> ContainerIcon;
 
-	/** 槽位数量（固定） */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity", meta = (ClampMin = "1", ClampMax = "100"))
+	/** 槽位数量（固定，列表布局使用） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity", meta = (EditCondition = "!bUseGridLayout", ClampMin = "1", ClampMax = "100"))
 	int32 SlotCount = 20;
 
+	/**
+	 * 是否使用网格布局
+	 * 网格中每个格子是一个槽位（槽位ID = 行 * 宽度 + 列），物品按定义的宽高占用多个格子，
+	 * 只登记在左上角格子的槽位上，其余格子的占用记录在容器的行位图中
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity")
+	bool bUseGridLayout = false;
+
+	/** 网格宽度（列数，每行用一个64位位图表示，最多64列） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity", meta = (EditCondition = "bUseGridLayout", ClampMin = "1", ClampMax = "64"))
+	int32 GridWidth = 10;
+
+	/** 网格高度（行数） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity", meta = (EditCondition = "bUseGridLayout", ClampMin = "1", ClampMax = "64"))
+	int32 GridHeight = 6;
+
 	/** 是否启用体积限制 */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Container Capacity")
 	bool bEnableVolumeLimit = false;
@@ -399,6 +690,12 @@ public:
 	{
 	}
 
+	/** 实际槽位数量（网格布局为格子数） */
+	int32 GetSlotCount() const
+	{
+		return bUseGridLayout ? GridWidth * GridHeight : SlotCount;
+	}
+
 	/** 检查是否允许指定标签的物品 */
 	bool HasAllowedTag(const FGameplayTag& InItemTag) const
 	{
@@ -462,6 +759,25 @@ public:
 	}
 };
 
+#if !UE_BUILD_SHIPPING
+/**
+ * 调试显示名称旁表（仅开发版本）
+ * 物品和容器共用，按UID索引；不参与复制和存档，发行版本中不存在
+ * 加锁保护，日志可以在任意线程读取
+ */
+struct GAIAGAME_API FGaiaInventoryDebugNames
+{
+	/** 设置调试名称（空字符串等同于移除） */
+	static void Set(const FGuid& UID, const FString& DebugName);
+
+	/** 获取调试名称（未设置返回空字符串） */
+	static FString Get(const FGuid& UID);
+
+	/** 移除调试名称 */
+	static void Remove(const FGuid& UID);
+};
+#endif
+
 /**
  * 物品实例
  * 运行时物品数据，代表具体的一个或一堆物品
@@ -496,9 +812,16 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = "Item Location")
 	int32 CurrentSlotID = -1;
 
-	/** 调试显示名称（用于日志输出） */
-	UPROPERTY(BlueprintReadWrite, Category = "Debug")
-	FString DebugDisplayName;
+	/** 在网格容器中是否旋转了90度（宽高互换，列表容器中忽略） */
+	UPROPERTY(BlueprintReadWrite, Category = "Item Location")
+	bool bRotated = false;
+
+	/**
+	 * 过期时间（服务器世界时间，秒），0 表示永不过期；由库存子系统的时间轮调度
+	 * 客户端用 UGaiaInventorySubsystem::GetLifetimeClock（同步后的服务器时间）计算剩余寿命，不能与本地 GetTimeSeconds 比较
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Item Lifetime")
+	double ExpireTime = 0.0;
 
 public:
 	FGaiaItemInstance()
@@ -508,10 +831,17 @@ public:
 		, OwnedContainerUID()
 		, CurrentContainerUID()
 		, CurrentSlotID(-1)
-		, DebugDisplayName(TEXT(""))
+		, bRotated(false)
+		, ExpireTime(0.0)
 	{
 	}
 
+	/** 是否会过期 */
+	bool HasLifetime() const
+	{
+		return ExpireTime > 0.0;
+	}
+
 	/** 是否有容器 */
 	bool HasContainer() const
 	{
@@ -539,10 +869,13 @@ public:
 	/** 获取简短的调试名称 */
 	FString GetDebugName() const
 	{
+#if !UE_BUILD_SHIPPING
+		const FString DebugDisplayName = FGaiaInventoryDebugNames::Get(InstanceUID);
 		if (!DebugDisplayName.IsEmpty())
 		{
 			return FString::Printf(TEXT("%s(x%d)"), *DebugDisplayName, Quantity);
 		}
+#endif
 		return FString::Printf(TEXT("%s(x%d)"), *ItemDefinitionID.ToString(), Quantity);
 	}
 
@@ -580,25 +913,51 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = "Container Instance")
 	FGuid ParentContainerUID;
 
+	/** 嵌套深度（顶层容器为0，由子系统在嵌套和取出时维护） */
+	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
+	int32 NestingDepth = 0;
+
+	/** 子树高度（内部嵌套容器的最大层数，没有嵌套容器为0，由子系统与嵌套深度一起维护） */
+	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
+	int32 NestedHeight = 0;
+
+	/** 所在容器树的根容器UID（无效表示自身就是根，由子系统维护） */
+	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
+	FGuid RootContainerUID;
+
 	/** 槽位信息列表（只保存引用，不保存物品数据） */
 	UPROPERTY(BlueprintReadWrite, Category = "Container Instance")
 	TArray<FGaiaSlotInfo> Slots;
 
-	/** 缓存的总重量（优化用） */
+	/** 缓存的总重量（直接内容物，不含嵌套容器内容，由子系统增量维护） */
 	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
 	int32 CachedTotalWeight = 0;
 
-	/** 缓存的总体积（优化用） */
+	/** 缓存的总体积（直接内容物，由子系统增量维护） */
 	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
 	int32 CachedTotalVolume = 0;
 
-	/** 是否需要重新计算缓存 */
+	/** 缓存的已用槽位数（由子系统增量维护） */
+	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
+	int32 CachedUsedSlotCount = 0;
+
+	/** 内容修订号（每次内容变化递增，用于UI判断是否需要重建） */
+	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
+	int32 ContentRevision = 0;
+
+	/** 是否需要重新计算缓存（为true时缓存值不可信，需要全量重算） */
 	UPROPERTY(BlueprintReadOnly, Category = "Container Instance")
 	bool bNeedRecalculate = true;
 
-	/** 调试显示名称（用于日志输出） */
-	UPROPERTY(BlueprintReadWrite, Category = "Debug")
-	FString DebugDisplayName;
+	/** 各物品定义的总数量（直接内容物，与统计缓存一起由子系统增量维护，服务器本地使用，不复制） */
+	TMap<FName, int32> CachedDefinitionCounts;
+
+	/**
+	 * 网格布局的占用位图（每行一个 uint64，第X位对应第X列，列表布局为空）
+	 * 由子系统在槽位变化时维护，随容器数据下发，客户端拖放预判直接使用
+	 */
+	UPROPERTY()
+	TArray<uint64> GridRows;
 
 public:
 	FGaiaContainerInstance()
@@ -606,17 +965,41 @@ public:
 		, ContainerDefinitionID(NAME_None)
 		, OwnerItemUID()
 		, ParentContainerUID()
+		, NestingDepth(0)
+		, NestedHeight(0)
+		, RootContainerUID()
 		, CachedTotalWeight(0)
 		, CachedTotalVolume(0)
+		, CachedUsedSlotCount(0)
+		, ContentRevision(0)
 		, bNeedRecalculate(true)
-		, DebugDisplayName(TEXT(""))
 	{
 	}
 
-	/** 标记需要重新计算 */
+	/** 标记需要重新计算（缓存失效，下次查询时全量重算） */
 	void MarkDirty()
 	{
 		bNeedRecalculate = true;
+		++ContentRevision;
+	}
+
+	/** 缓存的统计值是否可用 */
+	bool HasValidAggregates() const
+	{
+		return !bNeedRecalculate;
+	}
+
+	/** 获取容器中指定物品定义的总数量（需要统计缓存有效） */
+	int32 GetCachedDefinitionCount(FName ItemDefID) const
+	{
+		const int32* Count = CachedDefinitionCounts.Find(ItemDefID);
+		return Count ? *Count : 0;
+	}
+
+	/** 获取所在容器树的根容器UID */
+	FGuid GetRootContainerUID() const
+	{
+		return RootContainerUID.IsValid() ? RootContainerUID : ContainerUID;
 	}
 
 	/** 获取槽位在数组中的索引 */
@@ -648,6 +1031,11 @@ public:
 	/** 获取已使用的槽位数量 */
 	int32 GetUsedSlotCount() const
 	{
+		if (HasValidAggregates())
+		{
+			return CachedUsedSlotCount;
+		}
+		
 		int32 Count = 0;
 		for (const FGaiaSlotInfo& Slot : Slots)
 		{
@@ -662,10 +1050,13 @@ public:
 	/** 获取简短的调试名称 */
 	FString GetDebugName() const
 	{
+#if !UE_BUILD_SHIPPING
+		FString DebugDisplayName = FGaiaInventoryDebugNames::Get(ContainerUID);
 		if (!DebugDisplayName.IsEmpty())
 		{
 			return DebugDisplayName;
 		}
+#endif
 		return ContainerDefinitionID.ToString();
 	}
 
@@ -676,6 +1067,159 @@ public:
 	}
 };
 
+/** 交易报价：一件物品及给出的数量 */
+USTRUCT(BlueprintType)
+struct FGaiaTradeOffer
+{
+	GENERATED_BODY()
+
+public:
+	/** 物品UID（必须在报价方的容器树中） */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trade")
+	FGuid ItemUID;
+
+	/** 给出的数量（可堆叠物品可以只给出一部分，带容器的物品整件给出） */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trade", meta = (ClampMin = "1"))
+	int32 Quantity = 1;
+
+	FGaiaTradeOffer() = default;
+
+	FGaiaTradeOffer(const FGuid& InItemUID, int32 InQuantity)
+		: ItemUID(InItemUID)
+		, Quantity(InQuantity)
+	{}
+
+	bool operator==(const FGaiaTradeOffer& Other) const
+	{
+		return ItemUID == Other.ItemUID && Quantity == Other.Quantity;
+	}
+};
+
+/** 交易执行结果 */
+USTRUCT(BlueprintType)
+struct FGaiaTradeResult
+{
+	GENERATED_BODY()
+
+public:
+	/** 是否成交（失败时两棵容器树都没有任何变化） */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Result")
+	bool bSuccess = false;
+
+	/** 失败原因 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Result")
+	FString ErrorMessage;
+
+	/** 甲方收到的物品（只给出部分数量的堆叠是新拆出的物品） */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Result")
+	TArray<FGuid> ReceivedItemUIDsA;
+
+	/** 乙方收到的物品 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Result")
+	TArray<FGuid> ReceivedItemUIDsB;
+
+	static FGaiaTradeResult Failure(const FString& InErrorMessage)
+	{
+		FGaiaTradeResult Result;
+		Result.ErrorMessage = InErrorMessage;
+		return Result;
+	}
+};
+
+/**
+ * 交易会话的客户端视图（从接收方的角度）
+ * 对方的物品不在接收方的本地缓存中，随视图一起发送快照
+ */
+USTRUCT(BlueprintType)
+struct FGaiaTradeSessionView
+{
+	GENERATED_BODY()
+
+public:
+	/** 会话ID */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	FGuid SessionID;
+
+	/** 会话状态 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	EGaiaTradeState State = EGaiaTradeState::Pending;
+
+	/** 报价修订号（任何一方修改报价时递增，确认时必须与服务器一致） */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	int32 Revision = 0;
+
+	/** 对方的玩家状态 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	TObjectPtr<APlayerState> Partner;
+
+	/** 是否由自己发起 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	bool bIsInitiator = false;
+
+	/** 自己的报价 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	TArray<FGaiaTradeOffer> MyOffers;
+
+	/** 对方的报价 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	TArray<FGaiaTradeOffer> PartnerOffers;
+
+	/** 对方报价中物品的快照（数量为物品当前的堆叠数量） */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	TArray<FGaiaItemInstance> PartnerItems;
+
+	/** 自己是否已确认当前报价 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	bool bMyConfirmed = false;
+
+	/** 对方是否已确认当前报价 */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	bool bPartnerConfirmed = false;
+
+	/** 会话结束的原因（取消或成交失败时） */
+	UPROPERTY(BlueprintReadOnly, Category = "Trade Session")
+	FString Message;
+};
+
+/** 交易会话更新事件 */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTradeUpdated, const FGaiaTradeSessionView&, Session);
+
+/**
+ * 网格占用位图运算
+ * 每行一个 uint64，第X位为1表示第X列已占用；找位置时把物品高度内的各行按位或，
+ * 取反得到这一段行都空闲的列，再与自身右移 1..宽度-1 位的结果按位与，剩下的最低位就是可放置的最左列
+ */
+struct GAIAGAME_API FGaiaInventoryGrid
+{
+	/** 单行最多的列数 */
+	static constexpr int32 MaxWidth = 64;
+
+	/** 网格最多的行数（与定义的编辑上限一致） */
+	static constexpr int32 MaxHeight = 64;
+
+	/** 任何容器的槽位ID上限（最大网格的格子数，大于列表布局的槽位上限） */
+	static constexpr int32 MaxSlotCount = MaxWidth * MaxHeight;
+
+	/** 第 X 列开始、宽 Width 列的行掩码 */
+	static uint64 MakeRowMask(int32 X, int32 Width)
+	{
+		const uint64 Bits = Width >= MaxWidth ? ~uint64(0) : ((uint64(1) << Width) - 1);
+		return Bits << X;
+	}
+
+	/** 矩形是否完全在网格内且没有被占用（网格高度为 Rows.Num()） */
+	static bool IsAreaFree(TConstArrayView<uint64> Rows, int32 GridWidth, int32 X, int32 Y, int32 Width, int32 Height);
+
+	/**
+	 * 按行优先查找第一个能放下 Width×Height 的左上角格子
+	 * @return 是否找到
+	 */
+	static bool FindFreeArea(TConstArrayView<uint64> Rows, int32 GridWidth, int32 Width, int32 Height, int32& OutX, int32& OutY);
+
+	/** 设置或清除矩形的占用（调用者保证矩形在网格内） */
+	static void MarkArea(TArrayView<uint64> Rows, int32 X, int32 Y, int32 Width, int32 Height, bool bOccupied);
+};
+
 // ========================================
 // UI相关枚举和结构
 // ========================================
@@ -0,0 +1,29 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaLootTable.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaLootTable)
+
+void UGaiaLootTable::RollGrants(FRandomStream& RandomStream, TArray<FGaiaItemGrant>& OutGrants) const
+{
+	for (int32 Roll = 0; Roll < NumRolls; ++Roll)
+	{
+		for (const FGaiaLootEntry& Entry : Entries)
+		{
+			if (Entry.ItemDefinitionID.IsNone() || RandomStream.GetFraction() >= Entry.DropChance)
+			{
+				continue;
+			}
+
+			const int32 Quantity = RandomStream.RandRange(Entry.MinQuantity, FMath::Max(Entry.MinQuantity, Entry.MaxQuantity));
+			if (FGaiaItemGrant* Existing = OutGrants.FindByPredicate([&Entry](const FGaiaItemGrant& Grant) { return Grant.ItemDefinitionID == Entry.ItemDefinitionID; }))
+			{
+				Existing->Quantity += Quantity;
+			}
+			else
+			{
+				OutGrants.Emplace(Entry.ItemDefinitionID, Quantity);
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaLootTable.generated.h"
+
+/** 掉落表条目 */
+USTRUCT(BlueprintType)
+struct FGaiaLootEntry
+{
+	GENERATED_BODY()
+
+public:
+	/** 物品定义ID */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot")
+	FName ItemDefinitionID = NAME_None;
+
+	/** 掉落概率（0-1） */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "0", ClampMax = "1"))
+	float DropChance = 1.0f;
+
+	/** 最小数量 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int32 MinQuantity = 1;
+
+	/** 最大数量 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int32 MaxQuantity = 1;
+};
+
+/**
+ * 掉落表
+ * 每个条目独立按概率掉落，数量在范围内均匀随机；
+ * 掷骰结果交给 UGaiaInventorySubsystem::GrantItems 一次性发放
+ */
+UCLASS(BlueprintType, Const)
+class GAIAGAME_API UGaiaLootTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * 掷骰生成发放列表（同一物品的多个条目合并为一项）
+	 * @param RandomStream 随机流（相同种子得到相同结果）
+	 * @param OutGrants 输出：发放列表
+	 */
+	void RollGrants(FRandomStream& RandomStream, TArray<FGaiaItemGrant>& OutGrants) const;
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot", meta = (TitleProperty = "ItemDefinitionID"))
+	TArray<FGaiaLootEntry> Entries;
+
+	/** 整张表重复掷骰的次数 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int32 NumRolls = 1;
+};
@@ -0,0 +1,397 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaTradeSubsystem.h"
+#include "GaiaInventoryRPCComponent.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaLogChannels.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaTradeSubsystem)
+
+namespace GaiaTrade
+{
+	/** RPC组件所属玩家的 PlayerState（组件挂在 PlayerController 或 PlayerState 上） */
+	APlayerState* GetPlayerState(const UGaiaInventoryRPCComponent* Component)
+	{
+		AActor* Owner = Component ? Component->GetOwner() : nullptr;
+		if (APlayerState* PlayerState = Cast<APlayerState>(Owner))
+		{
+			return PlayerState;
+		}
+		const APlayerController* PC = Cast<APlayerController>(Owner);
+		return PC ? PC->PlayerState.Get() : nullptr;
+	}
+}
+
+void UGaiaTradeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	InventorySubsystem = Collection.InitializeDependency<UGaiaInventorySubsystem>();
+}
+
+void UGaiaTradeSubsystem::Deinitialize()
+{
+	Sessions.Empty();
+	ParticipantSessions.Empty();
+	InventorySubsystem = nullptr;
+
+	Super::Deinitialize();
+}
+
+UGaiaTradeSubsystem* UGaiaTradeSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UGaiaTradeSubsystem>() : nullptr;
+}
+
+UGaiaInventoryRPCComponent* UGaiaTradeSubsystem::FindParticipantComponent(const APlayerState* PlayerState)
+{
+	if (!PlayerState)
+	{
+		return nullptr;
+	}
+
+	if (UGaiaInventoryRPCComponent* RPCComp = PlayerState->FindComponentByClass<UGaiaInventoryRPCComponent>())
+	{
+		return RPCComp;
+	}
+
+	// 服务器上 PlayerState 的 Owner 是其 PlayerController
+	const AActor* Owner = PlayerState->GetOwner();
+	return Owner ? Owner->FindComponentByClass<UGaiaInventoryRPCComponent>() : nullptr;
+}
+
+// ========================================
+// 会话
+// ========================================
+
+bool UGaiaTradeSubsystem::InviteTrade(UGaiaInventoryRPCComponent* Initiator, UGaiaInventoryRPCComponent* Partner, const FGuid& RootContainerUID, FString& OutErrorMessage)
+{
+	if (!InventorySubsystem || !Initiator || !Partner || Initiator == Partner)
+	{
+		OutErrorMessage = TEXT("交易对象无效");
+		return false;
+	}
+
+	if (IsTrading(Initiator) || IsTrading(Partner))
+	{
+		OutErrorMessage = TEXT("一方已在交易中");
+		return false;
+	}
+
+	if (!OwnsRootContainer(Initiator, RootContainerUID))
+	{
+		OutErrorMessage = TEXT("交易使用的容器不属于发起方");
+		return false;
+	}
+
+	const FGuid SessionID = FGuid::NewGuid();
+	FTradeSession Session;
+	Session.SessionID = SessionID;
+	Session.Participants[0].Component = Initiator;
+	Session.Participants[0].Key = Initiator;
+	Session.Participants[0].RootContainerUID = RootContainerUID;
+	Session.Participants[1].Component = Partner;
+	Session.Participants[1].Key = Partner;
+
+	const FTradeSession& AddedSession = Sessions.Add(SessionID, MoveTemp(Session));
+	ParticipantSessions.Add(Initiator, SessionID);
+	ParticipantSessions.Add(Partner, SessionID);
+
+	UE_LOG(LogGaia, Log, TEXT("[交易] 发起邀请: %s -> %s (会话 %s)"),
+		*GetNameSafe(Initiator->GetOwner()), *GetNameSafe(Partner->GetOwner()), *SessionID.ToString());
+
+	NotifyParticipants(AddedSession);
+	return true;
+}
+
+bool UGaiaTradeSubsystem::AcceptTrade(UGaiaInventoryRPCComponent* Participant, const FGuid& RootContainerUID, FString& OutErrorMessage)
+{
+	int32 ParticipantIndex = INDEX_NONE;
+	FTradeSession* Session = FindSession(Participant, ParticipantIndex);
+	if (!Session || Session->State != EGaiaTradeState::Pending || ParticipantIndex != 1)
+	{
+		OutErrorMessage = TEXT("没有待接受的交易邀请");
+		return false;
+	}
+
+	if (!OwnsRootContainer(Participant, RootContainerUID) || RootContainerUID == Session->Participants[0].RootContainerUID)
+	{
+		OutErrorMessage = TEXT("交易使用的容器不属于接受方");
+		return false;
+	}
+
+	Session->Participants[1].RootContainerUID = RootContainerUID;
+	Session->State = EGaiaTradeState::Open;
+
+	UE_LOG(LogGaia, Log, TEXT("[交易] 接受邀请: 会话 %s"), *Session->SessionID.ToString());
+
+	NotifyParticipants(*Session);
+	return true;
+}
+
+bool UGaiaTradeSubsystem::SetTradeOffers(UGaiaInventoryRPCComponent* Participant, const TArray<FGaiaTradeOffer>& Offers, FString& OutErrorMessage)
+{
+	int32 ParticipantIndex = INDEX_NONE;
+	FTradeSession* Session = FindSession(Participant, ParticipantIndex);
+	if (!Session || Session->State != EGaiaTradeState::Open)
+	{
+		OutErrorMessage = TEXT("没有进行中的交易");
+		return false;
+	}
+
+	FTradeParticipant& Self = Session->Participants[ParticipantIndex];
+	if (!InventorySubsystem->ValidateTradeOffers(Self.RootContainerUID, Offers, OutErrorMessage))
+	{
+		return false;
+	}
+
+	Self.Offers = Offers;
+	Self.OfferFingerprint = ComputeOfferFingerprint(Offers);
+	ResetConfirmations(*Session);
+
+	NotifyParticipants(*Session);
+	return true;
+}
+
+bool UGaiaTradeSubsystem::ConfirmTrade(UGaiaInventoryRPCComponent* Participant, int32 Revision, FString& OutErrorMessage)
+{
+	int32 ParticipantIndex = INDEX_NONE;
+	FTradeSession* Session = FindSession(Participant, ParticipantIndex);
+	if (!Session || Session->State != EGaiaTradeState::Open)
+	{
+		OutErrorMessage = TEXT("没有进行中的交易");
+		return false;
+	}
+
+	const FGuid SessionID = Session->SessionID;
+	if (!Session->Participants[0].Component.IsValid() || !Session->Participants[1].Component.IsValid())
+	{
+		EndSession(SessionID, EGaiaTradeState::Cancelled, TEXT("对方已离开"));
+		OutErrorMessage = TEXT("对方已离开");
+		return false;
+	}
+
+	if (Revision != Session->Revision)
+	{
+		OutErrorMessage = TEXT("报价已变化，请重新确认");
+		return false;
+	}
+
+	// 报价之后物品被消耗、拆分或改动了内容：按当前状态重新记录，双方需要重新确认
+	bool bOffersChanged = false;
+	for (FTradeParticipant& Each : Session->Participants)
+	{
+		const uint32 Fingerprint = ComputeOfferFingerprint(Each.Offers);
+		if (Fingerprint != Each.OfferFingerprint)
+		{
+			Each.OfferFingerprint = Fingerprint;
+			bOffersChanged = true;
+		}
+	}
+	if (bOffersChanged)
+	{
+		OutErrorMessage = TEXT("报价中的物品已变化，请重新确认");
+		ResetConfirmations(*Session);
+		NotifyParticipants(*Session, OutErrorMessage);
+		return false;
+	}
+
+	if (Session->Participants[0].Offers.IsEmpty() && Session->Participants[1].Offers.IsEmpty())
+	{
+		OutErrorMessage = TEXT("双方都没有报价");
+		return false;
+	}
+
+	Session->Participants[ParticipantIndex].bConfirmed = true;
+	if (!Session->Participants[1 - ParticipantIndex].bConfirmed)
+	{
+		NotifyParticipants(*Session);
+		return true;
+	}
+
+	// 双方都已确认：一次完成交换
+	const FTradeParticipant& ParticipantA = Session->Participants[0];
+	const FTradeParticipant& ParticipantB = Session->Participants[1];
+	const FGaiaTradeResult Result = InventorySubsystem->ExecuteTrade(
+		ParticipantA.RootContainerUID, ParticipantA.Offers,
+		ParticipantB.RootContainerUID, ParticipantB.Offers);
+	if (!Result.bSuccess)
+	{
+		// 两棵容器树都没有变化，会话保持打开，调整报价后重新确认
+		OutErrorMessage = Result.ErrorMessage;
+		ResetConfirmations(*Session);
+		NotifyParticipants(*Session, OutErrorMessage);
+		return false;
+	}
+
+	// 只有两个参与者需要新的库存数据
+	for (const FTradeParticipant& Each : Session->Participants)
+	{
+		if (UGaiaInventoryRPCComponent* Component = Each.Component.Get())
+		{
+			Component->SchedulePushInventory();
+		}
+	}
+
+	EndSession(SessionID, EGaiaTradeState::Completed, TEXT("交易完成"));
+	return true;
+}
+
+void UGaiaTradeSubsystem::CancelTrade(UGaiaInventoryRPCComponent* Participant, const FString& Reason)
+{
+	int32 ParticipantIndex = INDEX_NONE;
+	if (const FTradeSession* Session = FindSession(Participant, ParticipantIndex))
+	{
+		// 会话在 EndSession 中移除，先复制ID
+		const FGuid SessionID = Session->SessionID;
+		EndSession(SessionID, EGaiaTradeState::Cancelled, Reason);
+	}
+}
+
+bool UGaiaTradeSubsystem::IsTrading(const UGaiaInventoryRPCComponent* Participant) const
+{
+	return ParticipantSessions.Contains(Participant);
+}
+
+// ========================================
+// 内部辅助函数
+// ========================================
+
+UGaiaTradeSubsystem::FTradeSession* UGaiaTradeSubsystem::FindSession(const UGaiaInventoryRPCComponent* Participant, int32& OutIndex)
+{
+	OutIndex = INDEX_NONE;
+
+	const FGuid* SessionID = ParticipantSessions.Find(Participant);
+	FTradeSession* Session = SessionID ? Sessions.Find(*SessionID) : nullptr;
+	if (!Session)
+	{
+		return nullptr;
+	}
+
+	OutIndex = Session->Participants[0].Key == TObjectKey<UGaiaInventoryRPCComponent>(Participant) ? 0 : 1;
+	return Session;
+}
+
+bool UGaiaTradeSubsystem::OwnsRootContainer(const UGaiaInventoryRPCComponent* Participant, const FGuid& RootContainerUID) const
+{
+	return RootContainerUID.IsValid() && Participant->GetOwnedContainerUIDs().Contains(RootContainerUID);
+}
+
+uint32 UGaiaTradeSubsystem::ComputeOfferFingerprint(const TArray<FGaiaTradeOffer>& Offers) const
+{
+	uint32 Fingerprint = 0;
+	for (const FGaiaTradeOffer& Offer : Offers)
+	{
+		Fingerprint = HashCombine(Fingerprint, GetTypeHash(Offer.ItemUID));
+
+		FGaiaItemInstance Item;
+		if (!InventorySubsystem->FindItemByUID(Offer.ItemUID, Item))
+		{
+			continue;
+		}
+
+		Fingerprint = HashCombine(Fingerprint, GetTypeHash(Item.ItemDefinitionID));
+		Fingerprint = HashCombine(Fingerprint, GetTypeHash(Item.Quantity));
+
+		// 带容器的物品：其中任何一个容器的内容变化都会改变内容修订号
+		TArray<FGuid> PendingContainers;
+		if (Item.HasContainer())
+		{
+			PendingContainers.Add(Item.OwnedContainerUID);
+		}
+		for (int32 QueueIndex = 0; QueueIndex < PendingContainers.Num(); ++QueueIndex)
+		{
+			FGaiaContainerInstance Container;
+			if (!InventorySubsystem->FindContainerByUID(PendingContainers[QueueIndex], Container))
+			{
+				continue;
+			}
+
+			Fingerprint = HashCombine(Fingerprint, GetTypeHash(Container.ContentRevision));
+			for (const FGaiaItemInstance& ContainedItem : InventorySubsystem->GetItemsInContainer(Container.ContainerUID))
+			{
+				if (ContainedItem.HasContainer())
+				{
+					PendingContainers.Add(ContainedItem.OwnedContainerUID);
+				}
+			}
+		}
+	}
+	return Fingerprint;
+}
+
+void UGaiaTradeSubsystem::ResetConfirmations(FTradeSession& Session)
+{
+	++Session.Revision;
+	for (FTradeParticipant& Each : Session.Participants)
+	{
+		Each.bConfirmed = false;
+	}
+}
+
+void UGaiaTradeSubsystem::NotifyParticipants(const FTradeSession& Session, const FString& Message) const
+{
+	for (int32 Index = 0; Index < 2; ++Index)
+	{
+		if (UGaiaInventoryRPCComponent* Component = Session.Participants[Index].Component.Get())
+		{
+			Component->ClientTradeUpdated(BuildSessionView(Session, Index, Message));
+		}
+	}
+}
+
+FGaiaTradeSessionView UGaiaTradeSubsystem::BuildSessionView(const FTradeSession& Session, int32 ViewerIndex, const FString& Message) const
+{
+	const FTradeParticipant& Viewer = Session.Participants[ViewerIndex];
+	const FTradeParticipant& Partner = Session.Participants[1 - ViewerIndex];
+
+	FGaiaTradeSessionView View;
+	View.SessionID = Session.SessionID;
+	View.State = Session.State;
+	View.Revision = Session.Revision;
+	View.Partner = GaiaTrade::GetPlayerState(Partner.Component.Get());
+	View.bIsInitiator = ViewerIndex == 0;
+	View.MyOffers = Viewer.Offers;
+	View.PartnerOffers = Partner.Offers;
+	View.bMyConfirmed = Viewer.bConfirmed;
+	View.bPartnerConfirmed = Partner.bConfirmed;
+	View.Message = Message;
+
+	// 成交后对方的物品已经属于自己，不再附带快照
+	if (InventorySubsystem && Session.State == EGaiaTradeState::Open)
+	{
+		for (const FGaiaTradeOffer& Offer : Partner.Offers)
+		{
+			FGaiaItemInstance Item;
+			if (InventorySubsystem->FindItemByUID(Offer.ItemUID, Item))
+			{
+				View.PartnerItems.Add(MoveTemp(Item));
+			}
+		}
+	}
+	return View;
+}
+
+void UGaiaTradeSubsystem::EndSession(const FGuid& SessionID, EGaiaTradeState FinalState, const FString& Message)
+{
+	FTradeSession Session;
+	if (!Sessions.RemoveAndCopyValue(SessionID, Session))
+	{
+		return;
+	}
+
+	for (const FTradeParticipant& Each : Session.Participants)
+	{
+		ParticipantSessions.Remove(Each.Key);
+	}
+
+	Session.State = FinalState;
+	NotifyParticipants(Session, Message);
+
+	UE_LOG(LogGaia, Log, TEXT("[交易] 会话结束: %s (%s) %s"),
+		*SessionID.ToString(), *UEnum::GetValueAsString(FinalState), *Message);
+}
@@ -0,0 +1,153 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "GaiaInventoryTypes.h"
+#include "GaiaTradeSubsystem.generated.h"
+
+#define UE_API GAIAGAME_API
+
+class APlayerState;
+class UGaiaInventoryRPCComponent;
+class UGaiaInventorySubsystem;
+
+/**
+ * Gaia交易子系统（仅服务器）
+ *
+ * 玩家之间的交易会话：
+ * - 一方邀请、另一方接受后会话打开，双方各自指定交易使用的根容器
+ * - 报价只记录物品UID和数量，不移动任何物品；任何一方修改报价都会递增修订号并清除双方的确认
+ * - 确认必须针对当前修订号；报价中的物品在确认之后发生变化（数量、带容器物品的内容）时同样清除确认
+ * - 双方都确认后通过 UGaiaInventorySubsystem::ExecuteTrade 一次完成交换，失败时两边都不变，会话保持打开
+ * - 会话的变化只通知两个参与者（客户端RPC），成交后只给两个参与者推送库存
+ * 每个玩家同一时间只能参与一个会话，RPC组件结束时自动取消
+ */
+UCLASS(MinimalAPI)
+class UGaiaTradeSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem Interface
+	UE_API virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	UE_API virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/** 获取交易子系统 */
+	static UE_API UGaiaTradeSubsystem* Get(const UObject* WorldContextObject);
+
+	/** 查找玩家的RPC组件（PlayerState 上或其所属的 PlayerController 上） */
+	static UE_API UGaiaInventoryRPCComponent* FindParticipantComponent(const APlayerState* PlayerState);
+
+	//~BEGIN 会话
+
+	/**
+	 * 邀请交易
+	 * @param Initiator 发起方
+	 * @param Partner 被邀请方
+	 * @param RootContainerUID 发起方用于交易的根容器（必须是发起方拥有的容器）
+	 * @param OutErrorMessage 失败原因
+	 * @return 是否创建了会话
+	 */
+	UE_API bool InviteTrade(UGaiaInventoryRPCComponent* Initiator, UGaiaInventoryRPCComponent* Partner, const FGuid& RootContainerUID, FString& OutErrorMessage);
+
+	/**
+	 * 接受邀请，会话进入报价阶段
+	 * @param Participant 被邀请方
+	 * @param RootContainerUID 被邀请方用于交易的根容器
+	 */
+	UE_API bool AcceptTrade(UGaiaInventoryRPCComponent* Participant, const FGuid& RootContainerUID, FString& OutErrorMessage);
+
+	/**
+	 * 替换自己的报价（不移动物品），修订号递增并清除双方的确认
+	 * @param Participant 参与者
+	 * @param Offers 新的报价（空数组表示撤回全部报价）
+	 */
+	UE_API bool SetTradeOffers(UGaiaInventoryRPCComponent* Participant, const TArray<FGaiaTradeOffer>& Offers, FString& OutErrorMessage);
+
+	/**
+	 * 确认当前报价，双方都确认后立即成交
+	 * @param Participant 参与者
+	 * @param Revision 客户端看到的修订号（与服务器不一致时拒绝）
+	 * @return 确认是否被接受（成交失败时也返回false，会话保持打开）
+	 */
+	UE_API bool ConfirmTrade(UGaiaInventoryRPCComponent* Participant, int32 Revision, FString& OutErrorMessage);
+
+	/**
+	 * 取消参与者所在的会话（邀请中或报价中），通知双方
+	 * @param Reason 取消原因
+	 */
+	UE_API void CancelTrade(UGaiaInventoryRPCComponent* Participant, const FString& Reason);
+
+	/** 参与者是否在会话中 */
+	UE_API bool IsTrading(const UGaiaInventoryRPCComponent* Participant) const;
+
+	//~END 会话
+
+private:
+	/** 会话中的一方 */
+	struct FTradeParticipant
+	{
+		TWeakObjectPtr<UGaiaInventoryRPCComponent> Component;
+
+		/** ParticipantSessions 的键（组件销毁后仍可用于移除） */
+		TObjectKey<UGaiaInventoryRPCComponent> Key;
+
+		/** 交易使用的根容器（被邀请方接受前无效） */
+		FGuid RootContainerUID;
+
+		TArray<FGaiaTradeOffer> Offers;
+
+		/** 报价物品的状态指纹（报价时计算，确认和成交前比较） */
+		uint32 OfferFingerprint = 0;
+
+		bool bConfirmed = false;
+	};
+
+	/** 交易会话，Participants[0] 为发起方、同时是 ExecuteTrade 的甲方 */
+	struct FTradeSession
+	{
+		FGuid SessionID;
+		EGaiaTradeState State = EGaiaTradeState::Pending;
+		int32 Revision = 0;
+		FTradeParticipant Participants[2];
+	};
+
+	/**
+	 * 查找参与者所在的会话
+	 * @param OutIndex 参与者在会话中的下标
+	 */
+	FTradeSession* FindSession(const UGaiaInventoryRPCComponent* Participant, int32& OutIndex);
+
+	/** 参与者是否拥有该根容器 */
+	bool OwnsRootContainer(const UGaiaInventoryRPCComponent* Participant, const FGuid& RootContainerUID) const;
+
+	/** 计算报价物品的状态指纹：定义、数量，带容器的物品还包括其中所有容器的内容修订号 */
+	uint32 ComputeOfferFingerprint(const TArray<FGaiaTradeOffer>& Offers) const;
+
+	/** 报价被修改：修订号递增，清除双方的确认 */
+	void ResetConfirmations(FTradeSession& Session);
+
+	/** 把会话视图发送给两个参与者 */
+	void NotifyParticipants(const FTradeSession& Session, const FString& Message = FString()) const;
+
+	/** 构建参与者看到的会话视图 */
+	FGaiaTradeSessionView BuildSessionView(const FTradeSession& Session, int32 ViewerIndex, const FString& Message) const;
+
+	/** 结束会话（成交或取消），通知双方后移除 */
+	void EndSession(const FGuid& SessionID, EGaiaTradeState FinalState, const FString& Message);
+
+	/** 会话 */
+	TMap<FGuid, FTradeSession> Sessions;
+
+	/** 参与者 -> 所在会话 */
+	TMap<TObjectKey<UGaiaInventoryRPCComponent>, FGuid> ParticipantSessions;
+
+	/** 库存子系统 */
+	UPROPERTY()
+	TObjectPtr<UGaiaInventorySubsystem> InventorySubsystem;
+};
+
+#undef UE_API
@@ -0,0 +1,72 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "GaiaWorldContainerComponent.h"
+#include "GaiaInventorySubsystem.h"
+#include "GaiaLogChannels.h"
+#include "GameFramework/Actor.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GaiaWorldContainerComponent)
+
+UGaiaWorldContainerComponent::UGaiaWorldContainerComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UGaiaWorldContainerComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// 空间索引只存在于服务器
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	UGaiaInventorySubsystem* InventorySystem = UGaiaInventorySubsystem::Get(this);
+	if (!InventorySystem)
+	{
+		return;
+	}
+
+	FGaiaContainerInstance ExistingContainer;
+	if (!InventorySystem->FindContainerByUID(ContainerUID, ExistingContainer) && !ContainerDefinitionID.IsNone())
+	{
+		ContainerUID = InventorySystem->CreateContainerInstance(ContainerDefinitionID);
+	}
+
+	if (!ContainerUID.IsValid())
+	{
+		UE_LOG(LogGaia, Warning, TEXT("[世界容器] %s 没有可用的容器"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	InventorySystem->RegisterWorldContainer(ContainerUID, GetOwner()->GetActorLocation());
+	bRegistered = true;
+}
+
+void UGaiaWorldContainerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRegistered)
+	{
+		if (UGaiaInventorySubsystem* InventorySystem = UGaiaInventorySubsystem::Get(this))
+		{
+			InventorySystem->UnregisterWorldContainer(ContainerUID);
+		}
+		bRegistered = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGaiaWorldContainerComponent::UpdateRegisteredLocation()
+{
+	if (!bRegistered)
+	{
+		return;
+	}
+
+	if (UGaiaInventorySubsystem* InventorySystem = UGaiaInventorySubsystem::Get(this))
+	{
+		InventorySystem->RegisterWorldContainer(ContainerUID, GetOwner()->GetActorLocation());
+	}
+}
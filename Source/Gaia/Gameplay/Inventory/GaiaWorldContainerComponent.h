@@ -0,0 +1,52 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GaiaWorldContainerComponent.generated.h"
+
+/**
+ * 世界容器组件
+ * 
+ * 挂载在箱子等放置在世界中的Actor上，服务器开始时把容器登记到库存子系统的空间索引，
+ * 结束时取消登记，快速堆放等按位置查找的操作由此找到附近的容器。
+ * 
+ * 使用方式：
+ * - 指定 ContainerUID（例如从存档恢复的容器），或只指定 ContainerDefinitionID 由服务器创建
+ * - 登记位置取Actor开始时的位置，Actor移动后调用 UpdateRegisteredLocation
+ */
+UCLASS(ClassGroup=(Inventory), meta=(BlueprintSpawnableComponent))
+class GAIAGAME_API UGaiaWorldContainerComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGaiaWorldContainerComponent();
+
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	//~ End UActorComponent Interface
+
+	/** 按Actor当前位置重新登记（仅服务器） */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory")
+	void UpdateRegisteredLocation();
+
+	/** 获取容器UID */
+	UFUNCTION(BlueprintPure, Category = "Gaia|Inventory")
+	FGuid GetContainerUID() const { return ContainerUID; }
+
+protected:
+	/** 容器定义ID（ContainerUID 为空或容器不存在时用于创建容器） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gaia|Inventory")
+	FName ContainerDefinitionID;
+
+	/** 容器UID */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gaia|Inventory")
+	FGuid ContainerUID;
+
+private:
+	/** 是否已登记 */
+	bool bRegistered = false;
+};
@@ -6,12 +6,19 @@
 #include "Components/Overlay.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/DataTable.h"
+#include "CommonUIAnimationSubsystem.h"
 #include "GaiaLogChannels.h"
 
+namespace GaiaButtonAnimation
+{
+	static const FName Pulse(TEXT("Pulse"));
+	static const FName Click(TEXT("Click"));
+}
+
 UGaiaButton::UGaiaButton(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
-	// 默认启用 Tick（用于动画）
+	// 不使用 Tick，动画由 UCommonUIAnimationSubsystem 驱动
 	bIsVariable = true;
 	SetVisibility(ESlateVisibility::Visible);
 }
@@ -44,17 +51,21 @@ void UGaiaButton::NativeConstruct()
 	}
 }
 
-void UGaiaButton::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+void UGaiaButton::NativeDestruct()
 {
-	Super::NativeTick(MyGeometry, InDeltaTime);
+	// 移出视口后不再占用动画更新
+	if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
+	{
+		AnimationSubsystem->StopAllAnimations(this);
+	}
+	bIsPlayingPulse = false;
 
-	// 更新脉冲动画
-	if (bIsPlayingPulse && Background)
+	if (Background)
 	{
-		PulseTime += InDeltaTime * PulseSpeed;
-		float Scale = 1.0f + (FMath::Sin(PulseTime * 2.0f * PI) * 0.5f + 0.5f) * (PulseScale - 1.0f);
-		Background->SetRenderScale(FVector2D(Scale, Scale));
+		Background->SetRenderScale(FVector2D(1.0f, 1.0f));
 	}
+
+	Super::NativeDestruct();
 }
 
 // ========================================
@@ -190,13 +201,25 @@ void UGaiaButton::SetButtonTooltip(const FText& InTooltipText)
 
 void UGaiaButton::PlayPulseAnimation()
 {
+	UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this);
+	if (!AnimationSubsystem || !Background)
+	{
+		return;
+	}
+
 	bIsPlayingPulse = true;
-	PulseTime = 0.0f;
+	AnimationSubsystem->PlayAnimation(this, GaiaButtonAnimation::Pulse,
+		FCommonUIAnimationUpdate::CreateUObject(this, &UGaiaButton::UpdatePulseAnimation));
 }
 
 void UGaiaButton::StopPulseAnimation()
 {
 	bIsPlayingPulse = false;
+
+	if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
+	{
+		AnimationSubsystem->StopAnimation(this, GaiaButtonAnimation::Pulse);
+	}
 	
 	// 恢复原始缩放
 	if (Background)
@@ -207,22 +230,51 @@ void UGaiaButton::StopPulseAnimation()
 
 void UGaiaButton::PlayClickAnimation()
 {
-	if (Background)
+	UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this);
+	if (!AnimationSubsystem || !Background)
+	{
+		return;
+	}
+
+	// 按下缩小，在 ClickAnimationDuration 内恢复
+	Background->SetRenderScale(FVector2D(ClickScale, ClickScale));
+	AnimationSubsystem->PlayAnimation(this, GaiaButtonAnimation::Click,
+		FCommonUIAnimationUpdate::CreateUObject(this, &UGaiaButton::UpdateClickAnimation));
+}
+
+bool UGaiaButton::UpdatePulseAnimation(float ElapsedTime)
+{
+	if (!bIsPlayingPulse || !Background)
+	{
+		return false;
+	}
+
+	// 点击反馈期间让出缩放控制
+	if (UCommonUIAnimationSubsystem* AnimationSubsystem = UCommonUIAnimationSubsystem::Get(this))
 	{
-		// 简单的缩放动画
-		Background->SetRenderScale(FVector2D(0.95f, 0.95f));
-		
-		// TODO: 使用 UMG 动画或 Tween 系统实现更平滑的动画
-		// 这里需要在下一帧恢复缩放
-		FTimerHandle TimerHandle;
-		GetWorld()->GetTimerManager().SetTimer(TimerHandle, [this]()
+		if (AnimationSubsystem->IsAnimationPlaying(this, GaiaButtonAnimation::Click))
 		{
-			if (Background)
-			{
-				Background->SetRenderScale(FVector2D(1.0f, 1.0f));
-			}
-		}, 0.1f, false);
+			return true;
+		}
 	}
+
+	const float PulseTime = ElapsedTime * PulseSpeed;
+	const float Scale = 1.0f + (FMath::Sin(PulseTime * 2.0f * PI) * 0.5f + 0.5f) * (PulseScale - 1.0f);
+	Background->SetRenderScale(FVector2D(Scale, Scale));
+	return true;
+}
+
+bool UGaiaButton::UpdateClickAnimation(float ElapsedTime)
+{
+	if (!Background)
+	{
+		return false;
+	}
+
+	const float Alpha = FMath::Clamp(ElapsedTime / ClickAnimationDuration, 0.0f, 1.0f);
+	const float Scale = FMath::Lerp(ClickScale, 1.0f, Alpha);
+	Background->SetRenderScale(FVector2D(Scale, Scale));
+	return Alpha < 1.0f;
 }
 
 // ========================================
@@ -121,6 +121,10 @@ struct FGaiaButtonSizeData
  * - 声音效果
  * - 工具提示
  * 
+ * 动画说明：
+ * - 按钮本身不Tick，脉冲/点击动画注册到 UCommonUIAnimationSubsystem 统一更新
+ * - 未播放动画的按钮不产生任何每帧开销
+ * 
  * UMG 层级结构（需要在蓝图中创建）：
  * [Overlay] Root
  * ├─ [Border] Background (必须，命名为 Background)
@@ -132,7 +136,7 @@ struct FGaiaButtonSizeData
  * └─ [Border] Badge (可选，命名为 Badge)
  *     └─ [TextBlock] BadgeText (可选，命名为 BadgeText)
  */
-UCLASS(Abstract, Blueprintable)
+UCLASS(Abstract, Blueprintable, meta = (DisableNativeTick))
 class GAIAGAME_API UGaiaButton : public UCommonButtonBase
 {
 	GENERATED_BODY()
@@ -143,7 +147,7 @@ public:
 	//~Begin UUserWidget Interface
 	virtual void NativePreConstruct() override;
 	virtual void NativeConstruct() override;
-	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+	virtual void NativeDestruct() override;
 	//~End UUserWidget Interface
 
 	// ========================================
@@ -257,6 +261,12 @@ protected:
 	/** 播放声音 */
 	void PlaySound(USoundBase* Sound);
 
+	/** 脉冲动画更新（由UI动画子系统调用） */
+	bool UpdatePulseAnimation(float ElapsedTime);
+
+	/** 点击动画更新（由UI动画子系统调用） */
+	bool UpdateClickAnimation(float ElapsedTime);
+
 	// ========================================
 	// UMG 组件（通过 BindWidget 或 BindWidgetOptional 绑定）
 	// ========================================
@@ -329,6 +339,14 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gaia|Button|Animation", meta = (ClampMin = "1.0", ClampMax = "2.0"))
 	float PulseScale = 1.1f;
 
+	/** 点击动画时长（秒） */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gaia|Button|Animation", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float ClickAnimationDuration = 0.1f;
+
+	/** 点击动画缩放 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gaia|Button|Animation", meta = (ClampMin = "0.5", ClampMax = "1.0"))
+	float ClickScale = 0.95f;
+
 	// ========================================
 	// 内部状态
 	// ========================================
@@ -343,8 +361,5 @@ protected:
 
 	/** 是否正在播放脉冲动画 */
 	bool bIsPlayingPulse = false;
-
-	/** 脉冲动画时间累积 */
-	float PulseTime = 0.0f;
 };
 
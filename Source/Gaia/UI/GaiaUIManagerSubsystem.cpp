@@ -5,8 +5,9 @@
 #include "GameUIPolicy.h"
 #include "Inventory/GaiaContainerWindowWidget.h"
 #include "Inventory/GaiaContainerGridWidget.h"
+#include "Inventory/GaiaItemContextMenu.h"
 #include "Gameplay/Inventory/GaiaInventoryRPCComponent.h"
-#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "Player/GaiaPlayerController.h"
 #include "Widgets/CommonActivatableWidgetContainer.h"
 
@@ -216,6 +217,13 @@ bool UGaiaUIManagerSubsystem::IsContainerWindowOpen(const FGuid& ContainerUID) c
 	return OpenContainerWindows.Contains(ContainerUID);
 }
 
+TArray<FGuid> UGaiaUIManagerSubsystem::GetOpenContainerUIDs() const
+{
+	TArray<FGuid> ContainerUIDs;
+	OpenContainerWindows.GenerateKeyArray(ContainerUIDs);
+	return ContainerUIDs;
+}
+
 UCommonActivatableWidget* UGaiaUIManagerSubsystem::PushWidgetToLayer(
 	FGameplayTag LayerTag,
 	TSubclassOf<UCommonActivatableWidget> WidgetClass)
@@ -323,24 +331,24 @@ void UGaiaUIManagerSubsystem::OnInventoryUpdated()
 
 void UGaiaUIManagerSubsystem::OpenContainerByItemUID(const FGuid& ItemUID)
 {
-	// 获取库存子系统
-	UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(this);
-	if (!InvSys)
+	// 获取客户端只读模型（嵌套容器随玩家库存一起同步，无需额外请求）
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	if (!ReadModel)
 	{
-		UE_LOG(LogGaia, Warning, TEXT("OpenContainerByItemUID: InventorySubsystem not found"));
+		UE_LOG(LogGaia, Warning, TEXT("OpenContainerByItemUID: InventoryReadModel not found"));
 		return;
 	}
 
 	// 查找物品
-	FGaiaItemInstance Item;
-	if (!InvSys->FindItemByUID(ItemUID, Item))
+	const FGaiaItemInstance* Item = ReadModel->FindItem(ItemUID);
+	if (!Item)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("OpenContainerByItemUID: Item not found: %s"), *ItemUID.ToString());
 		return;
 	}
 
 	// 检查物品是否有容器
-	if (!Item.HasContainer())
+	if (!Item->HasContainer())
 	{
 		UE_LOG(LogGaia, Warning, TEXT("OpenContainerByItemUID: Item has no container: %s"), *ItemUID.ToString());
 		return;
@@ -348,8 +356,44 @@ void UGaiaUIManagerSubsystem::OpenContainerByItemUID(const FGuid& ItemUID)
 
 	// 打开容器
 	UE_LOG(LogGaia, Log, TEXT("Opening container from item: %s, container: %s"), 
-		*ItemUID.ToString(), *Item.OwnedContainerUID.ToString());
+		*ItemUID.ToString(), *Item->OwnedContainerUID.ToString());
 	
-	OpenContainerWindow(Item.OwnedContainerUID);
+	OpenContainerWindow(Item->OwnedContainerUID);
+}
+
+UGaiaItemContextMenu* UGaiaUIManagerSubsystem::ShowItemContextMenu(
+	TSubclassOf<UGaiaItemContextMenu> MenuClass,
+	const FGuid& ItemUID,
+	const FGaiaItemDefinition& ItemDef,
+	FVector2D ScreenPosition)
+{
+	if (!MenuClass)
+	{
+		return nullptr;
+	}
+
+	// 菜单仍处于打开状态：原地切换到新物品，不再推入新的Widget
+	UGaiaItemContextMenu* Menu = ActiveContextMenu.Get();
+	if (Menu && Menu->IsActivated() && Menu->GetClass() == MenuClass)
+	{
+		Menu->InitializeMenu(ItemUID, ItemDef);
+		Menu->SetMenuPosition(ScreenPosition);
+		return Menu;
+	}
+
+	// Layer Stack会优先从Widget池中取出已停用的菜单实例
+	Menu = PushWidgetToLayerWithInit<UGaiaItemContextMenu>(
+		FGameplayTag::RequestGameplayTag(TEXT("UI.Layer.Menu")),
+		MenuClass,
+		[&ItemUID, &ItemDef, ScreenPosition](UGaiaItemContextMenu& InMenu)
+		{
+			// 在Widget创建后、激活前初始化
+			InMenu.InitializeMenu(ItemUID, ItemDef);
+			InMenu.SetMenuPosition(ScreenPosition);
+		}
+	);
+
+	ActiveContextMenu = Menu;
+	return Menu;
 }
 
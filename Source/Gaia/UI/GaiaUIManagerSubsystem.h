@@ -7,7 +7,9 @@
 
 class UGaiaPrimaryGameLayout;
 class UGaiaContainerWindowWidget;
+class UGaiaItemContextMenu;
 class UCommonActivatableWidget;
+struct FGaiaItemDefinition;
 
 /**
  * Gaia UI管理器（基于CommonUI Layer System）
@@ -132,6 +134,13 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Gaia|UI|Inventory")
 	bool IsContainerWindowOpen(const FGuid& ContainerUID) const;
 
+	/**
+	 * 获取所有已打开容器窗口的容器UID
+	 * @return 容器UID列表
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|UI|Inventory")
+	TArray<FGuid> GetOpenContainerUIDs() const;
+
 	/**
 	 * 通过物品UID打开容器（右键菜单调用）
 	 * 自动查找物品拥有的容器并打开
@@ -140,6 +149,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Gaia|UI|Inventory")
 	void OpenContainerByItemUID(const FGuid& ItemUID);
 
+	// ========================================
+	// 右键菜单
+	// ========================================
+
+	/**
+	 * 显示物品右键菜单
+	 * 菜单已打开时原地重新初始化，否则从Layer的Widget池中取出
+	 * @param MenuClass 菜单Widget类
+	 * @param ItemUID 物品UID
+	 * @param ItemDef 物品定义
+	 * @param ScreenPosition 屏幕位置
+	 * @return 菜单实例
+	 */
+	UGaiaItemContextMenu* ShowItemContextMenu(
+		TSubclassOf<UGaiaItemContextMenu> MenuClass,
+		const FGuid& ItemUID,
+		const FGaiaItemDefinition& ItemDef,
+		FVector2D ScreenPosition
+	);
+
 protected:
 	/**
 	 * 获取主玩家的PrimaryGameLayout
@@ -174,4 +203,7 @@ protected:
 	/** 当前打开的容器窗口映射（ContainerUID -> Widget） */
 	UPROPERTY(Transient)
 	TMap<FGuid, TObjectPtr<UGaiaContainerWindowWidget>> OpenContainerWindows;
+
+	/** 最近一次显示的右键菜单（Layer池持有实例，这里只弱引用） */
+	TWeakObjectPtr<UGaiaItemContextMenu> ActiveContextMenu;
 };
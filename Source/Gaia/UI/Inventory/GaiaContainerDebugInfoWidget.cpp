@@ -29,31 +29,49 @@ void UGaiaContainerDebugInfoWidget::UpdateDebugInfo(const FContainerUIDebugInfo&
 		)));
 	}
 	
-	// 更新物品列表
+	// 更新物品列表（复用已有文本块，只改文本）
 	if (ScrollBox_ItemList)
 	{
-		// 清空现有物品
-		ScrollBox_ItemList->ClearChildren();
-		
-		// 添加物品
-		for (const FString& ItemInfo : DebugInfo.ItemList)
+		const int32 NumLines = DebugInfo.ItemList.Num();
+		for (int32 Index = 0; Index < NumLines; ++Index)
 		{
-			UTextBlock* ItemText = NewObject<UTextBlock>(ScrollBox_ItemList);
-			if (ItemText)
+			if (UTextBlock* ItemText = GetOrCreateItemLine(Index))
 			{
-				ItemText->SetText(FText::FromString(ItemInfo));
-				ItemText->SetAutoWrapText(true);
-				
-				// 设置字体大小
-				FSlateFontInfo FontInfo = ItemText->GetFont();
-				FontInfo.Size = 16;
-				ItemText->SetFont(FontInfo);
-				
-				ScrollBox_ItemList->AddChild(ItemText);
+				ItemText->SetText(FText::FromString(DebugInfo.ItemList[Index]));
+				ItemText->SetVisibility(ESlateVisibility::SelfHitTestInvisible);
 			}
 		}
+		
+		// 隐藏多余的行
+		for (int32 Index = NumLines; Index < ItemLinePool.Num(); ++Index)
+		{
+			ItemLinePool[Index]->SetVisibility(ESlateVisibility::Collapsed);
+		}
 	}
 	
 	UE_LOG(LogGaia, Verbose, TEXT("[调试信息] 刷新: Container=%s, Items=%d"),
 		*DebugInfo.ContainerUID.ToString(), DebugInfo.ItemList.Num());
 }
+
+UTextBlock* UGaiaContainerDebugInfoWidget::GetOrCreateItemLine(int32 Index)
+{
+	if (ItemLinePool.IsValidIndex(Index))
+	{
+		return ItemLinePool[Index];
+	}
+	
+	UTextBlock* ItemText = NewObject<UTextBlock>(ScrollBox_ItemList);
+	if (ItemText)
+	{
+		ItemText->SetAutoWrapText(true);
+		
+		// 设置字体大小
+		FSlateFontInfo FontInfo = ItemText->GetFont();
+		FontInfo.Size = 16;
+		ItemText->SetFont(FontInfo);
+		
+		ScrollBox_ItemList->AddChild(ItemText);
+		ItemLinePool.Add(ItemText);
+	}
+	return ItemText;
+}
@@ -76,5 +76,13 @@ protected:
 	/** 整个调试面板 */
 	UPROPERTY(BlueprintReadWrite, meta = (BindWidgetOptional))
 	TObjectPtr<UBorder> Border_DebugPanel;
+
+private:
+	/** 获取第Index行的物品文本（已创建的文本块复用，不足时新建） */
+	UTextBlock* GetOrCreateItemLine(int32 Index);
+
+	/** 物品列表文本块池（按行复用，多余的行隐藏） */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UTextBlock>> ItemLinePool;
 };
 
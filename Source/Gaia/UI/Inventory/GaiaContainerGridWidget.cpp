@@ -2,7 +2,7 @@
 
 #include "GaiaContainerGridWidget.h"
 #include "GaiaItemSlotWidget.h"
-#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "Components/UniformGridPanel.h"
 #include "Components/UniformGridSlot.h"
 #include "Components/WrapBox.h"
@@ -84,29 +84,29 @@ UGaiaItemSlotWidget* UGaiaContainerGridWidget::GetSlotWidget(int32 SlotID) const
 
 void UGaiaContainerGridWidget::CreateSlotWidgets()
 {
-	UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(GetWorld());
-	if (!InvSys || !ContainerUID.IsValid())
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	if (!ReadModel || !ContainerUID.IsValid())
 	{
 		return;
 	}
 	
-	// 获取容器信息
-	FGaiaContainerInstance Container;
-	if (!InvSys->FindContainerByUID(ContainerUID, Container))
+	// 获取容器信息（客户端缓存）
+	const FGaiaContainerInstance* Container = ReadModel->FindContainer(ContainerUID);
+	if (!Container)
 	{
 		UE_LOG(LogGaia, Error, TEXT("[容器网格] 容器不存在: %s"), *ContainerUID.ToString());
 		return;
 	}
 	
 	// 获取容器定义（获取SlotCount）
-	FGaiaContainerDefinition ContainerDef;
-	if (!UGaiaInventorySubsystem::GetContainerDefinition(Container.ContainerDefinitionID, ContainerDef))
+	const FGaiaContainerDefinition* ContainerDef = UGaiaInventoryReadModel::FindContainerDefinition(Container->ContainerDefinitionID);
+	if (!ContainerDef)
 	{
-		UE_LOG(LogGaia, Error, TEXT("[容器网格] 容器定义不存在: %s"), *Container.ContainerDefinitionID.ToString());
+		UE_LOG(LogGaia, Error, TEXT("[容器网格] 容器定义不存在: %s"), *Container->ContainerDefinitionID.ToString());
 		return;
 	}
 	
-	int32 MaxSlots = ContainerDef.SlotCount;
+	int32 MaxSlots = ContainerDef->GetSlotCount();
 	
 	// 检查Widget类
 	if (!ItemSlotWidgetClass)
@@ -1,11 +1,13 @@
 #include "GaiaContainerWindowWidget.h"
 #include "GaiaContainerGridWidget.h"
 #include "GaiaContainerDebugInfoWidget.h"
-#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "UI/GaiaUIManagerSubsystem.h"
 #include "Components/TextBlock.h"
 #include "Components/Button.h"
 #include "Components/Border.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
 #include "GaiaLogChannels.h"
 
 void UGaiaContainerWindowWidget::NativeConstruct()
@@ -19,17 +21,28 @@ void UGaiaContainerWindowWidget::NativeConstruct()
 	}
 }
 
+void UGaiaContainerWindowWidget::NativeDestruct()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(DebugRefreshTimerHandle);
+	}
+	
+	Super::NativeDestruct();
+}
+
 void UGaiaContainerWindowWidget::NativeOnActivated()
 {
 	Super::NativeOnActivated();
 	
 	UE_LOG(LogGaia, Verbose, TEXT("[容器窗口] 激活: %s"), *ContainerUID.ToString());
 	
-	// 窗口激活时刷新一次调试信息
+	// 窗口激活时刷新一次调试信息，并启动节流定时器
 	if (bDebugMode)
 	{
 		RefreshDebugInfo();
 	}
+	UpdateDebugRefreshTimer();
 }
 
 void UGaiaContainerWindowWidget::NativeOnDeactivated()
@@ -38,6 +51,9 @@ void UGaiaContainerWindowWidget::NativeOnDeactivated()
 	
 	Super::NativeOnDeactivated();
 	
+	// 停用后不再拉取调试信息
+	UpdateDebugRefreshTimer();
+	
 	// 通知 UIManager 从映射表移除窗口
 	UGaiaUIManagerSubsystem* UIManager = UGaiaUIManagerSubsystem::Get(this);
 	if (UIManager)
@@ -60,20 +76,16 @@ UWidget* UGaiaContainerWindowWidget::NativeGetDesiredFocusTarget() const
 void UGaiaContainerWindowWidget::InitializeWindow(const FGuid& InContainerUID)
 {
 	ContainerUID = InContainerUID;
+	LastDebugContentRevision = INDEX_NONE;
 
 	// 更新标题
 	if (Text_Title)
 	{
-		if (UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(GetWorld()))
+		if (UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this))
 		{
-			FGaiaContainerInstance Container;
-			if (InvSys->FindContainerByUID(ContainerUID, Container))
+			if (const FGaiaContainerInstance* Container = ReadModel->FindContainer(ContainerUID))
 			{
-				FString TitleText = Container.DebugDisplayName.IsEmpty()
-					? Container.ContainerDefinitionID.ToString()
-					: Container.DebugDisplayName;
-				
-				Text_Title->SetText(FText::FromString(TitleText));
+				Text_Title->SetText(FText::FromString(Container->GetDebugName()));
 			}
 		}
 	}
@@ -112,8 +124,11 @@ void UGaiaContainerWindowWidget::SetDebugMode(bool bEnabled)
 
 	if (bEnabled)
 	{
-		RefreshDebugInfo();
+		// 面板刚显示，立即刷新一次，之后交给节流定时器
+		UpdateDebugInfoNow();
 	}
+	
+	UpdateDebugRefreshTimer();
 }
 
 void UGaiaContainerWindowWidget::RefreshDebugInfo()
@@ -123,9 +138,72 @@ void UGaiaContainerWindowWidget::RefreshDebugInfo()
 		return;
 	}
 
-	if (UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(GetWorld()))
+	bDebugRefreshPending = true;
+}
+
+void UGaiaContainerWindowWidget::UpdateDebugRefreshTimer()
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+	
+	FTimerManager& TimerManager = World->GetTimerManager();
+	const bool bShouldRun = bDebugMode && DebugInfoPanel && IsActivated();
+	
+	if (!bShouldRun)
+	{
+		TimerManager.ClearTimer(DebugRefreshTimerHandle);
+		return;
+	}
+	
+	if (!TimerManager.IsTimerActive(DebugRefreshTimerHandle))
+	{
+		const float Interval = 1.0f / FMath::Max(DebugRefreshRateHz, 0.1f);
+		TimerManager.SetTimer(DebugRefreshTimerHandle, this, &UGaiaContainerWindowWidget::OnDebugRefreshTimer, Interval, true);
+	}
+}
+
+void UGaiaContainerWindowWidget::OnDebugRefreshTimer()
+{
+	// 窗口或面板不可见时跳过，不产生任何统计开销
+	if (!IsVisible() || !DebugInfoPanel || !DebugInfoPanel->IsVisible())
+	{
+		return;
+	}
+	
+	// 容器内容未变化且没有显式请求时跳过
+	if (!bDebugRefreshPending)
+	{
+		const UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+		const FGaiaContainerInstance* Container = ReadModel ? ReadModel->FindContainer(ContainerUID) : nullptr;
+		if (!Container || Container->ContentRevision == LastDebugContentRevision)
+		{
+			return;
+		}
+	}
+	
+	UpdateDebugInfoNow();
+}
+
+void UGaiaContainerWindowWidget::UpdateDebugInfoNow()
+{
+	bDebugRefreshPending = false;
+	
+	if (!bDebugMode || !DebugInfoPanel)
+	{
+		return;
+	}
+
+	if (UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this))
 	{
-		FContainerUIDebugInfo DebugInfo = InvSys->GetContainerDebugInfo(ContainerUID);
+		if (const FGaiaContainerInstance* Container = ReadModel->FindContainer(ContainerUID))
+		{
+			LastDebugContentRevision = Container->ContentRevision;
+		}
+		
+		FContainerUIDebugInfo DebugInfo = ReadModel->GetContainerDebugInfo(ContainerUID);
 		DebugInfoPanel->UpdateDebugInfo(DebugInfo);
 	}
 }
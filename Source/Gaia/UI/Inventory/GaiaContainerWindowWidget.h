@@ -32,6 +32,7 @@ class GAIAGAME_API UGaiaContainerWindowWidget : public UCommonActivatableWidget
 public:
 	//~ Begin UUserWidget Interface
 	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
 	//~ End UUserWidget Interface
 	
 	//~ Begin UCommonActivatableWidget Interface
@@ -81,7 +82,8 @@ public:
 	void SetDebugMode(bool bEnabled);
 
 	/**
-	 * 刷新调试信息
+	 * 请求刷新调试信息
+	 * 只做标记，实际拉取由节流定时器在面板可见时完成，可以随库存更新频繁调用
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Gaia|Inventory|UI")
 	void RefreshDebugInfo();
@@ -93,6 +95,16 @@ protected:
 	UFUNCTION()
 	void OnCloseButtonClicked();
 
+private:
+	/** 启动/停止调试信息节流定时器（仅在调试模式且窗口激活时运行） */
+	void UpdateDebugRefreshTimer();
+	
+	/** 节流定时器回调：面板可见且容器内容变化时才拉取统计 */
+	void OnDebugRefreshTimer();
+	
+	/** 立即拉取并刷新调试面板 */
+	void UpdateDebugInfoNow();
+
 protected:
 	/** 容器UID */
 	UPROPERTY(BlueprintReadOnly, Category = "Gaia|Inventory|UI")
@@ -102,6 +114,10 @@ protected:
 	UPROPERTY(BlueprintReadWrite, Category = "Gaia|Inventory|UI")
 	bool bDebugMode = false;
 
+	/** 调试信息最高刷新频率（次/秒） */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gaia|Inventory|UI", meta = (ClampMin = "0.1", UIMin = "0.5", UIMax = "30.0"))
+	float DebugRefreshRateHz = 4.0f;
+
 	// ========================================
 	// Widget绑定（需要在UMG中绑定）
 	// ========================================
@@ -125,5 +141,15 @@ protected:
 	/** 调试信息面板（可选） */
 	UPROPERTY(BlueprintReadWrite, meta = (BindWidgetOptional))
 	TObjectPtr<UGaiaContainerDebugInfoWidget> DebugInfoPanel;
+
+private:
+	/** 调试信息节流定时器 */
+	FTimerHandle DebugRefreshTimerHandle;
+	
+	/** 上次刷新时容器的内容修订号（INDEX_NONE 表示尚未刷新） */
+	int32 LastDebugContentRevision = INDEX_NONE;
+	
+	/** 是否有待处理的刷新请求 */
+	bool bDebugRefreshPending = false;
 };
 
@@ -2,10 +2,28 @@
 #include "Components/VerticalBox.h"
 #include "GaiaContextMenuButton.h"
 #include "Gameplay/Inventory/GaiaInventoryRPCComponent.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "UI/GaiaUIManagerSubsystem.h"
 #include "GaiaLogChannels.h"
 #include "GameFramework/PlayerController.h"
 
+void UGaiaItemContextMenu::NativeOnInitialized()
+{
+	Super::NativeOnInitialized();
+
+	// 预创建按钮，首次右键时不再分配
+	if (MenuItemsContainer && MenuItemButtonClass)
+	{
+		for (int32 Index = 0; Index < PrewarmButtonCount; ++Index)
+		{
+			if (UGaiaContextMenuButton* Button = GetOrCreatePooledButton(Index))
+			{
+				Button->SetVisibility(ESlateVisibility::Collapsed);
+			}
+		}
+	}
+}
+
 void UGaiaItemContextMenu::NativeConstruct()
 {
 	Super::NativeConstruct();
@@ -47,7 +65,18 @@ FReply UGaiaItemContextMenu::NativeOnFocusReceived(const FGeometry& InGeometry,
 void UGaiaItemContextMenu::InitializeMenu(const FGuid& InItemUID, const FGaiaItemDefinition& ItemDef)
 {
 	CurrentItemUID = InItemUID;
-	BuildMenuItems(ItemDef);
+
+	// 物品定义ID作为自定义菜单布局的缓存键
+	FName ItemDefID = NAME_None;
+	if (UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this))
+	{
+		if (const FGaiaItemInstance* Item = ReadModel->FindItem(InItemUID))
+		{
+			ItemDefID = Item->ItemDefinitionID;
+		}
+	}
+
+	BuildMenuItems(ItemDefID, ItemDef);
 }
 
 void UGaiaItemContextMenu::SetMenuPosition(FVector2D ScreenPosition)
@@ -61,7 +90,7 @@ void UGaiaItemContextMenu::CloseMenu()
 	DeactivateWidget();
 }
 
-void UGaiaItemContextMenu::BuildMenuItems(const FGaiaItemDefinition& ItemDef)
+void UGaiaItemContextMenu::BuildMenuItems(FName ItemDefID, const FGaiaItemDefinition& ItemDef)
 {
 	if (!MenuItemsContainer)
 	{
@@ -75,21 +104,101 @@ void UGaiaItemContextMenu::BuildMenuItems(const FGaiaItemDefinition& ItemDef)
 		return;
 	}
 
-	// 清空现有菜单项
-	MenuItemsContainer->ClearChildren();
+	const bool bIsCustom = ItemDef.ContextMenuType == EItemContextMenuType::Custom;
+	const FName LayoutDefID = bIsCustom ? ItemDefID : NAME_None;
+
+	// 布局未变化时只刷新启用状态
+	const bool bSameLayout = bLayoutValid
+		&& CurrentMenuType == ItemDef.ContextMenuType
+		&& CurrentLayoutDefID == LayoutDefID;
+
+	if (!bSameLayout)
+	{
+		if (bIsCustom && ItemDefID.IsNone())
+		{
+			// 无法确定定义ID时不缓存，直接使用定义中的菜单项
+			ApplyMenuLayout(ItemDef.CustomMenuItems);
+			bLayoutValid = false;
+		}
+		else
+		{
+			ApplyMenuLayout(bIsCustom ? GetCustomMenuItems(ItemDefID, ItemDef) : GetPredefinedMenuItems(ItemDef.ContextMenuType));
+			CurrentMenuType = ItemDef.ContextMenuType;
+			CurrentLayoutDefID = LayoutDefID;
+			bLayoutValid = true;
+		}
+	}
+
+	RefreshMenuItemStates();
+}
 
-	// 获取菜单项配置
-	TArray<FItemContextMenuItem> MenuItems;
-	if (ItemDef.ContextMenuType == EItemContextMenuType::Custom)
+const TArray<FItemContextMenuItem>& UGaiaItemContextMenu::GetPredefinedMenuItems(EItemContextMenuType MenuType)
+{
+	// 预定义菜单只构建一次
+	static const TArray<FItemContextMenuItem> PredefinedMenus[] =
 	{
-		MenuItems = ItemDef.CustomMenuItems;
+		// None
+		{},
+		// Consumable
+		{
+			{ EItemContextAction::Use, FText::FromString(TEXT("使用")), nullptr, true, NAME_None },
+			{ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None },
+			{ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None },
+		},
+		// Equipment
+		{
+			{ EItemContextAction::Equip, FText::FromString(TEXT("装备")), nullptr, true, NAME_None },
+			{ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None },
+			{ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None },
+		},
+		// Container
+		{
+			{ EItemContextAction::OpenContainer, FText::FromString(TEXT("打开")), nullptr, true, NAME_None },
+			{ EItemContextAction::EmptyContainer, FText::FromString(TEXT("清空")), nullptr, true, NAME_None },
+			{ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None },
+		},
+		// Material
+		{
+			{ EItemContextAction::Split, FText::FromString(TEXT("拆分")), nullptr, true, NAME_None },
+			{ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None },
+			{ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None },
+		},
+		// QuestItem
+		{
+			{ EItemContextAction::Inspect, FText::FromString(TEXT("查看详情")), nullptr, true, NAME_None },
+		},
+	};
+
+	const int32 Index = static_cast<int32>(MenuType);
+	if (Index < static_cast<int32>(UE_ARRAY_COUNT(PredefinedMenus)))
+	{
+		return PredefinedMenus[Index];
 	}
-	else
+	return PredefinedMenus[0];
+}
+
+const TArray<FItemContextMenuItem>& UGaiaItemContextMenu::GetCustomMenuItems(FName ItemDefID, const FGaiaItemDefinition& ItemDef)
+{
+	if (const TArray<FItemContextMenuItem>* Cached = CustomLayoutCache.Find(ItemDefID))
+	{
+		return *Cached;
+	}
+
+	// 首次使用时过滤禁用项并缓存
+	TArray<FItemContextMenuItem>& Layout = CustomLayoutCache.Add(ItemDefID);
+	for (const FItemContextMenuItem& MenuItem : ItemDef.CustomMenuItems)
 	{
-		MenuItems = GetPredefinedMenuItems(ItemDef.ContextMenuType);
+		if (MenuItem.bEnabled)
+		{
+			Layout.Add(MenuItem);
+		}
 	}
+	return Layout;
+}
 
-	// 创建菜单项按钮
+void UGaiaItemContextMenu::ApplyMenuLayout(const TArray<FItemContextMenuItem>& MenuItems)
+{
+	int32 ButtonIndex = 0;
 	for (const FItemContextMenuItem& MenuItem : MenuItems)
 	{
 		if (!MenuItem.bEnabled)
@@ -97,59 +206,82 @@ void UGaiaItemContextMenu::BuildMenuItems(const FGaiaItemDefinition& ItemDef)
 			continue;
 		}
 
-		UGaiaContextMenuButton* Button = CreateWidget<UGaiaContextMenuButton>(
-			GetOwningPlayer(), MenuItemButtonClass);
+		UGaiaContextMenuButton* Button = GetOrCreatePooledButton(ButtonIndex);
+		if (!Button)
+		{
+			break;
+		}
+
+		Button->SetMenuItemData(MenuItem);
+		Button->SetVisibility(ESlateVisibility::Visible);
+		++ButtonIndex;
+	}
 
-		if (Button)
+	// 隐藏多余的按钮（保留在池中）
+	for (int32 Index = ButtonIndex; Index < ActiveButtonCount; ++Index)
+	{
+		if (ButtonPool.IsValidIndex(Index) && ButtonPool[Index])
 		{
-			Button->SetMenuItemData(MenuItem);
-			// 绑定到我们的公开事件
-			Button->OnMenuButtonClicked.AddDynamic(this, &UGaiaItemContextMenu::OnMenuItemClicked);
-			MenuItemsContainer->AddChild(Button);
+			ButtonPool[Index]->SetVisibility(ESlateVisibility::Collapsed);
 		}
 	}
+
+	ActiveButtonCount = ButtonIndex;
 }
 
-TArray<FItemContextMenuItem> UGaiaItemContextMenu::GetPredefinedMenuItems(EItemContextMenuType MenuType) const
+void UGaiaItemContextMenu::RefreshMenuItemStates()
 {
-	TArray<FItemContextMenuItem> Items;
+	const UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	const FGaiaItemInstance* Item = ReadModel ? ReadModel->FindItem(CurrentItemUID) : nullptr;
 
-	switch (MenuType)
+	for (int32 Index = 0; Index < ActiveButtonCount; ++Index)
 	{
-	case EItemContextMenuType::Consumable:
-		Items.Add({ EItemContextAction::Use, FText::FromString(TEXT("使用")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None });
-		break;
+		UGaiaContextMenuButton* Button = ButtonPool[Index];
+		if (!Button)
+		{
+			continue;
+		}
 
-	case EItemContextMenuType::Equipment:
-		Items.Add({ EItemContextAction::Equip, FText::FromString(TEXT("装备")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None });
-		break;
+		bool bAvailable = true;
+		switch (Button->GetAction())
+		{
+		case EItemContextAction::Split:
+			bAvailable = Item && Item->Quantity > 1;
+			break;
 
-	case EItemContextMenuType::Container:
-		Items.Add({ EItemContextAction::OpenContainer, FText::FromString(TEXT("打开")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::EmptyContainer, FText::FromString(TEXT("清空")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None });
-		break;
+		case EItemContextAction::OpenContainer:
+		case EItemContextAction::EmptyContainer:
+			bAvailable = Item && Item->HasContainer();
+			break;
 
-	case EItemContextMenuType::Material:
-		Items.Add({ EItemContextAction::Split, FText::FromString(TEXT("拆分")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Drop, FText::FromString(TEXT("丢弃")), nullptr, true, NAME_None });
-		Items.Add({ EItemContextAction::Destroy, FText::FromString(TEXT("销毁")), nullptr, true, NAME_None });
-		break;
+		default:
+			break;
+		}
 
-	case EItemContextMenuType::QuestItem:
-		Items.Add({ EItemContextAction::Inspect, FText::FromString(TEXT("查看详情")), nullptr, true, NAME_None });
-		break;
+		Button->SetIsEnabled(bAvailable);
+	}
+}
 
-	case EItemContextMenuType::None:
-	default:
-		break;
+UGaiaContextMenuButton* UGaiaItemContextMenu::GetOrCreatePooledButton(int32 Index)
+{
+	if (ButtonPool.IsValidIndex(Index))
+	{
+		return ButtonPool[Index];
 	}
 
-	return Items;
+	check(Index == ButtonPool.Num());
+
+	UGaiaContextMenuButton* Button = CreateWidget<UGaiaContextMenuButton>(GetOwningPlayer(), MenuItemButtonClass);
+	if (!Button)
+	{
+		return nullptr;
+	}
+
+	// 按钮在池中常驻，只绑定一次
+	Button->OnMenuButtonClicked.AddUniqueDynamic(this, &UGaiaItemContextMenu::OnMenuItemClicked);
+	MenuItemsContainer->AddChild(Button);
+	ButtonPool.Add(Button);
+	return Button;
 }
 
 void UGaiaItemContextMenu::OnMenuItemClicked(UGaiaContextMenuButton* Button)
@@ -176,12 +308,30 @@ void UGaiaItemContextMenu::ExecuteMenuAction(EItemContextAction Action, FName Cu
 
 	case EItemContextAction::Equip:
 		UE_LOG(LogGaia, Log, TEXT("Equip item: %s"), *CurrentItemUID.ToString());
-		// TODO: 实现装备物品逻辑
+		if (RPCComp)
+		{
+			RPCComp->RequestEquipItem(CurrentItemUID);
+		}
 		break;
 
 	case EItemContextAction::Unequip:
 		UE_LOG(LogGaia, Log, TEXT("Unequip item: %s"), *CurrentItemUID.ToString());
-		// TODO: 实现卸下装备逻辑
+		if (RPCComp)
+		{
+			// 装备容器的槽位ID就是装备槽下标，放回第一个其他的自有容器
+			FGaiaItemInstance Item;
+			if (RPCComp->GetCachedItem(CurrentItemUID, Item) && Item.IsInContainer())
+			{
+				for (const FGuid& ContainerUID : RPCComp->GetOwnedContainerUIDs())
+				{
+					if (ContainerUID != Item.CurrentContainerUID)
+					{
+						RPCComp->RequestUnequipItem(Item.CurrentSlotID, ContainerUID);
+						break;
+					}
+				}
+			}
+		}
 		break;
 
 	case EItemContextAction::OpenContainer:
@@ -233,9 +383,9 @@ void UGaiaItemContextMenu::ExecuteMenuAction(EItemContextAction Action, FName Cu
 
 UGaiaInventoryRPCComponent* UGaiaItemContextMenu::GetRPCComponent() const
 {
-	if (APlayerController* PC = GetOwningPlayer())
+	if (UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this))
 	{
-		return PC->FindComponentByClass<UGaiaInventoryRPCComponent>();
+		return ReadModel->GetRPCComponent();
 	}
 	return nullptr;
 }
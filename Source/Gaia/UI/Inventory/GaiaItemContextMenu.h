@@ -15,6 +15,11 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnCustomMenuAction, FGuid, ItemUID
 /**
  * 物品右键菜单Widget
  * 显示物品的可用操作列表
+ *
+ * 池化设计：
+ * - 菜单实例由CommonUI Layer的Widget池复用，按钮由菜单内部的按钮池复用
+ * - 按钮布局按菜单类型（预定义）或物品定义（自定义）缓存，布局不变时不重建按钮
+ * - 每次打开只更新按钮的启用状态，不创建新的UObject
  */
 UCLASS()
 class GAIAGAME_API UGaiaItemContextMenu : public UCommonActivatableWidget
@@ -44,23 +49,49 @@ public:
 	void CloseMenu();
 
 protected:
+	virtual void NativeOnInitialized() override;
 	virtual void NativeConstruct() override;
 	virtual void NativeOnActivated() override;
 	virtual void NativeOnDeactivated() override;
 	virtual FReply NativeOnFocusReceived(const FGeometry& InGeometry, const FFocusEvent& InFocusEvent) override;
 
 	/**
-	 * 构建菜单项
+	 * 构建菜单项（布局与当前布局相同时只刷新启用状态）
+	 * @param ItemDefID 物品定义ID（自定义菜单的缓存键）
 	 * @param ItemDef 物品定义
 	 */
-	void BuildMenuItems(const FGaiaItemDefinition& ItemDef);
+	void BuildMenuItems(FName ItemDefID, const FGaiaItemDefinition& ItemDef);
 
 	/**
-	 * 获取预定义菜单项
+	 * 获取预定义菜单项（每种类型只构建一次）
 	 * @param MenuType 菜单类型
 	 * @return 菜单项列表
 	 */
-	TArray<FItemContextMenuItem> GetPredefinedMenuItems(EItemContextMenuType MenuType) const;
+	static const TArray<FItemContextMenuItem>& GetPredefinedMenuItems(EItemContextMenuType MenuType);
+
+	/**
+	 * 获取自定义菜单布局（按物品定义缓存，已过滤禁用项）
+	 * @param ItemDefID 物品定义ID
+	 * @param ItemDef 物品定义
+	 */
+	const TArray<FItemContextMenuItem>& GetCustomMenuItems(FName ItemDefID, const FGaiaItemDefinition& ItemDef);
+
+	/**
+	 * 将布局应用到按钮池（多余按钮折叠隐藏）
+	 * @param MenuItems 菜单项列表
+	 */
+	void ApplyMenuLayout(const TArray<FItemContextMenuItem>& MenuItems);
+
+	/**
+	 * 根据当前物品刷新按钮启用状态
+	 */
+	void RefreshMenuItemStates();
+
+	/**
+	 * 获取池中指定位置的按钮（不足时创建）
+	 * @param Index 按钮索引
+	 */
+	UGaiaContextMenuButton* GetOrCreatePooledButton(int32 Index);
 
 	/**
 	 * 处理菜单项点击
@@ -94,8 +125,32 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Gaia|UI")
 	TSubclassOf<UGaiaContextMenuButton> MenuItemButtonClass;
 
+	/** 初始化时预创建的按钮数量 */
+	UPROPERTY(EditDefaultsOnly, Category = "Gaia|UI", meta = (ClampMin = "0"))
+	int32 PrewarmButtonCount = 4;
+
 	/** 自定义操作事件 */
 	UPROPERTY(BlueprintAssignable, Category = "Gaia|UI")
 	FOnCustomMenuAction OnCustomAction;
+
+private:
+	/** 按钮池（常驻于MenuItemsContainer中，按需显示/隐藏） */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UGaiaContextMenuButton>> ButtonPool;
+
+	/** 自定义菜单布局缓存（物品定义ID -> 过滤后的菜单项） */
+	TMap<FName, TArray<FItemContextMenuItem>> CustomLayoutCache;
+
+	/** 当前布局对应的菜单类型 */
+	EItemContextMenuType CurrentMenuType = EItemContextMenuType::None;
+
+	/** 当前布局对应的物品定义ID（仅自定义菜单有效） */
+	FName CurrentLayoutDefID = NAME_None;
+
+	/** 当前布局是否有效 */
+	bool bLayoutValid = false;
+
+	/** 当前显示的按钮数量 */
+	int32 ActiveButtonCount = 0;
 };
 
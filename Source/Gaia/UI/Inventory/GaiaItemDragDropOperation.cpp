@@ -2,9 +2,10 @@
 
 #include "GaiaItemDragDropOperation.h"
 #include "GaiaItemSlotWidget.h"
-#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "Gameplay/Inventory/GaiaInventoryRPCComponent.h"
 #include "Player/GaiaPlayerController.h"
+#include "UI/GaiaUIManagerSubsystem.h"
 #include "GaiaLogChannels.h"
 
 UGaiaItemDragDropOperation* UGaiaItemDragDropOperation::CreateDragDropOperation(UGaiaItemSlotWidget* SourceSlot)
@@ -28,26 +29,28 @@ UGaiaItemDragDropOperation* UGaiaItemDragDropOperation::CreateDragDropOperation(
 	Operation->SourceSlotID = SourceSlot->GetSlotID();
 	Operation->ItemUID = SourceSlot->GetItemUID();
 	
-	// 获取物品信息
-	UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(SourceSlot->GetWorld());
-	if (InvSys)
+	// 获取物品信息（客户端只读模型）
+	if (UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(SourceSlot))
 	{
-		FGaiaItemInstance ItemInstance;
-		if (InvSys->FindItemByUID(Operation->ItemUID, ItemInstance))
+		if (const FGaiaItemInstance* ItemInstance = ReadModel->FindItem(Operation->ItemUID))
 		{
-			Operation->ItemDefinitionID = ItemInstance.ItemDefinitionID;
-			Operation->Quantity = ItemInstance.Quantity;
+			Operation->ItemDefinitionID = ItemInstance->ItemDefinitionID;
+			Operation->Quantity = ItemInstance->Quantity;
 		}
 	}
 	
+	// 预计算所有打开窗口中的拖放目标，悬停时只查表
+	Operation->RebuildDropTargets();
+	
 	// TODO: 创建拖放视觉Widget
 	// Operation->DefaultDragVisual = ...;
 	
-	UE_LOG(LogGaia, Log, TEXT("[拖放操作] 创建: Item=%s, Container=%s, Slot=%d, Qty=%d"),
+	UE_LOG(LogGaia, Log, TEXT("[拖放操作] 创建: Item=%s, Container=%s, Slot=%d, Qty=%d, 目标容器数=%d"),
 		*Operation->ItemUID.ToString(),
 		*Operation->SourceContainerUID.ToString(),
 		Operation->SourceSlotID,
-		Operation->Quantity);
+		Operation->Quantity,
+		Operation->DropTargets.Num());
 	
 	return Operation;
 }
@@ -89,41 +92,27 @@ bool UGaiaItemDragDropOperation::ExecuteDropToSlot(UGaiaItemSlotWidget* TargetSl
 		return false;
 	}
 	
-	// 判断操作类型
-	if (TargetSlot->IsEmpty())
+	// 按预计算结果分派（服务器会根据目标槽位自动路由，这里只区分日志）
+	switch (GetDropOutcome(TargetSlot))
 	{
+	case EGaiaDropOutcome::Move:
 		UE_LOG(LogGaia, Warning, TEXT("[拖放操作] → 移动到空槽位"));
-		// 移动到空槽位
 		return MoveItemToSlot(TargetSlot);
-	}
-	else if (TargetSlot->GetItemUID() == ItemUID)
-	{
-		// 同一个物品，不应该发生
-		UE_LOG(LogGaia, Warning, TEXT("[拖放操作] ❌ 尝试拖放到同一个物品实例"));
-		return false;
-	}
-	else
-	{
-		// 目标槽位有其他物品
-		// 检查是否可以堆叠
-		UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(TargetSlot->GetWorld());
-		if (InvSys)
-		{
-			FGaiaItemInstance TargetItem;
-			if (InvSys->FindItemByUID(TargetSlot->GetItemUID(), TargetItem))
-			{
-				if (TargetItem.ItemDefinitionID == ItemDefinitionID)
-				{
-					UE_LOG(LogGaia, Warning, TEXT("[拖放操作] → 堆叠物品"));
-					// 可以堆叠
-					return StackItemToSlot(TargetSlot);
-				}
-			}
-		}
 		
+	case EGaiaDropOutcome::Stack:
+		UE_LOG(LogGaia, Warning, TEXT("[拖放操作] → 堆叠物品"));
+		return StackItemToSlot(TargetSlot);
+		
+	case EGaiaDropOutcome::Nest:
+		UE_LOG(LogGaia, Warning, TEXT("[拖放操作] → 放入目标物品的容器"));
+		return SwapItemWithSlot(TargetSlot);
+		
+	case EGaiaDropOutcome::Swap:
 		UE_LOG(LogGaia, Warning, TEXT("[拖放操作] → 交换物品"));
-		// 不能堆叠，交换
 		return SwapItemWithSlot(TargetSlot);
+		
+	default:
+		return false;
 	}
 }
 
@@ -168,15 +157,76 @@ bool UGaiaItemDragDropOperation::CanDropToSlot(UGaiaItemSlotWidget* TargetSlot,
 		return false;
 	}
 	
-	// TODO: 添加更多检查
-	// - 容器权限检查
-	// - 物品类型限制检查
-	// - 槽位锁定检查
+	// 查表：类型限制、嵌套权限、循环引用、体积、堆叠上限已在拖拽开始时计算
+	if (const FGaiaDropTargetInfo* Info = FindDropTarget(TargetContainerUID, TargetSlotID))
+	{
+		if (!Info->IsValid())
+		{
+			OutErrorMessage = FText::FromString(Info->ErrorMessage);
+			return false;
+		}
+	}
+	
+	// TODO: 槽位锁定检查
 	
 	OutErrorMessage = FText::GetEmpty();
 	return true;
 }
 
+EGaiaDropOutcome UGaiaItemDragDropOperation::GetDropOutcome(UGaiaItemSlotWidget* TargetSlot) const
+{
+	if (!TargetSlot)
+	{
+		return EGaiaDropOutcome::Invalid;
+	}
+	
+	if (const FGaiaDropTargetInfo* Info = FindDropTarget(TargetSlot->GetContainerUID(), TargetSlot->GetSlotID()))
+	{
+		return Info->Outcome;
+	}
+	
+	// 不在预计算范围内（例如拖拽中途打开的窗口），按槽位状态交给服务器判定
+	if (TargetSlot->GetContainerUID() == SourceContainerUID && TargetSlot->GetSlotID() == SourceSlotID)
+	{
+		return EGaiaDropOutcome::Invalid;
+	}
+	return TargetSlot->IsEmpty() ? EGaiaDropOutcome::Move : EGaiaDropOutcome::Swap;
+}
+
+void UGaiaItemDragDropOperation::RebuildDropTargets()
+{
+	DropTargets.Reset();
+	
+	if (!SourceSlotWidget)
+	{
+		return;
+	}
+	
+	UGaiaUIManagerSubsystem* UIManager = UGaiaUIManagerSubsystem::Get(SourceSlotWidget);
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(SourceSlotWidget);
+	if (!UIManager || !ReadModel)
+	{
+		return;
+	}
+	
+	TArray<FGuid> TargetContainerUIDs = UIManager->GetOpenContainerUIDs();
+	TargetContainerUIDs.AddUnique(SourceContainerUID);
+	
+	ReadModel->BuildDropTargetMap(ItemUID, TargetContainerUIDs, DropTargets);
+}
+
+const FGaiaDropTargetInfo* UGaiaItemDragDropOperation::FindDropTarget(const FGuid& TargetContainerUID, int32 TargetSlotID) const
+{
+	const FGaiaContainerDropTargets* Targets = DropTargets.Find(TargetContainerUID);
+	if (!Targets || !Targets->Slots.IsValidIndex(TargetSlotID))
+	{
+		return nullptr;
+	}
+	
+	// 槽位ID与槽位索引一一对应（见 CreateContainerInstance）
+	return &Targets->Slots[TargetSlotID];
+}
+
 bool UGaiaItemDragDropOperation::MoveItemToSlot(UGaiaItemSlotWidget* TargetSlot)
 {
 	if (!TargetSlot || !TargetSlot->IsEmpty())
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/DragDropOperation.h"
+#include "Gameplay/Inventory/GaiaInventoryTypes.h"
 #include "GaiaItemDragDropOperation.generated.h"
 
 class UGaiaItemSlotWidget;
@@ -13,6 +14,7 @@ class UGaiaItemSlotWidget;
  * 
  * 职责：
  * - 存储拖放的物品信息
+ * - 拖拽开始时预计算所有打开窗口中的有效目标（悬停时只查表）
  * - 提供拖放视觉反馈
  * - 执行拖放完成后的操作
  */
@@ -66,6 +68,10 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Gaia|UI|DragDrop")
 	int32 SplitQuantity = 0;
 
+	/** 预计算的拖放目标（ContainerUID -> 各槽位结果），拖拽开始时生成 */
+	UPROPERTY(BlueprintReadOnly, Category = "Gaia|UI|DragDrop")
+	TMap<FGuid, FGaiaContainerDropTargets> DropTargets;
+
 	// ========================================
 	// 拖放操作
 	// ========================================
@@ -101,7 +107,27 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Gaia|UI|DragDrop")
 	bool CanDropToSlot(UGaiaItemSlotWidget* TargetSlot, FText& OutErrorMessage) const;
 
+	/**
+	 * 获取拖放到指定槽位的预期结果（查表，不做任何规则计算）
+	 * @param TargetSlot 目标槽位Widget
+	 * @return 预期结果（移动/堆叠/交换/嵌套/无效）
+	 */
+	UFUNCTION(BlueprintPure, Category = "Gaia|UI|DragDrop")
+	EGaiaDropOutcome GetDropOutcome(UGaiaItemSlotWidget* TargetSlot) const;
+
+	/**
+	 * 重新计算拖放目标（拖拽过程中打开了新窗口时调用）
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gaia|UI|DragDrop")
+	void RebuildDropTargets();
+
 protected:
+	/**
+	 * 查找目标槽位的预计算结果
+	 * @return 不在任何打开窗口中时返回nullptr
+	 */
+	const FGaiaDropTargetInfo* FindDropTarget(const FGuid& TargetContainerUID, int32 TargetSlotID) const;
+
 	/**
 	 * 移动物品到目标槽位
 	 */
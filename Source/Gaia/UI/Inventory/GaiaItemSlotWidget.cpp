@@ -3,8 +3,7 @@
 #include "GaiaItemSlotWidget.h"
 #include "GaiaItemDragDropOperation.h"
 #include "GaiaItemContextMenu.h"
-#include "Gameplay/Inventory/GaiaInventorySubsystem.h"
-#include "Gameplay/Inventory/GaiaInventoryRPCComponent.h"
+#include "Gameplay/Inventory/GaiaInventoryReadModel.h"
 #include "UI/GaiaUIManagerSubsystem.h"
 #include "Components/Image.h"
 #include "Components/TextBlock.h"
@@ -216,26 +215,18 @@ void UGaiaItemSlotWidget::RefreshSlot()
 		return;
 	}
 	
-	// 获取 RPC 组件（客户端使用缓存数据）
-	APlayerController* PC = GetOwningPlayer();
-	if (!PC)
+	// 获取客户端只读模型
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	if (!ReadModel)
 	{
-		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法获取 PlayerController"));
+		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法获取库存只读模型"));
 		SetEmpty();
 		return;
 	}
 	
-	UGaiaInventoryRPCComponent* RPCComp = PC->FindComponentByClass<UGaiaInventoryRPCComponent>();
-	if (!RPCComp)
-	{
-		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法获取 RPC 组件"));
-		SetEmpty();
-		return;
-	}
-	
-	// 从 RPC 组件的缓存中获取容器数据
-	FGaiaContainerInstance Container;
-	if (!RPCComp->GetCachedContainer(ContainerUID, Container))
+	// 从缓存中获取容器数据
+	const FGaiaContainerInstance* Container = ReadModel->FindContainer(ContainerUID);
+	if (!Container)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 容器不存在于缓存: %s"), *ContainerUID.ToString());
 		SetEmpty();
@@ -243,19 +234,19 @@ void UGaiaItemSlotWidget::RefreshSlot()
 	}
 	
 	UE_LOG(LogGaia, Log, TEXT("[物品槽位] RefreshSlot: Container=%s, SlotID=%d, TotalSlots=%d"),
-		*ContainerUID.ToString(), SlotID, Container.Slots.Num());
+		*ContainerUID.ToString(), SlotID, Container->Slots.Num());
 	
 	// 查找槽位
-	int32 SlotIndex = Container.GetSlotIndexByID(SlotID);
-	if (SlotIndex == INDEX_NONE || SlotIndex >= Container.Slots.Num())
+	int32 SlotIndex = Container->GetSlotIndexByID(SlotID);
+	if (SlotIndex == INDEX_NONE || SlotIndex >= Container->Slots.Num())
 	{
 		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 槽位索引无效: SlotID=%d, SlotIndex=%d, TotalSlots=%d"),
-			SlotID, SlotIndex, Container.Slots.Num());
+			SlotID, SlotIndex, Container->Slots.Num());
 		SetEmpty();
 		return;
 	}
 	
-	const FGaiaSlotInfo& SlotInfo = Container.Slots[SlotIndex];
+	const FGaiaSlotInfo& SlotInfo = Container->Slots[SlotIndex];
 	
 	UE_LOG(LogGaia, Log, TEXT("[物品槽位] 槽位信息: SlotID=%d, ItemUID=%s, IsEmpty=%d"),
 		SlotInfo.SlotID, *SlotInfo.ItemInstanceUID.ToString(), !SlotInfo.ItemInstanceUID.IsValid());
@@ -268,9 +259,9 @@ void UGaiaItemSlotWidget::RefreshSlot()
 		return;
 	}
 	
-	// 从 RPC 组件的缓存中获取物品数据
-	FGaiaItemInstance ItemInstance;
-	if (!RPCComp->GetCachedItem(SlotInfo.ItemInstanceUID, ItemInstance))
+	// 从缓存中获取物品数据
+	const FGaiaItemInstance* ItemInstance = ReadModel->FindItem(SlotInfo.ItemInstanceUID);
+	if (!ItemInstance)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 物品不存在于缓存: %s"), *SlotInfo.ItemInstanceUID.ToString());
 		SetEmpty();
@@ -278,10 +269,10 @@ void UGaiaItemSlotWidget::RefreshSlot()
 	}
 	
 	UE_LOG(LogGaia, Log, TEXT("[物品槽位] 找到物品: UID=%s, Def=%s, Qty=%d"),
-		*ItemInstance.InstanceUID.ToString(), *ItemInstance.ItemDefinitionID.ToString(), ItemInstance.Quantity);
+		*ItemInstance->InstanceUID.ToString(), *ItemInstance->ItemDefinitionID.ToString(), ItemInstance->Quantity);
 	
 	// 设置槽位数据
-	SetSlotData(ItemInstance);
+	SetSlotData(*ItemInstance);
 }
 
 void UGaiaItemSlotWidget::SetEmpty()
@@ -316,28 +307,23 @@ void UGaiaItemSlotWidget::SetSlotData(const FGaiaItemInstance& ItemInstance)
 	ItemDefinitionID = ItemInstance.ItemDefinitionID;
 	Quantity = ItemInstance.Quantity;
 	
-	// 获取物品定义
-	UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(GetWorld());
-	if (InvSys)
+	// 获取物品定义（定义缓存指针，不拷贝）
+	if (const FGaiaItemDefinition* ItemDef = UGaiaInventoryReadModel::FindItemDefinition(ItemDefinitionID))
 	{
-		FGaiaItemDefinition ItemDef;
-		if (UGaiaInventorySubsystem::GetItemDefinition(ItemDefinitionID, ItemDef))
+		// 加载图标
+		LoadItemIcon(*ItemDef);
+		
+		// 更新数量文本
+		if (Text_Quantity)
 		{
-			// 加载图标
-			LoadItemIcon(ItemDef);
-			
-			// 更新数量文本
-			if (Text_Quantity)
+			if (Quantity > 1)
+			{
+				Text_Quantity->SetText(FText::AsNumber(Quantity));
+				Text_Quantity->SetVisibility(ESlateVisibility::Visible);
+			}
+			else
 			{
-				if (Quantity > 1)
-				{
-					Text_Quantity->SetText(FText::AsNumber(Quantity));
-					Text_Quantity->SetVisibility(ESlateVisibility::Visible);
-				}
-				else
-				{
-					Text_Quantity->SetVisibility(ESlateVisibility::Collapsed);
-				}
+				Text_Quantity->SetVisibility(ESlateVisibility::Collapsed);
 			}
 		}
 	}
@@ -496,16 +482,17 @@ void UGaiaItemSlotWidget::ShowContextMenu(FVector2D ScreenPosition)
 		return;
 	}
 
-	// 获取物品定义
-	FGaiaItemDefinition ItemDef;
-	if (!GetItemDefinition(ItemDef))
+	// 获取物品定义（定义缓存指针，不拷贝）
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	const FGaiaItemDefinition* ItemDef = ReadModel ? ReadModel->FindItemDefinitionForItem(ItemUID) : nullptr;
+	if (!ItemDef)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("[右键菜单] 无法获取物品定义"));
 		return;
 	}
 
 	// 检查菜单类型 - 如果是None则不显示菜单
-	if (ItemDef.ContextMenuType == EItemContextMenuType::None)
+	if (ItemDef->ContextMenuType == EItemContextMenuType::None)
 	{
 		UE_LOG(LogGaia, Log, TEXT("[右键菜单] 物品菜单类型为None，不显示菜单: %s"), *ItemDefinitionID.ToString());
 		return;
@@ -526,32 +513,11 @@ void UGaiaItemSlotWidget::ShowContextMenu(FVector2D ScreenPosition)
 		return;
 	}
 
-	// 捕获变量用于Lambda
-	FGuid CapturedItemUID = ItemUID;
-	FGaiaItemDefinition CapturedItemDef = ItemDef;
-	FVector2D CapturedScreenPos = ScreenPosition;
-
-	UE_LOG(LogGaia, Log, TEXT("[右键菜单] 使用CommonUI方式创建菜单..."));
-
-	// 使用CommonUI的正确方式：让Layer创建Widget，在回调中初始化
-	UGaiaItemContextMenu* ContextMenu = UIManager->PushWidgetToLayerWithInit<UGaiaItemContextMenu>(
-		FGameplayTag::RequestGameplayTag(TEXT("UI.Layer.Menu")),
-		ContextMenuClass,
-		[CapturedItemUID, CapturedItemDef, CapturedScreenPos](UGaiaItemContextMenu& Menu)
-		{
-			// 在Widget创建后、激活前初始化
-			Menu.InitializeMenu(CapturedItemUID, CapturedItemDef);
-			Menu.SetMenuPosition(CapturedScreenPos);
-		}
-	);
-
-	if (ContextMenu)
-	{
-		UE_LOG(LogGaia, Log, TEXT("[右键菜单] 菜单创建并推送成功"));
-	}
-	else
+	// 由UIManager复用已打开的菜单或从Layer的Widget池中取出
+	UGaiaItemContextMenu* ContextMenu = UIManager->ShowItemContextMenu(ContextMenuClass, ItemUID, *ItemDef, ScreenPosition);
+	if (!ContextMenu)
 	{
-		UE_LOG(LogGaia, Error, TEXT("[右键菜单] 菜单创建失败"));
+		UE_LOG(LogGaia, Error, TEXT("[右键菜单] 菜单显示失败"));
 	}
 }
 
@@ -562,30 +528,32 @@ bool UGaiaItemSlotWidget::GetItemDefinition(FGaiaItemDefinition& OutItemDef) con
 		return false;
 	}
 
-	// 从库存子系统获取物品
-	UGaiaInventorySubsystem* InvSys = UGaiaInventorySubsystem::Get(GetWorld());
-	if (!InvSys)
+	// 从客户端只读模型获取物品
+	UGaiaInventoryReadModel* ReadModel = UGaiaInventoryReadModel::Get(this);
+	if (!ReadModel)
 	{
-		UE_LOG(LogGaia, Error, TEXT("[物品槽位] 无法获取 InventorySubsystem"));
+		UE_LOG(LogGaia, Error, TEXT("[物品槽位] 无法获取库存只读模型"));
 		return false;
 	}
 
-	FGaiaItemInstance Item;
-	if (!InvSys->FindItemByUID(ItemUID, Item))
+	const FGaiaItemInstance* Item = ReadModel->FindItem(ItemUID);
+	if (!Item)
 	{
 		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法找到物品: %s"), *ItemUID.ToString());
 		return false;
 	}
 
 	// 获取物品定义
-	if (!UGaiaInventorySubsystem::GetItemDefinition(Item.ItemDefinitionID, OutItemDef))
+	const FGaiaItemDefinition* ItemDef = UGaiaInventoryReadModel::FindItemDefinition(Item->ItemDefinitionID);
+	if (!ItemDef)
 	{
-		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法获取物品定义: %s"), *Item.ItemDefinitionID.ToString());
+		UE_LOG(LogGaia, Warning, TEXT("[物品槽位] 无法获取物品定义: %s"), *Item->ItemDefinitionID.ToString());
 		return false;
 	}
+	OutItemDef = *ItemDef;
 
 	UE_LOG(LogGaia, Verbose, TEXT("[物品槽位] 成功获取物品定义: %s, MenuType=%d"),
-		*Item.ItemDefinitionID.ToString(), (int32)OutItemDef.ContextMenuType);
+		*Item->ItemDefinitionID.ToString(), (int32)OutItemDef.ContextMenuType);
 
 	return true;
 }
@@ -0,0 +1,18 @@
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class GaiaServerTarget : TargetRules
+{
+	public GaiaServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		
+		// 读取 Config/Custom/Server 下的覆盖配置（不扫描数据注册表，定义由定义数据库提供）
+		CustomConfig = "Server";
+		
+		ExtraModuleNames.AddRange(new string[] { "GaiaGame" });
+		
+		DefaultBuildSettings = BuildSettingsVersion.V5;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_6;
+	}
+}